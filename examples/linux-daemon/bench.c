@@ -0,0 +1,388 @@
+/**
+ * minimr - mini mDNS Responder (framework)
+ *
+ * https://github.com/tschiemer/minimr
+ *
+ * MIT License
+ *
+ * Copyright (c) 2020 Philip Tschiemer, filou.se
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/**
+ * Loopback benchmark: keeps a window of (unicast) queries outstanding against a responder and reports responses/sec
+ * and response latencies. Queries are sent from an ephemeral port, ie the responder answers by unicast.
+ * Multiple clients (-c) each use their own thread and socket, ie distinct flows (as distributed among the workers of a
+ * responder using SO_REUSEPORT).
+ */
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <getopt.h>
+#include <poll.h>
+#include <time.h>
+#include <pthread.h>
+
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+#include "minimr.h"
+
+#define MAX_WINDOW      4096
+#define MAX_CLIENTS     64
+
+// latency histogram with microsecond resolution (and an overflow bucket)
+#define HIST_SIZE       100000
+
+#define MSG_MAXLEN      1500
+
+struct client {
+    pthread_t thread;
+    int fd;
+
+    uint64_t sent_at[UINT16_MAX + 1];
+    uint32_t hist[HIST_SIZE + 1];
+
+    uint8_t queries[MAX_WINDOW][MSG_MAXLEN];
+    uint8_t responses[MAX_WINDOW][MSG_MAXLEN];
+
+    struct mmsghdr msgs[MAX_WINDOW];
+    struct iovec iov[MAX_WINDOW];
+
+    uint64_t count;
+    uint64_t lost;
+    int error;
+};
+
+static unsigned int duration = 5;
+static unsigned int window = 64;
+
+static uint8_t query[MSG_MAXLEN];
+static uint16_t querylen = 0;
+
+static uint32_t hist[HIST_SIZE + 1];
+
+static void print_help(char * argv[])
+{
+    printf("Usage: %s [-h] [-a <ipv4>] [-p <port>] [-d <sec>] [-w <window>] [-c <clients>] [-t <qtype>] [<qname>]\n", argv[0]);
+    printf("Sends queries (default: A %s) to responder and reports responses/sec and latencies\n", MINIMR_SIMPLE_HOSTNAME);
+    printf("\t -a <ipv4> \t Address of responder (default 127.0.0.1)\n");
+    printf("\t -p <port> \t Port of responder (default %d)\n", MINIMR_DNS_PORT);
+    printf("\t -d <sec> \t Duration (default 5)\n");
+    printf("\t -w <window> \t Outstanding queries per client (default 64, max %d)\n", MAX_WINDOW);
+    printf("\t -c <clients> \t Clients (threads with their own socket, default 1, max %d)\n", MAX_CLIENTS);
+    printf("\t -t <qtype> \t Numeric query type (default 1 = A)\n");
+    printf("\n");
+    printf("qname must be formatted as follows: .segment1.segment2. etc .tld\n");
+    printf("\n");
+    printf("Copyfright 2020 filou.se, MIT License\n");
+    printf("~~ LONG LIVE KITTENS ~~\n");
+}
+
+static uint64_t now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static uint32_t percentile(uint64_t count, double p)
+{
+    uint64_t n = 0;
+    uint64_t target = (uint64_t)(count * p);
+
+    for(uint32_t i = 0; i <= HIST_SIZE; i++){
+        n += hist[i];
+        if (n > target){
+            return i;
+        }
+    }
+    return HIST_SIZE;
+}
+
+/**
+ * Keeps window queries outstanding for the given duration
+ */
+static void * client_run(void * arg)
+{
+    struct client * c = arg;
+
+    for(unsigned int i = 0; i < window; i++){
+        memcpy(c->queries[i], query, querylen);
+    }
+
+    uint16_t tid = 0;
+    unsigned int outstanding = 0;
+
+    uint64_t end = now_ns() + duration * 1000000000ULL;
+
+    while (now_ns() < end){
+
+        // fill window
+        unsigned int n = window - outstanding;
+
+        for(unsigned int i = 0; i < n; i++){
+            tid++;
+            if (tid == 0){
+                tid = 1;
+            }
+            c->queries[i][0] = tid >> 8;
+            c->queries[i][1] = tid & 0xff;
+
+            c->iov[i].iov_base = c->queries[i];
+            c->iov[i].iov_len = querylen;
+            c->msgs[i].msg_hdr.msg_iov = &c->iov[i];
+            c->msgs[i].msg_hdr.msg_iovlen = 1;
+
+            c->sent_at[tid] = now_ns();
+        }
+
+        for(unsigned int sent = 0; sent < n; ){
+            int res = sendmmsg(c->fd, &c->msgs[sent], n - sent, 0);
+            if (res == -1){
+                if (errno == EAGAIN || errno == EINTR){
+                    continue;
+                }
+                perror("sendmmsg");
+                c->error = 1;
+                return NULL;
+            }
+            sent += res;
+        }
+
+        outstanding += n;
+
+        // collect responses
+        struct pollfd pfd = {
+            .fd = c->fd,
+            .events = POLLIN
+        };
+
+        if (poll(&pfd, 1, 100) == 0){
+            // consider outstanding queries lost
+            c->lost += outstanding;
+            outstanding = 0;
+            memset(c->sent_at, 0, sizeof(c->sent_at));
+            continue;
+        }
+
+        for(unsigned int i = 0; i < window; i++){
+            c->iov[i].iov_base = c->responses[i];
+            c->iov[i].iov_len = MSG_MAXLEN;
+            c->msgs[i].msg_hdr.msg_iov = &c->iov[i];
+            c->msgs[i].msg_hdr.msg_iovlen = 1;
+        }
+
+        int res = recvmmsg(c->fd, c->msgs, window, MSG_DONTWAIT, NULL);
+
+        if (res == -1){
+            if (errno == EAGAIN || errno == EINTR){
+                continue;
+            }
+            // ex. responder not running
+            perror("recvmmsg");
+            c->error = 1;
+            return NULL;
+        }
+
+        uint64_t now = now_ns();
+
+        for(int i = 0; i < res; i++){
+            if (c->msgs[i].msg_len < MINIMR_DNS_HDR_SIZE){
+                continue;
+            }
+
+            uint16_t rtid = (c->responses[i][0] << 8) | c->responses[i][1];
+
+            if (c->sent_at[rtid] == 0){
+                continue;
+            }
+
+            uint64_t usec = (now - c->sent_at[rtid]) / 1000;
+
+            c->hist[usec < HIST_SIZE ? usec : HIST_SIZE]++;
+
+            c->sent_at[rtid] = 0;
+            outstanding--;
+            c->count++;
+        }
+    }
+
+    return NULL;
+}
+
+int main(int argc, char * argv[])
+{
+    int opt;
+
+    const char * address = "127.0.0.1";
+    uint16_t port = MINIMR_DNS_PORT;
+    unsigned int nclients = 1;
+    uint16_t qtype = MINIMR_DNS_TYPE_A;
+    uint8_t qname[256] = MINIMR_SIMPLE_HOSTNAME;
+
+    while ((opt = getopt(argc, argv, "ha:p:d:w:c:t:")) != -1) {
+        switch (opt) {
+            case 'h':
+            case '?':
+                print_help(argv);
+                return EXIT_SUCCESS;
+
+            case 'a':
+                address = optarg;
+                break;
+
+            case 'p':
+                port = atoi(optarg);
+                break;
+
+            case 'd':
+                duration = atoi(optarg);
+                break;
+
+            case 'w':
+                window = atoi(optarg);
+                if (window < 1 || window > MAX_WINDOW){
+                    fprintf(stderr, "ERROR window must be 1 - %d\n", MAX_WINDOW);
+                    return EXIT_FAILURE;
+                }
+                break;
+
+            case 'c':
+                nclients = atoi(optarg);
+                if (nclients < 1 || nclients > MAX_CLIENTS){
+                    fprintf(stderr, "ERROR clients must be 1 - %d\n", MAX_CLIENTS);
+                    return EXIT_FAILURE;
+                }
+                break;
+
+            case 't':
+                qtype = atoi(optarg);
+                break;
+
+            default:
+                fprintf(stderr, "ERROR unrecognized option\n");
+                print_help(argv);
+                return EXIT_FAILURE;
+        }
+    }
+
+    if (optind < argc){
+        if (strlen(argv[optind]) >= sizeof(qname)){
+            fprintf(stderr, "ERROR qname too long\n");
+            return EXIT_FAILURE;
+        }
+        strcpy((char *)qname, argv[optind]);
+    }
+
+    minimr_name_normalize(qname, NULL);
+
+    struct minimr_query q = {
+        .type = qtype,
+        .unicast_class = MINIMR_DNS_CLASS_IN,
+        .name = qname
+    };
+
+    if (minimr_make_msg(0, 0, 0, &q, 1, NULL, 0, NULL, 0, NULL, 0, query, &querylen, MSG_MAXLEN, NULL) != MINIMR_OK){
+        fprintf(stderr, "ERROR failed to generate query\n");
+        return EXIT_FAILURE;
+    }
+
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+
+    if (inet_pton(AF_INET, address, &addr.sin_addr) != 1){
+        fprintf(stderr, "ERROR invalid address: %s\n", address);
+        return EXIT_FAILURE;
+    }
+
+    struct client * clients[MAX_CLIENTS];
+
+    for(unsigned int i = 0; i < nclients; i++){
+
+        clients[i] = calloc(1, sizeof(struct client));
+
+        if (clients[i] == NULL){
+            perror("calloc");
+            return EXIT_FAILURE;
+        }
+
+        clients[i]->fd = socket(AF_INET, SOCK_DGRAM | SOCK_NONBLOCK, 0);
+
+        if (clients[i]->fd == -1 || connect(clients[i]->fd, (struct sockaddr *)&addr, sizeof(addr)) == -1){
+            perror("socket");
+            return EXIT_FAILURE;
+        }
+    }
+
+    uint64_t start = now_ns();
+
+    for(unsigned int i = 0; i < nclients; i++){
+        if (pthread_create(&clients[i]->thread, NULL, client_run, clients[i])){
+            fprintf(stderr, "ERROR failed to start client %u\n", i);
+            return EXIT_FAILURE;
+        }
+    }
+
+    uint64_t count = 0, lost = 0;
+    int error = 0;
+
+    for(unsigned int i = 0; i < nclients; i++){
+        pthread_join(clients[i]->thread, NULL);
+
+        count += clients[i]->count;
+        lost += clients[i]->lost;
+        error |= clients[i]->error;
+
+        for(uint32_t j = 0; j <= HIST_SIZE; j++){
+            hist[j] += clients[i]->hist[j];
+        }
+
+        close(clients[i]->fd);
+        free(clients[i]);
+    }
+
+    double sec = (now_ns() - start) / 1e9;
+
+    if (error){
+        return EXIT_FAILURE;
+    }
+
+    if (count == 0){
+        printf("no responses (%llu lost)\n", (unsigned long long)lost);
+        return EXIT_FAILURE;
+    }
+
+    printf("%llu responses in %.3f sec: %.0f responses/sec, latency p50 %u us, p99 %u us, p99.9 %u us (%llu lost)\n",
+           (unsigned long long)count, sec, count / sec,
+           percentile(count, 0.5), percentile(count, 0.99), percentile(count, 0.999),
+           (unsigned long long)lost
+    );
+
+    return EXIT_SUCCESS;
+}
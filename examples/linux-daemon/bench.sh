@@ -0,0 +1,26 @@
+#!/bin/sh
+#
+# Loopback benchmark of the daemon's I/O backends (responding only, to unicast queries on lo)
+#
+# Usage: bench.sh [<build-dir> [<seconds> [<window> [<workers> [<clients>]]]]]
+#
+# With multiple workers use (at least) as many clients, as the kernel distributes the queries among the workers by flow.
+
+BIN=${1:-build}
+SEC=${2:-5}
+WINDOW=${3:-64}
+WORKERS=${4:-1}
+CLIENTS=${5:-$WORKERS}
+PORT=15353
+
+for BACKEND in epoll uring; do
+    "$BIN/minimr-linux-daemon" -b $BACKEND -w $WORKERS -r -i lo -p $PORT > /dev/null &
+    PID=$!
+    sleep 0.5
+
+    printf "%-6s " $BACKEND
+    "$BIN/minimr-linux-bench" -p $PORT -d $SEC -w $WINDOW -c $CLIENTS
+
+    kill -INT $PID
+    wait $PID
+done
@@ -0,0 +1,175 @@
+/**
+ * minimr - mini mDNS Responder (framework)
+ *
+ * https://github.com/tschiemer/minimr
+ *
+ * MIT License
+ *
+ * Copyright (c) 2020 Philip Tschiemer, filou.se
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef MINIMR_LINUX_DAEMON_H
+#define MINIMR_LINUX_DAEMON_H
+
+#include <time.h>
+#include <pthread.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+
+// mdns responder
+#include "minimrsimple.h"
+
+#include "snapshot.h"
+
+#define MAX_IFACES      16
+#define MAX_WORKERS     64
+
+// messages per recvmmsg/sendmmsg call
+#define BATCH_SIZE      32
+
+// see https://tools.ietf.org/html/rfc6762#section-17
+#define RX_MAXLEN       9000
+#define TX_MAXLEN       1500
+
+#define NQSTATS         16
+
+typedef enum {
+    sock_ipv4,
+    sock_ipv6,
+    sock_count
+} sock_t;
+
+typedef enum {
+    timer_none,
+    timer_start,
+    timer_probe,
+    timer_announce
+} timer_event_t;
+
+union cmsg_buf {
+    uint8_t buf[CMSG_SPACE(sizeof(struct in6_pktinfo))];
+    struct cmsghdr align;
+};
+
+struct batch {
+    struct mmsghdr msgs[BATCH_SIZE];
+    struct iovec iov[BATCH_SIZE];
+    struct sockaddr_storage addr[BATCH_SIZE];
+    union cmsg_buf ctrl[BATCH_SIZE];
+    unsigned int count;
+};
+
+struct stats {
+    unsigned long long rx_packets;
+    unsigned long long rx_bytes;
+    unsigned long long rx_calls;
+    unsigned long long tx_packets;
+    unsigned long long tx_bytes;
+    unsigned long long tx_calls;
+    unsigned long long tx_errors;
+};
+
+struct config {
+    unsigned int ifindex[MAX_IFACES];
+    unsigned int nifaces;
+
+    unsigned int backend;
+    unsigned int nworkers;
+
+    uint16_t port;
+    uint16_t ttl;
+    uint8_t probe;
+    uint8_t respond_only;
+    uint8_t verbose;
+};
+
+/**
+ * Worker: has its own sockets (bound with SO_REUSEPORT to the same port) and batches and answers from the shared
+ * record snapshot. Worker 0 (the main thread) additionally drives the FSM, ie handles the timer and signals.
+ */
+struct worker {
+    unsigned int id;
+    pthread_t thread;
+
+    int sock[sock_count];
+
+    struct batch rx;
+    uint8_t rx_data[BATCH_SIZE][RX_MAXLEN];
+
+    struct batch tx[sock_count];
+    uint8_t tx_data[sock_count][BATCH_SIZE][TX_MAXLEN];
+
+    struct minimr_query_stat qstats[NQSTATS];
+
+    struct stats stats;
+
+    /**
+     * Sends (and empties) outgoing batch of socket, set by the I/O backend
+     */
+    void (*tx_flush)(struct worker * w, sock_t s);
+};
+
+extern struct config cfg;
+
+extern int timer_fd;
+extern int signal_fd;
+extern int stop_fd;
+extern volatile int running;
+
+void tx_flush_all(struct worker * w);
+
+/**
+ * Processes an incoming message (from interface ifindex), the response (if any) is added to the outgoing batch
+ * @param multicast     message was sent to the mDNS group, ie all workers receive it
+ */
+void rx_process(struct worker * w, sock_t s, uint8_t * msg, uint16_t msglen, struct sockaddr_storage * src, unsigned int ifindex, uint8_t multicast);
+
+/**
+ * Returns receiving interface (and whether the destination was a multicast address) of message
+ */
+unsigned int rx_ifindex(struct msghdr * hdr, uint8_t * multicast);
+
+int iface_selected(unsigned int ifindex);
+
+/**
+ * Handlers of the timer and signal file descriptor (to be called by worker 0 when readable)
+ */
+void timer_expired(struct worker * w);
+void signal_received(struct worker * w);
+
+/**
+ * Drives the FSM (if required) and publishes record changes, to be called by worker 0 after handling any events
+ */
+void process(struct worker * w);
+
+
+/************* I/O backends **************/
+
+/**
+ * Runs event loop of worker until stopped
+ * @return 0 on success
+ * @return -1 if the backend is not supported (before any message was processed)
+ */
+int epoll_run(struct worker * w);
+
+int uring_run(struct worker * w);
+
+#endif //MINIMR_LINUX_DAEMON_H
@@ -0,0 +1,1145 @@
+/**
+ * minimr - mini mDNS Responder (framework)
+ *
+ * https://github.com/tschiemer/minimr
+ *
+ * MIT License
+ *
+ * Copyright (c) 2020 Philip Tschiemer, filou.se
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/**
+ * Linux reference daemon: joins the mDNS groups on the selected interfaces and drains its (IPv4 and IPv6) sockets
+ * in batches (recvmmsg), responses of a batch are flushed at once (sendmmsg).
+ * Alternatively the io_uring backend (uring.c) is used, if supported.
+ *
+ * With multiple workers (-w) each worker thread has its own sockets bound with SO_REUSEPORT: the kernel distributes
+ * unicast queries (by flow) but delivers multicast queries to every socket, of which only one worker (by hash of the
+ * querier's address and port) responds. Workers answer from an immutable snapshot of the record set (snapshot.c)
+ * which is republished by worker 0 (running the FSM) on changes, ie there are no locks on the hot path.
+ */
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <getopt.h>
+#include <signal.h>
+#include <time.h>
+#include <pthread.h>
+
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/timerfd.h>
+#include <sys/signalfd.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <net/if.h>
+#include <ifaddrs.h>
+
+#include "daemon.h"
+
+static const char * backends[] = {"uring", "epoll"};
+
+struct config cfg;
+
+static struct worker * workers[MAX_WORKERS];
+
+int timer_fd = -1;
+int signal_fd = -1;
+int stop_fd = -1;
+
+static volatile timer_event_t timer_pending = timer_none;
+static volatile int processing_required = 0;
+static volatile int publishing_required = 0;
+volatile int running = 1;
+
+static struct minimr_simple_ctx simple;
+static simple_state_t simple_state = simple_state_init;
+
+static struct timespec since;
+
+
+static void print_help(char * argv[])
+{
+    printf("Usage: %s [-h] [-b <uring|epoll>] [-w <workers>] [-i <ifname>]* [-p <port>] [-t <ttl>] [-n] [-r] [-v]\n", argv[0]);
+    printf("Responds to mDNS queries on the given (or all multicast capable) interfaces\n");
+    printf("\t -b <uring|epoll> \t I/O backend (default uring, falls back to epoll if not supported)\n");
+    printf("\t -w <workers> \t Worker threads, each with its own sockets (default 1, max %d)\n", MAX_WORKERS);
+    printf("\t -i <ifname> \t Use interface (can be given multiple times), default: all multicast capable interfaces\n");
+    printf("\t -p <port> \t Listen on port (default %d)\n", MINIMR_DNS_PORT);
+    printf("\t -t <ttl> \t TTL of records (default %d)\n", MINIMR_DEFAULT_TTL);
+    printf("\t -n \t\t No probing\n");
+    printf("\t -r \t\t Respond only (no probing, no announcements)\n");
+    printf("\t -v \t\t Verbose\n");
+    printf("\n");
+    printf("Send SIGUSR1 to print statistics, SIGINT/SIGTERM to stop (sends goodbye messages)\n");
+    printf("\n");
+    printf("Copyfright 2020 filou.se, MIT License\n");
+    printf("~~ LONG LIVE KITTENS ~~\n");
+}
+
+/**
+ * Prints statistics summed over all workers (and per worker if multiple)
+ * NOTE the counters of running workers are read without synchronization, ie are approximate
+ */
+static void print_stats(void)
+{
+    struct timespec now;
+    struct stats stats;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    double sec = (now.tv_sec - since.tv_sec) + (now.tv_nsec - since.tv_nsec) / 1e9;
+
+    if (sec <= 0){
+        sec = 1e-9;
+    }
+
+    memset(&stats, 0, sizeof(stats));
+
+    for(unsigned int i = 0; i < cfg.nworkers; i++){
+        struct stats * ws = &workers[i]->stats;
+
+        stats.rx_packets += ws->rx_packets;
+        stats.rx_bytes += ws->rx_bytes;
+        stats.rx_calls += ws->rx_calls;
+        stats.tx_packets += ws->tx_packets;
+        stats.tx_bytes += ws->tx_bytes;
+        stats.tx_calls += ws->tx_calls;
+        stats.tx_errors += ws->tx_errors;
+
+        if (cfg.nworkers > 1){
+            printf("worker %u: rx %llu pkts, tx %llu pkts\n", i, ws->rx_packets, ws->tx_packets);
+        }
+    }
+
+    printf("rx %llu pkts (%llu bytes, %llu calls, %.1f pkts/call), tx %llu pkts (%llu bytes, %llu calls, %llu errors) in %.3f sec: %.0f rx pkts/sec, %.0f tx pkts/sec\n",
+           stats.rx_packets, stats.rx_bytes, stats.rx_calls, stats.rx_calls ? (double)stats.rx_packets / stats.rx_calls : 0.0,
+           stats.tx_packets, stats.tx_bytes, stats.tx_calls, stats.tx_errors,
+           sec, stats.rx_packets / sec, stats.tx_packets / sec
+    );
+    fflush(stdout);
+}
+
+int iface_selected(unsigned int ifindex)
+{
+    for(unsigned int i = 0; i < cfg.nifaces; i++){
+        if (cfg.ifindex[i] == ifindex){
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static int iface_add(unsigned int ifindex)
+{
+    if (iface_selected(ifindex)){
+        return 0;
+    }
+    if (cfg.nifaces >= MAX_IFACES){
+        fprintf(stderr, "ERROR too many interfaces (max %d)\n", MAX_IFACES);
+        return -1;
+    }
+    cfg.ifindex[cfg.nifaces++] = ifindex;
+    return 0;
+}
+
+/**
+ * Selects all multicast capable interfaces (that are up), if none were given
+ * and sets the addresses of the first interface as A/AAAA records.
+ */
+static int ifaces_setup(void)
+{
+    struct ifaddrs * ifaddr;
+
+    if (getifaddrs(&ifaddr) == -1){
+        perror("getifaddrs");
+        return -1;
+    }
+
+    if (cfg.nifaces == 0){
+        for(struct ifaddrs * ifa = ifaddr; ifa != NULL; ifa = ifa->ifa_next){
+            if ((ifa->ifa_flags & IFF_UP) && (ifa->ifa_flags & IFF_MULTICAST) && !(ifa->ifa_flags & IFF_LOOPBACK)){
+                if (iface_add(if_nametoindex(ifa->ifa_name))){
+                    freeifaddrs(ifaddr);
+                    return -1;
+                }
+            }
+        }
+    }
+
+    if (cfg.nifaces == 0){
+        fprintf(stderr, "ERROR no (multicast capable) interfaces\n");
+        freeifaddrs(ifaddr);
+        return -1;
+    }
+
+    uint8_t ipv4[4];
+    uint16_t ipv6[8];
+    int has_ipv4 = 0, has_ipv6 = 0;
+
+    for(struct ifaddrs * ifa = ifaddr; ifa != NULL; ifa = ifa->ifa_next){
+
+        if (ifa->ifa_addr == NULL || if_nametoindex(ifa->ifa_name) != cfg.ifindex[0]){
+            continue;
+        }
+
+        if (ifa->ifa_addr->sa_family == AF_INET && !has_ipv4){
+            memcpy(ipv4, &((struct sockaddr_in *)ifa->ifa_addr)->sin_addr, 4);
+            has_ipv4 = 1;
+        }
+
+        // only link-local ipv6
+        if (ifa->ifa_addr->sa_family == AF_INET6 && !has_ipv6 && IN6_IS_ADDR_LINKLOCAL(&((struct sockaddr_in6 *)ifa->ifa_addr)->sin6_addr)){
+            uint8_t * a = ((struct sockaddr_in6 *)ifa->ifa_addr)->sin6_addr.s6_addr;
+            for(int i = 0; i < 8; i++){
+                ipv6[i] = (a[2*i] << 8) | a[2*i+1];
+            }
+            has_ipv6 = 1;
+        }
+    }
+
+    freeifaddrs(ifaddr);
+
+    if (!has_ipv4 && !has_ipv6){
+        fprintf(stderr, "ERROR no addresses on first interface\n");
+        return -1;
+    }
+
+    minimr_simple_set_ips(&simple, has_ipv4 ? ipv4 : NULL, has_ipv6 ? ipv6 : NULL);
+
+    return 0;
+}
+
+static int sock_open(sock_t type)
+{
+    int on = 1, off = 0;
+    int fd;
+
+    if (type == sock_ipv4){
+        fd = socket(AF_INET, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    } else {
+        fd = socket(AF_INET6, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    }
+    if (fd == -1){
+        perror("socket");
+        return -1;
+    }
+
+    // cooperate with other responders
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+    setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &on, sizeof(on));
+
+    if (type == sock_ipv4){
+
+        struct sockaddr_in addr;
+        memset(&addr, 0, sizeof(addr));
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(cfg.port);
+        addr.sin_addr.s_addr = htonl(INADDR_ANY);
+
+        // receiving interface, our own messages are not of interest
+        // (see https://tools.ietf.org/html/rfc6762#section-11 for the hop limit)
+        int ttl = 255;
+        setsockopt(fd, IPPROTO_IP, IP_PKTINFO, &on, sizeof(on));
+        setsockopt(fd, IPPROTO_IP, IP_MULTICAST_LOOP, &off, sizeof(off));
+        setsockopt(fd, IPPROTO_IP, IP_MULTICAST_TTL, &ttl, sizeof(ttl));
+
+        if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) == -1){
+            perror("bind (ipv4)");
+            close(fd);
+            return -1;
+        }
+
+        for(unsigned int i = 0; i < cfg.nifaces; i++){
+            struct ip_mreqn mreq;
+            memset(&mreq, 0, sizeof(mreq));
+            inet_pton(AF_INET, MINIMR_DNS_IPV4_MCAST_STR, &mreq.imr_multiaddr);
+            mreq.imr_ifindex = cfg.ifindex[i];
+
+            if (setsockopt(fd, IPPROTO_IP, IP_ADD_MEMBERSHIP, &mreq, sizeof(mreq)) == -1 && cfg.verbose){
+                fprintf(stderr, "WARNING failed to join %s on interface %u: %s\n", MINIMR_DNS_IPV4_MCAST_STR, cfg.ifindex[i], strerror(errno));
+            }
+        }
+
+    } else {
+
+        struct sockaddr_in6 addr;
+        memset(&addr, 0, sizeof(addr));
+        addr.sin6_family = AF_INET6;
+        addr.sin6_port = htons(cfg.port);
+        addr.sin6_addr = in6addr_any;
+
+        int hops = 255;
+        setsockopt(fd, IPPROTO_IPV6, IPV6_V6ONLY, &on, sizeof(on));
+        setsockopt(fd, IPPROTO_IPV6, IPV6_RECVPKTINFO, &on, sizeof(on));
+        setsockopt(fd, IPPROTO_IPV6, IPV6_MULTICAST_LOOP, &off, sizeof(off));
+        setsockopt(fd, IPPROTO_IPV6, IPV6_MULTICAST_HOPS, &hops, sizeof(hops));
+
+        if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) == -1){
+            perror("bind (ipv6)");
+            close(fd);
+            return -1;
+        }
+
+        for(unsigned int i = 0; i < cfg.nifaces; i++){
+            struct ipv6_mreq mreq;
+            memset(&mreq, 0, sizeof(mreq));
+            inet_pton(AF_INET6, MINIMR_DNS_IPV6_MCAST_STR, &mreq.ipv6mr_multiaddr);
+            mreq.ipv6mr_interface = cfg.ifindex[i];
+
+            if (setsockopt(fd, IPPROTO_IPV6, IPV6_ADD_MEMBERSHIP, &mreq, sizeof(mreq)) == -1 && cfg.verbose){
+                fprintf(stderr, "WARNING failed to join %s on interface %u: %s\n", MINIMR_DNS_IPV6_MCAST_STR, cfg.ifindex[i], strerror(errno));
+            }
+        }
+    }
+
+    return fd;
+}
+
+static void batch_init(struct batch * b, void * data, size_t maxlen)
+{
+    memset(b, 0, sizeof(struct batch));
+
+    for(unsigned int i = 0; i < BATCH_SIZE; i++){
+        b->iov[i].iov_base = (uint8_t *)data + i * maxlen;
+        b->iov[i].iov_len = maxlen;
+
+        b->msgs[i].msg_hdr.msg_name = &b->addr[i];
+        b->msgs[i].msg_hdr.msg_iov = &b->iov[i];
+        b->msgs[i].msg_hdr.msg_iovlen = 1;
+        b->msgs[i].msg_hdr.msg_control = &b->ctrl[i];
+    }
+}
+
+
+/************* Transmission **************/
+
+static void mmsg_tx_flush(struct worker * w, sock_t s)
+{
+    struct batch * tx = &w->tx[s];
+    unsigned int sent = 0;
+
+    while (sent < tx->count){
+
+        int res = sendmmsg(w->sock[s], &tx->msgs[sent], tx->count - sent, 0);
+
+        w->stats.tx_calls++;
+
+        if (res == -1){
+            if (errno == EINTR){
+                continue;
+            }
+            // drop the offending message (ex. unreachable interface), keep the others
+            if (cfg.verbose){
+                perror("sendmmsg");
+            }
+            w->stats.tx_errors++;
+            sent++;
+            continue;
+        }
+
+        for(int i = 0; i < res; i++){
+            w->stats.tx_packets++;
+            w->stats.tx_bytes += tx->msgs[sent + i].msg_len;
+        }
+
+        sent += res;
+    }
+
+    tx->count = 0;
+}
+
+/**
+ * Returns buffer of next outgoing message (of given socket)
+ */
+static uint8_t * tx_next(struct worker * w, sock_t s)
+{
+    if (w->tx[s].count >= BATCH_SIZE){
+        w->tx_flush(w, s);
+    }
+    return w->tx_data[s][w->tx[s].count];
+}
+
+/**
+ * Queues message written to tx_next() buffer, to be sent to dst (or the mDNS group if NULL) from interface ifindex
+ */
+static void tx_queue(struct worker * w, sock_t s, unsigned int ifindex, struct sockaddr_storage * dst, uint16_t len)
+{
+    struct batch * tx = &w->tx[s];
+    unsigned int i = tx->count;
+
+    struct msghdr * hdr = &tx->msgs[i].msg_hdr;
+    struct sockaddr_storage * addr = &tx->addr[i];
+
+    tx->iov[i].iov_len = len;
+
+    memset(&tx->ctrl[i], 0, sizeof(union cmsg_buf));
+
+    hdr->msg_control = &tx->ctrl[i];
+
+    if (s == sock_ipv4){
+
+        if (dst != NULL){
+            memcpy(addr, dst, sizeof(struct sockaddr_in));
+        } else {
+            struct sockaddr_in * sin = (struct sockaddr_in *)addr;
+            memset(sin, 0, sizeof(struct sockaddr_in));
+            sin->sin_family = AF_INET;
+            sin->sin_port = htons(cfg.port);
+            inet_pton(AF_INET, MINIMR_DNS_IPV4_MCAST_STR, &sin->sin_addr);
+        }
+        hdr->msg_namelen = sizeof(struct sockaddr_in);
+
+        hdr->msg_controllen = CMSG_SPACE(sizeof(struct in_pktinfo));
+
+        struct cmsghdr * cmsg = CMSG_FIRSTHDR(hdr);
+        cmsg->cmsg_level = IPPROTO_IP;
+        cmsg->cmsg_type = IP_PKTINFO;
+        cmsg->cmsg_len = CMSG_LEN(sizeof(struct in_pktinfo));
+
+        struct in_pktinfo * pktinfo = (struct in_pktinfo *)CMSG_DATA(cmsg);
+        pktinfo->ipi_ifindex = ifindex;
+
+    } else {
+
+        if (dst != NULL){
+            memcpy(addr, dst, sizeof(struct sockaddr_in6));
+        } else {
+            struct sockaddr_in6 * sin6 = (struct sockaddr_in6 *)addr;
+            memset(sin6, 0, sizeof(struct sockaddr_in6));
+            sin6->sin6_family = AF_INET6;
+            sin6->sin6_port = htons(cfg.port);
+            sin6->sin6_scope_id = ifindex;
+            inet_pton(AF_INET6, MINIMR_DNS_IPV6_MCAST_STR, &sin6->sin6_addr);
+        }
+        hdr->msg_namelen = sizeof(struct sockaddr_in6);
+
+        hdr->msg_controllen = CMSG_SPACE(sizeof(struct in6_pktinfo));
+
+        struct cmsghdr * cmsg = CMSG_FIRSTHDR(hdr);
+        cmsg->cmsg_level = IPPROTO_IPV6;
+        cmsg->cmsg_type = IPV6_PKTINFO;
+        cmsg->cmsg_len = CMSG_LEN(sizeof(struct in6_pktinfo));
+
+        struct in6_pktinfo * pktinfo = (struct in6_pktinfo *)CMSG_DATA(cmsg);
+        pktinfo->ipi6_ifindex = ifindex;
+    }
+
+    tx->count++;
+}
+
+/**
+ * Queues (multicast) message on all interfaces and both sockets
+ */
+static void tx_queue_all(struct worker * w, uint8_t * msg, uint16_t len)
+{
+    for(sock_t s = 0; s < sock_count; s++){
+        if (w->sock[s] == -1){
+            continue;
+        }
+        for(unsigned int i = 0; i < cfg.nifaces; i++){
+            memcpy(tx_next(w, s), msg, len);
+            tx_queue(w, s, cfg.ifindex[i], NULL, len);
+        }
+    }
+}
+
+void tx_flush_all(struct worker * w)
+{
+    for(sock_t s = 0; s < sock_count; s++){
+        if (w->tx[s].count > 0){
+            w->tx_flush(w, s);
+        }
+    }
+}
+
+
+/************* Reception **************/
+
+unsigned int rx_ifindex(struct msghdr * hdr, uint8_t * multicast)
+{
+    for(struct cmsghdr * cmsg = CMSG_FIRSTHDR(hdr); cmsg != NULL; cmsg = CMSG_NXTHDR(hdr, cmsg)){
+        if (cmsg->cmsg_level == IPPROTO_IP && cmsg->cmsg_type == IP_PKTINFO){
+            struct in_pktinfo * pktinfo = (struct in_pktinfo *)CMSG_DATA(cmsg);
+            *multicast = IN_MULTICAST(ntohl(pktinfo->ipi_addr.s_addr));
+            return pktinfo->ipi_ifindex;
+        }
+        if (cmsg->cmsg_level == IPPROTO_IPV6 && cmsg->cmsg_type == IPV6_PKTINFO){
+            struct in6_pktinfo * pktinfo = (struct in6_pktinfo *)CMSG_DATA(cmsg);
+            *multicast = IN6_IS_ADDR_MULTICAST(&pktinfo->ipi6_addr);
+            return pktinfo->ipi6_ifindex;
+        }
+    }
+    *multicast = 0;
+    return 0;
+}
+
+static uint16_t rx_port(sock_t s, struct sockaddr_storage * addr)
+{
+    if (s == sock_ipv4){
+        return ntohs(((struct sockaddr_in *)addr)->sin_port);
+    }
+    return ntohs(((struct sockaddr_in6 *)addr)->sin6_port);
+}
+
+/**
+ * Worker responsible for a multicast message (delivered to all workers): by hash of the querier's address and port,
+ * ie all messages of a querier are handled by the same worker
+ */
+static unsigned int rx_shard(sock_t s, struct sockaddr_storage * src)
+{
+    uint8_t * key;
+    size_t len;
+    uint32_t hash = 2166136261UL;
+
+    if (s == sock_ipv4){
+        key = (uint8_t *)&((struct sockaddr_in *)src)->sin_addr;
+        len = sizeof(struct in_addr);
+    } else {
+        key = (uint8_t *)&((struct sockaddr_in6 *)src)->sin6_addr;
+        len = sizeof(struct in6_addr);
+    }
+
+    for(size_t i = 0; i < len; i++){
+        hash = (hash ^ key[i]) * 16777619UL;
+    }
+
+    uint16_t port = rx_port(s, src);
+
+    hash = (hash ^ (port >> 8)) * 16777619UL;
+    hash = (hash ^ (port & 0xff)) * 16777619UL;
+
+    return hash % cfg.nworkers;
+}
+
+/**
+ * Queues response written to tx_next() buffer
+ */
+static void rx_reply(struct worker * w, sock_t s, unsigned int ifindex, struct sockaddr_storage * src, uint8_t unicast_requested, uint16_t len)
+{
+    // legacy (one-shot) queriers do not listen on the mDNS port and expect a unicast response
+    // (see https://tools.ietf.org/html/rfc6762#section-6.7 )
+    if (unicast_requested || rx_port(s, src) != MINIMR_DNS_PORT){
+        tx_queue(w, s, ifindex, src, len);
+    } else {
+        tx_queue(w, s, ifindex, NULL, len);
+    }
+}
+
+void rx_process(struct worker * w, sock_t s, uint8_t * msg, uint16_t msglen, struct sockaddr_storage * src, unsigned int ifindex, uint8_t multicast)
+{
+    uint8_t * out = tx_next(w, s);
+    uint16_t outlen = 0;
+    uint8_t unicast_requested = 0;
+    int32_t res;
+
+    struct snapshot * snap = snapshot_enter(w->id);
+
+    if (snap->nrecords > 0){
+
+        if (multicast && cfg.nworkers > 1 && rx_shard(s, src) != w->id){
+            snapshot_exit(w->id);
+            return;
+        }
+
+        res = minimr_query_response_msg(msg, msglen, w->qstats, NQSTATS, snap->set, snap->nrecords, out, &outlen, TX_MAXLEN, &unicast_requested, NULL);
+
+        // response does not fit into one packet
+        if (res == MINIMR_DNS_HDR2_RCODE_SERVAIL){
+
+            struct minimr_msg_cursor cursor;
+
+            minimr_msg_cursor_init(&cursor);
+
+            while (minimr_query_response_msg_next(msg, msglen, w->qstats, NQSTATS, snap->set, snap->nrecords, NULL, &cursor, out, &outlen, TX_MAXLEN, &unicast_requested, NULL) == MINIMR_OK){
+                rx_reply(w, s, ifindex, src, unicast_requested, outlen);
+                out = tx_next(w, s);
+            }
+        }
+
+        snapshot_exit(w->id);
+
+    } else {
+
+        snapshot_exit(w->id);
+
+        // nothing published (yet), ie not responding: only the FSM (of worker 0) is interested in all messages
+        if (w->id != 0){
+            return;
+        }
+
+        res = minimr_simple_fsm(&simple, msg, msglen, out, &outlen, TX_MAXLEN, &unicast_requested);
+    }
+
+    if (res != MINIMR_OK || outlen == 0){
+        return;
+    }
+
+    rx_reply(w, s, ifindex, src, unicast_requested, outlen);
+}
+
+/**
+ * Drains socket in batches of BATCH_SIZE messages
+ */
+static void rx_drain(struct worker * w, sock_t s)
+{
+    struct batch * rx = &w->rx;
+    int n;
+
+    do {
+        for(unsigned int i = 0; i < BATCH_SIZE; i++){
+            rx->msgs[i].msg_hdr.msg_namelen = sizeof(struct sockaddr_storage);
+            rx->msgs[i].msg_hdr.msg_controllen = sizeof(union cmsg_buf);
+            rx->msgs[i].msg_hdr.msg_flags = 0;
+        }
+
+        n = recvmmsg(w->sock[s], rx->msgs, BATCH_SIZE, MSG_DONTWAIT, NULL);
+
+        if (n == -1){
+            if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR){
+                perror("recvmmsg");
+            }
+            break;
+        }
+
+        w->stats.rx_calls++;
+
+        for(int i = 0; i < n; i++){
+
+            struct msghdr * hdr = &rx->msgs[i].msg_hdr;
+            unsigned int len = rx->msgs[i].msg_len;
+            uint8_t multicast;
+            unsigned int ifindex = rx_ifindex(hdr, &multicast);
+
+            w->stats.rx_packets++;
+            w->stats.rx_bytes += len;
+
+            if ((hdr->msg_flags & MSG_TRUNC) || !iface_selected(ifindex)){
+                continue;
+            }
+
+            rx_process(w, s, w->rx_data[i], len, &rx->addr[i], ifindex, multicast);
+        }
+
+        // flush responses of this batch
+        tx_flush_all(w);
+
+    } while (n == BATCH_SIZE);
+}
+
+
+/************* FSM integration **************/
+
+static void timer_set(timer_event_t what, unsigned int msec)
+{
+    struct itimerspec its;
+    memset(&its, 0, sizeof(its));
+
+    its.it_value.tv_sec = msec / 1000;
+    its.it_value.tv_nsec = (msec % 1000) * 1000000L;
+
+    // a zero value would disarm the timer
+    if (msec == 0){
+        its.it_value.tv_nsec = 1;
+    }
+
+    timer_pending = what;
+
+    timerfd_settime(timer_fd, 0, &its, NULL);
+}
+
+void timer_expired(struct worker * w)
+{
+    uint64_t expirations;
+
+    if (read(timer_fd, &expirations, sizeof(expirations)) != sizeof(expirations)){
+        return;
+    }
+
+    timer_event_t what = timer_pending;
+
+    timer_pending = timer_none;
+
+    uint8_t msg[TX_MAXLEN];
+    uint16_t msglen = 0;
+
+    switch(what){
+        case timer_start:
+            minimr_simple_start(&simple, cfg.ttl);
+            break;
+
+        case timer_probe:
+            minimr_simple_probe(&simple, msg, &msglen, sizeof(msg));
+            if (msglen > 0){
+                tx_queue_all(w, msg, msglen);
+            }
+            break;
+
+        case timer_announce:
+            if (minimr_simple_announce(&simple, msg, &msglen, sizeof(msg)) == MINIMR_OK && msglen > 0){
+                tx_queue_all(w, msg, msglen);
+            }
+            break;
+
+        default:
+            break;
+    }
+}
+
+void process(struct worker * w)
+{
+    while (processing_required){
+        processing_required = 0;
+
+        uint8_t msg[TX_MAXLEN];
+        uint16_t msglen = 0;
+        uint8_t unicast_requested = 0;
+
+        if (minimr_simple_fsm(&simple, NULL, 0, msg, &msglen, sizeof(msg), &unicast_requested) == MINIMR_OK && msglen > 0){
+            tx_queue_all(w, msg, msglen);
+        }
+    }
+
+    // workers answer from the snapshot (only) while responding
+    // (when responding only the FSM is not driven past the start, ie it remains in the announce state)
+    if (publishing_required){
+        publishing_required = 0;
+
+        if (simple_state == simple_state_responding || (cfg.respond_only && simple_state == simple_state_announce)){
+            if (snapshot_publish(simple.rr_set, MINIMR_RR_TYPE_DEFAULT_COUNT)){
+                fprintf(stderr, "WARNING failed to publish records to workers\n");
+            }
+        } else {
+            snapshot_publish(NULL, 0);
+        }
+    }
+}
+
+/**
+ * Stops all workers
+ */
+static void shutdown_workers(void)
+{
+    uint64_t one = 1;
+
+    running = 0;
+
+    // wakes up all other workers (the descriptor stays readable)
+    if (write(stop_fd, &one, sizeof(one)) != sizeof(one)){
+        perror("write (stop)");
+    }
+}
+
+static void stop(struct worker * w)
+{
+    uint8_t msg[TX_MAXLEN];
+    uint16_t msglen = 0;
+
+    // withdraw records from the workers before they are invalidated (TTL 0)
+    snapshot_publish(NULL, 0);
+
+    if (minimr_simple_stop(&simple, msg, &msglen, sizeof(msg)) == MINIMR_OK && msglen > 0){
+        tx_queue_all(w, msg, msglen);
+        tx_flush_all(w);
+    }
+
+    shutdown_workers();
+}
+
+void signal_received(struct worker * w)
+{
+    struct signalfd_siginfo si;
+
+    if (read(signal_fd, &si, sizeof(si)) != sizeof(si)){
+        return;
+    }
+
+    if (si.ssi_signo == SIGUSR1){
+        print_stats();
+    } else {
+        stop(w);
+    }
+}
+
+static void state_changed(struct minimr_simple_ctx * ctx, simple_state_t state)
+{
+    simple_state = state;
+    publishing_required = 1;
+
+    if (!cfg.verbose){
+        return;
+    }
+
+    printf("minimrsimple: state changed = ");
+    switch(state){
+        case simple_state_init:
+            printf("init\n");
+            break;
+
+        case simple_state_probe:
+            printf("probe\n");
+            break;
+
+        case simple_state_await_probe_response:
+            printf("await probe response\n");
+            break;
+
+        case simple_state_announce:
+            printf("announce\n");
+            break;
+
+        case simple_state_responding:
+            printf("responding\n");
+            break;
+
+        case simple_state_stopped:
+            printf("stopped\n");
+    }
+}
+
+static void reconfiguration_needed(struct minimr_simple_ctx * ctx)
+{
+    fprintf(stderr, "ERROR probing failed (name conflict), reconfiguration needed!\n");
+    shutdown_workers();
+}
+
+static void set_processing_required(struct minimr_simple_ctx * ctx)
+{
+    processing_required = 1;
+}
+
+static void probing_end_timer(struct minimr_simple_ctx * ctx, uint16_t msec)
+{
+    timer_set(timer_probe, msec);
+}
+
+static void announcement_timer(struct minimr_simple_ctx * ctx, uint16_t sec)
+{
+    timer_set(timer_announce, sec * 1000);
+}
+
+
+int epoll_run(struct worker * w)
+{
+    int epfd = epoll_create1(EPOLL_CLOEXEC);
+
+    if (epfd == -1){
+        perror("epoll_create1");
+        return -1;
+    }
+
+    struct epoll_event ev;
+
+    for(sock_t s = 0; s < sock_count; s++){
+        if (w->sock[s] != -1){
+            ev.events = EPOLLIN;
+            ev.data.fd = w->sock[s];
+            epoll_ctl(epfd, EPOLL_CTL_ADD, w->sock[s], &ev);
+        }
+    }
+
+    if (w->id == 0){
+        ev.events = EPOLLIN;
+        ev.data.fd = timer_fd;
+        epoll_ctl(epfd, EPOLL_CTL_ADD, timer_fd, &ev);
+
+        ev.events = EPOLLIN;
+        ev.data.fd = signal_fd;
+        epoll_ctl(epfd, EPOLL_CTL_ADD, signal_fd, &ev);
+    } else {
+        ev.events = EPOLLIN;
+        ev.data.fd = stop_fd;
+        epoll_ctl(epfd, EPOLL_CTL_ADD, stop_fd, &ev);
+    }
+
+    while (running) {
+
+        struct epoll_event events[4];
+
+        int n = epoll_wait(epfd, events, 4, -1);
+
+        if (n == -1){
+            if (errno == EINTR){
+                continue;
+            }
+            perror("epoll_wait");
+            break;
+        }
+
+        for(int i = 0; i < n && running; i++){
+            int fd = events[i].data.fd;
+
+            if (fd == w->sock[sock_ipv4]){
+                rx_drain(w, sock_ipv4);
+            } else if (fd == w->sock[sock_ipv6]){
+                rx_drain(w, sock_ipv6);
+            } else if (fd == timer_fd){
+                timer_expired(w);
+            } else if (fd == signal_fd){
+                signal_received(w);
+            }
+        }
+
+        if (running && w->id == 0){
+            process(w);
+        }
+
+        tx_flush_all(w);
+    }
+
+
+    close(epfd);
+
+    return 0;
+}
+
+/**
+ * Runs selected backend (or the next supported one)
+ */
+static int worker_run(struct worker * w)
+{
+    int res = -1;
+
+    for(unsigned int b = cfg.backend; b < sizeof(backends) / sizeof(backends[0]) && res != 0; b++){
+        if (cfg.verbose){
+            printf("worker %u: using %s backend\n", w->id, backends[b]);
+        }
+        if (b == 0){
+            res = uring_run(w);
+        } else {
+            w->tx_flush = mmsg_tx_flush;
+            res = epoll_run(w);
+        }
+    }
+
+    return res;
+}
+
+static void * worker_thread(void * arg)
+{
+    if (worker_run(arg)){
+        shutdown_workers();
+    }
+    return NULL;
+}
+
+static struct worker * worker_create(unsigned int id)
+{
+    struct worker * w = calloc(1, sizeof(struct worker));
+
+    if (w == NULL){
+        perror("calloc");
+        return NULL;
+    }
+
+    w->id = id;
+    w->tx_flush = mmsg_tx_flush;
+
+    w->sock[sock_ipv4] = sock_open(sock_ipv4);
+    w->sock[sock_ipv6] = sock_open(sock_ipv6);
+
+    if (w->sock[sock_ipv4] == -1 && w->sock[sock_ipv6] == -1){
+        free(w);
+        return NULL;
+    }
+
+    batch_init(&w->rx, w->rx_data, RX_MAXLEN);
+    batch_init(&w->tx[sock_ipv4], w->tx_data[sock_ipv4], TX_MAXLEN);
+    batch_init(&w->tx[sock_ipv6], w->tx_data[sock_ipv6], TX_MAXLEN);
+
+    return w;
+}
+
+static void worker_destroy(struct worker * w)
+{
+    for(sock_t s = 0; s < sock_count; s++){
+        if (w->sock[s] != -1){
+            close(w->sock[s]);
+        }
+    }
+    free(w);
+}
+
+int main(int argc, char * argv[])
+{
+    int opt;
+
+    cfg.port = MINIMR_DNS_PORT;
+    cfg.ttl = MINIMR_DEFAULT_TTL;
+    cfg.probe = 1;
+    cfg.nworkers = 1;
+
+    while ((opt = getopt(argc, argv, "hb:w:i:p:t:nrv")) != -1) {
+        switch (opt) {
+            case 'h':
+            case '?':
+                print_help(argv);
+                return EXIT_SUCCESS;
+
+            case 'b':
+                for(cfg.backend = 0; cfg.backend < sizeof(backends) / sizeof(backends[0]) && strcmp(optarg, backends[cfg.backend]); cfg.backend++);
+                if (cfg.backend >= sizeof(backends) / sizeof(backends[0])){
+                    fprintf(stderr, "ERROR invalid backend (-b <uring|epoll>): %s\n", optarg);
+                    return EXIT_FAILURE;
+                }
+                break;
+
+            case 'w':
+                cfg.nworkers = atoi(optarg);
+                if (cfg.nworkers < 1 || cfg.nworkers > MAX_WORKERS){
+                    fprintf(stderr, "ERROR workers must be 1 - %d\n", MAX_WORKERS);
+                    return EXIT_FAILURE;
+                }
+                break;
+
+            case 'i': {
+                unsigned int ifindex = if_nametoindex(optarg);
+                if (ifindex == 0){
+                    fprintf(stderr, "ERROR no such interface: %s\n", optarg);
+                    return EXIT_FAILURE;
+                }
+                if (iface_add(ifindex)){
+                    return EXIT_FAILURE;
+                }
+                break;
+            }
+
+            case 'p':
+                cfg.port = atoi(optarg);
+                break;
+
+            case 't':
+                cfg.ttl = atoi(optarg);
+                break;
+
+            case 'n':
+                cfg.probe = 0;
+                break;
+
+            case 'r':
+                cfg.respond_only = 1;
+                break;
+
+            case 'v':
+                cfg.verbose = 1;
+                break;
+
+            default:
+                fprintf(stderr, "ERROR unrecognized option\n");
+                print_help(argv);
+                return EXIT_FAILURE;
+        }
+    }
+
+    struct minimr_simple_init_st init_st;
+    memset(&init_st, 0, sizeof(init_st));
+
+    init_st.state_changed = state_changed;
+    init_st.processing_required = set_processing_required;
+    init_st.probe_or_not = cfg.probe && !cfg.respond_only;
+    init_st.probing_end_timer = probing_end_timer;
+    init_st.reconfiguration_needed = reconfiguration_needed;
+    init_st.announcement_count = cfg.respond_only ? 0 : 8;
+    init_st.announcement_timer = announcement_timer;
+
+    if (minimr_simple_init(&simple, &init_st) != MINIMR_OK){
+        fprintf(stderr, "ERROR failed to initialize responder\n");
+        return EXIT_FAILURE;
+    }
+
+    if (ifaces_setup()){
+        return EXIT_FAILURE;
+    }
+
+    snapshot_init(cfg.nworkers);
+
+    for(unsigned int i = 0; i < cfg.nworkers; i++){
+        workers[i] = worker_create(i);
+        if (workers[i] == NULL){
+            return EXIT_FAILURE;
+        }
+    }
+
+    // (blocked) signals are inherited by the worker threads, ie are only received through the descriptor
+    sigset_t mask;
+    sigemptyset(&mask);
+    sigaddset(&mask, SIGINT);
+    sigaddset(&mask, SIGTERM);
+    sigaddset(&mask, SIGUSR1);
+    sigprocmask(SIG_BLOCK, &mask, NULL);
+
+    signal_fd = signalfd(-1, &mask, SFD_NONBLOCK | SFD_CLOEXEC);
+    timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    stop_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+
+    if (signal_fd == -1 || timer_fd == -1 || stop_fd == -1){
+        perror("setup");
+        return EXIT_FAILURE;
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &since);
+
+    if (cfg.respond_only){
+        // straight to responding (no probing, no announcements)
+        minimr_simple_start(&simple, cfg.ttl);
+        processing_required = 0;
+        process(workers[0]);
+    } else {
+        // random startup delay
+        srand(time(NULL) ^ getpid());
+        timer_set(timer_start, rand() % MINIMR_DNS_STARTUP_MAXDELAY_MSEC);
+    }
+
+    unsigned int started = 1;
+
+    for(; started < cfg.nworkers; started++){
+        if (pthread_create(&workers[started]->thread, NULL, worker_thread, workers[started])){
+            fprintf(stderr, "ERROR failed to start worker %u\n", started);
+            shutdown_workers();
+            break;
+        }
+    }
+
+    int res = worker_run(workers[0]);
+
+    shutdown_workers();
+
+    for(unsigned int i = 1; i < started; i++){
+        pthread_join(workers[i]->thread, NULL);
+    }
+
+    print_stats();
+
+    for(unsigned int i = 0; i < cfg.nworkers; i++){
+        worker_destroy(workers[i]);
+    }
+    close(timer_fd);
+    close(signal_fd);
+    close(stop_fd);
+
+    return res == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
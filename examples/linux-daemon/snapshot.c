@@ -0,0 +1,319 @@
+/**
+ * minimr - mini mDNS Responder (framework)
+ *
+ * https://github.com/tschiemer/minimr
+ *
+ * MIT License
+ *
+ * Copyright (c) 2020 Philip Tschiemer, filou.se
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#define _GNU_SOURCE
+
+#include <string.h>
+#include <sched.h>
+
+#include "snapshot.h"
+
+// one cache line per reader (the counters are written on every message)
+struct reader {
+    unsigned long epoch;
+} __attribute__((aligned(64)));
+
+static struct reader readers[SNAPSHOT_MAX_READERS];
+static unsigned int nreaders = 0;
+
+static struct snapshot snapshots[2];
+static struct snapshot * current = &snapshots[0];
+
+
+static int32_t snapshot_rr_query_get_rr(struct minimr_rr * rr, struct minimr_query_stat * qstat, uint8_t * outmsg, uint16_t * outlen, uint16_t outmsgmaxlen, uint16_t * nrr, void * user_data, struct minimr_name_dict * dict);
+static int32_t snapshot_rr_query_get_extra_rrs(struct minimr_rr * rr, struct minimr_query_stat * qstat, uint8_t * outmsg, uint16_t * outlen, uint16_t outmsgmaxlen, uint16_t * nrr, void * user_data, struct minimr_name_dict * dict);
+static int32_t snapshot_rr_get_rr(struct minimr_rr * rr, uint8_t * outmsg, uint16_t * outlen, uint16_t outmsgmaxlen, uint16_t * nrr, void * user_data, struct minimr_name_dict * dict);
+
+static const struct minimr_rr_ops snapshot_rr_ops = {
+    .query_get_rr = snapshot_rr_query_get_rr,
+    .query_get_extra_rrs = snapshot_rr_query_get_extra_rrs,
+    .get_rr = snapshot_rr_get_rr,
+    .announce_get_rr = snapshot_rr_get_rr,
+};
+
+
+static int32_t snapshot_rr_get_rr(struct minimr_rr * rr, uint8_t * outmsg, uint16_t * outlen, uint16_t outmsgmaxlen, uint16_t * nrr, void * user_data, struct minimr_name_dict * dict)
+{
+    if (minimr_rr_wire_write(rr, outmsg, outlen, outmsgmaxlen, dict) != MINIMR_OK){
+        return MINIMR_NOT_OK;
+    }
+    if (nrr != NULL){
+        *nrr = 1;
+    }
+    return MINIMR_OK;
+}
+
+static int32_t snapshot_rr_query_get_rr(struct minimr_rr * rr, struct minimr_query_stat * qstat, uint8_t * outmsg, uint16_t * outlen, uint16_t outmsgmaxlen, uint16_t * nrr, void * user_data, struct minimr_name_dict * dict)
+{
+    return snapshot_rr_get_rr(rr, outmsg, outlen, outmsgmaxlen, nrr, user_data, dict);
+}
+
+static int32_t snapshot_rr_query_get_extra_rrs(struct minimr_rr * rr, struct minimr_query_stat * qstat, uint8_t * outmsg, uint16_t * outlen, uint16_t outmsgmaxlen, uint16_t * nrr, void * user_data, struct minimr_name_dict * dict)
+{
+    struct snapshot_rr * srr = (struct snapshot_rr *)rr;
+
+    uint8_t * extra = srr->extra;
+    uint8_t nextra = srr->nextra;
+
+    if (qstat->type != rr->type){
+        extra = srr->extra_any;
+        nextra = srr->nextra_any;
+    }
+
+    // all extra records are written at once (or not at all)
+    uint16_t l = *outlen;
+
+    for(uint8_t i = 0; i < nextra; i++){
+        if (minimr_rr_wire_write(srr->snapshot->set[extra[i]], outmsg, &l, outmsgmaxlen, dict) != MINIMR_OK){
+            minimr_name_dict_truncate(dict, *outlen);
+            return MINIMR_NOT_OK;
+        }
+    }
+
+    *outlen = l;
+
+    if (nrr != NULL){
+        *nrr = nextra;
+    }
+
+    return MINIMR_OK;
+}
+
+/**
+ * Length of the (uncompressed) record at the start of buf, 0 if invalid
+ */
+static uint16_t snapshot_record_length(uint8_t * buf, uint16_t len, uint16_t * namelen)
+{
+    uint16_t p = 0;
+
+    while (p < len && buf[p] != 0){
+        p += buf[p] + 1;
+    }
+    p++;
+
+    // TYPE(2) CLASS(2) TTL(4) RDLENGTH(2)
+    if (p + 10 > len){
+        return 0;
+    }
+
+    uint16_t rdlength = (buf[p + 8] << 8) | buf[p + 9];
+
+    if (p + 10 + rdlength > len){
+        return 0;
+    }
+
+    *namelen = p;
+
+    return p + 10 + rdlength;
+}
+
+/**
+ * Resolves the extra records the original record adds (if its type or any type was queried) to the records of the
+ * snapshot, ie the snapshot answers exactly as the original record set (whatever the records' operations are).
+ */
+static int snapshot_resolve_extras(struct snapshot * snap, struct minimr_rr * rr, uint16_t qtype, uint8_t * extra, uint8_t * nextra)
+{
+    uint8_t buf[SNAPSHOT_MAX_RECORDS * (SNAPSHOT_NAMELEN + SNAPSHOT_WIRELEN)];
+    uint16_t len = 0, nrr = 0;
+
+    struct minimr_query_stat qstat;
+    memset(&qstat, 0, sizeof(qstat));
+    qstat.type = qtype;
+    qstat.unicast_class = rr->cache_class & MINIMR_DNS_QCLASS;
+
+    *nextra = 0;
+
+    if (MINIMR_RR_OP_QUERY_GET_EXTRARR(rr, &qstat, buf, &len, sizeof(buf), &nrr, NULL, NULL) != MINIMR_OK){
+        return -1;
+    }
+
+    for(uint16_t p = 0, r = 0; r < nrr; r++){
+
+        uint16_t namelen;
+        uint16_t l = snapshot_record_length(&buf[p], len - p, &namelen);
+
+        if (l == 0){
+            return -1;
+        }
+
+        uint16_t i;
+
+        for(i = 0; i < snap->nrecords; i++){
+            struct snapshot_rr * srr = &snap->records[i];
+
+            if (srr->wire_length == l - namelen && memcmp(srr->name, &buf[p], namelen) == 0 && memcmp(srr->template, &buf[p + namelen], srr->wire_length) == 0){
+                break;
+            }
+        }
+
+        // not part of the record set
+        if (i == snap->nrecords || *nextra >= SNAPSHOT_MAX_RECORDS){
+            return -1;
+        }
+
+        extra[(*nextra)++] = i;
+
+        p += l;
+    }
+
+    return 0;
+}
+
+static int snapshot_build(struct snapshot * snap, struct minimr_rr ** records, uint16_t nrecords)
+{
+    // the uncompressed record as written by its own operations, ie NAME TYPE CLASS TTL RDLENGTH RDATA
+    uint8_t buf[SNAPSHOT_NAMELEN + SNAPSHOT_WIRELEN];
+    struct minimr_rr * src[SNAPSHOT_MAX_RECORDS];
+
+    snap->nrecords = 0;
+
+    for(uint16_t i = 0; records != NULL && i < nrecords; i++){
+
+        struct minimr_rr * rr = records[i];
+
+        if (rr == NULL){
+            continue;
+        }
+        if (snap->nrecords >= SNAPSHOT_MAX_RECORDS){
+            return -1;
+        }
+
+        uint16_t len = 0, nrr = 0;
+
+        if (MINIMR_RR_OP_GET_RR(rr, buf, &len, sizeof(buf), &nrr, NULL, NULL) != MINIMR_OK || nrr != 1){
+            return -1;
+        }
+
+        uint16_t p;
+
+        if (snapshot_record_length(buf, len, &p) != len || p > SNAPSHOT_NAMELEN || len - p > SNAPSHOT_WIRELEN){
+            return -1;
+        }
+
+        struct snapshot_rr * srr = &snap->records[snap->nrecords];
+
+        srr->type = rr->type;
+        srr->cache_class = rr->cache_class;
+        srr->ttl = rr->ttl;
+
+        srr->ops = &snapshot_rr_ops;
+        srr->handler = minimr_rr_ops_handler;
+
+        srr->name_length = rr->name_length;
+        memcpy(srr->name, buf, p);
+
+        memcpy(srr->template, &buf[p], len - p);
+        srr->wire = srr->template;
+        srr->wire_length = len - p;
+        srr->wire_maxlen = sizeof(srr->template);
+
+        srr->snapshot = snap;
+
+#if MINIMR_RR_DIGEST_USE == 1
+        // computed once, ie the (concurrent) readers never do
+        minimr_rr_digest_update((struct minimr_rr *)srr, NULL);
+#endif
+
+        src[snap->nrecords] = rr;
+
+        snap->set[snap->nrecords++] = (struct minimr_rr *)srr;
+    }
+
+    for(uint16_t i = 0; i < snap->nrecords; i++){
+        struct snapshot_rr * srr = &snap->records[i];
+
+        if (snapshot_resolve_extras(snap, src[i], srr->type, srr->extra, &srr->nextra) ||
+            snapshot_resolve_extras(snap, src[i], MINIMR_DNS_TYPE_ANY, srr->extra_any, &srr->nextra_any)){
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+/**
+ * Waits until all readers which are currently inside a read section have left it
+ */
+static void snapshot_synchronize(void)
+{
+    for(unsigned int i = 0; i < nreaders; i++){
+
+        unsigned long epoch = __atomic_load_n(&readers[i].epoch, __ATOMIC_SEQ_CST);
+
+        if ((epoch & 1) == 0){
+            continue;
+        }
+        while (__atomic_load_n(&readers[i].epoch, __ATOMIC_ACQUIRE) == epoch){
+            sched_yield();
+        }
+    }
+}
+
+void snapshot_init(unsigned int n)
+{
+    nreaders = n < SNAPSHOT_MAX_READERS ? n : SNAPSHOT_MAX_READERS;
+
+    snapshots[0].nrecords = 0;
+    snapshots[1].nrecords = 0;
+
+    __atomic_store_n(&current, &snapshots[0], __ATOMIC_SEQ_CST);
+}
+
+int snapshot_publish(struct minimr_rr ** records, uint16_t nrecords)
+{
+    struct snapshot * cur = __atomic_load_n(&current, __ATOMIC_RELAXED);
+    struct snapshot * next = cur == &snapshots[0] ? &snapshots[1] : &snapshots[0];
+
+    // readers might still use the slot since the previous publication
+    snapshot_synchronize();
+
+    if (snapshot_build(next, records, nrecords)){
+        return -1;
+    }
+
+    __atomic_store_n(&current, next, __ATOMIC_SEQ_CST);
+
+    return 0;
+}
+
+struct snapshot * snapshot_enter(unsigned int reader)
+{
+    unsigned long epoch = __atomic_load_n(&readers[reader].epoch, __ATOMIC_RELAXED);
+
+    // the (odd) counter must be visible before the pointer is read, ie a full barrier
+    __atomic_store_n(&readers[reader].epoch, epoch + 1, __ATOMIC_SEQ_CST);
+
+    return __atomic_load_n(&current, __ATOMIC_SEQ_CST);
+}
+
+void snapshot_exit(unsigned int reader)
+{
+    unsigned long epoch = __atomic_load_n(&readers[reader].epoch, __ATOMIC_RELAXED);
+
+    __atomic_store_n(&readers[reader].epoch, epoch + 1, __ATOMIC_RELEASE);
+}
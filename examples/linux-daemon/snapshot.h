@@ -0,0 +1,95 @@
+/**
+ * minimr - mini mDNS Responder (framework)
+ *
+ * https://github.com/tschiemer/minimr
+ *
+ * MIT License
+ *
+ * Copyright (c) 2020 Philip Tschiemer, filou.se
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef MINIMR_LINUX_SNAPSHOT_H
+#define MINIMR_LINUX_SNAPSHOT_H
+
+#include "minimr.h"
+
+#if MINIMR_RR_WIRE_TEMPLATE_USE != 1
+#error snapshots require MINIMR_RR_WIRE_TEMPLATE_USE == 1
+#endif
+
+#define SNAPSHOT_MAX_RECORDS    16
+#define SNAPSHOT_MAX_READERS    64
+
+#define SNAPSHOT_NAMELEN        256
+
+// TYPE(2) CLASS(2) TTL(4) RDLENGTH(2) RDATA
+#define SNAPSHOT_WIRELEN        (10 + 512)
+
+struct snapshot;
+
+/**
+ * Immutable copy of a record: its wire template is built when taking the snapshot (ie it is never rebuilt when
+ * writing), the extra records (indices into the same snapshot) are resolved likewise, both for queries of the record's
+ * type and of any type.
+ */
+MINIMR_RR_TYPE_BEGIN_STNAME(SNAPSHOT_NAMELEN, snapshot_rr)
+    struct snapshot * snapshot;
+    uint8_t nextra;
+    uint8_t extra[SNAPSHOT_MAX_RECORDS];
+    uint8_t nextra_any;
+    uint8_t extra_any[SNAPSHOT_MAX_RECORDS];
+    uint8_t template[SNAPSHOT_WIRELEN];
+MINIMR_RR_TYPE_END();
+
+struct snapshot {
+    struct snapshot_rr records[SNAPSHOT_MAX_RECORDS];
+
+    // record set as passed to minimr_query_response_msg()
+    struct minimr_rr * set[SNAPSHOT_MAX_RECORDS];
+    uint16_t nrecords;
+};
+
+/**
+ * Read-mostly record set shared by the workers (RCU-like)
+ *
+ * Readers (workers) access the current snapshot between snapshot_enter() and snapshot_exit() only and never block
+ * nor lock. The (single) publisher builds the next snapshot into the slot not in use, switches the current pointer and
+ * before reusing the previous slot (on the next publication) waits for all readers which were inside a read section
+ * to leave it (each reader's counter is odd while inside).
+ */
+void snapshot_init(unsigned int nreaders);
+
+/**
+ * Publishes a copy of the given records (NULL entries are skipped), an empty set if records == NULL
+ * NOTE MUST NOT be called from within a read section, only by one thread
+ * @return 0 on success
+ * @return -1 if the records do not fit into a snapshot (the current snapshot is kept)
+ */
+int snapshot_publish(struct minimr_rr ** records, uint16_t nrecords);
+
+/**
+ * Begins read section of reader and returns the current snapshot (valid until snapshot_exit())
+ */
+struct snapshot * snapshot_enter(unsigned int reader);
+
+void snapshot_exit(unsigned int reader);
+
+#endif //MINIMR_LINUX_SNAPSHOT_H
@@ -0,0 +1,587 @@
+/**
+ * minimr - mini mDNS Responder (framework)
+ *
+ * https://github.com/tschiemer/minimr
+ *
+ * MIT License
+ *
+ * Copyright (c) 2020 Philip Tschiemer, filou.se
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/**
+ * io_uring backend (raw syscalls, no liburing)
+ *
+ * Both sockets are read by multishot recvmsg requests using a registered ring of provided buffers, timer and
+ * signal descriptors by multishot polls. Responses are submitted as sendmsg requests together with waiting for the
+ * next completions, ie there is (at most) one io_uring_enter() per loop iteration instead of a syscall per packet.
+ *
+ * Sends use MSG_DONTWAIT, ie they are issued (or fail) during submission and the outgoing batch can be reused
+ * right away.
+ *
+ * Requires Linux 6.0 (multishot recvmsg), uring_run() fails if not supported such that the epoll backend can be used.
+ *
+ * Each worker (thread) has its own ring.
+ */
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <poll.h>
+
+#include <sys/mman.h>
+#include <sys/syscall.h>
+
+#include <linux/io_uring.h>
+
+#include "daemon.h"
+
+#define URING_ENTRIES   256
+
+// provided receive buffers (shared by both sockets), must be a power of 2
+#define URING_NBUFS     64
+#define URING_BGID      0
+
+// multishot recvmsg layout: header, name, control, payload
+#define URING_BUF_SIZE  ((sizeof(struct io_uring_recvmsg_out) + sizeof(struct sockaddr_storage) + sizeof(union cmsg_buf) + RX_MAXLEN + 63) & ~63)
+
+typedef enum {
+    tag_recv = 1,
+    tag_send,
+    tag_poll
+} tag_t;
+
+#define UD(tag, id)     (((uint64_t)(tag) << 8) | (id))
+#define UD_TAG(ud)      ((ud) >> 8)
+#define UD_ID(ud)       ((ud) & 0xff)
+
+#define POLL_TIMER      0
+#define POLL_SIGNAL     1
+#define POLL_STOP       2
+
+static __thread struct {
+    int fd;
+
+    void * sq_ptr;
+    size_t sq_size;
+    unsigned * sq_head;
+    unsigned * sq_tail;
+    unsigned * sq_mask;
+    unsigned * sq_array;
+    unsigned sq_entries;
+    struct io_uring_sqe * sqes;
+    size_t sqes_size;
+
+    // local tail and number of entries not yet submitted
+    unsigned sq_local_tail;
+    unsigned sq_pending;
+
+    void * cq_ptr;
+    size_t cq_size;
+    unsigned * cq_head;
+    unsigned * cq_tail;
+    unsigned * cq_mask;
+    struct io_uring_cqe * cqes;
+
+    struct io_uring_buf_ring * br;
+    size_t br_size;
+    uint8_t * bufs;
+    size_t bufs_size;
+    unsigned short br_tail;
+
+    // set should requests no longer be submittable
+    int failed;
+} ring = {
+    .fd = -1
+};
+
+// multishot recvmsg template (size of name and control areas)
+static __thread struct msghdr recv_hdr;
+
+
+static int sys_io_uring_setup(unsigned entries, struct io_uring_params * p)
+{
+    return syscall(__NR_io_uring_setup, entries, p);
+}
+
+static int sys_io_uring_enter(unsigned to_submit, unsigned min_complete, unsigned flags)
+{
+    return syscall(__NR_io_uring_enter, ring.fd, to_submit, min_complete, flags, NULL, 0);
+}
+
+static int sys_io_uring_register(unsigned opcode, void * arg, unsigned nr_args)
+{
+    return syscall(__NR_io_uring_register, ring.fd, opcode, arg, nr_args);
+}
+
+/**
+ * Submits pending entries and (if min_complete > 0) waits for completions
+ */
+static int uring_submit(unsigned min_complete)
+{
+    int res;
+
+    __atomic_store_n(ring.sq_tail, ring.sq_local_tail, __ATOMIC_RELEASE);
+
+    do {
+        res = sys_io_uring_enter(ring.sq_pending, min_complete, min_complete ? IORING_ENTER_GETEVENTS : 0);
+    } while (res == -1 && errno == EINTR);
+
+    if (res > 0){
+        ring.sq_pending -= res;
+    }
+
+    return res;
+}
+
+static struct io_uring_sqe * uring_sqe(void)
+{
+    // should the submission queue be full, submit (without waiting)
+    if (ring.sq_local_tail - __atomic_load_n(ring.sq_head, __ATOMIC_ACQUIRE) >= ring.sq_entries){
+        uring_submit(0);
+    }
+
+    unsigned idx = ring.sq_local_tail & *ring.sq_mask;
+
+    struct io_uring_sqe * sqe = &ring.sqes[idx];
+
+    memset(sqe, 0, sizeof(struct io_uring_sqe));
+
+    ring.sq_array[idx] = idx;
+    ring.sq_local_tail++;
+    ring.sq_pending++;
+
+    return sqe;
+}
+
+static void uring_buf_add(unsigned short bid)
+{
+    // NOTE only addr, len and bid are set as the tail is located in the (reserved) field of the first entry
+    struct io_uring_buf * buf = &ring.br->bufs[ring.br_tail & (URING_NBUFS - 1)];
+
+    buf->addr = (uint64_t)(uintptr_t)(ring.bufs + bid * URING_BUF_SIZE);
+    buf->len = URING_BUF_SIZE;
+    buf->bid = bid;
+
+    ring.br_tail++;
+}
+
+static void uring_buf_publish(void)
+{
+    __atomic_store_n(&ring.br->tail, ring.br_tail, __ATOMIC_RELEASE);
+}
+
+static void uring_deinit(void)
+{
+    if (ring.fd != -1){
+        close(ring.fd);
+        ring.fd = -1;
+    }
+    if (ring.sqes != NULL && ring.sqes != MAP_FAILED){
+        munmap(ring.sqes, ring.sqes_size);
+    }
+    if (ring.cq_ptr != NULL && ring.cq_ptr != MAP_FAILED && ring.cq_ptr != ring.sq_ptr){
+        munmap(ring.cq_ptr, ring.cq_size);
+    }
+    if (ring.sq_ptr != NULL && ring.sq_ptr != MAP_FAILED){
+        munmap(ring.sq_ptr, ring.sq_size);
+    }
+    if (ring.br != NULL && ring.br != MAP_FAILED){
+        munmap(ring.br, ring.br_size);
+    }
+    if (ring.bufs != NULL && ring.bufs != MAP_FAILED){
+        munmap(ring.bufs, ring.bufs_size);
+    }
+
+    memset(&ring, 0, sizeof(ring));
+    ring.fd = -1;
+}
+
+static int uring_init(void)
+{
+    struct io_uring_params p;
+
+    memset(&p, 0, sizeof(p));
+    p.flags = IORING_SETUP_SINGLE_ISSUER | IORING_SETUP_DEFER_TASKRUN;
+
+    ring.fd = sys_io_uring_setup(URING_ENTRIES, &p);
+
+    // older kernels do not know these flags
+    if (ring.fd == -1 && errno == EINVAL){
+        memset(&p, 0, sizeof(p));
+        ring.fd = sys_io_uring_setup(URING_ENTRIES, &p);
+    }
+    if (ring.fd == -1){
+        if (cfg.verbose){
+            perror("io_uring_setup");
+        }
+        return -1;
+    }
+
+    ring.sq_size = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+    ring.cq_size = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+
+    if (p.features & IORING_FEAT_SINGLE_MMAP){
+        if (ring.cq_size > ring.sq_size){
+            ring.sq_size = ring.cq_size;
+        }
+        ring.cq_size = ring.sq_size;
+    }
+
+    ring.sq_ptr = mmap(NULL, ring.sq_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring.fd, IORING_OFF_SQ_RING);
+    if (ring.sq_ptr == MAP_FAILED){
+        uring_deinit();
+        return -1;
+    }
+
+    if (p.features & IORING_FEAT_SINGLE_MMAP){
+        ring.cq_ptr = ring.sq_ptr;
+    } else {
+        ring.cq_ptr = mmap(NULL, ring.cq_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring.fd, IORING_OFF_CQ_RING);
+        if (ring.cq_ptr == MAP_FAILED){
+            uring_deinit();
+            return -1;
+        }
+    }
+
+    ring.sqes_size = p.sq_entries * sizeof(struct io_uring_sqe);
+    ring.sqes = mmap(NULL, ring.sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring.fd, IORING_OFF_SQES);
+    if (ring.sqes == MAP_FAILED){
+        uring_deinit();
+        return -1;
+    }
+
+    ring.sq_head = (unsigned *)((uint8_t *)ring.sq_ptr + p.sq_off.head);
+    ring.sq_tail = (unsigned *)((uint8_t *)ring.sq_ptr + p.sq_off.tail);
+    ring.sq_mask = (unsigned *)((uint8_t *)ring.sq_ptr + p.sq_off.ring_mask);
+    ring.sq_array = (unsigned *)((uint8_t *)ring.sq_ptr + p.sq_off.array);
+    ring.sq_entries = p.sq_entries;
+    ring.sq_local_tail = *ring.sq_tail;
+
+    ring.cq_head = (unsigned *)((uint8_t *)ring.cq_ptr + p.cq_off.head);
+    ring.cq_tail = (unsigned *)((uint8_t *)ring.cq_ptr + p.cq_off.tail);
+    ring.cq_mask = (unsigned *)((uint8_t *)ring.cq_ptr + p.cq_off.ring_mask);
+    ring.cqes = (struct io_uring_cqe *)((uint8_t *)ring.cq_ptr + p.cq_off.cqes);
+
+    // provided buffer ring (Linux 5.19+)
+    ring.br_size = URING_NBUFS * sizeof(struct io_uring_buf);
+    ring.br = mmap(NULL, ring.br_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    ring.bufs_size = URING_NBUFS * URING_BUF_SIZE;
+    ring.bufs = mmap(NULL, ring.bufs_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+    if (ring.br == MAP_FAILED || ring.bufs == MAP_FAILED){
+        uring_deinit();
+        return -1;
+    }
+
+    struct io_uring_buf_reg reg;
+    memset(&reg, 0, sizeof(reg));
+    reg.ring_addr = (uint64_t)(uintptr_t)ring.br;
+    reg.ring_entries = URING_NBUFS;
+    reg.bgid = URING_BGID;
+
+    if (sys_io_uring_register(IORING_REGISTER_PBUF_RING, &reg, 1)){
+        if (cfg.verbose){
+            perror("io_uring_register (buffer ring)");
+        }
+        uring_deinit();
+        return -1;
+    }
+
+    ring.br_tail = 0;
+    for(unsigned short bid = 0; bid < URING_NBUFS; bid++){
+        uring_buf_add(bid);
+    }
+    uring_buf_publish();
+
+    memset(&recv_hdr, 0, sizeof(recv_hdr));
+    recv_hdr.msg_namelen = sizeof(struct sockaddr_storage);
+    recv_hdr.msg_controllen = sizeof(union cmsg_buf);
+
+    return 0;
+}
+
+static void uring_recv(struct worker * w, sock_t s)
+{
+    struct io_uring_sqe * sqe = uring_sqe();
+
+    sqe->opcode = IORING_OP_RECVMSG;
+    sqe->fd = w->sock[s];
+    sqe->addr = (uint64_t)(uintptr_t)&recv_hdr;
+    sqe->len = 1;
+    sqe->ioprio = IORING_RECV_MULTISHOT;
+    sqe->flags = IOSQE_BUFFER_SELECT;
+    sqe->buf_group = URING_BGID;
+    sqe->user_data = UD(tag_recv, s);
+}
+
+static void uring_poll(int fd, unsigned int id)
+{
+    struct io_uring_sqe * sqe = uring_sqe();
+
+    sqe->opcode = IORING_OP_POLL_ADD;
+    sqe->fd = fd;
+    sqe->poll32_events = POLLIN;
+    sqe->len = IORING_POLL_ADD_MULTI;
+    sqe->user_data = UD(tag_poll, id);
+}
+
+// number of messages of each outgoing batch (of the worker) already added as sendmsg requests
+static __thread unsigned int tx_queued[sock_count];
+
+/**
+ * Adds (but does not submit) sendmsg requests for the messages of outgoing batch not yet added
+ */
+static void uring_send(struct worker * w, sock_t s)
+{
+    struct batch * tx = &w->tx[s];
+
+    for(unsigned int i = tx_queued[s]; i < tx->count; i++){
+        struct io_uring_sqe * sqe = uring_sqe();
+
+        sqe->opcode = IORING_OP_SENDMSG;
+        sqe->fd = w->sock[s];
+        sqe->addr = (uint64_t)(uintptr_t)&tx->msgs[i].msg_hdr;
+        sqe->len = 1;
+        sqe->msg_flags = MSG_DONTWAIT;
+        sqe->flags = IOSQE_CQE_SKIP_SUCCESS;
+        sqe->user_data = UD(tag_send, s);
+
+        // only failures complete (and are accounted for as such)
+        w->stats.tx_packets++;
+        w->stats.tx_bytes += tx->iov[i].iov_len;
+    }
+    tx_queued[s] = tx->count;
+}
+
+/**
+ * Releases the outgoing batches for reuse, but only once the kernel has consumed all their sendmsg requests
+ * (unsubmitted requests still point into the batch buffers)
+ * @return 0 if released
+ */
+static int uring_tx_release(struct worker * w)
+{
+    if (ring.sq_pending > 0){
+        return -1;
+    }
+    for(sock_t s = 0; s < sock_count; s++){
+        w->tx[s].count = 0;
+        tx_queued[s] = 0;
+    }
+    return 0;
+}
+
+static void uring_tx_flush(struct worker * w, sock_t s)
+{
+    uring_send(w, s);
+
+    // a partial submission stops at a failed request, the remaining ones can be submitted again
+    int res;
+    do {
+        res = uring_submit(0);
+    } while (ring.sq_pending > 0 && (res > 0 || (res == -1 && errno == EAGAIN)));
+
+    w->stats.tx_calls++;
+
+    if (uring_tx_release(w) == 0){
+        return;
+    }
+
+    // completions are not reaped while processing, thus there is no way to make room and the batch
+    // can neither be sent nor reused: give up the unsubmitted requests and stop the worker
+    perror("io_uring_enter (tx)");
+
+    ring.sq_local_tail -= ring.sq_pending;
+    ring.sq_pending = 0;
+    __atomic_store_n(ring.sq_tail, ring.sq_local_tail, __ATOMIC_RELEASE);
+
+    uring_tx_release(w);
+
+    ring.failed = 1;
+}
+
+static int uring_poll_fd(unsigned int id)
+{
+    switch(id){
+        case POLL_TIMER:    return timer_fd;
+        case POLL_SIGNAL:   return signal_fd;
+        default:            return stop_fd;
+    }
+}
+
+/**
+ * @return -1 if multishot receive is not supported
+ */
+static int uring_complete(struct worker * w, struct io_uring_cqe * cqe, int * received)
+{
+    unsigned int id = UD_ID(cqe->user_data);
+
+    switch(UD_TAG(cqe->user_data)){
+
+        case tag_recv:
+
+            if (cqe->res >= 0 && (cqe->flags & IORING_CQE_F_BUFFER)){
+
+                unsigned short bid = cqe->flags >> IORING_CQE_BUFFER_SHIFT;
+                uint8_t * buf = ring.bufs + bid * URING_BUF_SIZE;
+
+                struct io_uring_recvmsg_out * out = (struct io_uring_recvmsg_out *)buf;
+
+                uint8_t * name = buf + sizeof(struct io_uring_recvmsg_out);
+                uint8_t * control = name + recv_hdr.msg_namelen;
+                uint8_t * payload = control + recv_hdr.msg_controllen;
+
+                struct msghdr hdr;
+                memset(&hdr, 0, sizeof(hdr));
+                hdr.msg_control = control;
+                hdr.msg_controllen = out->controllen;
+
+                uint8_t multicast;
+                unsigned int ifindex = rx_ifindex(&hdr, &multicast);
+
+                w->stats.rx_packets++;
+                w->stats.rx_bytes += out->payloadlen;
+
+                *received = 1;
+
+                if (!(out->flags & MSG_TRUNC) && out->namelen <= sizeof(struct sockaddr_storage) && iface_selected(ifindex)){
+                    struct sockaddr_storage src;
+
+                    memcpy(&src, name, out->namelen);
+
+                    rx_process(w, id, payload, out->payloadlen, &src, ifindex, multicast);
+                }
+
+                uring_buf_add(bid);
+
+            } else if (cqe->res == -EINVAL && !*received){
+                if (cfg.verbose){
+                    fprintf(stderr, "multishot recvmsg not supported\n");
+                }
+                return -1;
+
+            } else if (cqe->res < 0 && cqe->res != -ENOBUFS && cfg.verbose){
+                fprintf(stderr, "recvmsg: %s\n", strerror(-cqe->res));
+            }
+
+            // rearm (also when out of buffers, they are given back after this round)
+            if (!(cqe->flags & IORING_CQE_F_MORE)){
+                uring_recv(w, id);
+            }
+            break;
+
+        case tag_send:
+            if (cfg.verbose){
+                fprintf(stderr, "sendmsg: %s\n", strerror(-cqe->res));
+            }
+            w->stats.tx_packets--;
+            w->stats.tx_errors++;
+            break;
+
+        case tag_poll:
+            if (id == POLL_TIMER){
+                timer_expired(w);
+            } else if (id == POLL_SIGNAL){
+                signal_received(w);
+            }
+            // (POLL_STOP merely wakes up the worker)
+
+            if (!(cqe->flags & IORING_CQE_F_MORE)){
+                uring_poll(uring_poll_fd(id), id);
+            }
+            break;
+    }
+
+    return 0;
+}
+
+int uring_run(struct worker * w)
+{
+    int received = 0;
+
+    if (uring_init()){
+        return -1;
+    }
+
+    w->tx_flush = uring_tx_flush;
+
+    for(sock_t s = 0; s < sock_count; s++){
+        if (w->sock[s] != -1){
+            uring_recv(w, s);
+        }
+    }
+
+    if (w->id == 0){
+        uring_poll(timer_fd, POLL_TIMER);
+        uring_poll(signal_fd, POLL_SIGNAL);
+    } else {
+        uring_poll(stop_fd, POLL_STOP);
+    }
+
+    while (running && !ring.failed) {
+
+        // submit responses (and any rearmed requests) and wait for the next completion(s)
+        for(sock_t s = 0; s < sock_count; s++){
+            if (w->tx[s].count > tx_queued[s]){
+                uring_send(w, s);
+            }
+        }
+
+        int res = uring_submit(1);
+
+        w->stats.rx_calls++;
+
+        // requests not submitted (yet) will be with the next iteration, their batch has to be kept until then
+        uring_tx_release(w);
+
+        if (res == -1 && errno != EBUSY && errno != EAGAIN){
+            perror("io_uring_enter");
+            break;
+        }
+
+        unsigned head = *ring.cq_head;
+        unsigned tail = __atomic_load_n(ring.cq_tail, __ATOMIC_ACQUIRE);
+
+        for(; head != tail && running; head++){
+            struct io_uring_cqe cqe = ring.cqes[head & *ring.cq_mask];
+
+            __atomic_store_n(ring.cq_head, head + 1, __ATOMIC_RELEASE);
+
+            if (uring_complete(w, &cqe, &received)){
+                uring_deinit();
+                return -1;
+            }
+        }
+
+        uring_buf_publish();
+
+        if (running && w->id == 0){
+            process(w);
+        }
+    }
+
+    uring_deinit();
+
+    return 0;
+}
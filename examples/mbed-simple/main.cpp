@@ -56,6 +56,8 @@ UDPSocket mdns_sock;
 SocketAddress mdns_ipv4(MINIMR_DNS_IPV4_MCAST_STR, MINIMR_DNS_PORT);
 SocketAddress mdns_ipv6(MINIMR_DNS_IPV6_MCAST_STR, MINIMR_DNS_PORT);
 
+struct minimr_simple_ctx mdns;
+
 
 typedef enum {
     mdns_state_stopped,
@@ -121,26 +123,8 @@ int main()
 
     led_eth = 1;
 
-    if (eth.get_ipv6_link_local_address(&ipv6ll)){
-        printf("has no ipv6 link-local!\n");
-        minimr_simple_set_ips((uint8_t*)ipv4ll.get_ip_bytes(), NULL);
-    } else {
-        printf("using ipv6 link-local: %s\n", ipv6ll.get_ip_address());
-
-        uint16_t ipv6[8];
-
-        memcpy(&ipv6, ipv6ll.get_ip_bytes(), 16);
-
-        for(int i = 0; i < 8; i++){
-            ipv6[i] = ntohs(ipv6[i]);
-        }        
-
-        minimr_simple_set_ips((uint8_t*)ipv4ll.get_ip_bytes(), ipv6);
-    }
-
-
-    struct minimr_simple_init_st init_st;
-    init_st.state_changed = [](simple_state_t state){
+    struct minimr_simple_init_st init_st = {};
+    init_st.state_changed = [](struct minimr_simple_ctx * ctx, simple_state_t state){
 
         if (mdns_state == mdns_state_start && (state == simple_state_probe || state == simple_state_announce)){
             mdns_state = mdns_state_started;
@@ -181,27 +165,44 @@ int main()
         }
     };
     init_st.probe_or_not = 1;
-    init_st.reconfiguration_needed = [](){
+    init_st.reconfiguration_needed = [](struct minimr_simple_ctx * ctx){
         printf("mDNS: probing failed, reconfiguration needed!\n");
         led_error = 1;
     };
-    init_st.processing_required = [](){
+    init_st.processing_required = [](struct minimr_simple_ctx * ctx){
         mdns_processing_required = true;
     };
-    init_st.probing_end_timer = [](uint16_t msec){
+    init_st.probing_end_timer = [](struct minimr_simple_ctx * ctx, uint16_t msec){
         mdns_timeout.attach([](){
             mdns_probe_timer_timeout = true;
         }, std::chrono::milliseconds(msec) );
     };
     init_st.announcement_count = 8;
-    init_st.announcement_timer = [](uint16_t sec){
+    init_st.announcement_timer = [](struct minimr_simple_ctx * ctx, uint16_t sec){
         mdns_timeout.attach([](){
             mdns_announcement_timer_timeout = true;
         }, std::chrono::seconds(sec) );
     };
 
 
-    minimr_simple_init(&init_st);
+    minimr_simple_init(&mdns, &init_st);
+
+    if (eth.get_ipv6_link_local_address(&ipv6ll)){
+        printf("has no ipv6 link-local!\n");
+        minimr_simple_set_ips(&mdns, (uint8_t*)ipv4ll.get_ip_bytes(), NULL);
+    } else {
+        printf("using ipv6 link-local: %s\n", ipv6ll.get_ip_address());
+
+        uint16_t ipv6[8];
+
+        memcpy(&ipv6, ipv6ll.get_ip_bytes(), 16);
+
+        for(int i = 0; i < 8; i++){
+            ipv6[i] = ntohs(ipv6[i]);
+        }        
+
+        minimr_simple_set_ips(&mdns, (uint8_t*)ipv4ll.get_ip_bytes(), ipv6);
+    }
     
 
 
@@ -244,7 +245,7 @@ int main()
 
                 packet_out_len = 0;
 
-                minimr_simple_fsm(packet_in, sockres, packet_out, &packet_out_len, sizeof(packet_out), &unicast_requested);
+                minimr_simple_fsm(&mdns, packet_in, sockres, packet_out, &packet_out_len, sizeof(packet_out), &unicast_requested);
 
                 if (packet_out_len){
 
@@ -273,14 +274,14 @@ int main()
             mdns_sock.join_multicast_group(mdns_ipv6);
 
             // start with a TTL of 120 sec
-            minimr_simple_start(120);
+            minimr_simple_start(&mdns, 120);
         }
 
         if (mdns_state == mdns_state_stop){
 
             packet_out_len = 0;
 
-            int res = minimr_simple_stop(packet_out, &packet_out_len, sizeof(packet_out));
+            int res = minimr_simple_stop(&mdns, packet_out, &packet_out_len, sizeof(packet_out));
 
             if (res == MINIMR_OK && packet_out_len){
                 mdns_sock.sendto(mdns_ipv4, packet_out, packet_out_len);
@@ -300,7 +301,7 @@ int main()
 
             packet_out_len = 0;
 
-            int res = minimr_simple_fsm(NULL, 0, packet_out, &packet_out_len, sizeof(packet_out), &unicast_requested);
+            int res = minimr_simple_fsm(&mdns, NULL, 0, packet_out, &packet_out_len, sizeof(packet_out), &unicast_requested);
 
             if (res == MINIMR_OK && packet_out_len){
                 mdns_sock.sendto(mdns_ipv4, packet_out, packet_out_len);
@@ -313,7 +314,7 @@ int main()
 
             packet_out_len = 0;
 
-            minimr_simple_probe(packet_out, &packet_out_len, sizeof(packet_out));
+            minimr_simple_probe(&mdns, packet_out, &packet_out_len, sizeof(packet_out));
 
             // well it's pretty much always guaranteed to be larger than 0..
             if (packet_out_len > 0){
@@ -327,7 +328,7 @@ int main()
 
             packet_out_len = 0;
 
-            int res = minimr_simple_announce(packet_out, &packet_out_len, sizeof(packet_out));
+            int res = minimr_simple_announce(&mdns, packet_out, &packet_out_len, sizeof(packet_out));
 
             // well it's pretty much always guaranteed to be larger than 0..
             if (res == MINIMR_OK && packet_out_len > 0){
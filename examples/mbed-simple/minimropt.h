@@ -36,6 +36,9 @@
 
 #define MINIMR_SIMPLE_INTERFACE_ENABLED 1
 
+// keep records pre-serialized (costs some RAM, saves CPU per response)
+#define MINIMR_RR_WIRE_TEMPLATE_USE 1
+
 #define MINIMR_SIMPLE_HOSTNAME          ".here-be-kittens.local"
 #define MINIMR_SIMPLE_SERVICE_PTR       "._echo._udp.local"
 #define MINIMR_SIMPLE_SERVICE_NAME      ".Here be Kittens._echo._udp.local"
@@ -28,6 +28,19 @@
 
 #include "minimr.h"
 
+#include <stdarg.h>
+
+// declares (and initializes) a per message name compression dictionary <name> (a pointer, NULL if compression is disabled)
+#if MINIMR_NAME_COMPRESSION_ENABLED == 1
+#define MINIMR_NAME_DICT(name) \
+    struct minimr_name_dict name##_st; \
+    struct minimr_name_dict * name = &name##_st; \
+    minimr_name_dict_init(name);
+#else
+#define MINIMR_NAME_DICT(name) \
+    struct minimr_name_dict * name = NULL;
+#endif
+
 
 const uint8_t * minimr_dns_type_tostr(uint16_t type)
 {
@@ -109,6 +122,96 @@ void minimr_dns_hdr_write(uint8_t *dst, struct minimr_dns_hdr *hdr) {
     MINIMR_DEBUGF("hdr\n id %04x flag %02x%02x nq %04x nrr %04x narr %04x nexrr %04x\n", hdr->transaction_id, hdr->flags[0], hdr->flags[1], hdr->nqueries, hdr->nanswers, hdr->nauthrr, hdr->nextrarr);
 }
 
+/**
+ * Walks (possibly compressed) name at <pos> computing the case-folded name hash (following any compression jumps)
+ * and sets <end> to the position after the name as it lies in the message (ie after NUL or compression pointer)
+ */
+static uint8_t minimr_name_walk(uint8_t * msg, uint16_t pos, uint16_t msglen, uint16_t * end, uint32_t * hash)
+{
+    uint32_t h = MINIMR_NAME_HASH_INIT;
+    uint8_t njumps = 0;
+
+    *end = 0;
+
+    while (pos < msglen && msg[pos] != '\0'){
+
+        // is name compressed? jump
+        if ((msg[pos] & MINIMR_DNS_COMPRESSED_NAME) == MINIMR_DNS_COMPRESSED_NAME){
+
+            // is offset address in msg?
+            if (pos + 1 >= msglen){
+                return MINIMR_NOT_OK;
+            }
+
+            // the name (as in the message) ends after the first pointer
+            if (njumps == 0){
+                *end = pos + 2;
+            }
+
+            njumps++;
+
+            // evil (or faulty) messages can loop
+            if (njumps > MINIMR_COMPRESSION_MAX_JUMPS){
+                return MINIMR_NOT_OK;
+            }
+
+            pos = ((msg[pos] & MINIMR_DNS_COMPRESSED_NAME_OFFSET) << 8) | msg[pos+1];
+
+            continue;
+        }
+
+        uint8_t seglen = msg[pos];
+
+        // labels are at most 63 bytes (other label types are reserved)
+        if (seglen > MINIMR_DNS_LABEL_MAXLEN || pos + seglen >= msglen){
+            return MINIMR_NOT_OK;
+        }
+
+        for(uint8_t i = 0; i <= seglen; i++, pos++){
+            MINIMR_NAME_HASH_STEP(h, msg[pos]);
+        }
+    }
+
+    if (pos >= msglen){
+        return MINIMR_NOT_OK;
+    }
+
+    // uncompressed name, ends after NUL
+    if (njumps == 0){
+        *end = pos + 1;
+    }
+
+    *hash = h;
+
+    return MINIMR_OK;
+}
+
+uint16_t minimr_name_length(uint8_t * uncompressed_name)
+{
+    MINIMR_ASSERT(uncompressed_name != NULL);
+
+    uint16_t l = 0;
+
+    while (uncompressed_name[l] != '\0'){
+        l += uncompressed_name[l] + 1;
+    }
+
+    return l + 1;
+}
+
+uint32_t minimr_name_hash(uint8_t * uncompressed_name)
+{
+    MINIMR_ASSERT(uncompressed_name != NULL);
+
+    uint32_t h = MINIMR_NAME_HASH_INIT;
+
+    for(uint16_t i = 0; uncompressed_name[i] != '\0'; i++){
+        MINIMR_NAME_HASH_STEP(h, uncompressed_name[i]);
+    }
+
+    return h;
+}
+
 uint8_t minimr_extract_query_stat(struct minimr_query_stat * stat, uint8_t * msg, uint16_t * pos, uint16_t msglen)
 {
     uint16_t p = *pos;
@@ -119,34 +222,22 @@ uint8_t minimr_extract_query_stat(struct minimr_query_stat * stat, uint8_t * msg
         return MINIMR_NOT_OK;
     }
 
-    for(; p < msglen && msg[p] != '\0'; p++){
-        // just looking for the end of rrname
-        // note: it's not checked wether the rrname is correctly formatted
-
-        if ( (msg[p] & MINIMR_DNS_COMPRESSED_NAME) == MINIMR_DNS_COMPRESSED_NAME){
-            p ++;
-//            MINIMR_DEBUGF("is jump\n");
-            break;
-        }
-
-//        MINIMR_DEBUGF("p + %d\n", msg[p]);
-
-        p += msg[p];
+    // find end of qname and compute its hash at the same time
+    // note: it's not checked wether the qname is correctly formatted
+    if (minimr_name_walk(msg, p, msglen, &p, &stat->name_hash) != MINIMR_OK){
+        return MINIMR_NOT_OK;
     }
 
     // simple sanity check
-    // did not go beyond msg
     // read at least 1 bytes?
-    if (p >= msglen || p == *pos ){
+    // QTYPE(2) UNICAST/QCLASS(2) within msg?
+    if (p == *pos + 1 || p + 4 > msglen){
 //        MINIMR_DEBUGF("1 *pos %d p %d msglen %d\n", *pos, p, msglen);
         return MINIMR_NOT_OK;
     }
 
 //    stat->name_length = p - *pos;
 
-    // move past last name byte (either NUL or second byte of pointer offset
-    p++;
-
     stat->name_offset = *pos;
 
     stat->type = msg[p++] << 8;
@@ -303,6 +394,89 @@ void minimr_field_denormalize(uint8_t * field, uint16_t length, uint8_t marker)
 //}
 
 
+#define MINIMR_NAME_FOLD(c) ( ('A' <= (c) && (c) <= 'Z') ? ((c) - 'A' + 'a' ) : (c) )
+
+/**
+ * Vectorized case-insensitive comparison of name chunks
+ *
+ * minimr_name_vdiff(a, b) compares MINIMR_NAME_CMP_VLEN bytes of a and b (case-folded) and returns a bitmask of
+ * differing bytes with MINIMR_NAME_CMP_VBITS bits per byte (lowest bits correspond to the first byte).
+ * If available, minimr_name_vdiff_wide(a, b) does the same for MINIMR_NAME_CMP_VLEN_WIDE bytes.
+ */
+#if MINIMR_NAME_CMP_SIMD == 1 && defined(__GNUC__) && defined(__SSE2__)
+
+#include <emmintrin.h>
+
+#define MINIMR_NAME_CMP_VLEN    16
+#define MINIMR_NAME_CMP_VBITS   1
+
+static inline __m128i minimr_name_vfold(__m128i c)
+{
+    // 'A' - 'Z' mapped to -128 - -103 (signed) such that a single compare detects uppercase letters
+    __m128i t = _mm_add_epi8(c, _mm_set1_epi8((char)(0x80 - 'A')));
+    __m128i upper = _mm_cmplt_epi8(t, _mm_set1_epi8((char)(0x80 + 26)));
+
+    return _mm_or_si128(c, _mm_and_si128(upper, _mm_set1_epi8(0x20)));
+}
+
+static inline uint64_t minimr_name_vdiff(uint8_t * a, uint8_t * b)
+{
+    __m128i va = minimr_name_vfold(_mm_loadu_si128((const __m128i *)a));
+    __m128i vb = minimr_name_vfold(_mm_loadu_si128((const __m128i *)b));
+
+    return ~(uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(va, vb)) & 0xffff;
+}
+
+#if defined(__AVX2__)
+
+#include <immintrin.h>
+
+#define MINIMR_NAME_CMP_VLEN_WIDE   32
+
+static inline __m256i minimr_name_vfold_wide(__m256i c)
+{
+    __m256i t = _mm256_add_epi8(c, _mm256_set1_epi8((char)(0x80 - 'A')));
+    __m256i upper = _mm256_cmpgt_epi8(_mm256_set1_epi8((char)(0x80 + 26)), t);
+
+    return _mm256_or_si256(c, _mm256_and_si256(upper, _mm256_set1_epi8(0x20)));
+}
+
+static inline uint64_t minimr_name_vdiff_wide(uint8_t * a, uint8_t * b)
+{
+    __m256i va = minimr_name_vfold_wide(_mm256_loadu_si256((const __m256i *)a));
+    __m256i vb = minimr_name_vfold_wide(_mm256_loadu_si256((const __m256i *)b));
+
+    return ~(uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(va, vb)) & 0xffffffffUL;
+}
+
+#endif //__AVX2__
+
+#elif MINIMR_NAME_CMP_SIMD == 1 && defined(__GNUC__) && defined(__ARM_NEON)
+
+#include <arm_neon.h>
+
+#define MINIMR_NAME_CMP_VLEN    16
+#define MINIMR_NAME_CMP_VBITS   4
+
+static inline uint8x16_t minimr_name_vfold(uint8x16_t c)
+{
+    uint8x16_t upper = vcleq_u8(vsubq_u8(c, vdupq_n_u8('A')), vdupq_n_u8('Z' - 'A'));
+
+    return vorrq_u8(c, vandq_u8(upper, vdupq_n_u8(0x20)));
+}
+
+static inline uint64_t minimr_name_vdiff(uint8_t * a, uint8_t * b)
+{
+    uint8x16_t eq = vceqq_u8(minimr_name_vfold(vld1q_u8(a)), minimr_name_vfold(vld1q_u8(b)));
+
+    // there is no movemask, but narrowing gives a nibble per byte
+    uint8x8_t nibbles = vshrn_n_u16(vreinterpretq_u16_u8(eq), 4);
+
+    return ~vget_lane_u64(vreinterpret_u64_u8(nibbles), 0);
+}
+
+#endif
+
 int32_t minimr_name_cmp(uint8_t * uncompressed_name, uint16_t namepos, uint8_t * msg, uint16_t msglen)
 {
     MINIMR_ASSERT(uncompressed_name != NULL);
@@ -314,6 +488,11 @@ int32_t minimr_name_cmp(uint8_t * uncompressed_name, uint16_t namepos, uint8_t *
 
     uint8_t njumps = 0;
 
+#ifdef MINIMR_NAME_CMP_VLEN
+    // chunks must not be read beyond the end of either name
+    uint16_t namelen = minimr_name_length(uncompressed_name);
+#endif
+
     while (uncompressed_name[len] != '\0' && namepos < msglen && msg[namepos] != '\0'){
 
         // is name compressed? jump
@@ -340,6 +519,11 @@ int32_t minimr_name_cmp(uint8_t * uncompressed_name, uint16_t namepos, uint8_t *
                     return -1;
                 }
 
+                // jumps must stay within msg
+                if (offset >= msglen){
+                    return -1;
+                }
+
                 // actually make jump
                 namepos = offset;
 
@@ -350,19 +534,58 @@ int32_t minimr_name_cmp(uint8_t * uncompressed_name, uint16_t namepos, uint8_t *
             continue;
         }
 
-        uint8_t seglen = uncompressed_name[len];
+        // length byte and label
+        uint16_t n = uncompressed_name[len] + 1;
+
+
+//        MINIMR_DEBUGF("2 namepos %d seglen %d\n", namepos, n - 1);
+
+#ifdef MINIMR_NAME_CMP_VLEN
+        // compare whole chunks of label (where possible)
+        while(n > 0){
+
+            uint16_t c;
+            uint64_t diff;
+
+#ifdef MINIMR_NAME_CMP_VLEN_WIDE
+            if (n > MINIMR_NAME_CMP_VLEN && len + MINIMR_NAME_CMP_VLEN_WIDE <= namelen && namepos + MINIMR_NAME_CMP_VLEN_WIDE <= msglen){
+                c = n < MINIMR_NAME_CMP_VLEN_WIDE ? n : MINIMR_NAME_CMP_VLEN_WIDE;
+                diff = minimr_name_vdiff_wide(&uncompressed_name[len], &msg[namepos]);
+            } else
+#endif
+            if (len + MINIMR_NAME_CMP_VLEN <= namelen && namepos + MINIMR_NAME_CMP_VLEN <= msglen){
+                c = n < MINIMR_NAME_CMP_VLEN ? n : MINIMR_NAME_CMP_VLEN;
+                diff = minimr_name_vdiff(&uncompressed_name[len], &msg[namepos]);
+            } else {
+                break;
+            }
+
+            // ignore bytes beyond label
+            if (c * MINIMR_NAME_CMP_VBITS < 64){
+                diff &= (((uint64_t)1) << (c * MINIMR_NAME_CMP_VBITS)) - 1;
+            }
+
+            if (diff != 0){
+                uint16_t i = __builtin_ctzll(diff) / MINIMR_NAME_CMP_VBITS;
+
+                uint8_t lhs = MINIMR_NAME_FOLD(uncompressed_name[len + i]);
+                uint8_t rhs = MINIMR_NAME_FOLD(msg[namepos + i]);
 
+                return lhs < rhs ? -1 : 1;
+            }
 
-//        MINIMR_DEBUGF("2 namepos %d seglen %d\n", namepos, seglen);
+            len += c;
+            namepos += c;
+            n -= c;
+        }
+#endif
 
-        for(uint8_t i = 0; i <= seglen && namepos < msglen; i++){
+        for(; n > 0 && namepos < msglen; n--){
             uint8_t lhs = uncompressed_name[len++];
             uint8_t rhs = msg[namepos++];
 
-            #define LOWERCASE(c) ( ('A' <= (c) && (c) <= 'Z') ? ((c) - 'A' + 'a' ) : (c) )
-            lhs = LOWERCASE(lhs);
-            rhs = LOWERCASE(rhs);
-            #undef LOWERCASE
+            lhs = MINIMR_NAME_FOLD(lhs);
+            rhs = MINIMR_NAME_FOLD(rhs);
 
             if (lhs < rhs) return -1;
             if (lhs > rhs) return 1;
@@ -381,7 +604,7 @@ int32_t minimr_name_cmp(uint8_t * uncompressed_name, uint16_t namepos, uint8_t *
     return 1;
 }
 
-int32_t minimr_name_uncompress(uint8_t * uncompressed_name, uint16_t maxlen, uint16_t namepos, uint8_t * msg, uint8_t msglen)
+int32_t minimr_name_uncompress(uint8_t * uncompressed_name, uint16_t maxlen, uint16_t namepos, uint8_t * msg, uint16_t msglen)
 {
     MINIMR_ASSERT(uncompressed_name != NULL);
     MINIMR_ASSERT(maxlen > 0);
@@ -421,6 +644,11 @@ int32_t minimr_name_uncompress(uint8_t * uncompressed_name, uint16_t maxlen, uin
                     return -1;
                 }
 
+                // jumps must stay within msg
+                if (offset >= msglen){
+                    return -1;
+                }
+
                 // actually make jump
                 namepos = offset;
 
@@ -433,7 +661,8 @@ int32_t minimr_name_uncompress(uint8_t * uncompressed_name, uint16_t maxlen, uin
 
         uint8_t seglen = msg[namepos];
 
-        if (namepos + seglen >= msglen){
+        // labels are at most 63 bytes (other label types are reserved), the whole label (and NUL) must fit
+        if (seglen > MINIMR_DNS_LABEL_MAXLEN || namepos + seglen >= msglen || len + seglen + 1 >= maxlen){
             return -1;
         }
 
@@ -455,826 +684,2796 @@ int32_t minimr_name_uncompress(uint8_t * uncompressed_name, uint16_t maxlen, uin
 }
 
 
-int32_t  minimr_parse_msg(
-        uint8_t *msg, uint16_t msglen,
-        minimr_msgtype msgtype,
-        minimr_query_handler qhandler, struct minimr_filter * qfilters, uint16_t nqfilters,
-        minimr_rr_handler rrhandler, struct minimr_filter * rrfilters, uint16_t nrrfilters,
-        void * user_data
-)
+/**
+ * Exact (case-sensitive) comparison of uncompressed name with (possibly compressed) name in message
+ * Used for name compression such that names are reproduced exactly.
+ */
+static uint8_t minimr_name_equals(uint8_t * uncompressed_name, uint16_t namepos, uint8_t * msg, uint16_t msglen)
 {
-    MINIMR_ASSERT(msg != NULL);
-    MINIMR_ASSERT(nqfilters == 0 || qfilters != NULL);
-    MINIMR_ASSERT(nrrfilters == 0 || rrfilters != NULL);
-    MINIMR_ASSERT(qhandler != NULL && rrhandler != NULL); // doesn't make any sense not to use any handler at all.
-
-//    MINIMR_DEBUGF("\nnew msg %p (len %d)\n", msg, msglen);
-//
-//    MINIMR_DEBUGF("msglen check\n");
+    uint16_t len = 0;
+    uint8_t njumps = 0;
 
-    // ignore messages that are not long enough to even have a complete header
-    if (msglen < MINIMR_DNS_HDR_SIZE){
-        return MINIMR_OK;
-    }
+    while (namepos < msglen){
 
-    struct minimr_dns_hdr hdr;
+        // is name compressed? jump
+        if ((msg[namepos] & MINIMR_DNS_COMPRESSED_NAME) == MINIMR_DNS_COMPRESSED_NAME){
 
-    // read header info
-    minimr_dns_hdr_read(&hdr, msg);
+            if (namepos + 1 >= msglen || ++njumps > MINIMR_COMPRESSION_MAX_JUMPS){
+                return 0;
+            }
 
-    // if asked for specific type but other at hand, abort
-    if ((msgtype == minimr_msgtype_query && (hdr.flags[0] & MINIMR_DNS_HDR1_QR) == MINIMR_DNS_HDR1_QR_REPLY )
-        || (msgtype == minimr_msgtype_response && (hdr.flags[0] & MINIMR_DNS_HDR1_QR) == MINIMR_DNS_HDR1_QR_REPLY )){
-        return MINIMR_OK;
-    }
+            namepos = ((msg[namepos] & MINIMR_DNS_COMPRESSED_NAME_OFFSET) << 8) | msg[namepos+1];
 
-    uint16_t pos = MINIMR_DNS_HDR_SIZE;
+            continue;
+        }
 
-    for(uint16_t iq = 0; iq < hdr.nqueries && pos < msglen; iq++){
+        if (uncompressed_name[len] != msg[namepos]){
+            return 0;
+        }
 
-        struct minimr_query_stat qstat;
+        // both are NUL
+        if (msg[namepos] == '\0'){
+            return 1;
+        }
 
-        uint8_t res = minimr_extract_query_stat(&qstat, msg, &pos, msglen);
+        uint8_t seglen = msg[namepos];
 
-        // in case of a server fail, pass this along
-        if (res == MINIMR_DNS_HDR2_RCODE_SERVAIL) {
-            return MINIMR_DNS_HDR2_RCODE_SERVAIL;
+        if (namepos + seglen >= msglen){
+            return 0;
         }
 
-        if (res != MINIMR_OK){
-            // we could respond that it was a faulty query..
-            return MINIMR_DNS_HDR2_RCODE_FORMERR;
+        for(uint8_t i = 1; i <= seglen; i++){
+            if (uncompressed_name[len + i] != msg[namepos + i]){
+                return 0;
+            }
         }
 
-        if (qhandler == NULL){
-            continue;
-        }
+        len += seglen + 1;
+        namepos += seglen + 1;
+    }
+
+    return 0;
+}
 
+uint8_t minimr_name_write(uint8_t * outmsg, uint16_t * outlen, uint16_t outmsgmaxlen, uint8_t * name, struct minimr_name_dict * dict)
+{
+    MINIMR_ASSERT(outmsg != NULL);
+    MINIMR_ASSERT(outlen != NULL);
+    MINIMR_ASSERT(name != NULL);
 
-        uint8_t cont = MINIMR_CONTINUE;
+    uint16_t l = *outlen;
+    uint16_t count = dict != NULL ? dict->count : 0;
 
-        if (nqfilters == 0){
-            cont = qhandler(&hdr, &qstat, msg, msglen, user_data);
-        } else {
+    uint16_t i = 0;
 
-            for (uint16_t i = 0; i < nqfilters; i++){
+    while(name[i] != '\0'){
 
-                MINIMR_ASSERT(qfilters[i].name != NULL);
+        // is the remaining name (suffix) already in the message? then just point to it
+        for(uint16_t d = 0; dict != NULL && d < dict->count; d++){
 
-                // type match?
-                if (qfilters[i].type != MINIMR_DNS_TYPE_ANY && qstat.type != MINIMR_DNS_TYPE_ANY && qfilters[i].type != qstat.type){
-                    continue;
-                }
+            if (minimr_name_equals(&name[i], dict->offsets[d], outmsg, l)){
 
-                // class match?
-                if (qfilters[i].fclass != MINIMR_DNS_CLASS_ANY && (qstat.unicast_class & MINIMR_DNS_QCLASS) != MINIMR_DNS_CLASS_ANY && qfilters[i].fclass != (qstat.unicast_class & MINIMR_DNS_QCLASS) ){
-                    continue;
+                if (l + 2 > outmsgmaxlen){
+                    dict->count = count;
+                    return MINIMR_NOT_OK;
                 }
 
-                if (minimr_name_cmp(qfilters[i].name, qstat.name_offset, msg, msglen) == 0){
+                outmsg[l++] = MINIMR_DNS_COMPRESSED_NAME | ((dict->offsets[d] >> 8) & MINIMR_DNS_COMPRESSED_NAME_OFFSET);
+                outmsg[l++] = dict->offsets[d] & 0xff;
 
-                    qstat.match_i = i;
+                *outlen = l;
 
-                    // pass to user rr handler
-                    cont = qhandler(&hdr, &qstat, msg, msglen, user_data);
-                }
+                return MINIMR_OK;
             }
         }
 
-        if (cont != MINIMR_CONTINUE){
-            return MINIMR_OK;
+        uint8_t seglen = name[i];
+
+        // segment plus (at least) terminating NUL
+        if (l + seglen + 2 > outmsgmaxlen){
+            if (dict != NULL){
+                dict->count = count;
+            }
+            return MINIMR_NOT_OK;
         }
-    }
 
+        // remember suffix for later use (if it can be pointed to)
+        if (dict != NULL && dict->count < MINIMR_NAME_DICT_SIZE && l <= MINIMR_DNS_COMPRESSED_NAME_MAX_OFFSET){
+            dict->offsets[dict->count++] = l;
+        }
 
-    // msg seems to be faulty, stop processing
-    if (pos > msglen){
-        return MINIMR_DNS_HDR2_RCODE_FORMERR;
+        for(uint8_t j = 0; j <= seglen; j++){
+            outmsg[l++] = name[i++];
+        }
     }
 
-    if (pos == msglen){
-        return MINIMR_OK;
+    outmsg[l++] = '\0';
+
+    *outlen = l;
+
+    return MINIMR_OK;
+}
+
+void minimr_name_dict_truncate(struct minimr_name_dict * dict, uint16_t outlen)
+{
+    if (dict == NULL){
+        return;
     }
 
-    // if we're not interested in records, skip further processing
-    if (rrhandler == NULL){
-        return MINIMR_OK;
+    // offsets are added in increasing order
+    while(dict->count > 0 && dict->offsets[dict->count - 1] >= outlen){
+        dict->count--;
     }
+}
 
-    MINIMR_DEBUGF("checking %d rr, %d authrr, %d extrarr\n", hdr.nanswers, hdr.nauthrr, hdr.nextrarr);
+uint8_t minimr_rr_write_begin(struct minimr_rr * rr, uint8_t * outmsg, uint16_t * outlen, uint16_t outmsgmaxlen, struct minimr_name_dict * dict, uint16_t * rdpos)
+{
+    MINIMR_ASSERT(rr != NULL);
+    MINIMR_ASSERT(rdpos != NULL);
 
-    uint16_t nrr = hdr.nanswers + hdr.nauthrr + hdr.nextrarr;
-    minimr_rr_section section = minimr_rr_section_answer;
-    uint16_t section_until = hdr.nanswers;
+    uint16_t l = *outlen;
 
-    for(uint16_t ir = 0; ir < nrr && pos < msglen; ir++){
+    if (minimr_name_write(outmsg, &l, outmsgmaxlen, rr->name, dict) != MINIMR_OK){
+        return MINIMR_NOT_OK;
+    }
 
-        struct minimr_rr_stat rstat;
+    // TYPE(2) CLASS(2) TTL(4) RDLENGTH(2)
+    if (l + 10 > outmsgmaxlen){
+        minimr_name_dict_truncate(dict, *outlen);
+        return MINIMR_NOT_OK;
+    }
 
-        uint8_t res = minimr_extract_rr_stat(&rstat, msg, &pos, msglen);
+    MINIMR_DNS_RR_WRITE_TYPE(outmsg, l, rr->type);
+    if (MINIMR_RR_IS_SHARED(rr)){
+        MINIMR_DNS_Q_WRITE_CLASS(outmsg, l, rr->cache_class & ~MINIMR_DNS_CACHEFLUSH);
+    } else {
+        MINIMR_DNS_RR_WRITE_CACHECLASS(outmsg, l, rr->cache_class);
+    }
+    MINIMR_DNS_RR_WRITE_TTL(outmsg, l, rr->ttl);
 
-        // in case of a server fail, pass this along
-        if (res == MINIMR_DNS_HDR2_RCODE_SERVAIL) {
-            return MINIMR_DNS_HDR2_RCODE_SERVAIL;
-        }
+    *rdpos = l;
 
-        if (res != MINIMR_OK){
-            // we could respond that it was a faulty query..
-            return MINIMR_DNS_HDR2_RCODE_FORMERR;
+    outmsg[l++] = 0;
+    outmsg[l++] = 0;
+
+    *outlen = l;
+
+    return MINIMR_OK;
+}
+
+uint8_t minimr_rr_write_data(uint8_t * data, uint16_t len, uint8_t * outmsg, uint16_t * outlen, uint16_t outmsgmaxlen)
+{
+    uint16_t l = *outlen;
+
+    if (l + len > outmsgmaxlen){
+        return MINIMR_NOT_OK;
+    }
+
+    for(uint16_t i = 0; i < len; i++){
+        outmsg[l++] = data[i];
+    }
+
+    *outlen = l;
+
+    return MINIMR_OK;
+}
+
+uint8_t minimr_rr_write_end(uint8_t * outmsg, uint16_t outlen, uint16_t rdpos)
+{
+    uint16_t rdlength = outlen - rdpos - 2;
+
+    outmsg[rdpos] = (rdlength >> 8) & 0xff;
+    outmsg[rdpos+1] = rdlength & 0xff;
+
+    return MINIMR_OK;
+}
+
+int32_t minimr_rr_ops_handler(minimr_rr_fun fun, struct minimr_rr *rr, ...)
+{
+    MINIMR_ASSERT(MINIMR_RR_FUN_IS_VALID(fun));
+    MINIMR_ASSERT(rr != NULL);
+    MINIMR_ASSERT(rr->ops != NULL);
+
+    va_list args;
+    va_start(args, rr);
+
+    const struct minimr_rr_ops * ops = rr->ops;
+
+    struct minimr_query_stat * qstat = NULL;
+    uint8_t * outmsg;
+    uint16_t * outlen;
+    uint16_t outmsgmaxlen;
+    uint16_t * nrr;
+    void * user_data;
+    struct minimr_name_dict * dict;
+
+    uint16_t rclass;
+    uint16_t rtype;
+    uint8_t * rdata;
+    uint16_t rdlength;
+
+    int32_t res = MINIMR_OK;
+
+    switch(fun){
+
+        case minimr_rr_fun_query_respond_to:
+            user_data = va_arg(args, void*);
+
+            res = ops->query_respond_to == NULL ? MINIMR_RESPOND : ops->query_respond_to(rr, user_data);
+            break;
+
+        case minimr_rr_fun_lexcmp:
+            rclass = va_arg(args, int32_t); // uint16_t will be promoted to int
+            rtype = va_arg(args, int32_t);
+            rdata = va_arg(args, uint8_t*);
+            rdlength = va_arg(args, int32_t);
+            user_data = va_arg(args, void*);
+
+            res = ops->lexcmp == NULL ? 0 : ops->lexcmp(rr, rclass, rtype, rdata, rdlength, user_data);
+            break;
+
+        case minimr_rr_fun_query_get_rr:
+        case minimr_rr_fun_query_get_authority_rrs:
+        case minimr_rr_fun_query_get_extra_rrs:
+            qstat = va_arg(args, struct minimr_query_stat *);
+            /* fall through */
+        case minimr_rr_fun_get_rr:
+        case minimr_rr_fun_announce_get_rr:
+        case minimr_rr_fun_announce_get_extra_rrs:
+            outmsg = va_arg(args, uint8_t *);
+            outlen = va_arg(args, uint16_t *);
+            outmsgmaxlen = va_arg(args, int); // uint16_t will be promoted to int
+            nrr = va_arg(args, uint16_t *);
+            user_data = va_arg(args, void*);
+            dict = va_arg(args, struct minimr_name_dict *);
+
+            if (fun == minimr_rr_fun_query_get_rr && ops->query_get_rr != NULL){
+                res = ops->query_get_rr(rr, qstat, outmsg, outlen, outmsgmaxlen, nrr, user_data, dict);
+            } else if (fun == minimr_rr_fun_query_get_authority_rrs && ops->query_get_authority_rrs != NULL){
+                res = ops->query_get_authority_rrs(rr, qstat, outmsg, outlen, outmsgmaxlen, nrr, user_data, dict);
+            } else if (fun == minimr_rr_fun_query_get_extra_rrs && ops->query_get_extra_rrs != NULL){
+                res = ops->query_get_extra_rrs(rr, qstat, outmsg, outlen, outmsgmaxlen, nrr, user_data, dict);
+            } else if (fun == minimr_rr_fun_get_rr && ops->get_rr != NULL){
+                res = ops->get_rr(rr, outmsg, outlen, outmsgmaxlen, nrr, user_data, dict);
+            } else if (fun == minimr_rr_fun_announce_get_rr && ops->announce_get_rr != NULL){
+                res = ops->announce_get_rr(rr, outmsg, outlen, outmsgmaxlen, nrr, user_data, dict);
+            } else if (fun == minimr_rr_fun_announce_get_extra_rrs && ops->announce_get_extra_rrs != NULL){
+                res = ops->announce_get_extra_rrs(rr, outmsg, outlen, outmsgmaxlen, nrr, user_data, dict);
+            }
+            break;
+    }
+
+    va_end(args);
+
+    return res;
+}
+
+void minimr_rr_changed(struct minimr_rr * rr)
+{
+    MINIMR_ASSERT(rr != NULL);
+
+#if MINIMR_RR_WIRE_TEMPLATE_USE == 1
+    rr->wire_length = 0;
+#endif
+
+#if MINIMR_RR_DIGEST_USE == 1
+    rr->rdata_digest = 0;
+#endif
+}
+
+void minimr_response_cache_invalidate(volatile uint32_t * generation)
+{
+    MINIMR_ASSERT(generation != NULL);
+
+    (*generation)++;
+}
+
+/**
+ * Gets offset of the (possibly compressed) name in rdata of given type, <rdlength> if there is none
+ */
+static uint16_t minimr_rdata_name_offset(uint16_t type, uint16_t rdlength)
+{
+    if (type == MINIMR_DNS_TYPE_PTR || type == MINIMR_DNS_TYPE_CNAME || type == MINIMR_DNS_TYPE_NS){
+        return 0;
+    }
+    if (type == MINIMR_DNS_TYPE_MX){
+        return 2;
+    }
+    if (type == MINIMR_DNS_TYPE_SRV){
+        return 6;
+    }
+    return rdlength;
+}
+
+/**
+ * Computes digest of rdata at <pos> (of <rdlength>) in msg: names (of the types which may be compressed) are walked
+ * decompressed and case-folded, anything else is digested as is.
+ * Never yields 0 (as used to mark cached digests as outdated).
+ */
+static uint8_t minimr_rdata_digest(uint16_t type, uint8_t * msg, uint16_t pos, uint16_t rdlength, uint16_t msglen, uint32_t * digest)
+{
+    // offset of name in rdata (if any)
+    uint16_t n = minimr_rdata_name_offset(type, rdlength);
+
+    if (n > rdlength || pos + rdlength > msglen){
+        return MINIMR_NOT_OK;
+    }
+
+    uint32_t d = MINIMR_NAME_HASH_INIT;
+
+    for(uint16_t i = 0; i < n; i++){
+        d = (d ^ msg[pos + i]) * MINIMR_NAME_HASH_PRIME;
+    }
+
+    if (n < rdlength){
+
+        uint16_t end;
+        uint32_t h;
+
+        // the name must make up the rest of rdata
+        if (minimr_name_walk(msg, pos + n, msglen, &end, &h) != MINIMR_OK || end != pos + rdlength){
+            return MINIMR_NOT_OK;
         }
 
-        if (section == minimr_rr_section_answer && ir >= section_until){
-            section = minimr_rr_section_authority;
-            section_until += hdr.nauthrr;
+        for(uint8_t i = 0; i < 4; i++, h >>= 8){
+            d = (d ^ (h & 0xff)) * MINIMR_NAME_HASH_PRIME;
         }
-        if (section == minimr_rr_section_authority && ir >= section_until){
-            section = minimr_rr_section_extra;
+    }
+
+    *digest = d == 0 ? 1 : d;
+
+    return MINIMR_OK;
+}
+
+/**
+ * Gets (uncompressed) rdata of record from its wire template (if valid) or by writing it into <buf>
+ */
+static uint8_t minimr_rr_rdata(struct minimr_rr * rr, void * user_data, uint8_t * buf, uint16_t bufsize, uint8_t ** rdata, uint16_t * rdlength)
+{
+#if MINIMR_RR_WIRE_TEMPLATE_USE == 1
+    // TYPE(2) CLASS(2) TTL(4) RDLENGTH(2)
+    if (rr->wire != NULL && rr->wire_length >= 10){
+        *rdata = &rr->wire[10];
+        *rdlength = rr->wire_length - 10;
+        return MINIMR_OK;
+    }
+#endif
+
+    uint16_t len = 0, nrr = 0;
+
+    //minimr_rr_fun_handler( minimr_rr_fun_get_rr, struct minimr_rr * rr,  uint8_t * outmsg, uint16_t * outlen, uint16_t outmsgmaxlen, uint16_t * nrr, void * user_data, struct minimr_name_dict * dict)
+    if (MINIMR_RR_OP_GET_RR(rr, buf, &len, bufsize, &nrr, user_data, NULL) != MINIMR_OK || nrr != 1){
+        return MINIMR_NOT_OK;
+    }
+
+    uint16_t p;
+    uint32_t h;
+
+    // NAME TYPE(2) CLASS(2) TTL(4) RDLENGTH(2) RDATA
+    if (minimr_name_walk(buf, 0, len, &p, &h) != MINIMR_OK || p + 10 > len){
+        return MINIMR_NOT_OK;
+    }
+
+    *rdlength = (buf[p + 8] << 8) | buf[p + 9];
+
+    if (p + 10 + *rdlength != len){
+        return MINIMR_NOT_OK;
+    }
+
+    *rdata = &buf[p + 10];
+
+    return MINIMR_OK;
+}
+
+/**
+ * Computes digest of rdata of record from its wire template (if valid) or by writing it (uncompressed)
+ */
+static uint8_t minimr_rr_digest(struct minimr_rr * rr, void * user_data, uint32_t * digest)
+{
+    uint8_t buf[MINIMR_RR_DIGEST_MAXLEN];
+    uint8_t * rdata;
+    uint16_t rdlength;
+
+    if (minimr_rr_rdata(rr, user_data, buf, sizeof(buf), &rdata, &rdlength) != MINIMR_OK){
+        return MINIMR_NOT_OK;
+    }
+
+    return minimr_rdata_digest(rr->type, rdata, 0, rdlength, rdlength, digest);
+}
+
+/**
+ * Compares rdata of record with rdata at <pos> (of <rdlength>) in msg, names (if any) case-insensitively
+ * Used to confirm matching digests (which can collide).
+ */
+static uint8_t minimr_rr_rdata_equals(struct minimr_rr * rr, void * user_data, uint8_t * msg, uint16_t pos, uint16_t rdlength, uint16_t msglen)
+{
+    uint8_t buf[MINIMR_RR_DIGEST_MAXLEN];
+    uint8_t * rdata;
+    uint16_t len;
+
+    if (minimr_rr_rdata(rr, user_data, buf, sizeof(buf), &rdata, &len) != MINIMR_OK){
+        return 0;
+    }
+
+    uint16_t n = minimr_rdata_name_offset(rr->type, len);
+
+    // without name the length must match, otherwise the name (possibly compressed in msg) must follow the same prefix
+    if (n > len || (n == len ? len != rdlength : n >= rdlength) || pos + rdlength > msglen){
+        return 0;
+    }
+
+    for(uint16_t i = 0; i < n; i++){
+        if (rdata[i] != msg[pos + i]){
+            return 0;
+        }
+    }
+
+    if (n == len){
+        return 1;
+    }
+
+    return minimr_name_cmp(&rdata[n], pos + n, msg, msglen) == 0;
+}
+
+#if MINIMR_RR_DIGEST_USE == 1
+
+uint8_t minimr_rr_digest_update(struct minimr_rr * rr, void * user_data)
+{
+    MINIMR_ASSERT(rr != NULL);
+
+    uint32_t digest;
+
+    if (minimr_rr_digest(rr, user_data, &digest) != MINIMR_OK){
+        rr->rdata_digest = 0;
+        return MINIMR_NOT_OK;
+    }
+
+    rr->rdata_digest = digest;
+
+    return MINIMR_OK;
+}
+
+#endif //MINIMR_RR_DIGEST_USE == 1
+
+/**
+ * Gets (cached) rdata digest of record
+ */
+static uint8_t minimr_rr_digest_get(struct minimr_rr * rr, void * user_data, uint32_t * digest)
+{
+#if MINIMR_RR_DIGEST_USE == 1
+    if (rr->rdata_digest == 0 && minimr_rr_digest_update(rr, user_data) != MINIMR_OK){
+        return MINIMR_NOT_OK;
+    }
+
+    *digest = rr->rdata_digest;
+
+    return MINIMR_OK;
+#else
+    return minimr_rr_digest(rr, user_data, digest);
+#endif
+}
+
+#if MINIMR_RR_WIRE_TEMPLATE_USE == 1
+
+uint8_t minimr_rr_wire_write(struct minimr_rr * rr, uint8_t * outmsg, uint16_t * outlen, uint16_t outmsgmaxlen, struct minimr_name_dict * dict)
+{
+    MINIMR_ASSERT(rr != NULL);
+    MINIMR_ASSERT(outmsg != NULL);
+    MINIMR_ASSERT(outlen != NULL);
+
+    if (rr->wire == NULL){
+        return MINIMR_IGNORE;
+    }
+
+#if MINIMR_RR_TYPE_DEFAULT_COUNT > 0
+    if (rr->wire_length == 0 && minimr_default_rr_wire_update(rr) != MINIMR_OK){
+        return MINIMR_IGNORE;
+    }
+#endif
+
+    // TYPE(2) CLASS(2) TTL(4) RDLENGTH(2)
+    if (rr->wire_length < 10){
+        return MINIMR_IGNORE;
+    }
+
+    uint16_t l = *outlen;
+
+    if (minimr_name_write(outmsg, &l, outmsgmaxlen, rr->name, dict) != MINIMR_OK){
+        return MINIMR_NOT_OK;
+    }
+
+    // offset of a (trailing) name in rdata, which is compressed as well
+    uint16_t n = rr->wire_length;
+    if (dict != NULL){
+        if (rr->type == MINIMR_DNS_TYPE_PTR && rr->wire_length > 10){
+            n = 10;
+        } else if (rr->type == MINIMR_DNS_TYPE_SRV && rr->wire_length > 16){
+            n = 16;
+        }
+    }
+
+    if (l + n > outmsgmaxlen){
+        minimr_name_dict_truncate(dict, *outlen);
+        return MINIMR_NOT_OK;
+    }
+
+    uint16_t p = l;
+
+    for(uint16_t i = 0; i < n; i++){
+        outmsg[l++] = rr->wire[i];
+    }
+
+    if (n < rr->wire_length){
+        if (minimr_name_write(outmsg, &l, outmsgmaxlen, &rr->wire[n], dict) != MINIMR_OK){
+            minimr_name_dict_truncate(dict, *outlen);
+            return MINIMR_NOT_OK;
+        }
+        minimr_rr_write_end(outmsg, l, p + 8);
+    }
+
+    // patch cache-flush bit and TTL
+    if (MINIMR_RR_IS_SHARED(rr)){
+        outmsg[p + 2] &= ~(MINIMR_DNS_CACHEFLUSH >> 8);
+    } else {
+        outmsg[p + 2] |= (MINIMR_DNS_CACHEFLUSH >> 8);
+    }
+    p += 4;
+    MINIMR_DNS_RR_WRITE_TTL(outmsg, p, rr->ttl);
+
+    *outlen = l;
+
+    return MINIMR_OK;
+}
+
+#endif //MINIMR_RR_WIRE_TEMPLATE_USE == 1
+
+
+int32_t  minimr_parse_msg(
+        uint8_t *msg, uint16_t msglen,
+        minimr_msgtype msgtype,
+        minimr_query_handler qhandler, struct minimr_filter * qfilters, uint16_t nqfilters,
+        minimr_rr_handler rrhandler, struct minimr_filter * rrfilters, uint16_t nrrfilters,
+        void * user_data
+)
+{
+    MINIMR_ASSERT(msg != NULL);
+    MINIMR_ASSERT(nqfilters == 0 || qfilters != NULL);
+    MINIMR_ASSERT(nrrfilters == 0 || rrfilters != NULL);
+    MINIMR_ASSERT(qhandler != NULL || rrhandler != NULL); // doesn't make any sense not to use any handler at all.
+
+//    MINIMR_DEBUGF("\nnew msg %p (len %d)\n", msg, msglen);
+//
+//    MINIMR_DEBUGF("msglen check\n");
+
+    // ignore messages that are not long enough to even have a complete header
+    if (msglen < MINIMR_DNS_HDR_SIZE){
+        return MINIMR_OK;
+    }
+
+    struct minimr_dns_hdr hdr;
+
+    // read header info
+    minimr_dns_hdr_read(&hdr, msg);
+
+    // if asked for specific type but other at hand, abort
+    if ((msgtype == minimr_msgtype_query && (hdr.flags[0] & MINIMR_DNS_HDR1_QR) == MINIMR_DNS_HDR1_QR_REPLY )
+        || (msgtype == minimr_msgtype_response && (hdr.flags[0] & MINIMR_DNS_HDR1_QR) == MINIMR_DNS_HDR1_QR_QUERY )){
+        return MINIMR_OK;
+    }
+
+    uint16_t pos = MINIMR_DNS_HDR_SIZE;
+
+    for(uint16_t iq = 0; iq < hdr.nqueries && pos < msglen; iq++){
+
+        struct minimr_query_stat qstat;
+
+        uint8_t res = minimr_extract_query_stat(&qstat, msg, &pos, msglen);
+
+        // in case of a server fail, pass this along
+        if (res == MINIMR_DNS_HDR2_RCODE_SERVAIL) {
+            return MINIMR_DNS_HDR2_RCODE_SERVAIL;
+        }
+
+        if (res != MINIMR_OK){
+            // we could respond that it was a faulty query..
+            return MINIMR_DNS_HDR2_RCODE_FORMERR;
+        }
+
+        if (qhandler == NULL){
+            continue;
         }
 
+
         uint8_t cont = MINIMR_CONTINUE;
 
-        // if any filter records were given, just look for these
-        if (nrrfilters == 0) {
-            cont = rrhandler(&hdr, section, &rstat, msg, msglen, user_data);
+        if (nqfilters == 0){
+            cont = qhandler(&hdr, &qstat, msg, msglen, user_data);
         } else {
-            for (uint16_t i = 0; i < nrrfilters; i++){
 
-                MINIMR_ASSERT(rrfilters[i].name != NULL);
+            for (uint16_t i = 0; i < nqfilters; i++){
+
+                MINIMR_ASSERT(qfilters[i].name != NULL);
+
+                // type match?
+                if (qfilters[i].type != MINIMR_DNS_TYPE_ANY && qstat.type != MINIMR_DNS_TYPE_ANY && qfilters[i].type != qstat.type){
+                    continue;
+                }
+
+                // class match?
+                if (qfilters[i].fclass != MINIMR_DNS_CLASS_ANY && (qstat.unicast_class & MINIMR_DNS_QCLASS) != MINIMR_DNS_CLASS_ANY && qfilters[i].fclass != (qstat.unicast_class & MINIMR_DNS_QCLASS) ){
+                    continue;
+                }
+
+                if (minimr_name_cmp(qfilters[i].name, qstat.name_offset, msg, msglen) == 0){
+
+                    qstat.match_i = i;
+
+                    // pass to user rr handler
+                    cont = qhandler(&hdr, &qstat, msg, msglen, user_data);
+                }
+            }
+        }
+
+        if (cont != MINIMR_CONTINUE){
+            return MINIMR_OK;
+        }
+    }
+
+
+    // msg seems to be faulty, stop processing
+    if (pos > msglen){
+        return MINIMR_DNS_HDR2_RCODE_FORMERR;
+    }
+
+    if (pos == msglen){
+        return MINIMR_OK;
+    }
+
+    // if we're not interested in records, skip further processing
+    if (rrhandler == NULL){
+        return MINIMR_OK;
+    }
+
+    MINIMR_DEBUGF("checking %d rr, %d authrr, %d extrarr\n", hdr.nanswers, hdr.nauthrr, hdr.nextrarr);
+
+    uint16_t nrr = hdr.nanswers + hdr.nauthrr + hdr.nextrarr;
+    minimr_rr_section section = minimr_rr_section_answer;
+    uint16_t section_until = hdr.nanswers;
+
+    for(uint16_t ir = 0; ir < nrr && pos < msglen; ir++){
+
+        struct minimr_rr_stat rstat;
+
+        uint8_t res = minimr_extract_rr_stat(&rstat, msg, &pos, msglen);
+
+        // in case of a server fail, pass this along
+        if (res == MINIMR_DNS_HDR2_RCODE_SERVAIL) {
+            return MINIMR_DNS_HDR2_RCODE_SERVAIL;
+        }
+
+        if (res != MINIMR_OK){
+            // we could respond that it was a faulty query..
+            return MINIMR_DNS_HDR2_RCODE_FORMERR;
+        }
+
+        if (section == minimr_rr_section_answer && ir >= section_until){
+            section = minimr_rr_section_authority;
+            section_until += hdr.nauthrr;
+        }
+        if (section == minimr_rr_section_authority && ir >= section_until){
+            section = minimr_rr_section_extra;
+        }
+
+        uint8_t cont = MINIMR_CONTINUE;
+
+        // if any filter records were given, just look for these
+        if (nrrfilters == 0) {
+            cont = rrhandler(&hdr, section, &rstat, msg, msglen, user_data);
+        } else {
+            for (uint16_t i = 0; i < nrrfilters; i++){
+
+                MINIMR_ASSERT(rrfilters[i].name != NULL);
+
+                // type match?
+                if (rrfilters[i].type != MINIMR_DNS_TYPE_ANY && rrfilters[i].type != rstat.type){
+                    continue;
+                }
+                // class match?
+                if (rrfilters[i].fclass != MINIMR_DNS_CLASS_ANY && rrfilters[i].fclass != (rstat.cache_class & MINIMR_DNS_RRCLASS) ){
+                    continue;
+                }
+
+                if (minimr_name_cmp(rrfilters[i].name, rstat.name_offset, msg, msglen) == 0){
+
+                    rstat.match_i = i;
+
+                    // pass to user rr handler
+                    cont = rrhandler(&hdr, section, &rstat, msg, msglen, user_data);
+                }
+            }
+        }
+
+        if (cont != MINIMR_CONTINUE){
+            return MINIMR_OK;
+        }
+    }
+
+
+    return MINIMR_OK;
+}
+
+/**
+ * @return index of first record of given section to write (depending on cursor), 0xffff if section was written already
+ */
+static uint16_t minimr_msg_start(struct minimr_msg_cursor * cursor, uint8_t section)
+{
+    if (cursor == NULL || cursor->section < section){
+        return 0;
+    }
+    if (cursor->section == section){
+        return cursor->i;
+    }
+    return 0xffff;
+}
+
+/**
+ * Handles record (or group of records) i of given section not fitting into the message
+ * @param empty     if nothing was written to the message so far
+ * @return MINIMR_OK        if the record is to be written to the next message (position saved to cursor)
+ * @return MINIMR_IGNORE    if the record is to be skipped (additional record not even fitting an empty message)
+ * @return MINIMR_DNS_HDR2_RCODE_SERVAIL if not splitting messages or any other record not fitting an empty message
+ */
+static int32_t minimr_msg_overflow(struct minimr_msg_cursor * cursor, uint8_t section, uint16_t i, uint8_t empty)
+{
+    if (cursor == NULL){
+        return MINIMR_DNS_HDR2_RCODE_SERVAIL;
+    }
+
+    if (empty){
+        // additional records are optional, the others are not
+        if (section == MINIMR_MSG_SECTION_ADDITIONAL){
+            return MINIMR_IGNORE;
+        }
+        return MINIMR_DNS_HDR2_RCODE_SERVAIL;
+    }
+
+    cursor->section = section;
+    cursor->i = i;
+
+    return MINIMR_OK;
+}
+
+void minimr_msg_cursor_init(struct minimr_msg_cursor * cursor)
+{
+    MINIMR_ASSERT(cursor != NULL);
+
+    cursor->section = MINIMR_MSG_SECTION_QUESTION;
+    cursor->i = 0;
+}
+
+static int32_t  minimr_make(
+        uint16_t tid, uint8_t flag1, uint8_t flag2,
+        struct minimr_query * queries, uint16_t nqueries,
+        struct minimr_rr ** answerrr, uint16_t nanswers,
+        struct minimr_rr ** authrr, uint16_t nauthrr,
+        struct minimr_rr ** extrarr, uint16_t nextrarr,
+        struct minimr_msg_cursor * cursor,
+        uint8_t *outmsg, uint16_t *outmsglen, uint16_t outmsgmaxlen,
+        void * user_data
+)
+{
+    MINIMR_ASSERT(nqueries == 0 || queries != NULL);
+    MINIMR_ASSERT(nanswers == 0 || answerrr != NULL);
+    MINIMR_ASSERT(nauthrr == 0 || authrr != NULL);
+    MINIMR_ASSERT(nextrarr == 0 || extrarr != NULL);
+    MINIMR_ASSERT(outmsg != NULL);
+    MINIMR_ASSERT(outmsglen != NULL);
+
+
+    // sanity check config
+    if (outmsgmaxlen <= MINIMR_DNS_HDR_SIZE){
+        return MINIMR_DNS_HDR2_RCODE_SERVAIL;
+    }
+
+    if (cursor != NULL && cursor->section == MINIMR_MSG_SECTION_DONE){
+        return MINIMR_IGNORE;
+    }
+
+    uint16_t outlen = MINIMR_DNS_HDR_SIZE;
+
+    MINIMR_NAME_DICT(dict);
+
+    uint16_t final_nqueries = 0; // questions are only written to the first message
+
+    if (minimr_msg_start(cursor, MINIMR_MSG_SECTION_QUESTION) == 0){
+
+        for (uint16_t i = 0; i < nqueries; i++){
+
+            MINIMR_ASSERT(queries[i].name != NULL);
+
+            if (minimr_name_write(outmsg, &outlen, outmsgmaxlen, queries[i].name, dict) != MINIMR_OK){
+                return MINIMR_DNS_HDR2_RCODE_SERVAIL;
+            }
+
+            if (outlen + 4 > outmsgmaxlen){
+                return MINIMR_DNS_HDR2_RCODE_SERVAIL;
+            }
+
+            MINIMR_DNS_Q_WRITE_TYPE( outmsg, outlen, queries[i].type);
+            MINIMR_DNS_Q_WRITE_CLASS( outmsg, outlen, queries[i].unicast_class );
+        }
+
+        final_nqueries = nqueries;
+    }
+
+    MINIMR_DEBUGF("added %d queries\n", final_nqueries);
+
+    uint8_t full = 0;
+
+    uint16_t final_nanswers = 0; // needed because there might be NULL entries
+
+    // add all normal answers RRs
+    for(uint16_t i = minimr_msg_start(cursor, MINIMR_MSG_SECTION_ANSWER); i < nanswers; i++){
+
+        if (answerrr[i] == NULL){
+            continue;
+        }
+
+        uint16_t nrr = 0;
+
+        //minimr_rr_fun_handler( minimr_rr_fun_get_rr, struct minimr_rr * rr,  uint8_t * outmsg, uint16_t * outlen, uint16_t outmsgmaxlen, uint16_t * nrr, void * user_data, struct minimr_name_dict * dict)
+        int32_t res = MINIMR_RR_OP_GET_RR(answerrr[i], outmsg, &outlen, outmsgmaxlen, &nrr, user_data, dict);
+
+        if (res != MINIMR_OK){
+            res = minimr_msg_overflow(cursor, MINIMR_MSG_SECTION_ANSWER, i, final_nqueries + final_nanswers == 0);
+            if (res != MINIMR_OK){
+                return MINIMR_DNS_HDR2_RCODE_SERVAIL;
+            }
+            full = 1;
+            break;
+        }
+
+        final_nanswers += nrr;
+    }
+
+    MINIMR_DEBUGF("added %d known answer rr\n", final_nanswers);
+
+    uint16_t final_nauthrr = 0;
+
+    // add all normal answers RRs
+    for(uint16_t i = minimr_msg_start(cursor, MINIMR_MSG_SECTION_AUTHORITY); !full && i < nauthrr; i++){
+
+        if (authrr[i] == NULL){
+            continue;
+        }
+
+        uint16_t nrr = 0;
+
+        int32_t res = MINIMR_RR_OP_GET_RR(authrr[i], outmsg, &outlen, outmsgmaxlen, &nrr, user_data, dict);
+
+        if (res != MINIMR_OK){
+            res = minimr_msg_overflow(cursor, MINIMR_MSG_SECTION_AUTHORITY, i, final_nqueries + final_nanswers + final_nauthrr == 0);
+            if (res != MINIMR_OK){
+                return MINIMR_DNS_HDR2_RCODE_SERVAIL;
+            }
+            full = 1;
+            break;
+        }
+
+        final_nauthrr += nrr;
+    }
+
+    MINIMR_DEBUGF("added %d extra rr\n", final_nauthrr);
+
+    uint16_t final_nextrarr = 0;
+
+    // add all normal answers RRs
+    for(uint16_t i = minimr_msg_start(cursor, MINIMR_MSG_SECTION_ADDITIONAL); !full && i < nextrarr; i++){
+
+        if (extrarr[i] == NULL){
+            continue;
+        }
+
+        uint16_t nrr = 0;
+
+        int32_t res = MINIMR_RR_OP_GET_RR(extrarr[i], outmsg, &outlen, outmsgmaxlen, &nrr, user_data, dict);
+
+        if (res != MINIMR_OK){
+            res = minimr_msg_overflow(cursor, MINIMR_MSG_SECTION_ADDITIONAL, i, final_nqueries + final_nanswers + final_nauthrr + final_nextrarr == 0);
+            if (res == MINIMR_IGNORE){
+                continue;
+            }
+            if (res != MINIMR_OK){
+                return MINIMR_DNS_HDR2_RCODE_SERVAIL;
+            }
+            full = 1;
+            break;
+        }
+
+        final_nextrarr += nrr;
+    }
+
+    MINIMR_DEBUGF("added %d extra rr\n", final_nextrarr);
+
+    if (cursor != NULL){
+
+        // nothing left but records that were skipped
+        if (final_nqueries + final_nanswers + final_nauthrr + final_nextrarr == 0 && cursor->section != MINIMR_MSG_SECTION_QUESTION){
+            cursor->section = MINIMR_MSG_SECTION_DONE;
+            return MINIMR_IGNORE;
+        }
+
+        if (full == 0){
+            cursor->section = MINIMR_MSG_SECTION_DONE;
+        } else if (nqueries > 0){
+            // more known answers follow (see https://tools.ietf.org/html/rfc6762#section-7.2 )
+            flag1 |= MINIMR_DNS_HDR1_TC;
+        }
+    }
+
+    // prepare outheader and out sanity check
+    struct minimr_dns_hdr outhdr;
+
+    // finalize header
+    outhdr.transaction_id = tid;
+
+    // set QR flag depending on queries given
+    flag1 = (flag1 & ~MINIMR_DNS_HDR1_QR) | (nqueries ? MINIMR_DNS_HDR1_QR_QUERY : MINIMR_DNS_HDR1_QR_REPLY);
+
+    // note: the AA flag is not set by default (because maybe, maybe you don't want to send an authorative answer ;)
+
+    outhdr.flags[0] = flag1;
+    outhdr.flags[1] = flag2;
+
+    outhdr.nqueries = final_nqueries;
+    outhdr.nanswers = final_nanswers;
+    outhdr.nauthrr = final_nauthrr;
+    outhdr.nextrarr = final_nextrarr;
+
+    // add header
+    minimr_dns_hdr_write(outmsg, &outhdr);
+
+    *outmsglen = outlen;
+
+    return MINIMR_OK;
+}
+
+int32_t  minimr_make_msg(
+        uint16_t tid, uint8_t flag1, uint8_t flag2,
+        struct minimr_query * queries, uint16_t nqueries,
+        struct minimr_rr ** answerrr, uint16_t nanswers,
+        struct minimr_rr ** authrr, uint16_t nauthrr,
+        struct minimr_rr ** extrarr, uint16_t nextrarr,
+        uint8_t *outmsg, uint16_t *outmsglen, uint16_t outmsgmaxlen,
+        void * user_data
+)
+{
+    return minimr_make(
+            tid, flag1, flag2,
+            queries, nqueries,
+            answerrr, nanswers,
+            authrr, nauthrr,
+            extrarr, nextrarr,
+            NULL,
+            outmsg, outmsglen, outmsgmaxlen,
+            user_data
+    );
+}
+
+int32_t  minimr_make_msg_next(
+        uint16_t tid, uint8_t flag1, uint8_t flag2,
+        struct minimr_query * queries, uint16_t nqueries,
+        struct minimr_rr ** answerrr, uint16_t nanswers,
+        struct minimr_rr ** authrr, uint16_t nauthrr,
+        struct minimr_rr ** extrarr, uint16_t nextrarr,
+        struct minimr_msg_cursor * cursor,
+        uint8_t *outmsg, uint16_t *outmsglen, uint16_t outmsgmaxlen,
+        void * user_data
+)
+{
+    MINIMR_ASSERT(cursor != NULL);
+
+    return minimr_make(
+            tid, flag1, flag2,
+            queries, nqueries,
+            answerrr, nanswers,
+            authrr, nauthrr,
+            extrarr, nextrarr,
+            cursor,
+            outmsg, outmsglen, outmsgmaxlen,
+            user_data
+    );
+}
+
+int32_t minimr_probequery_msg(
+        uint8_t * name1,
+        uint8_t * name2,
+        struct minimr_rr ** proposed_rrs, uint16_t nproposed_rrs,
+        uint8_t *outmsg, uint16_t *outmsglen, uint16_t outmsgmaxlen,
+        uint8_t request_unicast,
+        void * user_data
+)
+{
+    MINIMR_ASSERT(name1 != NULL);
+    MINIMR_ASSERT(proposed_rrs != NULL);
+    MINIMR_ASSERT(nproposed_rrs > 0);
+
+    struct minimr_query queries[2];
+
+    queries[0].unicast_class = MINIMR_DNS_CLASS_IN | (request_unicast ? MINIMR_DNS_QUNICAST : 0);
+    queries[0].type = MINIMR_DNS_TYPE_ANY;
+    queries[0].name = name1;
+
+    uint16_t nqueries = 1;
+
+    if (name2 != NULL){
+        queries[1].unicast_class = MINIMR_DNS_CLASS_IN | (request_unicast ? MINIMR_DNS_QUNICAST : 0);
+        queries[1].type = MINIMR_DNS_TYPE_ANY;
+        queries[1].name = name2;
+        nqueries++;
+    }
+
+    return minimr_make_msg(
+            0, 0, 0, // no special header
+            queries, nqueries,
+            NULL, 0, // no answer rrs
+            proposed_rrs, nproposed_rrs, // proposed records in auth section
+            NULL, 0, // no extra rrs
+            outmsg, outmsglen, outmsgmaxlen,
+            user_data
+    );
+}
+
+
+int32_t minimr_query_msg(
+        uint8_t * name1,
+        uint8_t * name2,
+        struct minimr_rr ** knownanswer_rrs, uint16_t nknownanswer_rrs,
+        uint8_t *outmsg, uint16_t *outmsglen, uint16_t outmsgmaxlen,
+        uint8_t request_unicast,
+        void * user_data
+)
+{
+    MINIMR_ASSERT(name1 != NULL);
+    MINIMR_ASSERT(nknownanswer_rrs == 0 | knownanswer_rrs != NULL);
+
+    struct minimr_query queries[2];
+
+    queries[0].type = MINIMR_DNS_TYPE_ANY;
+    queries[0].unicast_class = MINIMR_DNS_CLASS_IN | (request_unicast ? MINIMR_DNS_QUNICAST : 0);
+    queries[0].name = name1;
+
+    uint16_t nqueries = 1;
+
+    if (name2 != NULL){
+        queries[1].type = MINIMR_DNS_TYPE_ANY;
+        queries[1].unicast_class = MINIMR_DNS_CLASS_IN | (request_unicast ? MINIMR_DNS_QUNICAST : 0);
+        queries[1].name = name2;
+
+        nqueries++;
+    }
+
+    return minimr_make_msg(
+            0, 0, 0, // no special header
+            queries, nqueries,
+            knownanswer_rrs, nknownanswer_rrs,
+            NULL, 0, // no auth rrs
+            NULL, 0, // no extra rrs
+            outmsg, outmsglen, outmsgmaxlen,
+            user_data
+    );
+}
+
+static int32_t minimr_announce(
+    struct minimr_rr **records, uint16_t nrecords,
+    struct minimr_msg_cursor * cursor,
+    uint8_t *outmsg, uint16_t *outmsglen, uint16_t outmsgmaxlen,
+    void * user_data
+)
+{
+
+    // sanity check config
+    if (outmsgmaxlen <= MINIMR_DNS_HDR_SIZE){
+        return MINIMR_DNS_HDR2_RCODE_SERVAIL;
+    }
+
+    if (cursor != NULL && cursor->section == MINIMR_MSG_SECTION_DONE){
+        return MINIMR_IGNORE;
+    }
+
+    uint16_t outlen = MINIMR_DNS_HDR_SIZE;
+
+    MINIMR_NAME_DICT(dict);
+
+    uint8_t full = 0;
+
+    uint16_t nanswers = 0;
+
+    // add all normal answers RRs
+    for(uint16_t i = minimr_msg_start(cursor, MINIMR_MSG_SECTION_ANSWER); i < nrecords; i++){
+
+        if (records[i] == NULL){
+            continue;
+        }
+
+        uint16_t nrr = 0;
+
+        //minimr_rr_fun_handler( minimr_rr_fun_announce_get_*, struct minimr_rr * rr, uint8_t * outmsg, uint16_t * outlen, uint16_t outmsgmaxlen, uint16_t * nrr, void * user_data, struct minimr_name_dict * dict)
+        int32_t res = MINIMR_RR_OP_ANNOUNCE_GET_RR(records[i], outmsg, &outlen, outmsgmaxlen, &nrr, user_data, dict);
+
+        if (res != MINIMR_OK){
+            res = minimr_msg_overflow(cursor, MINIMR_MSG_SECTION_ANSWER, i, nanswers == 0);
+            if (res != MINIMR_OK){
+                return MINIMR_DNS_HDR2_RCODE_SERVAIL;
+            }
+            full = 1;
+            break;
+        }
+
+        nanswers += nrr;
+    }
+
+    MINIMR_DEBUGF("added %d answer rr\n", nanswers);
+
+    // add all additional RRs
+    uint16_t nextrarr = 0;
+    for(uint16_t i = minimr_msg_start(cursor, MINIMR_MSG_SECTION_ADDITIONAL); !full && i < nrecords; i++){
+
+        // don't check questions that have become irrelevant
+        if (records[i] == NULL){
+            continue;
+        }
+
+        uint16_t nrr = 0;
+
+        //minimr_rr_fun_handler( minimr_rr_fun_announce_get_*, struct minimr_rr * rr, uint8_t * outmsg, uint16_t * outlen, uint16_t outmsgmaxlen, uint16_t * nrr, void * user_data, struct minimr_name_dict * dict)
+        int32_t res = MINIMR_RR_OP_ANNOUNCE_GET_EXTRA_RRS(records[i], outmsg, &outlen, outmsgmaxlen, &nrr, user_data, dict);
+
+        if (res != MINIMR_OK){
+            res = minimr_msg_overflow(cursor, MINIMR_MSG_SECTION_ADDITIONAL, i, nanswers + nextrarr == 0);
+            if (res == MINIMR_IGNORE){
+                continue;
+            }
+            if (res != MINIMR_OK){
+                return MINIMR_DNS_HDR2_RCODE_SERVAIL;
+            }
+            full = 1;
+            break;
+        }
+
+        nextrarr += nrr;
+    }
+
+    MINIMR_DEBUGF("added %d extra rr\n", nextrarr);
+
+    if (cursor != NULL){
+
+        // nothing left but records that were skipped
+        if (nanswers + nextrarr == 0 && cursor->section != MINIMR_MSG_SECTION_QUESTION){
+            cursor->section = MINIMR_MSG_SECTION_DONE;
+            return MINIMR_IGNORE;
+        }
+
+        if (full == 0){
+            cursor->section = MINIMR_MSG_SECTION_DONE;
+        }
+    }
+
+    // prepare outheader and out sanity check
+    struct minimr_dns_hdr outhdr;
+
+    // finalize header
+    outhdr.transaction_id = 0;
+
+    outhdr.flags[0] = MINIMR_DNS_HDR1_QR_REPLY | MINIMR_DNS_HDR1_AA;
+    outhdr.flags[1] = MINIMR_DNS_HDR2_RCODE_NOERROR;
+
+    outhdr.nqueries = 0;
+    outhdr.nanswers = nanswers;
+    outhdr.nauthrr = 0;
+    outhdr.nextrarr = nextrarr;
+
+    // add header
+    minimr_dns_hdr_write(outmsg, &outhdr);
+
+    *outmsglen = outlen;
+
+    return MINIMR_DNS_HDR2_RCODE_NOERROR;
+}
+
+int32_t minimr_announce_msg(
+    struct minimr_rr **records, uint16_t nrecords,
+    uint8_t *outmsg, uint16_t *outmsglen, uint16_t outmsgmaxlen,
+    void * user_data
+)
+{
+    return minimr_announce(records, nrecords, NULL, outmsg, outmsglen, outmsgmaxlen, user_data);
+}
+
+int32_t minimr_announce_msg_next(
+    struct minimr_rr **records, uint16_t nrecords,
+    struct minimr_msg_cursor * cursor,
+    uint8_t *outmsg, uint16_t *outmsglen, uint16_t outmsgmaxlen,
+    void * user_data
+)
+{
+    MINIMR_ASSERT(cursor != NULL);
+
+    return minimr_announce(records, nrecords, cursor, outmsg, outmsglen, outmsgmaxlen, user_data);
+}
+
+
+int32_t minimr_terminate_msg(
+    struct minimr_rr **records, uint16_t nrecords,
+    uint8_t *outmsg, uint16_t *outmsglen, uint16_t outmsgmaxlen,
+    void * user_data
+)
+{
+    for(uint16_t i = 0; i < nrecords; i++){
+        if (records[i] == NULL){
+            continue;
+        }
+        records[i]->ttl = 0;
+    }
+
+    return minimr_announce_msg(records, nrecords, outmsg, outmsglen, outmsgmaxlen, user_data);
+}
+
+int32_t minimr_terminate_msg_next(
+    struct minimr_rr **records, uint16_t nrecords,
+    struct minimr_msg_cursor * cursor,
+    uint8_t *outmsg, uint16_t *outmsglen, uint16_t outmsgmaxlen,
+    void * user_data
+)
+{
+    MINIMR_ASSERT(cursor != NULL);
+
+    if (cursor->section == MINIMR_MSG_SECTION_QUESTION){
+        for(uint16_t i = 0; i < nrecords; i++){
+            if (records[i] == NULL){
+                continue;
+            }
+            records[i]->ttl = 0;
+        }
+    }
+
+    return minimr_announce(records, nrecords, cursor, outmsg, outmsglen, outmsgmaxlen, user_data);
+}
+
+
+
+
+
+/**
+ * Notes record <ir> as match for question qstats[*nq] and prepares the next qstat with the same question
+ * (such that multiple records can match the same question)
+ * @return MINIMR_OK        if there are qstats remaining
+ * @return MINIMR_NOT_OK    if used up all qstats
+ */
+static uint8_t minimr_query_add_match(struct minimr_query_stat qstats[], uint16_t * nq, uint16_t nqstats, uint16_t ir)
+{
+    uint16_t n = *nq;
+
+    qstats[n].relevant = 1;
+    qstats[n].match_i = ir;
+
+    n++;
+
+    *nq = n;
+
+    // if used up all qstats, abort
+    if (n >= nqstats){
+        return MINIMR_NOT_OK;
+    }
+
+    // duplicate qstat to test for matching of multiple records
+    qstats[n].type = qstats[n-1].type;
+    qstats[n].unicast_class = qstats[n-1].unicast_class;
+    qstats[n].name_offset = qstats[n-1].name_offset;
+    qstats[n].name_hash = qstats[n-1].name_hash;
+    qstats[n].relevant = 0;
+
+    return MINIMR_OK;
+}
+
+#define MINIMR_KNOWN_ANSWER_BITSET_WORDS ((MINIMR_KNOWN_ANSWER_BITSET_SIZE + 31) / 32)
+
+/**
+ * Marks record <ir> as suppressed: in the bitset or (if beyond) directly in the matched questions
+ */
+static void minimr_known_answer_suppress(uint32_t suppressed[], struct minimr_query_stat qstats[], uint16_t nq, uint16_t ir)
+{
+    if (ir < MINIMR_KNOWN_ANSWER_BITSET_SIZE){
+        suppressed[ir / 32] |= 1UL << (ir % 32);
+        return;
+    }
+
+    for(uint16_t iq = 0; iq < nq; iq++){
+        if (qstats[iq].match_i == ir){
+            qstats[iq].relevant = 0;
+        }
+    }
+}
+
+// TTL rules of minimr_known_answer_check(): known answers must have at least half of our TTL (see
+// https://tools.ietf.org/html/rfc6762#section-7.1 ), duplicate answers at least our TTL (see
+// https://tools.ietf.org/html/rfc6762#section-7.4 )
+#define MINIMR_KNOWN_ANSWER_TTL_HALF    1
+#define MINIMR_KNOWN_ANSWER_TTL_FULL    0
+
+/**
+ * Checks if known answer (rstat, with its name hash and lazily computed rdata digest) suppresses the answer of record
+ * (see https://tools.ietf.org/html/rfc6762#section-7.1 )
+ * @param ttl_rule  MINIMR_KNOWN_ANSWER_TTL_HALF or MINIMR_KNOWN_ANSWER_TTL_FULL
+ * @return MINIMR_OK        if suppressed
+ * @return MINIMR_NOT_OK    if not
+ */
+static uint8_t minimr_known_answer_check(struct minimr_rr * rr, struct minimr_rr_stat * rstat, uint32_t * digest, uint8_t * msg, uint16_t msglen, uint8_t ttl_rule, void * user_data)
+{
+    if (rstat->type != rr->type) return MINIMR_NOT_OK;
+
+    if ((rstat->cache_class & MINIMR_DNS_RRCLASS) != (rr->cache_class & MINIMR_DNS_RRCLASS)) return MINIMR_NOT_OK;
+
+    // answers with less than (half of) our TTL do not suppress our answer
+    if (rstat->ttl < (rr->ttl >> ttl_rule)) return MINIMR_NOT_OK;
+
+    // hashes can collide, so make sure it's the very same name
+    if (minimr_name_cmp(rr->name, rstat->name_offset, msg, msglen) != 0) return MINIMR_NOT_OK;
+
+    uint32_t rrdigest;
+
+    // if the rdata can not be compared, let the record decide (as it knows its rdata)
+    if (minimr_rr_digest_get(rr, user_data, &rrdigest) != MINIMR_OK){
+
+        //minimr_rr_fun_handler(minimr_rr_fun_query_respond_to, struct minimr_rr * rr, void * user_data)
+        return MINIMR_RR_OP_QUERY_RESPOND_TO(rr, user_data) == MINIMR_DO_NOT_RESPOND ? MINIMR_OK : MINIMR_NOT_OK;
+    }
+
+    // digest of known answer computed only once needed (0 if not yet)
+    if (*digest == 0 && minimr_rdata_digest(rstat->type, msg, rstat->data_offset, rstat->dlength, msglen, digest) != MINIMR_OK){
+        return MINIMR_NOT_OK;
+    }
+
+    if (*digest != rrdigest){
+        return MINIMR_NOT_OK;
+    }
+
+    // digests can collide, so make sure it's the very same rdata
+    return minimr_rr_rdata_equals(rr, user_data, msg, rstat->data_offset, rstat->dlength, msglen) ? MINIMR_OK : MINIMR_NOT_OK;
+}
+
+/**
+ * Known answer stage: processes the known answers (starting at <pos>) and marks the matched questions whose record
+ * is known already as irrelevant.
+ * Every known answer is looked up by its name hash (in the index, if given, otherwise among the matched questions)
+ * and every record is checked until it is suppressed only (tracked in a bitset), ie the cost is linear in the number
+ * of known answers.
+ * @return MINIMR_OK                        if all ok
+ * @return MINIMR_DNS_HDR2_RCODE_FORMERR    if a known answer is faulty
+ * @return MINIMR_DNS_HDR2_RCODE_SERVAIL    if server failed
+ */
+static uint8_t minimr_query_known_answers(
+        uint8_t * msg, uint16_t msglen, struct minimr_dns_hdr * hdr, uint16_t pos,
+        struct minimr_query_stat qstats[], uint16_t nq,
+        struct minimr_rr ** records, struct minimr_rr_index * index,
+        void * user_data
+)
+{
+    uint32_t suppressed[MINIMR_KNOWN_ANSWER_BITSET_WORDS];
+
+    for(uint16_t i = 0; i < MINIMR_KNOWN_ANSWER_BITSET_WORDS; i++){
+        suppressed[i] = 0;
+    }
+
+    // a truncated query (TC) might lack the announced known answers, which will follow in subsequent messages
+    for(uint16_t ia = 0; ia < hdr->nanswers && pos < msglen; ia++){
+
+        struct minimr_rr_stat rstat;
+
+        uint8_t res = minimr_extract_rr_stat(&rstat, msg, &pos, msglen);
+
+        // in case of a server fail, pass this along
+        if (res == MINIMR_DNS_HDR2_RCODE_SERVAIL) {
+            return MINIMR_DNS_HDR2_RCODE_SERVAIL;
+        }
+
+        if (res != MINIMR_OK){
+            // we could respond that it was a faulty query..
+            return MINIMR_DNS_HDR2_RCODE_FORMERR;
+        }
+
+        uint16_t end;
+        uint32_t hash;
+
+        if (minimr_name_walk(msg, rstat.name_offset, msglen, &end, &hash) != MINIMR_OK){
+            return MINIMR_DNS_HDR2_RCODE_FORMERR;
+        }
+
+        uint32_t digest = 0;
+
+        if (index != NULL){
+
+            for(uint16_t ie = MINIMR_RR_INDEX_FIRST(index, hash); ie != MINIMR_RR_INDEX_NONE; ie = index->entries[ie].next){
+
+                if (index->entries[ie].name_hash != hash || index->entries[ie].type != rstat.type) continue;
+
+                // record might have been removed from set
+                if (records[ie] == NULL) continue;
+
+                if (ie < MINIMR_KNOWN_ANSWER_BITSET_SIZE && (suppressed[ie / 32] & (1UL << (ie % 32)))) continue;
+
+                if (minimr_known_answer_check(records[ie], &rstat, &digest, msg, msglen, MINIMR_KNOWN_ANSWER_TTL_HALF, user_data) == MINIMR_OK){
+                    minimr_known_answer_suppress(suppressed, qstats, nq, ie);
+                }
+            }
+
+            continue;
+        }
+
+        for(uint16_t iq = 0; iq < nq; iq++){
+
+            uint16_t ir = qstats[iq].match_i;
+
+            if (qstats[iq].relevant == 0 || qstats[iq].name_hash != hash) continue;
+
+            if (ir < MINIMR_KNOWN_ANSWER_BITSET_SIZE && (suppressed[ir / 32] & (1UL << (ir % 32)))) continue;
+
+            if (minimr_known_answer_check(records[ir], &rstat, &digest, msg, msglen, MINIMR_KNOWN_ANSWER_TTL_HALF, user_data) == MINIMR_OK){
+                minimr_known_answer_suppress(suppressed, qstats, nq, ir);
+            }
+        }
+    }
+
+    for(uint16_t iq = 0; iq < nq; iq++){
+
+        uint16_t ir = qstats[iq].match_i;
+
+        if (ir < MINIMR_KNOWN_ANSWER_BITSET_SIZE && (suppressed[ir / 32] & (1UL << (ir % 32)))){
+            qstats[iq].relevant = 0;
+        }
+    }
+
+    return MINIMR_OK;
+}
+
+int32_t minimr_query_match(
+        uint8_t * msg, uint16_t msglen,
+        struct minimr_query_stat qstats[], uint16_t nqstats, uint16_t * nmatches,
+        struct minimr_rr ** records, uint16_t nrecords,
+        struct minimr_rr_index * index,
+        uint8_t *unicast_requested,
+        void * user_data
+)
+{
+    MINIMR_ASSERT(msg != NULL);
+    MINIMR_ASSERT(qstats != NULL);
+    MINIMR_ASSERT(nqstats > 0);
+    MINIMR_ASSERT(nmatches != NULL);
+    MINIMR_ASSERT(records != NULL || index != NULL);
+
+    // MINIMR_DEBUGF("\nnew msg %p (len %d)\n", msg, msglen);
+
+    // MINIMR_DEBUGF("msglen check\n");
+
+    // ignore messages that are not long enough to even have a complete header
+    if (msglen < MINIMR_DNS_HDR_SIZE){
+        return MINIMR_IGNORE;
+    }
+
+    struct minimr_dns_hdr hdr;
+
+    // read header info
+    minimr_dns_hdr_read(&hdr, msg);
+
+    // MINIMR_DEBUGF("is standard query?\n");
+
+    // not a (standard) query? ignore
+    // or no questions? nothing to do!
+    if ( (hdr.flags[0] & MINIMR_DNS_HDR1_QR) != MINIMR_DNS_HDR1_QR_QUERY ||
+         (hdr.flags[0] & MINIMR_DNS_HDR1_OPCODE) != MINIMR_DNS_HDR1_OPCODE_QUERY ||
+         hdr.nqueries == 0){
+
+        return MINIMR_IGNORE;
+    }
+
+
+    if (index != NULL){
+        records = index->records;
+        nrecords = index->nrecords;
+    }
+
+    uint16_t pos = MINIMR_DNS_HDR_SIZE;
+    uint16_t nq = 0;
+
+    *nmatches = 0;
+
+    // MINIMR_DEBUGF("checking %d questions\n", hdr.nqueries);
+
+    // note all relevant questions for us
+    // stored in stats as 0 - nq
+    for(uint16_t iq = 0; iq < hdr.nqueries && nq < nqstats && pos < msglen; iq++){
+
+        uint8_t res = minimr_extract_query_stat(&qstats[nq], msg, &pos, msglen);
+
+        // in case of a server fail, pass this along
+        if (res == MINIMR_DNS_HDR2_RCODE_SERVAIL) {
+            return MINIMR_DNS_HDR2_RCODE_SERVAIL;
+        }
+
+        if (res != MINIMR_OK){
+            // we could respond that it was a faulty query..
+            return MINIMR_DNS_HDR2_RCODE_FORMERR;
+        }
+
+        // reset relevant stat
+        qstats[nq].relevant = 0;
+
+        // MINIMR_DEBUGF("comparing question %d with %d records\n", iq,nrecords);
+
+        // look up only those records with the same name hash
+        if (index != NULL){
+
+            uint32_t hash = qstats[nq].name_hash;
+
+            for(uint16_t ie = MINIMR_RR_INDEX_FIRST(index, hash); ie != MINIMR_RR_INDEX_NONE; ie = index->entries[ie].next){
+
+                if (index->entries[ie].name_hash != hash) continue;
+
+                if (qstats[nq].type != MINIMR_DNS_TYPE_ANY && qstats[nq].type != index->entries[ie].type) continue;
+
+                // record might have been removed from set
+                if (records[ie] == NULL) continue;
+
+                if ((qstats[nq].unicast_class & MINIMR_DNS_QCLASS) != MINIMR_DNS_CLASS_ANY &&
+                    (qstats[nq].unicast_class & MINIMR_DNS_QCLASS) != (records[ie]->cache_class & MINIMR_DNS_RRCLASS) ) continue;
+
+                // hashes can collide, so make sure it's the very same name
+                if (minimr_name_cmp(records[ie]->name, qstats[nq].name_offset, msg, msglen) != 0) continue;
+
+                if (minimr_query_add_match(qstats, &nq, nqstats, ie) != MINIMR_OK){
+                    break;
+                }
+            }
+
+            continue;
+        }
+
+        for(uint16_t ir = 0; ir < nrecords; ir++){
+
+            // don't check if record not given
+            if (records[ir] == NULL){
+                continue;
+            }
+
+//            MINIMR_DEBUGF("check types %d == %d\n", qstats[nq].type, records[ir]->type);
+
+            if (qstats[nq].type != MINIMR_DNS_TYPE_ANY && qstats[nq].type != records[ir]->type) continue;
+
+//            MINIMR_DEBUGF("check class %d ANY or == %d\n", (qstats[nq].unicast_class & MINIMR_DNS_QCLASS), (records[ir]->cache_class & MINIMR_DNS_RRCLASS));
+
+            // unless ANY class was asked for check if classes match
+            if ((qstats[nq].unicast_class & MINIMR_DNS_QCLASS) != MINIMR_DNS_CLASS_ANY &&
+                (qstats[nq].unicast_class & MINIMR_DNS_QCLASS) != (records[ir]->cache_class & MINIMR_DNS_RRCLASS) ) continue;
+
+
+            // if name lengths don't match, there's no point checking names
+           res = minimr_name_cmp(records[ir]->name, qstats[nq].name_offset, msg, msglen);
+
+            if (res != 0) continue;
+
+            // so it's a match and we might consider responding
+            // but let's remember this question and the matching record and let's go to the next question
+
+            // MINIMR_DEBUGF("question %d matches record %d\n", iq, ir);
+
+            // TODO test multiple answers for same question
+
+            // if used up all qstats, abort
+            if (minimr_query_add_match(qstats, &nq, nqstats, ir) != MINIMR_OK){
+                break;
+            }
+        }
+
+    }
+
+    // MINIMR_DEBUGF("got %d relevant questions\n", nq);
+
+    // no questions we need to answer
+    if (nq == 0){
+        return MINIMR_IGNORE;
+    }
+
+    // now check all known answers
+    if (hdr.nanswers > 0){
+
+        uint8_t res = minimr_query_known_answers(msg, msglen, &hdr, pos, qstats, nq, records, index, user_data);
 
-                // type match?
-                if (rrfilters[i].type != MINIMR_DNS_TYPE_ANY && rrfilters[i].type != rstat.type){
-                    continue;
-                }
-                // class match?
-                if (rrfilters[i].fclass != MINIMR_DNS_CLASS_ANY && rrfilters[i].fclass != (rstat.cache_class & MINIMR_DNS_RRCLASS) ){
-                    continue;
-                }
+        if (res != MINIMR_OK){
+            return res;
+        }
+    }
 
-                if (minimr_name_cmp(rrfilters[i].name, rstat.name_offset, msg, msglen) == 0){
+    // note how many questions we actually have to answer (and if any asks for a unicast response)
+    uint16_t remaining_nq = 0;
+    uint8_t unicast_req = 0;
 
-                    rstat.match_i = i;
+    for(uint16_t iq = 0; iq < nq; iq++){
 
-                    // pass to user rr handler
-                    cont = rrhandler(&hdr, section, &rstat, msg, msglen, user_data);
-                }
-            }
+        if (qstats[iq].relevant == 0){
+            continue;
         }
 
-        if (cont != MINIMR_CONTINUE){
-            return MINIMR_OK;
+        remaining_nq++;
+
+        if ((qstats[iq].unicast_class & MINIMR_DNS_QUNICAST) == MINIMR_DNS_QUNICAST) {
+            unicast_req = 1;
         }
     }
 
+    // MINIMR_DEBUGF("remaining questions %d\n", remaining_nq);
+
+    *nmatches = nq;
+
+    // MINIMR_DEBUGF("unicast requested %d\n", unicast_req);
+    if (unicast_requested != NULL){
+        *unicast_requested = unicast_req;
+    }
+
+    // oh, all our records are known already! time for a coffee
+    if (remaining_nq == 0){
+        return MINIMR_IGNORE;
+    }
 
     return MINIMR_OK;
 }
 
-int32_t  minimr_make_msg(
-        uint16_t tid, uint8_t flag1, uint8_t flag2,
-        struct minimr_query * queries, uint16_t nqueries,
-        struct minimr_rr ** answerrr, uint16_t nanswers,
-        struct minimr_rr ** authrr, uint16_t nauthrr,
-        struct minimr_rr ** extrarr, uint16_t nextrarr,
-        uint8_t *outmsg, uint16_t *outmsglen, uint16_t outmsgmaxlen,
+/**
+ * Writes response to the relevant questions qstats[0 .. nq - 1] (as matched by minimr_query_match())
+ */
+static int32_t minimr_query_write(
+        uint16_t tid,
+        struct minimr_query_stat qstats[], uint16_t nq,
+        struct minimr_rr ** records,
+        struct minimr_msg_cursor * cursor,
+        uint8_t *outmsg, uint16_t * outmsglen, uint16_t outmsgmaxlen,
         void * user_data
 )
 {
-    MINIMR_ASSERT(nqueries == 0 || queries != NULL);
-    MINIMR_ASSERT(nanswers == 0 || answerrr != NULL);
-    MINIMR_ASSERT(nauthrr == 0 || authrr != NULL);
-    MINIMR_ASSERT(nextrarr == 0 || extrarr != NULL);
-    MINIMR_ASSERT(outmsg != NULL);
-    MINIMR_ASSERT(outmsglen != NULL);
-
-
     // sanity check config
     if (outmsgmaxlen <= MINIMR_DNS_HDR_SIZE){
         return MINIMR_DNS_HDR2_RCODE_SERVAIL;
     }
 
+    if (cursor != NULL && cursor->section == MINIMR_MSG_SECTION_DONE){
+        return MINIMR_IGNORE;
+    }
 
     uint16_t outlen = MINIMR_DNS_HDR_SIZE;
 
-    for (uint16_t i = 0; i < nqueries; i++){
+    MINIMR_NAME_DICT(dict);
+
+    uint8_t full = 0;
+
+    uint16_t nanswers = 0;
+
+    // MINIMR_DEBUGF("outlen %d\n", outlen);
+
+    // add all normal answers RRs
+    for(uint16_t iq = minimr_msg_start(cursor, MINIMR_MSG_SECTION_ANSWER); iq < nq; iq++){
+
+        // don't check questions that have become irrelevant
+        if (qstats[iq].relevant == 0){
+            continue;
+        }
+
+        struct minimr_rr * rr = records[qstats[iq].match_i];
+
+        uint16_t nrr = 0;
 
-        MINIMR_ASSERT(queries[i].name != NULL);
+        //minimr_rr_fun_handler( minimquery_get_*, struct minimr_rr * rr, struct minimr_query_stat * qstat, uint8_t * outmsg, uint16_t * outlen, uint16_t outmsgmaxlen, uint16_t * nrr, void * user_data, struct minimr_name_dict * dict)
+        int32_t res = MINIMR_RR_OP_QUERY_GET_RR(rr, &qstats[iq], outmsg, &outlen, outmsgmaxlen, &nrr, user_data, dict);
 
-        for(uint16_t j = 0; queries[i].name[j] != '\0'; j++){
-            if (outlen > outmsgmaxlen){
+        if (res != MINIMR_OK){
+            res = minimr_msg_overflow(cursor, MINIMR_MSG_SECTION_ANSWER, iq, nanswers == 0);
+            if (res != MINIMR_OK){
                 return MINIMR_DNS_HDR2_RCODE_SERVAIL;
             }
-            outmsg[outlen++] = queries[i].name[j];
-
-            // MINIMR_DEBUGF("%02x ", queries[i].name[j]);
+            full = 1;
+            break;
         }
-        // MINIMR_DEBUGF("\n");
 
-        if (outlen + 5 > outmsgmaxlen){
-            return MINIMR_DNS_HDR2_RCODE_SERVAIL;
+        nanswers += nrr;
+    }
+
+    // MINIMR_DEBUGF("added %d answer rr\n", nanswers);
+
+    // add all authority RRs
+    uint16_t nauthrr = 0;
+    for(uint16_t iq = minimr_msg_start(cursor, MINIMR_MSG_SECTION_AUTHORITY); !full && iq < nq; iq++){
+
+        // don't check questions that have become irrelevant
+        if (qstats[iq].relevant == 0){
+            continue;
         }
 
-        // name termination
-        outmsg[outlen++] = '\0';
+        struct minimr_rr * rr = records[qstats[iq].match_i];
 
-        MINIMR_DNS_Q_WRITE_TYPE( outmsg, outlen, queries[i].type);
-        MINIMR_DNS_Q_WRITE_CLASS( outmsg, outlen, queries[i].unicast_class );
-    }
+        uint16_t nrr = 0;
 
-    MINIMR_DEBUGF("added %d queries\n", nqueries);
+        //minimr_rr_fun_handler( minimquery_get_*, struct minimr_rr * rr, struct minimr_query_stat * qstat, uint8_t * outmsg, uint16_t * outlen, uint16_t outmsgmaxlen, uint16_t * nrr, void * user_data, struct minimr_name_dict * dict)
+        int32_t res = MINIMR_RR_OP_QUERY_GET_AUTHRR(rr, &qstats[iq], outmsg, &outlen, outmsgmaxlen, &nrr, user_data, dict);
 
-    uint16_t final_nanswers = 0; // needed because there might be NULL entries
+        if (res != MINIMR_OK){
+            res = minimr_msg_overflow(cursor, MINIMR_MSG_SECTION_AUTHORITY, iq, nanswers + nauthrr == 0);
+            if (res != MINIMR_OK){
+                return MINIMR_DNS_HDR2_RCODE_SERVAIL;
+            }
+            full = 1;
+            break;
+        }
 
-    // add all normal answers RRs
-    for(uint16_t i = 0; i < nanswers; i++){
+        nauthrr += nrr;
+    }
 
-        if (answerrr[i] == NULL){
+    // MINIMR_DEBUGF("added %d authority rr\n", nauthrr);
+
+    // add all additional RRs
+    uint16_t nextrarr = 0;
+    for(uint16_t iq = minimr_msg_start(cursor, MINIMR_MSG_SECTION_ADDITIONAL); !full && iq < nq; iq++){
+
+        // don't check questions that have become irrelevant
+        if (qstats[iq].relevant == 0){
             continue;
         }
 
+        struct minimr_rr * rr = records[qstats[iq].match_i];
+
         uint16_t nrr = 0;
 
-        //minimr_rr_fun_handler( minimr_rr_fun_get_rr, struct minimr_rr * rr,  uint8_t * outmsg, uint16_t * outlen, uint16_t outmsgmaxlen, uint16_t * nrr, void * user_data)
-        uint8_t res = answerrr[i]->MINIMR_RR_FUN_GET_RR(answerrr[i], outmsg, &outlen, outmsgmaxlen, &nrr, user_data);
+        //minimr_rr_fun_handler( minimquery_get_*, struct minimr_rr * rr, struct minimr_query_stat * qstat, uint8_t * outmsg, uint16_t * outlen, uint16_t outmsgmaxlen, uint16_t * nrr, void * user_data, struct minimr_name_dict * dict)
+        int32_t res = MINIMR_RR_OP_QUERY_GET_EXTRARR(rr, &qstats[iq], outmsg, &outlen, outmsgmaxlen, &nrr, user_data, dict);
 
         if (res != MINIMR_OK){
-            return MINIMR_DNS_HDR2_RCODE_SERVAIL;
+            res = minimr_msg_overflow(cursor, MINIMR_MSG_SECTION_ADDITIONAL, iq, nanswers + nauthrr + nextrarr == 0);
+            if (res == MINIMR_IGNORE){
+                continue;
+            }
+            if (res != MINIMR_OK){
+                return MINIMR_DNS_HDR2_RCODE_SERVAIL;
+            }
+            full = 1;
+            break;
         }
 
-        final_nanswers += nrr;
+        nextrarr += nrr;
     }
 
-    MINIMR_DEBUGF("added %d known answer rr\n", nanswers);
+    // MINIMR_DEBUGF("added %d extra rr\n", nextrarr);
 
-    uint16_t final_nauthrr = 0;
+    if (cursor != NULL){
 
-    // add all normal answers RRs
-    for(uint16_t i = 0; i < nauthrr; i++){
+        // nothing left but records that were skipped
+        if (nanswers + nauthrr + nextrarr == 0 && cursor->section != MINIMR_MSG_SECTION_QUESTION){
+            cursor->section = MINIMR_MSG_SECTION_DONE;
+            return MINIMR_IGNORE;
+        }
 
-        if (authrr[i] == NULL){
+        if (full == 0){
+            cursor->section = MINIMR_MSG_SECTION_DONE;
+        }
+    }
+
+    // prepare outheader and out sanity check
+    struct minimr_dns_hdr outhdr;
+
+
+    // finalize header
+    outhdr.transaction_id = tid; // is generally ignored (ie 0x0000) but included for legacy support..
+
+    outhdr.flags[0] = MINIMR_DNS_HDR1_QR_REPLY | MINIMR_DNS_HDR1_AA;
+    outhdr.flags[1] = MINIMR_DNS_HDR2_RCODE_NOERROR;
+
+    outhdr.nqueries = 0;
+    outhdr.nanswers = nanswers;
+    outhdr.nauthrr = nauthrr;
+    outhdr.nextrarr = nextrarr;
+
+    // add header
+    minimr_dns_hdr_write(outmsg, &outhdr);
+
+    *outmsglen = outlen;
+
+    return MINIMR_OK;
+}
+
+int32_t minimr_query_match_known_answers(
+        uint8_t * msg, uint16_t msglen,
+        struct minimr_query_stat qstats[], uint16_t nmatches,
+        struct minimr_rr ** records, uint16_t nrecords,
+        struct minimr_rr_index * index,
+        uint8_t *unicast_requested,
+        void * user_data
+)
+{
+    MINIMR_ASSERT(msg != NULL);
+    MINIMR_ASSERT(nmatches == 0 || qstats != NULL);
+    MINIMR_ASSERT(records != NULL || index != NULL);
+
+    if (msglen < MINIMR_DNS_HDR_SIZE){
+        return MINIMR_NOT_OK;
+    }
+
+    struct minimr_dns_hdr hdr;
+
+    minimr_dns_hdr_read(&hdr, msg);
+
+    if ( (hdr.flags[0] & MINIMR_DNS_HDR1_QR) != MINIMR_DNS_HDR1_QR_QUERY ||
+         (hdr.flags[0] & MINIMR_DNS_HDR1_OPCODE) != MINIMR_DNS_HDR1_OPCODE_QUERY){
+        return MINIMR_NOT_OK;
+    }
+
+    if (index != NULL){
+        records = index->records;
+        nrecords = index->nrecords;
+    }
+
+    // matches refer to records by index, records removed in the meantime are not answered anymore
+    for(uint16_t iq = 0; iq < nmatches; iq++){
+        if (qstats[iq].match_i >= nrecords || records[qstats[iq].match_i] == NULL){
+            qstats[iq].relevant = 0;
+        }
+    }
+
+    uint16_t pos = MINIMR_DNS_HDR_SIZE;
+
+    // continued known answer lists should not repeat the questions, but skip them anyways
+    for(uint16_t iq = 0; iq < hdr.nqueries; iq++){
+
+        struct minimr_query_stat qstat;
+
+        if (minimr_extract_query_stat(&qstat, msg, &pos, msglen) != MINIMR_OK){
+            return MINIMR_DNS_HDR2_RCODE_FORMERR;
+        }
+    }
+
+    if (hdr.nanswers > 0){
+
+        uint8_t res = minimr_query_known_answers(msg, msglen, &hdr, pos, qstats, nmatches, records, index, user_data);
+
+        if (res != MINIMR_OK){
+            return res;
+        }
+    }
+
+    uint16_t remaining_nq = 0;
+    uint8_t unicast_req = 0;
+
+    for(uint16_t iq = 0; iq < nmatches; iq++){
+
+        if (qstats[iq].relevant == 0){
+            continue;
+        }
+
+        remaining_nq++;
+
+        if ((qstats[iq].unicast_class & MINIMR_DNS_QUNICAST) == MINIMR_DNS_QUNICAST) {
+            unicast_req = 1;
+        }
+    }
+
+    if (unicast_requested != NULL){
+        *unicast_requested = unicast_req;
+    }
+
+    if (remaining_nq == 0){
+        return MINIMR_IGNORE;
+    }
+
+    return MINIMR_OK;
+}
+
+int32_t minimr_query_match_response_msg(
+        uint16_t tid,
+        struct minimr_query_stat qstats[], uint16_t nmatches,
+        struct minimr_rr ** records, uint16_t nrecords,
+        struct minimr_rr_index * index,
+        struct minimr_msg_cursor * cursor,
+        uint8_t *outmsg, uint16_t * outmsglen, uint16_t outmsgmaxlen,
+        void * user_data
+)
+{
+    MINIMR_ASSERT(nmatches == 0 || qstats != NULL);
+    MINIMR_ASSERT(records != NULL || index != NULL);
+    MINIMR_ASSERT(outmsg != NULL);
+    MINIMR_ASSERT(outmsglen != NULL);
+
+    if (index != NULL){
+        records = index->records;
+        nrecords = index->nrecords;
+    }
+
+    uint16_t remaining_nq = 0;
+
+    for(uint16_t iq = 0; iq < nmatches; iq++){
+
+        if (qstats[iq].relevant == 0){
+            continue;
+        }
+
+        // records might have been removed in the meantime
+        if (qstats[iq].match_i >= nrecords || records[qstats[iq].match_i] == NULL){
+            qstats[iq].relevant = 0;
             continue;
         }
 
-        uint16_t nrr = 0;
+        remaining_nq++;
+    }
+
+    if (remaining_nq == 0){
+        return MINIMR_IGNORE;
+    }
+
+    return minimr_query_write(tid, qstats, nmatches, records, cursor, outmsg, outmsglen, outmsgmaxlen, user_data);
+}
+
+static int32_t minimr_query_response(
+        uint8_t * msg, uint16_t msglen,
+        struct minimr_query_stat qstats[], uint16_t nqstats,
+        struct minimr_rr ** records, uint16_t nrecords,
+        struct minimr_rr_index * index,
+        struct minimr_response_cache * cache,
+        struct minimr_msg_cursor * cursor,
+        uint8_t *outmsg, uint16_t * outmsglen, uint16_t outmsgmaxlen,
+        uint8_t *unicast_requested,
+        void * user_data
+)
+{
+    MINIMR_ASSERT(outmsg != NULL);
+    MINIMR_ASSERT(outmsglen != NULL);
+    MINIMR_ASSERT(outmsgmaxlen > MINIMR_DNS_HDR_SIZE);
+
+    uint16_t nq = 0;
+    uint8_t unicast_req = 0;
+
+    int32_t res = minimr_query_match(msg, msglen, qstats, nqstats, &nq, records, nrecords, index, &unicast_req, user_data);
+
+    if (res != MINIMR_OK){
+        return res;
+    }
+
+    if (unicast_requested != NULL){
+        *unicast_requested = unicast_req;
+    }
 
-        uint8_t res = authrr[i]->MINIMR_RR_FUN_GET_RR(authrr[i], outmsg, &outlen, outmsgmaxlen, &nrr, user_data);
+    struct minimr_dns_hdr hdr;
 
-        if (res != MINIMR_OK){
-            return MINIMR_DNS_HDR2_RCODE_SERVAIL;
-        }
+    minimr_dns_hdr_read(&hdr, msg);
 
-        final_nauthrr += nrr;
+    // sanity check config
+    if (outmsgmaxlen <= MINIMR_DNS_HDR_SIZE){
+        return MINIMR_DNS_HDR2_RCODE_SERVAIL;
     }
 
-    MINIMR_DEBUGF("added %d extra rr\n", nauthrr);
+    struct minimr_response_cache_entry * centry = NULL;
+    uint32_t generation = cache != NULL ? *cache->generation : 0;
+    uint32_t fingerprint = MINIMR_NAME_HASH_INIT;
+    uint16_t key[MINIMR_RESPONSE_CACHE_KEY_SIZE];
+    uint16_t nkey = 0;
 
-    uint16_t final_nextrarr = 0;
+    // (only) complete responses are cached
+    if (cache != NULL && cursor == NULL){
 
-    // add all normal answers RRs
-    for(uint16_t i = 0; i < nextrarr; i++){
+        uint16_t nrelevant = 0;
 
-        if (extrarr[i] == NULL){
-            continue;
+        // fingerprint of the questions to be answered
+        for(uint16_t iq = 0; iq < nq; iq++){
+            if (qstats[iq].relevant == 0){
+                continue;
+            }
+            nrelevant++;
+            if (nkey + 3 > MINIMR_RESPONSE_CACHE_KEY_SIZE){
+                continue;
+            }
+            key[nkey++] = qstats[iq].match_i;
+            key[nkey++] = qstats[iq].type;
+            key[nkey++] = qstats[iq].unicast_class & MINIMR_DNS_QCLASS;
         }
 
-        uint16_t nrr = 0;
+        for(uint16_t i = 0; i < nkey; i++){
+            fingerprint = (fingerprint ^ (key[i] & 0xff)) * MINIMR_NAME_HASH_PRIME;
+            fingerprint = (fingerprint ^ (key[i] >> 8)) * MINIMR_NAME_HASH_PRIME;
+        }
+        fingerprint = (fingerprint ^ unicast_req) * MINIMR_NAME_HASH_PRIME;
 
-        uint8_t res = extrarr[i]->MINIMR_RR_FUN_GET_RR(extrarr[i], outmsg, &outlen, outmsgmaxlen, &nrr, user_data);
+        // too many questions to fit into key, don't cache
+        if (nkey / 3 == nrelevant){
+            centry = &cache->entries[fingerprint % cache->nentries];
+        }
+    }
 
-        if (res != MINIMR_OK){
-            return MINIMR_DNS_HDR2_RCODE_SERVAIL;
+    if (centry != NULL &&
+        centry->length > 0 &&
+        centry->generation == generation &&
+        centry->fingerprint == fingerprint &&
+        centry->unicast == unicast_req &&
+        centry->nkey == nkey &&
+        centry->length <= outmsgmaxlen){
+
+        uint16_t i = 0;
+        while(i < nkey && centry->key[i] == key[i]){
+            i++;
         }
 
-        final_nextrarr += nrr;
-    }
+        if (i == nkey){
 
-    MINIMR_DEBUGF("added %d extra rr\n", nextrarr);
+            for(i = 0; i < centry->length; i++){
+                outmsg[i] = centry->msg[i];
+            }
 
-    // prepare outheader and out sanity check
-    struct minimr_dns_hdr outhdr;
+            // is generally ignored (ie 0x0000) but included for legacy support..
+            outmsg[0] = (hdr.transaction_id >> 8) & 0xff;
+            outmsg[1] = hdr.transaction_id & 0xff;
 
-    // finalize header
-    outhdr.transaction_id = tid;
+            *outmsglen = centry->length;
 
-    // set QR flag depending on queries given
-    flag1 = (flag1 & ~MINIMR_DNS_HDR1_QR) | (nqueries ? MINIMR_DNS_HDR1_QR_QUERY : MINIMR_DNS_HDR1_QR_REPLY);
+            return MINIMR_OK;
+        }
+    }
 
-    // note: the AA flag is not set by default (because maybe, maybe you don't want to send an authorative answer ;)
+    res = minimr_query_write(hdr.transaction_id, qstats, nq, records, cursor, outmsg, outmsglen, outmsgmaxlen, user_data);
 
-    outhdr.flags[0] = flag1;
-    outhdr.flags[1] = flag2;
+    if (res != MINIMR_OK){
+        return res;
+    }
 
-    outhdr.nqueries = nqueries;
-    outhdr.nanswers = final_nanswers;
-    outhdr.nauthrr = final_nauthrr;
-    outhdr.nextrarr = final_nextrarr;
+    uint16_t outlen = *outmsglen;
 
-    // add header
-    minimr_dns_hdr_write(outmsg, &outhdr);
+    // remember response unless records changed in the meantime
+    if (centry != NULL && outlen <= centry->maxlen && generation == *cache->generation){
 
-    *outmsglen = outlen;
+        for(uint16_t i = 0; i < outlen; i++){
+            centry->msg[i] = outmsg[i];
+        }
+        for(uint16_t i = 0; i < nkey; i++){
+            centry->key[i] = key[i];
+        }
+
+        centry->generation = generation;
+        centry->fingerprint = fingerprint;
+        centry->unicast = unicast_req;
+        centry->nkey = nkey;
+        centry->length = outlen;
+    }
 
     return MINIMR_OK;
 }
 
-int32_t minimr_probequery_msg(
-        uint8_t * name1,
-        uint8_t * name2,
-        struct minimr_rr ** proposed_rrs, uint16_t nproposed_rrs,
-        uint8_t *outmsg, uint16_t *outmsglen, uint16_t outmsgmaxlen,
-        uint8_t request_unicast,
+int32_t minimr_query_response_msg(
+        uint8_t * msg, uint16_t msglen,
+        struct minimr_query_stat qstats[], uint16_t nqstats,
+        struct minimr_rr ** records, uint16_t nrecords,
+        uint8_t *outmsg, uint16_t * outmsglen, uint16_t outmsgmaxlen,
+        uint8_t *unicast_requested,
         void * user_data
 )
 {
-    MINIMR_ASSERT(name1 != NULL);
-    MINIMR_ASSERT(proposed_rrs != NULL);
-    MINIMR_ASSERT(nproposed_rrs > 0);
+    MINIMR_ASSERT(nrecords > 0);
 
-    struct minimr_query queries[2];
+    return minimr_query_response(
+            msg, msglen,
+            qstats, nqstats,
+            records, nrecords,
+            NULL,
+            NULL,
+            NULL,
+            outmsg, outmsglen, outmsgmaxlen,
+            unicast_requested,
+            user_data
+    );
+}
 
-    queries[0].unicast_class = MINIMR_DNS_CLASS_IN | (request_unicast ? MINIMR_DNS_QUNICAST : 0);
-    queries[0].type = MINIMR_DNS_TYPE_ANY;
-    queries[0].name = name1;
+int32_t minimr_indexed_query_response_msg(
+        uint8_t * msg, uint16_t msglen,
+        struct minimr_query_stat qstats[], uint16_t nqstats,
+        struct minimr_rr_index * index,
+        uint8_t *outmsg, uint16_t * outmsglen, uint16_t outmsgmaxlen,
+        uint8_t *unicast_requested,
+        void * user_data
+)
+{
+    MINIMR_ASSERT(index != NULL);
+
+    return minimr_query_response(
+            msg, msglen,
+            qstats, nqstats,
+            index->records, index->nrecords,
+            index,
+            NULL,
+            NULL,
+            outmsg, outmsglen, outmsgmaxlen,
+            unicast_requested,
+            user_data
+    );
+}
 
-    uint16_t nqueries = 1;
+int32_t minimr_query_response_msg_next(
+        uint8_t * msg, uint16_t msglen,
+        struct minimr_query_stat qstats[], uint16_t nqstats,
+        struct minimr_rr ** records, uint16_t nrecords,
+        struct minimr_rr_index * index,
+        struct minimr_msg_cursor * cursor,
+        uint8_t *outmsg, uint16_t * outmsglen, uint16_t outmsgmaxlen,
+        uint8_t *unicast_requested,
+        void * user_data
+)
+{
+    MINIMR_ASSERT(cursor != NULL);
 
-    if (name2 != NULL){
-        queries[1].unicast_class = MINIMR_DNS_CLASS_IN | (request_unicast ? MINIMR_DNS_QUNICAST : 0);
-        queries[1].type = MINIMR_DNS_TYPE_ANY;
-        queries[1].name = name2;
-        nqueries++;
+    if (index != NULL){
+        records = index->records;
+        nrecords = index->nrecords;
     }
 
-    return minimr_make_msg(
-            0, 0, 0, // no special header
-            queries, nqueries,
-            NULL, 0, // no answer rrs
-            proposed_rrs, nproposed_rrs, // proposed records in auth section
-            NULL, 0, // no extra rrs
+    MINIMR_ASSERT(nrecords > 0);
+
+    return minimr_query_response(
+            msg, msglen,
+            qstats, nqstats,
+            records, nrecords,
+            index,
+            NULL,
+            cursor,
             outmsg, outmsglen, outmsgmaxlen,
+            unicast_requested,
             user_data
     );
 }
 
+void minimr_response_cache_init(
+        struct minimr_response_cache * cache,
+        struct minimr_response_cache_entry * entries, uint16_t nentries,
+        uint8_t * buffer, uint16_t msgmaxlen,
+        volatile uint32_t * generation
+)
+{
+    MINIMR_ASSERT(cache != NULL);
+    MINIMR_ASSERT(entries != NULL);
+    MINIMR_ASSERT(nentries > 0);
+    MINIMR_ASSERT(buffer != NULL);
+    MINIMR_ASSERT(generation != NULL);
+
+    cache->entries = entries;
+    cache->nentries = nentries;
+    cache->generation = generation;
+
+    for(uint16_t i = 0; i < nentries; i++){
+        entries[i].msg = &buffer[i * msgmaxlen];
+        entries[i].maxlen = msgmaxlen;
+        entries[i].length = 0;
+    }
+}
 
-int32_t minimr_query_msg(
-        uint8_t * name1,
-        uint8_t * name2,
-        struct minimr_rr ** knownanswer_rrs, uint16_t nknownanswer_rrs,
-        uint8_t *outmsg, uint16_t *outmsglen, uint16_t outmsgmaxlen,
-        uint8_t request_unicast,
+int32_t minimr_cached_query_response_msg(
+        uint8_t * msg, uint16_t msglen,
+        struct minimr_query_stat qstats[], uint16_t nqstats,
+        struct minimr_rr ** records, uint16_t nrecords,
+        struct minimr_rr_index * index,
+        struct minimr_response_cache * cache,
+        uint8_t *outmsg, uint16_t * outmsglen, uint16_t outmsgmaxlen,
+        uint8_t *unicast_requested,
         void * user_data
 )
 {
-    MINIMR_ASSERT(name1 != NULL);
-    MINIMR_ASSERT(nknownanswer_rrs == 0 | knownanswer_rrs != NULL);
+    MINIMR_ASSERT(cache != NULL);
 
-    struct minimr_query queries[2];
-
-    queries[0].type = MINIMR_DNS_TYPE_ANY;
-    queries[0].unicast_class = MINIMR_DNS_CLASS_IN | (request_unicast ? MINIMR_DNS_QUNICAST : 0);
-    queries[0].name = name1;
-
-    uint16_t nqueries = 1;
-
-    if (name2 != NULL){
-        queries[1].type = MINIMR_DNS_TYPE_ANY;
-        queries[1].unicast_class = MINIMR_DNS_CLASS_IN | (request_unicast ? MINIMR_DNS_QUNICAST : 0);
-        queries[1].name = name2;
+    if (index != NULL){
+        records = index->records;
+        nrecords = index->nrecords;
     }
 
-    return minimr_make_msg(
-            0, 0, 0, // no special header
-            queries, nqueries,
-            knownanswer_rrs, nknownanswer_rrs,
-            NULL, 0, // no auth rrs
-            NULL, 0, // no extra rrs
+    MINIMR_ASSERT(nrecords > 0);
+
+    return minimr_query_response(
+            msg, msglen,
+            qstats, nqstats,
+            records, nrecords,
+            index,
+            cache,
+            NULL,
             outmsg, outmsglen, outmsgmaxlen,
+            unicast_requested,
             user_data
     );
 }
 
-int32_t minimr_announce_msg(
-    struct minimr_rr **records, uint16_t nrecords,
-    uint8_t *outmsg, uint16_t *outmsglen, uint16_t outmsgmaxlen,
-    void * user_data
+
+void minimr_question_table_init(
+        struct minimr_question_table * table,
+        struct minimr_question_table_entry * entries, uint16_t nentries,
+        uint32_t interval
 )
 {
+    MINIMR_ASSERT(table != NULL);
+    MINIMR_ASSERT(entries != NULL);
+    MINIMR_ASSERT(nentries > 0 && (nentries & (nentries - 1)) == 0);
 
-    // sanity check config
-    if (outmsgmaxlen <= MINIMR_DNS_HDR_SIZE){
-        return MINIMR_DNS_HDR2_RCODE_SERVAIL;
+    table->entries = entries;
+    table->nentries = nentries;
+    table->interval = interval;
+
+    for(uint16_t i = 0; i < nentries; i++){
+        entries[i].type = 0;
     }
+}
+
+/**
+ * Slot of question in table
+ */
+static struct minimr_question_table_entry * minimr_question_table_slot(struct minimr_question_table * table, uint32_t name_hash, uint16_t type, uint16_t qclass)
+{
+    uint32_t h = name_hash;
 
+    h = (h ^ type) * MINIMR_NAME_HASH_PRIME;
+    h = (h ^ qclass) * MINIMR_NAME_HASH_PRIME;
 
-    uint16_t outlen = MINIMR_DNS_HDR_SIZE;
+    return &table->entries[(h ^ (h >> 16)) & (table->nentries - 1)];
+}
 
-    uint16_t nanswers = 0;
+void minimr_question_table_note(struct minimr_question_table * table, struct minimr_dns_hdr * hdr, struct minimr_query_stat * qstat, uint32_t now)
+{
+    MINIMR_ASSERT(table != NULL);
+    MINIMR_ASSERT(hdr != NULL);
+    MINIMR_ASSERT(qstat != NULL);
+
+    // known answers (possibly in subsequent messages) might contain records we would not include, probes are no
+    // ordinary queries and the answer to QU questions is not multicast
+    if (hdr->nanswers > 0 || hdr->nauthrr > 0 || (hdr->flags[0] & MINIMR_DNS_HDR1_TC) ||
+        (qstat->unicast_class & MINIMR_DNS_QUNICAST) == MINIMR_DNS_QUNICAST || qstat->type == 0){
+        return;
+    }
 
-    // add all normal answers RRs
-    for(uint16_t i = 0; i < nrecords; i++){
+    uint16_t qclass = qstat->unicast_class & MINIMR_DNS_QCLASS;
 
-        if (records[i] == NULL){
-            continue;
-        }
+    struct minimr_question_table_entry * entry = minimr_question_table_slot(table, qstat->name_hash, qstat->type, qclass);
 
-        uint16_t nrr = 0;
+    entry->name_hash = qstat->name_hash;
+    entry->type = qstat->type;
+    entry->qclass = qclass;
+    entry->seen = now;
+}
 
-        //minimr_rr_fun_handler( minimr_rr_fun_announce_get_*, struct minimr_rr * rr, uint8_t * outmsg, uint16_t * outlen, uint16_t outmsgmaxlen, uint16_t * nrr, void * user_data)
-        uint8_t res = records[i]->MINIMR_RR_FUN_ANNOUNCE_GET_RR( records[i], outmsg, &outlen, outmsgmaxlen, &nrr, user_data);
+struct minimr_question_table_observation {
+    struct minimr_question_table * table;
+    uint32_t now;
+};
 
-        if (res != MINIMR_OK){
-            return MINIMR_DNS_HDR2_RCODE_SERVAIL;
-        }
+static uint8_t minimr_question_table_qhandler(struct minimr_dns_hdr * hdr, struct minimr_query_stat * qstat, uint8_t * msg, uint16_t msglen, void * user_data)
+{
+    struct minimr_question_table_observation * obs = user_data;
 
-        nanswers += nrr;
+    // no need to look at the questions of queries which can not be noted anyways
+    if (hdr->nanswers > 0 || hdr->nauthrr > 0 || (hdr->flags[0] & MINIMR_DNS_HDR1_TC)){
+        return MINIMR_ABORT;
     }
 
-    MINIMR_DEBUGF("added %d answer rr\n", nanswers);
+    minimr_question_table_note(obs->table, hdr, qstat, obs->now);
 
-    // add all additional RRs
-    uint16_t nextrarr = 0;
-    for(uint16_t i = 0; i < nrecords; i++){
+    return MINIMR_CONTINUE;
+}
 
-        // don't check questions that have become irrelevant
-        if (records[i] == NULL){
-            continue;
-        }
+int32_t minimr_question_table_observe(struct minimr_question_table * table, uint8_t * msg, uint16_t msglen, uint32_t now)
+{
+    MINIMR_ASSERT(table != NULL);
+    MINIMR_ASSERT(msg != NULL);
 
-        uint16_t nrr = 0;
+    struct minimr_question_table_observation obs = {
+        .table = table,
+        .now = now
+    };
 
-        //minimr_rr_fun_handler( minimr_rr_fun_announce_get_*, struct minimr_rr * rr, uint8_t * outmsg, uint16_t * outlen, uint16_t outmsgmaxlen, uint16_t * nrr, void * user_data)
-        uint8_t res = records[i]->MINIMR_RR_FUN_ANNOUNCE_GET_EXTRA_RRS( records[i], outmsg, &outlen, outmsgmaxlen, &nrr, user_data);
+    return minimr_parse_msg(msg, msglen, minimr_msgtype_query, minimr_question_table_qhandler, NULL, 0, NULL, NULL, 0, &obs);
+}
 
-        if (res != MINIMR_OK){
-            return MINIMR_DNS_HDR2_RCODE_SERVAIL;
-        }
+uint8_t minimr_question_table_seen(struct minimr_question_table * table, struct minimr_query * query, uint32_t now)
+{
+    MINIMR_ASSERT(table != NULL);
+    MINIMR_ASSERT(query != NULL);
+    MINIMR_ASSERT(query->name != NULL);
 
-        nextrarr += nrr;
+    // QU questions ask for a unicast response we would not get from the other host's query
+    if ((query->unicast_class & MINIMR_DNS_QUNICAST) == MINIMR_DNS_QUNICAST){
+        return MINIMR_NOT_OK;
     }
 
-    MINIMR_DEBUGF("added %d extra rr\n", nextrarr);
-
-    // prepare outheader and out sanity check
-    struct minimr_dns_hdr outhdr;
+    uint32_t name_hash = minimr_name_hash(query->name);
+    uint16_t qclass = query->unicast_class & MINIMR_DNS_QCLASS;
 
-    // finalize header
-    outhdr.transaction_id = 0;
+    struct minimr_question_table_entry * entry = minimr_question_table_slot(table, name_hash, query->type, qclass);
 
-    outhdr.flags[0] = MINIMR_DNS_HDR1_QR_REPLY | MINIMR_DNS_HDR1_AA;
-    outhdr.flags[1] = MINIMR_DNS_HDR2_RCODE_NOERROR;
+    if (entry->type != query->type || entry->qclass != qclass || entry->name_hash != name_hash){
+        return MINIMR_NOT_OK;
+    }
 
-    outhdr.nqueries = 0;
-    outhdr.nanswers = nanswers;
-    outhdr.nauthrr = 0;
-    outhdr.nextrarr = nextrarr;
+    // (wrapping) time since seen
+    if ((uint32_t)(now - entry->seen) >= table->interval){
+        return MINIMR_NOT_OK;
+    }
 
-    // add header
-    minimr_dns_hdr_write(outmsg, &outhdr);
+    return MINIMR_OK;
+}
 
-    *outmsglen = outlen;
+uint16_t minimr_question_table_filter(struct minimr_question_table * table, struct minimr_query * queries, uint16_t nqueries, uint32_t now)
+{
+    MINIMR_ASSERT(nqueries == 0 || queries != NULL);
 
-    return MINIMR_DNS_HDR2_RCODE_NOERROR;
-}
+    uint16_t n = 0;
 
+    for(uint16_t i = 0; i < nqueries; i++){
 
-int32_t minimr_terminate_msg(
-    struct minimr_rr **records, uint16_t nrecords,
-    uint8_t *outmsg, uint16_t *outmsglen, uint16_t outmsgmaxlen,
-    void * user_data
-)
-{
-    for(uint16_t i = 0; i < nrecords; i++){
-        if (records[i] == NULL){
+        if (minimr_question_table_seen(table, &queries[i], now) == MINIMR_OK){
             continue;
         }
-        records[i]->ttl = 0;
-    }
-    return minimr_announce_msg(records, nrecords, outmsg, outmsglen, outmsgmaxlen, user_data);
-}
-
-
 
+        queries[n++] = queries[i];
+    }
 
+    return n;
+}
 
-int32_t minimr_query_response_msg(
+uint16_t minimr_duplicate_answer_suppress(
+        struct minimr_pending_answer * pending, uint16_t npending,
         uint8_t * msg, uint16_t msglen,
-        struct minimr_query_stat qstats[], uint16_t nqstats,
         struct minimr_rr ** records, uint16_t nrecords,
-        uint8_t *outmsg, uint16_t * outmsglen, uint16_t outmsgmaxlen,
-        uint8_t *unicast_requested,
         void * user_data
 )
 {
-    MINIMR_ASSERT(msg != NULL);
-    MINIMR_ASSERT(qstats != NULL);
-    MINIMR_ASSERT(nqstats > 0);
-    MINIMR_ASSERT(records != NULL);
-    MINIMR_ASSERT(nrecords > 0);
-    MINIMR_ASSERT(outmsg != NULL);
-    MINIMR_ASSERT(outmsglen != NULL);
-    MINIMR_ASSERT(outmsgmaxlen > MINIMR_DNS_HDR_SIZE);
-
-    // MINIMR_DEBUGF("\nnew msg %p (len %d)\n", msg, msglen);
-
-    // MINIMR_DEBUGF("msglen check\n");
+    MINIMR_ASSERT(npending == 0 || pending != NULL);
+    MINIMR_ASSERT(msg != NULL);
+    MINIMR_ASSERT(records != NULL);
 
-    // ignore messages that are not long enough to even have a complete header
-    if (msglen < MINIMR_DNS_HDR_SIZE){
-        return MINIMR_IGNORE;
+    if (npending == 0 || msglen < MINIMR_DNS_HDR_SIZE){
+        return npending;
     }
 
     struct minimr_dns_hdr hdr;
 
-    // read header info
     minimr_dns_hdr_read(&hdr, msg);
 
-    // MINIMR_DEBUGF("is standard query?\n");
+    // only (standard) responses
+    if ( (hdr.flags[0] & MINIMR_DNS_HDR1_QR) != MINIMR_DNS_HDR1_QR_REPLY ||
+         (hdr.flags[0] & MINIMR_DNS_HDR1_OPCODE) != MINIMR_DNS_HDR1_OPCODE_QUERY){
+        return npending;
+    }
 
-    // not a (standard) query? ignore
-    // or no questions? nothing to do!
-    if ( (hdr.flags[0] & MINIMR_DNS_HDR1_QR) != MINIMR_DNS_HDR1_QR_QUERY ||
-         (hdr.flags[0] & MINIMR_DNS_HDR1_OPCODE) != MINIMR_DNS_HDR1_OPCODE_QUERY ||
-         hdr.nqueries == 0){
+    uint16_t pos = MINIMR_DNS_HDR_SIZE;
 
-        return MINIMR_IGNORE;
-    }
+    // skip any questions
+    for(uint16_t iq = 0; iq < hdr.nqueries && pos < msglen; iq++){
 
+        struct minimr_query_stat qstat;
 
-    uint16_t pos = MINIMR_DNS_HDR_SIZE;
-    uint16_t nq = 0;
+        if (minimr_extract_query_stat(&qstat, msg, &pos, msglen) != MINIMR_OK){
+            return npending;
+        }
+    }
 
-    // MINIMR_DEBUGF("checking %d questions\n", hdr.nqueries);
+    uint16_t nrr = hdr.nanswers + hdr.nauthrr + hdr.nextrarr;
 
-    // note all relevant questions for us
-    // stored in stats as 0 - nq
-    for(uint16_t iq = 0; iq < hdr.nqueries && nq < nqstats && pos < msglen; iq++){
+    for(uint16_t ir = 0; ir < nrr && pos < msglen && npending > 0; ir++){
 
-        uint8_t res = minimr_extract_query_stat(&qstats[nq], msg, &pos, msglen);
+        struct minimr_rr_stat rstat;
 
-        // in case of a server fail, pass this along
-        if (res == MINIMR_DNS_HDR2_RCODE_SERVAIL) {
-            return MINIMR_DNS_HDR2_RCODE_SERVAIL;
+        if (minimr_extract_rr_stat(&rstat, msg, &pos, msglen) != MINIMR_OK){
+            return npending;
         }
 
-        if (res != MINIMR_OK){
-            // we could respond that it was a faulty query..
-            return MINIMR_DNS_HDR2_RCODE_FORMERR;
+        // authority records (of probes) are no answers
+        if (hdr.nanswers <= ir && ir < hdr.nanswers + hdr.nauthrr){
+            continue;
         }
 
-        // reset relevant stat
-        qstats[nq].relevant = 0;
-
-        // MINIMR_DEBUGF("comparing question %d with %d records\n", iq,nrecords);
+        // digest of answer computed only once needed (0 if not yet)
+        uint32_t digest = 0;
 
-        for(uint16_t ir = 0; ir < nrecords; ir++){
+        uint16_t n = 0;
 
-            // don't check if record not given
-            if (records[ir] == NULL){
-                continue;
-            }
+        for(uint16_t ip = 0; ip < npending; ip++){
 
-//            MINIMR_DEBUGF("check types %d == %d\n", qstats[nq].type, records[ir]->type);
+            struct minimr_rr * rr = pending[ip].record < nrecords ? records[pending[ip].record] : NULL;
 
-            if (qstats[nq].type != MINIMR_DNS_TYPE_ANY && qstats[nq].type != records[ir]->type) continue;
+            if (rr != NULL &&
+                MINIMR_RR_IS_SHARED(rr) &&
+                minimr_known_answer_check(rr, &rstat, &digest, msg, msglen, MINIMR_KNOWN_ANSWER_TTL_FULL, user_data) == MINIMR_OK){
 
-//            MINIMR_DEBUGF("check class %d ANY or == %d\n", (qstats[nq].unicast_class & MINIMR_DNS_QCLASS), (records[ir]->cache_class & MINIMR_DNS_RRCLASS));
+                // considered sent
+                continue;
+            }
 
-            // unless ANY class was asked for check if classes match
-            if ((qstats[nq].unicast_class & MINIMR_DNS_QCLASS) != MINIMR_DNS_CLASS_ANY &&
-                (qstats[nq].unicast_class & MINIMR_DNS_QCLASS) != (records[ir]->cache_class & MINIMR_DNS_RRCLASS) ) continue;
+            pending[n++] = pending[ip];
+        }
 
+        npending = n;
+    }
 
-            // if name lengths don't match, there's no point checking names
-           res = minimr_name_cmp(records[ir]->name, qstats[nq].name_offset, msg, msglen);
+    return npending;
+}
 
-            if (res != 0) continue;
+uint16_t minimr_known_answer_cancel(
+        struct minimr_pending_answer * pending, uint16_t npending,
+        uint8_t * msg, uint16_t msglen,
+        struct minimr_rr ** records, uint16_t nrecords,
+        void * user_data
+)
+{
+    MINIMR_ASSERT(npending == 0 || pending != NULL);
+    MINIMR_ASSERT(msg != NULL);
+    MINIMR_ASSERT(records != NULL);
 
-            // so it's a match and we might consider responding
-            // but let's remember this question and the matching record and let's go to the next question
+    if (npending == 0 || msglen < MINIMR_DNS_HDR_SIZE){
+        return npending;
+    }
 
-            qstats[nq].relevant = 1;
-            qstats[nq].match_i = ir;
+    struct minimr_dns_hdr hdr;
 
-            nq++;
+    minimr_dns_hdr_read(&hdr, msg);
 
-            // MINIMR_DEBUGF("question %d matches record %d\n", iq, ir);
+    // only (standard) queries
+    if ( (hdr.flags[0] & MINIMR_DNS_HDR1_QR) != MINIMR_DNS_HDR1_QR_QUERY ||
+         (hdr.flags[0] & MINIMR_DNS_HDR1_OPCODE) != MINIMR_DNS_HDR1_OPCODE_QUERY){
+        return npending;
+    }
 
-            // TODO test multiple answers for same question
+    uint16_t pos = MINIMR_DNS_HDR_SIZE;
 
-            // if used up all qstats, abort
-            if (nq > nqstats){
-                break;
-            }
+    // skip any questions
+    for(uint16_t iq = 0; iq < hdr.nqueries && pos < msglen; iq++){
 
-            // duplicate qstat to test for matching of multiple records
-            qstats[nq].type = qstats[nq-1].type;
-            qstats[nq].unicast_class = qstats[nq-1].unicast_class;
-            qstats[nq].name_offset = qstats[nq-1].name_offset;
-            qstats[nq].relevant = 0;
+        struct minimr_query_stat qstat;
 
+        if (minimr_extract_query_stat(&qstat, msg, &pos, msglen) != MINIMR_OK){
+            return npending;
         }
-
     }
 
-    // MINIMR_DEBUGF("got %d relevant questions\n", nq);
-
-    // no questions we need to answer
-    if (nq == 0){
-        return MINIMR_IGNORE;
-    }
+    // known answers are in the answer section only
+    for(uint16_t ir = 0; ir < hdr.nanswers && pos < msglen && npending > 0; ir++){
 
-    // init to false;
-    uint8_t unicast_req = 0;
+        struct minimr_rr_stat rstat;
 
-    // MINIMR_DEBUGF("checking known answers\n");
+        if (minimr_extract_rr_stat(&rstat, msg, &pos, msglen) != MINIMR_OK){
+            return npending;
+        }
 
-    // note how many questions we actually have to answer
-    // (can change after checking the known answers)
-    uint16_t remaining_nq = nq;
+        // digest of known answer computed only once needed (0 if not yet)
+        uint32_t digest = 0;
 
-    // now check all known answers
-    if (hdr.nanswers > 0){
+        uint16_t n = 0;
 
-        for(uint16_t ia = 0; ia < hdr.nanswers && nq < nqstats && pos < msglen; ia++){
+        for(uint16_t ip = 0; ip < npending; ip++){
 
-            struct minimr_rr_stat rstat;
+            struct minimr_rr * rr = pending[ip].record < nrecords ? records[pending[ip].record] : NULL;
 
-            uint8_t res = minimr_extract_rr_stat(&rstat, msg, &pos, msglen);
+            if (rr != NULL &&
+                pending[ip].truncated &&
+                minimr_known_answer_check(rr, &rstat, &digest, msg, msglen, MINIMR_KNOWN_ANSWER_TTL_HALF, user_data) == MINIMR_OK){
 
-            // in case of a server fail, pass this along
-            if (res == MINIMR_DNS_HDR2_RCODE_SERVAIL) {
-                return MINIMR_DNS_HDR2_RCODE_SERVAIL;
+                // known already
+                continue;
             }
 
-            if (res != MINIMR_OK){
-                // we could respond that it was a faulty query..
-                return MINIMR_DNS_HDR2_RCODE_FORMERR;
-            }
+            pending[n++] = pending[ip];
+        }
 
-            // check if the known answer relates to any of the relevant questions
+        npending = n;
+    }
 
-            for(uint16_t iq = 0; iq < nq; iq++){
+    return npending;
+}
 
-                // same type?
-                if (rstat.type != qstats[iq].type) continue;
+void minimr_rr_index_init(
+        struct minimr_rr_index * index,
+        struct minimr_rr ** records, uint16_t maxrecords,
+        struct minimr_rr_index_entry * entries,
+        uint16_t * buckets, uint16_t nbuckets
+)
+{
+    MINIMR_ASSERT(index != NULL);
+    MINIMR_ASSERT(records != NULL);
+    MINIMR_ASSERT(maxrecords < MINIMR_RR_INDEX_NONE);
+    MINIMR_ASSERT(entries != NULL);
+    MINIMR_ASSERT(buckets != NULL);
+    MINIMR_ASSERT(nbuckets > 0 && (nbuckets & (nbuckets - 1)) == 0); // power of two
 
-                // same class?
-                if ((rstat.cache_class & MINIMR_DNS_RRCLASS) != (qstats[iq].unicast_class & MINIMR_DNS_QCLASS) ) continue;
+    index->records = records;
+    index->nrecords = 0;
+    index->maxrecords = maxrecords;
 
+    index->entries = entries;
 
-                // only check name if name offsets do not match
-                if (rstat.name_offset != qstats[iq].name_offset){
+    index->buckets = buckets;
+    index->nbuckets = nbuckets;
 
-                    // if name lengths don't match, there's no point checking names
-                    res = minimr_name_cmp(records[qstats[iq].match_i]->name, qstats[iq].name_offset, msg, msglen);
+    for(uint16_t i = 0; i < nbuckets; i++){
+        buckets[i] = MINIMR_RR_INDEX_NONE;
+    }
+}
 
-                    if (res != 0) continue;
-                }
+/**
+ * Links record slot <i> into its bucket
+ */
+static void minimr_rr_index_link(struct minimr_rr_index * index, uint16_t i)
+{
+    struct minimr_rr * rr = index->records[i];
 
-                // so it's a match and we have to check wether it's up to date
-                struct minimr_rr * rr = records[qstats[iq].match_i];
+    index->entries[i].name_hash = minimr_name_hash(rr->name);
+    index->entries[i].type = rr->type;
 
-                //minimr_rr_fun_handler(minimr_rr_fun_query_respond_to, struct minimr_rr * rr, void * user_data)
-                if (rr->MINIMR_RR_FUN_QUERY_RESPOND_TO(rr, user_data) == MINIMR_DO_NOT_RESPOND){
-                    qstats[iq].relevant = 0;
-                    remaining_nq--;
-                } else if ((qstats[iq].unicast_class & MINIMR_DNS_QUNICAST) == MINIMR_DNS_QUNICAST) {
-                    unicast_req = 1;
-                }
+    uint16_t * bucket = &MINIMR_RR_INDEX_FIRST(index, index->entries[i].name_hash);
 
-                break;
-            }
+    index->entries[i].next = *bucket;
+    *bucket = i;
+}
 
-        }
+/**
+ * Unlinks record slot <i> from its bucket (walks the bucket chain only)
+ */
+static void minimr_rr_index_unlink(struct minimr_rr_index * index, uint16_t i)
+{
+    uint16_t * link = &MINIMR_RR_INDEX_FIRST(index, index->entries[i].name_hash);
 
-        // msg seems to be faulty, stop processing
-        if (pos >= msglen){
-            return MINIMR_DNS_HDR2_RCODE_FORMERR;
+    while (*link != MINIMR_RR_INDEX_NONE){
+        if (*link == i){
+            *link = index->entries[i].next;
+            return;
         }
+        link = &index->entries[*link].next;
     }
+}
 
-    // MINIMR_DEBUGF("remaining questions %d\n", remaining_nq);
+int32_t minimr_rr_index_add(struct minimr_rr_index * index, struct minimr_rr * rr)
+{
+    MINIMR_ASSERT(index != NULL);
+    MINIMR_ASSERT(rr != NULL);
 
-    // oh, all our records are known already! time for a coffee
-    if (remaining_nq == 0){
-        return MINIMR_IGNORE;
+    if (index->nrecords >= index->maxrecords){
+        return MINIMR_NOT_OK;
     }
 
+    uint16_t i = index->nrecords++;
 
-    // sanity check config
-    if (outmsgmaxlen <= MINIMR_DNS_HDR_SIZE){
-        return MINIMR_DNS_HDR2_RCODE_SERVAIL;
+    index->records[i] = rr;
+
+    minimr_rr_index_link(index, i);
+
+    return MINIMR_OK;
+}
+
+int32_t minimr_rr_index_remove(struct minimr_rr_index * index, uint16_t i)
+{
+    MINIMR_ASSERT(index != NULL);
+
+    if (i >= index->nrecords){
+        return MINIMR_NOT_OK;
     }
 
-    // MINIMR_DEBUGF("unicast requested %d\n", unicast_req);
-    if (unicast_requested != NULL){
-        *unicast_requested = unicast_req;
+    if (index->records[i] != NULL){
+        minimr_rr_index_unlink(index, i);
     }
 
+    uint16_t last = --index->nrecords;
 
-    uint16_t outlen = MINIMR_DNS_HDR_SIZE;
+    if (i != last){
 
-    uint16_t nanswers = 0;
+        // move last record into the gap (its hash is kept)
+        if (index->records[last] != NULL){
+            minimr_rr_index_unlink(index, last);
+        }
 
-    // MINIMR_DEBUGF("outlen %d\n", outlen);
+        index->records[i] = index->records[last];
+        index->entries[i] = index->entries[last];
 
-    // add all normal answers RRs
-    for(uint16_t iq = 0; iq < nq; iq++){
+        if (index->records[i] != NULL){
+            uint16_t * bucket = &MINIMR_RR_INDEX_FIRST(index, index->entries[i].name_hash);
 
-        // don't check questions that have become irrelevant
-        if (qstats[iq].relevant == 0){
-            continue;
+            index->entries[i].next = *bucket;
+            *bucket = i;
         }
+    }
 
-        struct minimr_rr * rr = records[qstats[iq].match_i];
+    index->records[last] = NULL;
 
-        uint16_t nrr = 0;
+    return MINIMR_OK;
+}
+
+void minimr_rr_index_build(
+        struct minimr_rr_index * index,
+        struct minimr_rr ** records, uint16_t nrecords,
+        struct minimr_rr_index_entry * entries,
+        uint16_t * buckets, uint16_t nbuckets
+)
+{
+    minimr_rr_index_init(index, records, nrecords, entries, buckets, nbuckets);
 
-        //minimr_rr_fun_handler( minimquery_get_*, struct minimr_rr * rr, struct minimr_query_stat * qstat, uint8_t * outmsg, uint16_t * outlen, uint16_t outmsgmaxlen, uint16_t * nrr, void * user_data)
-        uint8_t res = rr->MINIMR_RR_FUN_QUERY_GET_RR(rr, &qstats[iq], outmsg, &outlen, outmsgmaxlen, &nrr, user_data);
+    index->nrecords = nrecords;
 
-        if (res != MINIMR_OK){
-            return MINIMR_DNS_HDR2_RCODE_SERVAIL;
+    for(uint16_t i = 0; i < nrecords; i++){
+
+        // NULL records are kept in the set but can not be indexed
+        if (records[i] == NULL){
+            entries[i].next = MINIMR_RR_INDEX_NONE;
+            continue;
         }
 
-        nanswers += nrr;
+        minimr_rr_index_link(index, i);
     }
+}
 
-    // MINIMR_DEBUGF("added %d answer rr\n", nanswers);
 
-    // add all authority RRs
-    uint16_t nauthrr = 0;
-    for(uint16_t iq = 0; iq < nq; iq++){
+#if MINIMR_RR_TYPE_DEFAULT_COUNT > 0
 
-        // don't check questions that have become irrelevant
-        if (qstats[iq].relevant == 0){
-            continue;
+/**
+ * Writes RDATA of default type record
+ */
+static uint8_t minimr_default_rr_write_rdata(struct minimr_rr * rr, uint8_t * outmsg, uint16_t * outlen, uint16_t outmsgmaxlen, struct minimr_name_dict * dict)
+{
+    uint16_t l = *outlen;
+    uint8_t res;
+
+    if (0){
+        // :)
+    }
+#if MINIMR_RR_TYPE_A_DEFAULT
+    else if (rr->type == MINIMR_DNS_TYPE_A) {
+        res = minimr_rr_write_data(((minimr_rr_a*)rr)->ipv4, 4, outmsg, &l, outmsgmaxlen);
+    }
+#endif
+#if MINIMR_RR_TYPE_AAAA_DEFAULT
+    else if (rr->type == MINIMR_DNS_TYPE_AAAA) {
+        res = MINIMR_NOT_OK;
+        if (l + 16 <= outmsgmaxlen){
+            for(uint8_t i = 0; i < 8; i++){
+                outmsg[l++] = (((minimr_rr_aaaa*)rr)->ipv6[i] >> 8) & 0xff;
+                outmsg[l++] = ((minimr_rr_aaaa*)rr)->ipv6[i] & 0xff;
+            }
+            res = MINIMR_OK;
+        }
+    }
+#endif
+#if MINIMR_RR_TYPE_PTR_DEFAULT
+    else if (rr->type == MINIMR_DNS_TYPE_PTR) {
+        res = minimr_name_write(outmsg, &l, outmsgmaxlen, ((minimr_rr_ptr*)rr)->domain, dict);
+    }
+#endif
+#if MINIMR_RR_TYPE_SRV_DEFAULT
+    else if (rr->type == MINIMR_DNS_TYPE_SRV) {
+        res = MINIMR_NOT_OK;
+        if (l + 6 <= outmsgmaxlen){
+            outmsg[l++] = (((minimr_rr_srv*)rr)->priority >> 8) & 0xff;
+            outmsg[l++] = ((minimr_rr_srv*)rr)->priority & 0xff;
+            outmsg[l++] = (((minimr_rr_srv*)rr)->weight >> 8) & 0xff;
+            outmsg[l++] = ((minimr_rr_srv*)rr)->weight & 0xff;
+            outmsg[l++] = (((minimr_rr_srv*)rr)->port >> 8) & 0xff;
+            outmsg[l++] = ((minimr_rr_srv*)rr)->port & 0xff;
+            res = minimr_name_write(outmsg, &l, outmsgmaxlen, ((minimr_rr_srv*)rr)->target, dict);
         }
+    }
+#endif
+#if MINIMR_RR_TYPE_TXT_DEFAULT
+    else if (rr->type == MINIMR_DNS_TYPE_TXT) {
+        res = minimr_rr_write_data(((minimr_rr_txt*)rr)->txt, ((minimr_rr_txt*)rr)->txt_length, outmsg, &l, outmsgmaxlen);
+    }
+#endif
+    else {
+        MINIMR_DEBUGF("Unrecognized record type: %d", rr->type);
+        res = MINIMR_NOT_OK;
+    }
 
-        struct minimr_rr * rr = records[qstats[iq].match_i];
+    if (res == MINIMR_OK){
+        *outlen = l;
+    }
 
-        uint16_t nrr = 0;
+    return res;
+}
 
-        //minimr_rr_fun_handler( minimquery_get_*, struct minimr_rr * rr, struct minimr_query_stat * qstat, uint8_t * outmsg, uint16_t * outlen, uint16_t outmsgmaxlen, uint16_t * nrr, void * user_data)
-        uint8_t res = rr->MINIMR_RR_FUN_QUERY_GET_AUTHRR(rr, &qstats[iq], outmsg, &outlen, outmsgmaxlen, &nrr, user_data);
+uint8_t minimr_default_rr_write(struct minimr_rr * rr, uint8_t * outmsg, uint16_t * outlen, uint16_t outmsgmaxlen, struct minimr_name_dict * dict)
+{
+    MINIMR_ASSERT(rr != NULL);
+    MINIMR_ASSERT(outmsg != NULL);
+    MINIMR_ASSERT(outlen != NULL);
 
-        if (res != MINIMR_OK){
-            return MINIMR_DNS_HDR2_RCODE_SERVAIL;
-        }
+#if MINIMR_RR_WIRE_TEMPLATE_USE == 1
+    uint8_t wres = minimr_rr_wire_write(rr, outmsg, outlen, outmsgmaxlen, dict);
+    if (wres != MINIMR_IGNORE){
+        return wres;
+    }
+#endif
 
-        nauthrr += nrr;
+    uint16_t l = *outlen;
+    uint16_t rdpos;
+
+    if (minimr_rr_write_begin(rr, outmsg, &l, outmsgmaxlen, dict, &rdpos) != MINIMR_OK){
+        return MINIMR_NOT_OK;
     }
 
-    // MINIMR_DEBUGF("added %d authority rr\n", nauthrr);
+    if (minimr_default_rr_write_rdata(rr, outmsg, &l, outmsgmaxlen, dict) != MINIMR_OK){
+        minimr_name_dict_truncate(dict, *outlen);
+        return MINIMR_NOT_OK;
+    }
 
-    // add all additional RRs
-    uint16_t nextrarr = 0;
-    for(uint16_t iq = 0; iq < nq; iq++){
+    minimr_rr_write_end(outmsg, l, rdpos);
 
-        // don't check questions that have become irrelevant
-        if (qstats[iq].relevant == 0){
-            continue;
-        }
+    *outlen = l;
 
-        struct minimr_rr * rr = records[qstats[iq].match_i];
+    return MINIMR_OK;
+}
 
-        uint16_t nrr = 0;
+int32_t minimr_default_rr_op_query_get_rr(struct minimr_rr * rr, struct minimr_query_stat * qstat, uint8_t * outmsg, uint16_t * outlen, uint16_t outmsgmaxlen, uint16_t * nrr, void * user_data, struct minimr_name_dict * dict)
+{
+    if (minimr_default_rr_write(rr, outmsg, outlen, outmsgmaxlen, dict) != MINIMR_OK){
+        return MINIMR_NOT_OK;
+    }
 
-        //minimr_rr_fun_handler( minimquery_get_*, struct minimr_rr * rr, struct minimr_query_stat * qstat, uint8_t * outmsg, uint16_t * outlen, uint16_t outmsgmaxlen, uint16_t * nrr, void * user_data)
-        uint8_t res = rr->MINIMR_RR_FUN_QUERY_GET_EXTRARR(rr, &qstats[iq], outmsg, &outlen, outmsgmaxlen, &nrr, user_data);
+    *nrr = 1;
 
-        if (res != MINIMR_OK){
-            return MINIMR_DNS_HDR2_RCODE_SERVAIL;
-        }
+    return MINIMR_OK;
+}
 
-        nextrarr += nrr;
+int32_t minimr_default_rr_op_get_rr(struct minimr_rr * rr, uint8_t * outmsg, uint16_t * outlen, uint16_t outmsgmaxlen, uint16_t * nrr, void * user_data, struct minimr_name_dict * dict)
+{
+    if (minimr_default_rr_write(rr, outmsg, outlen, outmsgmaxlen, dict) != MINIMR_OK){
+        return MINIMR_NOT_OK;
     }
 
-    // MINIMR_DEBUGF("added %d extra rr\n", nextrarr);
+    *nrr = 1;
 
-    // prepare outheader and out sanity check
-    struct minimr_dns_hdr outhdr;
+    return MINIMR_OK;
+}
 
+const struct minimr_rr_ops minimr_default_rr_ops = {
+    .query_get_rr = minimr_default_rr_op_query_get_rr,
+    .get_rr = minimr_default_rr_op_get_rr,
+    .announce_get_rr = minimr_default_rr_op_get_rr,
+};
 
-    // finalize header
-    outhdr.transaction_id = hdr.transaction_id; // is generally ignored (ie 0x0000) but included for legacy support..
+#if MINIMR_RR_WIRE_TEMPLATE_USE == 1
 
-    outhdr.flags[0] = MINIMR_DNS_HDR1_QR_REPLY | MINIMR_DNS_HDR1_AA;
-    outhdr.flags[1] = MINIMR_DNS_HDR2_RCODE_NOERROR;
+uint8_t minimr_default_rr_wire_update(struct minimr_rr * rr)
+{
+    MINIMR_ASSERT(rr != NULL);
 
-    outhdr.nqueries = 0;
-    outhdr.nanswers = nanswers;
-    outhdr.nauthrr = nauthrr;
-    outhdr.nextrarr = nextrarr;
+    if (rr->wire == NULL || rr->wire_maxlen < 10){
+        rr->wire_length = 0;
+        return MINIMR_NOT_OK;
+    }
 
-    // add header
-    minimr_dns_hdr_write(outmsg, &outhdr);
+    uint16_t l = 0;
 
-    *outmsglen = outlen;
+    // TTL and cache-flush bit are patched when writing
+    MINIMR_DNS_RR_WRITE_TYPE(rr->wire, l, rr->type);
+    MINIMR_DNS_Q_WRITE_CLASS(rr->wire, l, rr->cache_class);
+    MINIMR_DNS_RR_WRITE_TTL(rr->wire, l, 0);
+
+    uint16_t rdpos = l;
+
+    rr->wire[l++] = 0;
+    rr->wire[l++] = 0;
+
+    if (minimr_default_rr_write_rdata(rr, rr->wire, &l, rr->wire_maxlen, NULL) != MINIMR_OK){
+        rr->wire_length = 0;
+        return MINIMR_NOT_OK;
+    }
+
+    minimr_rr_write_end(rr->wire, l, rdpos);
+
+    rr->wire_length = l;
 
     return MINIMR_OK;
 }
 
+#endif //MINIMR_RR_WIRE_TEMPLATE_USE == 1
+
+#endif //MINIMR_RR_TYPE_DEFAULT_COUNT > 0
+
 
 #if MINIMR_RR_COUNT > 0  && MINIMR_SIMPLE_INTERFACE_ENABLED == 0
 
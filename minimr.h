@@ -70,6 +70,44 @@ extern "C" {
 #endif
 
 
+// keep pre-serialized wire templates of records (rdata is only encoded when a record changes)
+#if MINIMR_RR_WIRE_TEMPLATE_USE == 1
+#define MINIMR_RR_WIRE_FIELD \
+        uint8_t * wire; \
+        uint16_t wire_length; \
+        uint16_t wire_maxlen;
+#else //MINIMR_RR_WIRE_TEMPLATE_USE == 0
+#define MINIMR_RR_WIRE_FIELD
+#endif
+
+// cache digests of records' rdata for known answer suppression (otherwise they are computed for every known answer)
+#ifndef MINIMR_RR_DIGEST_USE
+#define MINIMR_RR_DIGEST_USE 1
+#endif
+
+#if MINIMR_RR_DIGEST_USE == 1
+#define MINIMR_RR_DIGEST_FIELD \
+        uint32_t rdata_digest;
+#else //MINIMR_RR_DIGEST_USE == 0
+#define MINIMR_RR_DIGEST_FIELD
+#endif
+
+// max length of a (uncompressed) record written to compute its rdata digest (only needed if it has no wire template)
+#ifndef MINIMR_RR_DIGEST_MAXLEN
+#define MINIMR_RR_DIGEST_MAXLEN 512
+#endif
+
+// number of records (by index) known answer suppression is tracked for in a bitset, records beyond cost a pass
+// over the matched questions each
+#ifndef MINIMR_KNOWN_ANSWER_BITSET_SIZE
+#define MINIMR_KNOWN_ANSWER_BITSET_SIZE 256
+#endif
+
+// shared records (see https://tools.ietf.org/html/rfc6762#section-10.2 ) are written without cache-flush bit
+#ifndef MINIMR_RR_IS_SHARED
+#define MINIMR_RR_IS_SHARED(rr) ((rr)->type == MINIMR_DNS_TYPE_PTR)
+#endif
+
 #ifndef MINIMR_COMPRESSION_MAX_JUMPS
 #define MINIMR_COMPRESSION_MAX_JUMPS 8
 #endif
@@ -78,6 +116,61 @@ extern "C" {
 #define MINIMR_DEFAULT_TTL 120
 #endif
 
+// use name compression when generating messages
+#ifndef MINIMR_NAME_COMPRESSION_ENABLED
+#define MINIMR_NAME_COMPRESSION_ENABLED 1
+#endif
+
+// max number of name (suffixes) remembered per message for name compression
+#ifndef MINIMR_NAME_DICT_SIZE
+#define MINIMR_NAME_DICT_SIZE 32
+#endif
+
+// use vector instructions (SSE2/AVX2 or NEON, if available) to compare names
+#ifndef MINIMR_NAME_CMP_SIMD
+#define MINIMR_NAME_CMP_SIMD 1
+#endif
+
+// max number of key values of response cache entries (3 per answered question)
+#ifndef MINIMR_RESPONSE_CACHE_KEY_SIZE
+#define MINIMR_RESPONSE_CACHE_KEY_SIZE 24
+#endif
+
+// full (compiler and CPU) memory barrier as used by lock-free record updates (seqlock of the simple responder),
+// on single core targets a compiler barrier suffices
+#ifndef MINIMR_MEMORY_BARRIER
+#if defined(__GNUC__) || defined(__clang__)
+#define MINIMR_MEMORY_BARRIER() __sync_synchronize()
+#else
+#define MINIMR_MEMORY_BARRIER()
+#endif
+#endif
+
+// max length of (normalized) names of registry records (see minimrregistry.h)
+#ifndef MINIMR_REGISTRY_NAMELEN
+#define MINIMR_REGISTRY_NAMELEN 128
+#endif
+
+// max RDATA length of registry records
+#ifndef MINIMR_REGISTRY_RDATALEN
+#define MINIMR_REGISTRY_RDATALEN 256
+#endif
+
+// max length of (normalized) names of cached records (see minimrcache.h)
+#ifndef MINIMR_CACHE_NAMELEN
+#define MINIMR_CACHE_NAMELEN 128
+#endif
+
+// max RDATA length (names uncompressed) of cached records, longer records are not cached
+#ifndef MINIMR_CACHE_RDATALEN
+#define MINIMR_CACHE_RDATALEN 256
+#endif
+
+// max number of addresses of a bundle of cached records (see minimr_cache_bundle())
+#ifndef MINIMR_CACHE_BUNDLE_MAXADDRS
+#define MINIMR_CACHE_BUNDLE_MAXADDRS 4
+#endif
+
 /*************** minimr function return values  **************/
 
 #define MINIMR_IGNORE           0xff
@@ -159,6 +252,7 @@ extern "C" {
 #define MINIMR_DNS_TYPE_NSEC3       50
 #define MINIMR_DNS_TYPE_NSEC3PARAM  51
 #define MINIMR_DNS_TYPE_OPENGPGKEY  61
+#define MINIMR_DNS_TYPE_OPT         41  // EDNS(0) pseudo record
 #define MINIMR_DNS_TYPE_RRSIG       46
 #define MINIMR_DNS_TYPE_RP          17
 #define MINIMR_DNS_TYPE_SIG         24
@@ -183,6 +277,9 @@ uint16_t minimr_dns_class_fromstr(uint8_t * classstr);
 // Mask for offset (in message) of compressed name
 #define MINIMR_DNS_COMPRESSED_NAME_OFFSET    0x3f
 
+// Maximum length of a label (lengths 0x40 - 0xbf are reserved label types)
+#define MINIMR_DNS_LABEL_MAXLEN             63
+
 
 /*************** mDNS Header **************/
 
@@ -328,6 +425,7 @@ struct minimr_query_stat {
 
 //    uint16_t name_length;   // computed name length
     uint16_t name_offset;   // offset of name w.r.t message base
+    uint32_t name_hash;     // case-folded hash of (uncompressed) name, @see minimr_name_hash()
     
     // internal usage
     uint16_t match_i;            // record index of matched record (used in processing to avoid reprocessing)
@@ -357,6 +455,34 @@ uint8_t minimr_extract_query_stat(struct minimr_query_stat *stat, uint8_t *msg,
     MINIMR_DNS_Q_WRITE_TYPE( __dst__, __len__, __type__) \
     MINIMR_DNS_Q_WRITE_CLASS( __dst__, __len__, __class__ )
 
+/*************** Name compression **************/
+
+// max message offset a compression pointer can point to
+#define MINIMR_DNS_COMPRESSED_NAME_MAX_OFFSET   0x3fff
+
+/**
+ * Per message compression dictionary remembering the message offsets of names (or rather name suffixes) already
+ * written such that further occurrences can be replaced by a pointer.
+ * Must be initialized (per message) using minimr_name_dict_init()
+ * @see minimr_name_write()
+ */
+struct minimr_name_dict {
+    uint16_t count;
+    uint16_t offsets[MINIMR_NAME_DICT_SIZE];
+};
+
+#define minimr_name_dict_init(dict) (dict)->count = 0
+
+/**
+ * Writes uncompressed (normalized) NAME to outmsg replacing the longest suffix already known to dict with a pointer.
+ * Newly written suffixes are added to dict. If dict == NULL the name is written as is.
+ * On failure neither outlen nor dict are changed.
+ * @return MINIMR_OK        on success
+ * @return MINIMR_NOT_OK    if the name does not fit into outmsg
+ */
+uint8_t minimr_name_write(uint8_t * outmsg, uint16_t * outlen, uint16_t outmsgmaxlen, uint8_t * name, struct minimr_name_dict * dict);
+
+
 /*************** mDNS RR **************/
 
 #define MINIMR_DNS_CACHEFLUSH   0x8000  // cache flush requested
@@ -518,9 +644,48 @@ int8_t minimr_dns_rr_lexcmp(uint16_t lhsclass, uint16_t lhstype, uint8_t * lhsrd
     MINIMR_DNS_RR_WRITE_COMMON(__dst__, __len__, __name__, __namelen__, __type__, __cacheclass__, __ttl__) \
     MINIMR_DNS_RR_WRITE_TXT_BODY(__dst__, __len__, __txt__, __txtlen__)
 
-
-// forward declaration for minimr_rr_fun
+// forward declarations
 struct minimr_rr;
+struct minimr_rr_index;
+
+/**
+ * Bounds checked writer functions (alternatively to the above macros) for use in record handlers.
+ * If a name dictionary is given, names are compressed.
+ *
+ * A record is written using:
+ *
+ *  uint16_t l = *outlen, rdpos;
+ *  if (minimr_rr_write_begin(rr, outmsg, &l, outmsgmaxlen, dict, &rdpos) != MINIMR_OK ||
+ *      <write rdata using minimr_rr_write_data() and/or minimr_name_write()> ||
+ *      minimr_rr_write_end(outmsg, l, rdpos) != MINIMR_OK) {
+ *      return MINIMR_NOT_OK; // *outlen was not changed
+ *  }
+ *  *outlen = l;
+ *
+ * NOTE on failure any dictionary entries beyond *outlen must be dropped (minimr_name_dict_truncate()).
+ */
+
+/**
+ * Writes (possibly compressed) NAME, TYPE, CLASS, TTL and a placeholder RDLENGTH of record
+ * @param rdpos     is set to offset of RDLENGTH (as required by minimr_rr_write_end())
+ */
+uint8_t minimr_rr_write_begin(struct minimr_rr * rr, uint8_t * outmsg, uint16_t * outlen, uint16_t outmsgmaxlen, struct minimr_name_dict * dict, uint16_t * rdpos);
+
+/**
+ * Writes raw rdata
+ */
+uint8_t minimr_rr_write_data(uint8_t * data, uint16_t len, uint8_t * outmsg, uint16_t * outlen, uint16_t outmsgmaxlen);
+
+/**
+ * Sets RDLENGTH according to what has been written since minimr_rr_write_begin()
+ */
+uint8_t minimr_rr_write_end(uint8_t * outmsg, uint16_t outlen, uint16_t rdpos);
+
+/**
+ * Drops all dictionary entries pointing beyond outlen (to be used after discarding partially written data)
+ */
+void minimr_name_dict_truncate(struct minimr_name_dict * dict, uint16_t outlen);
+
 
 /**
  * desired function type
@@ -548,24 +713,74 @@ typedef enum  {
     (type) == minimr_rr_fun_lexcmp)
 
 // used internally to get the extra compiler argc check
-#define MINIMR_RR_FUN_QUERY_RESPOND_TO( rr, user_data )                                             handler(minimr_rr_fun_query_respond_to, rr, user_data)
-#define MINIMR_RR_FUN_QUERY_GET_RR( rr, qstat, outmsg, outlen, outmsgmaxlen, nrr, user_data )       handler(minimr_rr_fun_query_get_rr, rr, qstat, outmsg, outlen, outmsgmaxlen, nrr, user_data)
-#define MINIMR_RR_FUN_QUERY_GET_AUTHRR( rr, qstat, outmsg, outlen, outmsgmaxlen, nrr, user_data )   handler(minimr_rr_fun_query_get_authority_rrs, rr, qstat, outmsg, outlen, outmsgmaxlen, nrr, user_data)
-#define MINIMR_RR_FUN_QUERY_GET_EXTRARR( rr, qstat, outmsg, outlen, outmsgmaxlen, nrr, user_data )  handler(minimr_rr_fun_query_get_extra_rrs, rr, qstat, outmsg, outlen, outmsgmaxlen, nrr, user_data)
-#define MINIMR_RR_FUN_GET_RR( rr, outmsg, outlen, outmsgmaxlen, nrr, user_data )                    handler(minimr_rr_fun_get_rr, rr, outmsg, outlen, outmsgmaxlen, nrr, user_data)
-#define MINIMR_RR_FUN_ANNOUNCE_GET_RR( rr, outmsg, outlen, outmsgmaxlen, nrr, user_data )           handler(minimr_rr_fun_announce_get_rr, rr, outmsg, outlen, outmsgmaxlen, nrr, user_data)
-#define MINIMR_RR_FUN_ANNOUNCE_GET_EXTRA_RRS( rr, outmsg, outlen, outmsgmaxlen, nrr, user_data )    handler(minimr_rr_fun_announce_get_extra_rrs, rr, outmsg, outlen, outmsgmaxlen, nrr, user_data)
-#define MINIMR_RR_FUN_LEXCMP( rr, _class_, type, data, dlength, user_data )                         handler(minimr_rr_fun_lexcmp, rr, _class_, type, data, dlength, user_data )
+#define MINIMR_RR_FUN_QUERY_RESPOND_TO( rr, user_data )                                                     handler(minimr_rr_fun_query_respond_to, rr, user_data)
+#define MINIMR_RR_FUN_QUERY_GET_RR( rr, qstat, outmsg, outlen, outmsgmaxlen, nrr, user_data, dict )         handler(minimr_rr_fun_query_get_rr, rr, qstat, outmsg, outlen, outmsgmaxlen, nrr, user_data, dict)
+#define MINIMR_RR_FUN_QUERY_GET_AUTHRR( rr, qstat, outmsg, outlen, outmsgmaxlen, nrr, user_data, dict )     handler(minimr_rr_fun_query_get_authority_rrs, rr, qstat, outmsg, outlen, outmsgmaxlen, nrr, user_data, dict)
+#define MINIMR_RR_FUN_QUERY_GET_EXTRARR( rr, qstat, outmsg, outlen, outmsgmaxlen, nrr, user_data, dict )    handler(minimr_rr_fun_query_get_extra_rrs, rr, qstat, outmsg, outlen, outmsgmaxlen, nrr, user_data, dict)
+#define MINIMR_RR_FUN_GET_RR( rr, outmsg, outlen, outmsgmaxlen, nrr, user_data, dict )                      handler(minimr_rr_fun_get_rr, rr, outmsg, outlen, outmsgmaxlen, nrr, user_data, dict)
+#define MINIMR_RR_FUN_ANNOUNCE_GET_RR( rr, outmsg, outlen, outmsgmaxlen, nrr, user_data, dict )             handler(minimr_rr_fun_announce_get_rr, rr, outmsg, outlen, outmsgmaxlen, nrr, user_data, dict)
+#define MINIMR_RR_FUN_ANNOUNCE_GET_EXTRA_RRS( rr, outmsg, outlen, outmsgmaxlen, nrr, user_data, dict )      handler(minimr_rr_fun_announce_get_extra_rrs, rr, outmsg, outlen, outmsgmaxlen, nrr, user_data, dict)
+#define MINIMR_RR_FUN_LEXCMP( rr, _class_, type, data, dlength, user_data )                                 handler(minimr_rr_fun_lexcmp, rr, _class_, type, data, dlength, user_data )
 
 
 /**
  * minimr_rr_fun_handler( minimr_rr_fun_query_respond_to, struct minimr_rr * rr, void * user_data);
- * minimr_rr_fun_handler( minimr_rr_fun_query_get_*, struct minimr_rr * rr, struct minimr_query_stat * qstat, uint8_t * outmsg, uint16_t * outlen, uint16_t outmsgmaxlen, uint16_t * nrr, void * user_data)
- * minimr_rr_fun_handler( minimr_rr_fun_get_rr, struct minimr_rr * rr,  uint8_t * outmsg, uint16_t * outlen, uint16_t outmsgmaxlen, uint16_t * nrr, void * user_data)
- * minimr_rr_fun_handler( minimr_rr_fun_announce_get_*, struct minimr_rr * rr, uint8_t * outmsg, uint16_t * outlen, uint16_t outmsgmaxlen, uint16_t * nrr, void * user_data)
+ * minimr_rr_fun_handler( minimr_rr_fun_query_get_*, struct minimr_rr * rr, struct minimr_query_stat * qstat, uint8_t * outmsg, uint16_t * outlen, uint16_t outmsgmaxlen, uint16_t * nrr, void * user_data, struct minimr_name_dict * dict)
+ * minimr_rr_fun_handler( minimr_rr_fun_get_rr, struct minimr_rr * rr,  uint8_t * outmsg, uint16_t * outlen, uint16_t outmsgmaxlen, uint16_t * nrr, void * user_data, struct minimr_name_dict * dict)
+ * minimr_rr_fun_handler( minimr_rr_fun_announce_get_*, struct minimr_rr * rr, uint8_t * outmsg, uint16_t * outlen, uint16_t outmsgmaxlen, uint16_t * nrr, void * user_data, struct minimr_name_dict * dict)
+ *
+ * The name compression dictionary (dict) of the message is passed as last argument (after user_data, such that
+ * handlers not aware of it are not affected); it is NULL if no compression is to be used. Writing handlers must
+ * respect outmsgmaxlen and MUST NOT change *outlen if the record(s) do not fit.
+ * @see minimr_rr_write_begin()
  */
 typedef int32_t (*minimr_rr_fun_handler)(minimr_rr_fun type, struct minimr_rr *rr, ...);
 
+/**
+ * Typed record operations (alternative to the variadic minimr_rr_fun_handler)
+ *
+ * A (const) table is typically shared by all records of a kind and assigned to rr->ops; if set it takes precedence
+ * over rr->handler. Arguments and semantics correspond to the minimr_rr_fun_* types of minimr_rr_fun_handler.
+ *
+ * Any operation can be NULL: query_respond_to then defaults to MINIMR_RESPOND, lexcmp to 0 and all others write
+ * nothing (and return MINIMR_OK).
+ *
+ * @see minimr_rr_ops_handler()
+ */
+struct minimr_rr_ops {
+    int32_t (*query_respond_to)(struct minimr_rr * rr, void * user_data);
+
+    int32_t (*query_get_rr)(struct minimr_rr * rr, struct minimr_query_stat * qstat, uint8_t * outmsg, uint16_t * outlen, uint16_t outmsgmaxlen, uint16_t * nrr, void * user_data, struct minimr_name_dict * dict);
+    int32_t (*query_get_authority_rrs)(struct minimr_rr * rr, struct minimr_query_stat * qstat, uint8_t * outmsg, uint16_t * outlen, uint16_t outmsgmaxlen, uint16_t * nrr, void * user_data, struct minimr_name_dict * dict);
+    int32_t (*query_get_extra_rrs)(struct minimr_rr * rr, struct minimr_query_stat * qstat, uint8_t * outmsg, uint16_t * outlen, uint16_t outmsgmaxlen, uint16_t * nrr, void * user_data, struct minimr_name_dict * dict);
+
+    int32_t (*get_rr)(struct minimr_rr * rr, uint8_t * outmsg, uint16_t * outlen, uint16_t outmsgmaxlen, uint16_t * nrr, void * user_data, struct minimr_name_dict * dict);
+
+    int32_t (*announce_get_rr)(struct minimr_rr * rr, uint8_t * outmsg, uint16_t * outlen, uint16_t outmsgmaxlen, uint16_t * nrr, void * user_data, struct minimr_name_dict * dict);
+    int32_t (*announce_get_extra_rrs)(struct minimr_rr * rr, uint8_t * outmsg, uint16_t * outlen, uint16_t outmsgmaxlen, uint16_t * nrr, void * user_data, struct minimr_name_dict * dict);
+
+    int32_t (*lexcmp)(struct minimr_rr * rr, uint16_t cache_class, uint16_t type, uint8_t * rdata, uint16_t rdlength, void * user_data);
+};
+
+/**
+ * Compatibility shim: a minimr_rr_fun_handler unpacking its arguments and calling the respective rr->ops operation
+ * (for records using ops but which are passed to code calling rr->handler directly).
+ */
+int32_t minimr_rr_ops_handler(minimr_rr_fun type, struct minimr_rr *rr, ...);
+
+// call record operation through ops (if set) or handler
+#define MINIMR_RR_OP( rr, op, fun, dflt, ... ) \
+    ( (rr)->ops == NULL ? (rr)->handler(fun, rr, __VA_ARGS__) : ( (rr)->ops->op == NULL ? (dflt) : (rr)->ops->op(rr, __VA_ARGS__) ) )
+
+#define MINIMR_RR_OP_QUERY_RESPOND_TO( rr, user_data )                                                      MINIMR_RR_OP(rr, query_respond_to, minimr_rr_fun_query_respond_to, MINIMR_RESPOND, user_data)
+#define MINIMR_RR_OP_QUERY_GET_RR( rr, qstat, outmsg, outlen, outmsgmaxlen, nrr, user_data, dict )          MINIMR_RR_OP(rr, query_get_rr, minimr_rr_fun_query_get_rr, MINIMR_OK, qstat, outmsg, outlen, outmsgmaxlen, nrr, user_data, dict)
+#define MINIMR_RR_OP_QUERY_GET_AUTHRR( rr, qstat, outmsg, outlen, outmsgmaxlen, nrr, user_data, dict )      MINIMR_RR_OP(rr, query_get_authority_rrs, minimr_rr_fun_query_get_authority_rrs, MINIMR_OK, qstat, outmsg, outlen, outmsgmaxlen, nrr, user_data, dict)
+#define MINIMR_RR_OP_QUERY_GET_EXTRARR( rr, qstat, outmsg, outlen, outmsgmaxlen, nrr, user_data, dict )     MINIMR_RR_OP(rr, query_get_extra_rrs, minimr_rr_fun_query_get_extra_rrs, MINIMR_OK, qstat, outmsg, outlen, outmsgmaxlen, nrr, user_data, dict)
+#define MINIMR_RR_OP_GET_RR( rr, outmsg, outlen, outmsgmaxlen, nrr, user_data, dict )                       MINIMR_RR_OP(rr, get_rr, minimr_rr_fun_get_rr, MINIMR_OK, outmsg, outlen, outmsgmaxlen, nrr, user_data, dict)
+#define MINIMR_RR_OP_ANNOUNCE_GET_RR( rr, outmsg, outlen, outmsgmaxlen, nrr, user_data, dict )              MINIMR_RR_OP(rr, announce_get_rr, minimr_rr_fun_announce_get_rr, MINIMR_OK, outmsg, outlen, outmsgmaxlen, nrr, user_data, dict)
+#define MINIMR_RR_OP_ANNOUNCE_GET_EXTRA_RRS( rr, outmsg, outlen, outmsgmaxlen, nrr, user_data, dict )       MINIMR_RR_OP(rr, announce_get_extra_rrs, minimr_rr_fun_announce_get_extra_rrs, MINIMR_OK, outmsg, outlen, outmsgmaxlen, nrr, user_data, dict)
+#define MINIMR_RR_OP_LEXCMP( rr, _class_, type, data, dlength, user_data )                                  MINIMR_RR_OP(rr, lexcmp, minimr_rr_fun_lexcmp, 0, _class_, type, data, dlength, user_data)
+
 
 // Start of named RR struct definer
 #define MINIMR_RR_TYPE_BEGIN_STNAME(__namelen__, __stname__) \
@@ -576,7 +791,10 @@ typedef int32_t (*minimr_rr_fun_handler)(minimr_rr_fun type, struct minimr_rr *r
         \
         MINIMR_TIMESTAMP_FIELD \
         MINIMR_RR_CUSTOM_FIELD \
+        MINIMR_RR_WIRE_FIELD \
+        MINIMR_RR_DIGEST_FIELD \
         \
+        const struct minimr_rr_ops * ops; \
         minimr_rr_fun_handler handler; \
         \
         uint16_t name_length; \
@@ -596,6 +814,62 @@ typedef int32_t (*minimr_rr_fun_handler)(minimr_rr_fun type, struct minimr_rr *r
  */
 MINIMR_RR_TYPE_BEGIN_STNAME(,minimr_rr) MINIMR_RR_TYPE_END();
 
+/**
+ * To be called whenever the (record specific) data of a record changes, ie any derived data such as the wire template
+ * is invalidated.
+ * NOTE changing the TTL does not require calling this.
+ * NOTE cached responses are invalidated per record set, @see minimr_response_cache_invalidate()
+ */
+void minimr_rr_changed(struct minimr_rr * rr);
+
+/**
+ * Known Answer Suppression
+ *
+ * A known answer (of a query) only suppresses the answer of a record if name, type, class and rdata are equal and its
+ * TTL is at least half of the record's TTL (see https://tools.ietf.org/html/rfc6762#section-7.1 ).
+ * Rdata is compared by digest: names in rdata (PTR, CNAME, NS, MX, SRV) are digested decompressed and case-folded,
+ * ie a known answer matches no matter how it is compressed. Records' digests are computed from their wire template
+ * (if any) or by writing the record (@see MINIMR_RR_DIGEST_MAXLEN).
+ * Records for which no digest can be computed (ex. operations writing multiple records) are consulted as before
+ * using their query_respond_to operation (MINIMR_DO_NOT_RESPOND suppresses the answer).
+ */
+
+#if MINIMR_RR_DIGEST_USE == 1
+/**
+ * (Re-)computes the cached rdata digest of record (done on demand if rr->rdata_digest == 0, @see minimr_rr_changed())
+ * Records updated concurrently to readers should compute it (along with the wire template) while updating, such that
+ * readers never do.
+ * @return MINIMR_OK        on success
+ * @return MINIMR_NOT_OK    if no digest could be computed (rr->rdata_digest is reset)
+ */
+uint8_t minimr_rr_digest_update(struct minimr_rr * rr, void * user_data);
+#endif
+
+#if MINIMR_RR_WIRE_TEMPLATE_USE == 1
+
+/**
+ * Wire templates
+ *
+ * If a record has a template buffer assigned (rr->wire, rr->wire_maxlen) its TYPE, CLASS, TTL, RDLENGTH and RDATA
+ * are kept in wire format (rr->wire_length > 0) such that writing the record merely consists of writing the
+ * (compressed) name and copying the template. TTL and cache-flush bit are patched when writing, ie a change of TTL
+ * does not require a rebuild.
+ * The target names of PTR and SRV records are compressed from the template (ie written as they would without template).
+ *
+ * rr->wire_length == 0 marks the template as outdated (@see minimr_rr_changed()). Templates of default types are
+ * rebuilt on demand, templates of custom types must be set up by the user.
+ */
+
+/**
+ * Writes record using its template
+ * @return MINIMR_OK        on success
+ * @return MINIMR_NOT_OK    if the record does not fit into outmsg
+ * @return MINIMR_IGNORE    if there is no (valid) template, nothing was written
+ */
+uint8_t minimr_rr_wire_write(struct minimr_rr * rr, uint8_t * outmsg, uint16_t * outlen, uint16_t outmsgmaxlen, struct minimr_name_dict * dict);
+
+#endif //MINIMR_RR_WIRE_TEMPLATE_USE == 1
+
 
 // A struct fields
 #define MINIMR_RR_TYPE_BODY_A() \
@@ -692,10 +966,28 @@ void minimr_field_denormalize(uint8_t * field, uint16_t length, uint8_t marker);
  */
 int32_t minimr_name_cmp(uint8_t * uncompressed_name, uint16_t namepos, uint8_t * msg, uint16_t msglen);
 
+/**
+ * Length of an uncompressed (normalized) NAME including its terminating NUL
+ */
+uint16_t minimr_name_length(uint8_t * uncompressed_name);
+
 /**
  * Copies possibly compressed name to given destination and returns length of NUL-terminated string
  */
-int32_t minimr_name_uncompress(uint8_t * uncompressed_name, uint16_t maxlen, uint16_t namepos, uint8_t * msg, uint8_t msglen);
+int32_t minimr_name_uncompress(uint8_t * uncompressed_name, uint16_t maxlen, uint16_t namepos, uint8_t * msg, uint16_t msglen);
+
+// FNV-1a parameters used for name hashing
+#define MINIMR_NAME_HASH_INIT       2166136261UL
+#define MINIMR_NAME_HASH_PRIME      16777619UL
+
+#define MINIMR_NAME_HASH_STEP(__hash__, __c__) \
+    (__hash__) = ((__hash__) ^ ( ('A' <= (__c__) && (__c__) <= 'Z') ? ((__c__) - 'A' + 'a') : (__c__) )) * MINIMR_NAME_HASH_PRIME;
+
+/**
+ * Case-insensitive hash of an uncompressed (normalized) NAME
+ * Yields the same value as computed by minimr_extract_query_stat() for an equal (possibly compressed) QNAME
+ */
+uint32_t minimr_name_hash(uint8_t * uncompressed_name);
 
 
 /*************** Generic framework functions **************/
@@ -741,6 +1033,31 @@ int32_t minimr_parse_msg(
 );
 
 
+/**
+ * Sections of a message
+ */
+#define MINIMR_MSG_SECTION_QUESTION     0
+#define MINIMR_MSG_SECTION_ANSWER       1
+#define MINIMR_MSG_SECTION_AUTHORITY    2
+#define MINIMR_MSG_SECTION_ADDITIONAL   3
+#define MINIMR_MSG_SECTION_DONE         4
+
+/**
+ * Position of the next record to write of a message split across several packets.
+ * @see minimr_make_msg_next()
+ */
+struct minimr_msg_cursor {
+    uint8_t section;    // section of next record (MINIMR_MSG_SECTION_*)
+    uint16_t i;         // index of next record (within section)
+};
+
+#define MINIMR_MSG_CURSOR_DONE(cursor) ((cursor)->section == MINIMR_MSG_SECTION_DONE)
+
+/**
+ * Initializes cursor to the beginning of a message
+ */
+void minimr_msg_cursor_init(struct minimr_msg_cursor * cursor);
+
 /**
  * Generic query structure used for minimr_make_msg(..)
  * @see minimr_make_msg
@@ -775,6 +1092,29 @@ int32_t  minimr_make_msg(
 );
 
 
+/**
+ * Like minimr_make_msg() but splits the message across several packets if it does not fit outmsgmaxlen: generates the
+ * next packet at the cursor, ie call until MINIMR_MSG_CURSOR_DONE(cursor).
+ * Records (or rather record handler calls) are never split, answers come first (additional records are only written
+ * once all answers are), questions are only written to the first packet. Packets of a query but the last have the TC
+ * flag set (more known answers follow, see https://tools.ietf.org/html/rfc6762#section-7.2 ).
+ * Additional records not even fitting an empty packet are skipped.
+ * @return MINIMR_OK        if a packet was generated
+ * @return MINIMR_IGNORE    if there is nothing (left) to send
+ * @return MINIMR_DNS_HDR2_RCODE_SERVAIL if the questions or any other record do not fit a packet
+ */
+int32_t  minimr_make_msg_next(
+        uint16_t tid, uint8_t flag1, uint8_t flag2,
+        struct minimr_query * queries, uint16_t nqueries,
+        struct minimr_rr ** answer_rrs, uint16_t nanswer_rrs,
+        struct minimr_rr ** auth_rrs, uint16_t nauth_rrs,
+        struct minimr_rr ** extra_rrs, uint16_t nextra_rrs,
+        struct minimr_msg_cursor * cursor,
+        uint8_t *outmsg, uint16_t *outmsglen, uint16_t outmsgmaxlen,
+        void * user_data
+);
+
+
 /**
  * Comfort function to generate a probe-query for 1-2 specific (normalized) qnames ANY type and IN class
  *
@@ -819,7 +1159,8 @@ int32_t minimr_announce_msg(
 
 /**
  * Comfort function to generate a termination announcement setting all record's TTLs to zero (0)
- * DANGER: writes original record's TTL value
+ * DANGER: writes original record's TTL value (cached responses of the record set are to be invalidated,
+ * @see minimr_response_cache_invalidate())
  * @see minimr_announce()
  */
 int32_t minimr_terminate_msg(
@@ -830,6 +1171,79 @@ int32_t minimr_terminate_msg(
 
 
 
+/**
+ * Like minimr_announce_msg() (or minimr_terminate_msg()) but splits the announcement across several packets
+ * @see minimr_make_msg_next()
+ */
+int32_t minimr_announce_msg_next(
+        struct minimr_rr **records, uint16_t nrecords,
+        struct minimr_msg_cursor * cursor,
+        uint8_t *outmsg, uint16_t *outmsglen, uint16_t outmsgmaxlen,
+        void * user_data
+);
+
+int32_t minimr_terminate_msg_next(
+        struct minimr_rr **records, uint16_t nrecords,
+        struct minimr_msg_cursor * cursor,
+        uint8_t *outmsg, uint16_t *outmsglen, uint16_t outmsgmaxlen,
+        void * user_data
+);
+
+
+/**
+ * Matches the questions of given message (if is a query) against record set (or the records of index, if given) and
+ * checks the known answers, as done by minimr_query_response_msg() but without generating a response.
+ * qstats[0 .. *nmatches - 1] hold the matching questions (with the record index in match_i), those still to be
+ * answered after known answer suppression are marked relevant.
+ * @return MINIMR_OK        if there is anything to answer
+ * @return MINIMR_IGNORE    if not (or not a query)
+ * @return MINIMR_DNS_HDR2_RCODE_FORMERR or MINIMR_DNS_HDR2_RCODE_SERVAIL on failure
+ */
+int32_t minimr_query_match(
+        uint8_t * msg, uint16_t msglen,
+        struct minimr_query_stat qstats[], uint16_t nqstats, uint16_t * nmatches,
+        struct minimr_rr ** records, uint16_t nrecords,
+        struct minimr_rr_index * index,
+        uint8_t *unicast_requested,
+        void * user_data
+);
+
+/**
+ * Checks the known answers of a subsequent message continuing the known answer list of a truncated query (TC) against
+ * the matches qstats[0 .. nmatches - 1] of minimr_query_match() (for the very same record set), ie marks suppressed
+ * matches as no longer relevant.
+ * @return MINIMR_OK        if there is anything left to answer
+ * @return MINIMR_IGNORE    if not
+ * @return MINIMR_NOT_OK    if given message is not a query
+ * @return MINIMR_DNS_HDR2_RCODE_FORMERR or MINIMR_DNS_HDR2_RCODE_SERVAIL on failure
+ */
+int32_t minimr_query_match_known_answers(
+        uint8_t * msg, uint16_t msglen,
+        struct minimr_query_stat qstats[], uint16_t nmatches,
+        struct minimr_rr ** records, uint16_t nrecords,
+        struct minimr_rr_index * index,
+        uint8_t *unicast_requested,
+        void * user_data
+);
+
+/**
+ * Generates response message answering the (relevant) matches qstats[0 .. nmatches - 1] of minimr_query_match()
+ * @param tid       transaction id (of query)
+ * @param cursor    if not NULL, splits response across several packets (@see minimr_make_msg_next())
+ * @return MINIMR_OK        if a message was generated
+ * @return MINIMR_IGNORE    if there is nothing (left) to answer
+ * @return MINIMR_DNS_HDR2_RCODE_SERVAIL on failure
+ */
+int32_t minimr_query_match_response_msg(
+        uint16_t tid,
+        struct minimr_query_stat qstats[], uint16_t nmatches,
+        struct minimr_rr ** records, uint16_t nrecords,
+        struct minimr_rr_index * index,
+        struct minimr_msg_cursor * cursor,
+        uint8_t *outmsg, uint16_t *outmsglen, uint16_t outmsgmaxlen,
+        void * user_data
+);
+
 /**
  * Generates response messages to given message (if is a query) based on given record set
  * @param qstats    array of internally used query stat; typically nqstats >= nrecords
@@ -844,6 +1258,312 @@ int32_t minimr_query_response_msg(
 );
 
 
+/*************** Record index **************/
+
+// end of bucket chain marker
+#define MINIMR_RR_INDEX_NONE    0xffff
+
+/**
+ * Index entry, one per record slot
+ * @see struct minimr_rr_index
+ */
+struct minimr_rr_index_entry {
+    uint32_t name_hash;
+    uint16_t type;
+    uint16_t next;      // next entry in same bucket or MINIMR_RR_INDEX_NONE
+};
+
+/**
+ * Hash index over a record set used to look up records matching a question in (roughly) constant time.
+ * Records are bucketed by their case-folded name hash (irrespective of type, such that ANY queries can be resolved)
+ * whereas type and hash are compared before doing an actual name comparison.
+ *
+ * All memory is provided by the caller, entries[] must hold at least maxrecords elements and nbuckets MUST be a power
+ * of two (typically nbuckets >= maxrecords).
+ *
+ * NOTE if the name of an indexed record changes the index must be rebuilt.
+ */
+struct minimr_rr_index {
+    struct minimr_rr ** records;
+    uint16_t nrecords;
+    uint16_t maxrecords;
+
+    struct minimr_rr_index_entry * entries;
+
+    uint16_t * buckets;
+    uint16_t nbuckets;
+};
+
+/**
+ * Initializes an empty index (records are added using minimr_rr_index_add())
+ */
+void minimr_rr_index_init(
+        struct minimr_rr_index * index,
+        struct minimr_rr ** records, uint16_t maxrecords,
+        struct minimr_rr_index_entry * entries,
+        uint16_t * buckets, uint16_t nbuckets
+);
+
+/**
+ * Appends record to indexed record set
+ * @return MINIMR_OK        on success
+ * @return MINIMR_NOT_OK    if index is full
+ */
+int32_t minimr_rr_index_add(struct minimr_rr_index * index, struct minimr_rr * rr);
+
+/**
+ * Removes record at position i from indexed record set in (expected) constant time: the last record is moved to
+ * position i, ie the position of any other record remains unchanged.
+ * @return MINIMR_OK        on success
+ * @return MINIMR_NOT_OK    if there is no such position
+ */
+int32_t minimr_rr_index_remove(struct minimr_rr_index * index, uint16_t i);
+
+/**
+ * Builds index over an existing record set (records[] is used in place)
+ * NULL entries are allowed but are not indexed, ie if a NULL entry is set later on the index must be rebuilt.
+ */
+void minimr_rr_index_build(
+        struct minimr_rr_index * index,
+        struct minimr_rr ** records, uint16_t nrecords,
+        struct minimr_rr_index_entry * entries,
+        uint16_t * buckets, uint16_t nbuckets
+);
+
+/**
+ * Gets first entry (index) of bucket chain for given name hash; use entries[i].next to iterate
+ * Note that the chain can contain entries of other names (compare name_hash).
+ */
+#define MINIMR_RR_INDEX_FIRST(__index__, __hash__) ( (__index__)->buckets[ (__hash__) & ((__index__)->nbuckets - 1) ] )
+
+/**
+ * Like minimr_query_response_msg() but uses the given record index to find the records matching the questions
+ * (instead of comparing every question against every record).
+ * @see minimr_query_response_msg()
+ */
+int32_t minimr_indexed_query_response_msg(
+    uint8_t *msg, uint16_t msglen,
+    struct minimr_query_stat qstats[], uint16_t nqstats,
+    struct minimr_rr_index * index,
+    uint8_t *outmsg, uint16_t *outmsglen, uint16_t outmsgmaxlen,
+    uint8_t *unicast_requested,
+    void * user_data
+);
+
+/**
+ * Like minimr_query_response_msg() (or minimr_indexed_query_response_msg() if index != NULL, in which case records are
+ * taken from the index) but splits the response across several packets (the query is matched anew for every packet).
+ * @see minimr_make_msg_next()
+ */
+int32_t minimr_query_response_msg_next(
+    uint8_t *msg, uint16_t msglen,
+    struct minimr_query_stat qstats[], uint16_t nqstats,
+    struct minimr_rr ** records, uint16_t nrecords,
+    struct minimr_rr_index * index,
+    struct minimr_msg_cursor * cursor,
+    uint8_t *outmsg, uint16_t *outmsglen, uint16_t outmsgmaxlen,
+    uint8_t *unicast_requested,
+    void * user_data
+);
+
+
+/*************** Response cache **************/
+
+/**
+ * Entry of response cache
+ * @see struct minimr_response_cache
+ */
+struct minimr_response_cache_entry {
+    uint32_t generation;
+    uint32_t fingerprint;
+
+    // (match_i, type, qclass) of every question answered
+    uint16_t nkey;
+    uint16_t key[MINIMR_RESPONSE_CACHE_KEY_SIZE];
+
+    uint8_t unicast;
+
+    uint8_t * msg;
+    uint16_t length;    // 0 if unused
+    uint16_t maxlen;
+};
+
+/**
+ * Cache of complete response messages.
+ *
+ * Entries are keyed by a fingerprint of the questions remaining after known answer suppression (ie matching record,
+ * type and class) and the unicast response bit. A hit is copied to the output (with the transaction id of the query)
+ * without calling any record handler.
+ *
+ * A cache is bound to one record set (and user_data) and its generation: a counter kept along with the record set
+ * which minimr_response_cache_invalidate() MUST bump when records, their TTL or the record set change (entries of other
+ * generations are outdated). Changes of other record sets do not affect the cache.
+ * All memory is provided by the caller.
+ */
+struct minimr_response_cache {
+    struct minimr_response_cache_entry * entries;
+    uint16_t nentries;
+
+    volatile uint32_t * generation;
+};
+
+/**
+ * Initializes response cache with nentries entries each of which uses msgmaxlen bytes of buffer
+ * (ie buffer must be at least nentries * msgmaxlen bytes)
+ * @param generation    generation of the record set (owned by the caller, might be shared by several caches)
+ */
+void minimr_response_cache_init(
+        struct minimr_response_cache * cache,
+        struct minimr_response_cache_entry * entries, uint16_t nentries,
+        uint8_t * buffer, uint16_t msgmaxlen,
+        volatile uint32_t * generation
+);
+
+/**
+ * Invalidates the cached responses of the record set of given generation (of all caches bound to it)
+ */
+void minimr_response_cache_invalidate(volatile uint32_t * generation);
+
+/**
+ * Like minimr_query_response_msg() (or minimr_indexed_query_response_msg() if index != NULL, in which case records are
+ * taken from the index) but looks up and stores responses in given cache.
+ * @see minimr_query_response_msg()
+ */
+int32_t minimr_cached_query_response_msg(
+    uint8_t *msg, uint16_t msglen,
+    struct minimr_query_stat qstats[], uint16_t nqstats,
+    struct minimr_rr ** records, uint16_t nrecords,
+    struct minimr_rr_index * index,
+    struct minimr_response_cache * cache,
+    uint8_t *outmsg, uint16_t *outmsglen, uint16_t outmsgmaxlen,
+    uint8_t *unicast_requested,
+    void * user_data
+);
+
+
+
+/*************** Time utilities **************/
+
+/**
+ * @return 1 if (wrapping, ex. msec) time a is before or at b
+ */
+#define MINIMR_TIME_DUE(a, b) ((int32_t)((uint32_t)(a) - (uint32_t)(b)) <= 0)
+
+
+/*************** Duplicate question suppression **************/
+
+/**
+ * Question seen (in a query of another host)
+ * @see struct minimr_question_table
+ */
+struct minimr_question_table_entry {
+    uint32_t name_hash;
+    uint16_t type;          // 0 if unused
+    uint16_t qclass;
+    uint32_t seen;          // time seen (msec)
+};
+
+/**
+ * Table of recently seen questions (see https://tools.ietf.org/html/rfc6762#section-7.3 )
+ *
+ * Questions of other hosts' queries are noted (fed from minimr_parse_msg(), @see minimr_question_table_observe()) and
+ * a querier about to send a question checks if the very question was asked within the last interval - in which case
+ * the question is considered sent.
+ * Only QM questions of queries without known answers (and not truncated, ie no known answers follow) are noted, as
+ * such a query's known answers can not contain any records we would not include ourselves. Probes (queries with
+ * authority records) are not noted either.
+ *
+ * Questions are identified by (name hash, type, class), each is stored in one slot (given by the hash) replacing
+ * whatever question was there before, ie the table takes fixed memory (as provided by the caller).
+ * Time is given by the caller as (wrapping) msec timestamps.
+ */
+struct minimr_question_table {
+    struct minimr_question_table_entry * entries;
+    uint16_t nentries;
+    uint32_t interval;
+};
+
+/**
+ * Initializes (empty) table
+ * @param nentries  MUST be a power of two
+ * @param interval  time (msec) a seen question suppresses the same question, ex. 1000
+ */
+void minimr_question_table_init(
+        struct minimr_question_table * table,
+        struct minimr_question_table_entry * entries, uint16_t nentries,
+        uint32_t interval
+);
+
+/**
+ * Notes question (if applicable), to be called from a minimr_query_handler
+ * @see minimr_parse_msg()
+ */
+void minimr_question_table_note(struct minimr_question_table * table, struct minimr_dns_hdr * hdr, struct minimr_query_stat * qstat, uint32_t now);
+
+/**
+ * Notes the questions of (received) query
+ * @return as minimr_parse_msg()
+ */
+int32_t minimr_question_table_observe(struct minimr_question_table * table, uint8_t * msg, uint16_t msglen, uint32_t now);
+
+/**
+ * Checks if (normalized) question was seen within the last interval
+ * @return MINIMR_OK        if seen, ie the question need not be sent
+ * @return MINIMR_NOT_OK    if not
+ */
+uint8_t minimr_question_table_seen(struct minimr_question_table * table, struct minimr_query * query, uint32_t now);
+
+/**
+ * Removes the questions seen within the last interval from queries (preserving their order)
+ * @return number of remaining queries (to be passed to minimr_make_msg())
+ */
+uint16_t minimr_question_table_filter(struct minimr_question_table * table, struct minimr_query * queries, uint16_t nqueries, uint32_t now);
+
+
+/*************** Duplicate answer suppression **************/
+
+/**
+ * Answer (of a record) about to be multicast
+ */
+struct minimr_pending_answer {
+    uint16_t record;    // index of record in record set
+    uint16_t type;      // QTYPE of question answered
+    uint32_t earliest;  // time (msec) the answer may be sent (together with answers due)
+    uint32_t deadline;  // time (msec) the answer is due
+    uint8_t truncated;  // answer to truncated query only (ie more known answers might follow)
+};
+
+/**
+ * Cancels pending answers of shared records which another responder multicast in given response already
+ * (see https://tools.ietf.org/html/rfc6762#section-7.4 ): if the response contains the very same record (name, type,
+ * class and rdata, @see Known Answer Suppression) with a TTL not less than ours, our answer is considered sent.
+ * Answers of unique records are never canceled (another responder sending them is a conflict to be dealt with).
+ *
+ * Cancelled answers are removed from pending (preserving the order of the remaining)
+ * @return number of remaining pending answers
+ */
+uint16_t minimr_duplicate_answer_suppress(
+        struct minimr_pending_answer * pending, uint16_t npending,
+        uint8_t * msg, uint16_t msglen,
+        struct minimr_rr ** records, uint16_t nrecords,
+        void * user_data
+);
+
+/**
+ * Cancels pending answers to truncated queries which the known answers of given (follow-up) query suppress
+ * (see https://tools.ietf.org/html/rfc6762#section-7.2 and @see Known Answer Suppression).
+ * Pending answers not flagged as truncated are left as they are (they answer other queries as well).
+ *
+ * Cancelled answers are removed from pending (preserving the order of the remaining)
+ * @return number of remaining pending answers
+ */
+uint16_t minimr_known_answer_cancel(
+        struct minimr_pending_answer * pending, uint16_t npending,
+        uint8_t * msg, uint16_t msglen,
+        struct minimr_rr ** records, uint16_t nrecords,
+        void * user_data
+);
+
 /*************** Optional default types and functions **************/
 
 // if > 0 will typedef minimr_dns_rr_a with given (max) namelen
@@ -889,6 +1609,42 @@ typedef MINIMR_RR_TYPE_TXT(MINIMR_RR_TYPE_TXT_DEFAULT_NAMELEN, MINIMR_RR_TYPE_TX
 // how many default types are actually defined?
 #define MINIMR_RR_TYPE_DEFAULT_COUNT (MINIMR_RR_TYPE_A_DEFAULT + MINIMR_RR_TYPE_AAAA_DEFAULT + MINIMR_RR_TYPE_PTR_DEFAULT + MINIMR_RR_TYPE_SRV_DEFAULT + MINIMR_RR_TYPE_TXT_DEFAULT)
 
+#if MINIMR_RR_TYPE_DEFAULT_COUNT > 0
+
+/**
+ * Writes a complete record of any of the default types (minimr_rr_a, minimr_rr_aaaa, etc) using name compression
+ * (if dict != NULL). Names in PTR and SRV rdata are compressed aswell.
+ * On failure *outlen is not changed.
+ * @return MINIMR_OK        on success
+ * @return MINIMR_NOT_OK    if record does not fit or is not of a default type
+ */
+uint8_t minimr_default_rr_write(struct minimr_rr * rr, uint8_t * outmsg, uint16_t * outlen, uint16_t outmsgmaxlen, struct minimr_name_dict * dict);
+
+/**
+ * Operations writing the record using minimr_default_rr_write() (for use in custom operation tables)
+ */
+int32_t minimr_default_rr_op_query_get_rr(struct minimr_rr * rr, struct minimr_query_stat * qstat, uint8_t * outmsg, uint16_t * outlen, uint16_t outmsgmaxlen, uint16_t * nrr, void * user_data, struct minimr_name_dict * dict);
+int32_t minimr_default_rr_op_get_rr(struct minimr_rr * rr, uint8_t * outmsg, uint16_t * outlen, uint16_t outmsgmaxlen, uint16_t * nrr, void * user_data, struct minimr_name_dict * dict);
+
+/**
+ * Operations of default type records: all get_rr operations write the record using minimr_default_rr_write(), there
+ * are no authority or extra records.
+ */
+extern const struct minimr_rr_ops minimr_default_rr_ops;
+
+#if MINIMR_RR_WIRE_TEMPLATE_USE == 1
+/**
+ * (Re-)builds the wire template of default type record (if a template buffer is assigned)
+ * The template is rebuilt in place, ie rr->wire_length only changes once done (and is not reset before) such that
+ * concurrent readers do not consider it outdated (and start rebuilding it themselves).
+ * @return MINIMR_OK        on success
+ * @return MINIMR_NOT_OK    if there is no template buffer or it is too small
+ */
+uint8_t minimr_default_rr_wire_update(struct minimr_rr * rr);
+#endif
+
+#endif //MINIMR_RR_TYPE_DEFAULT_COUNT > 0
+
 
 
 //#if MINIMR_RR_COUNT > 0 && MINIMR_SIMPLE_INTERFACE_ENABLED == 0
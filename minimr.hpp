@@ -0,0 +1,753 @@
+/**
+ * minimr - mini mDNS Responder (framework)
+ *
+ * https://github.com/tschiemer/minimr
+ *
+ * MIT License
+ *
+ * Copyright (c) 2020 Philip Tschiemer, filou.se
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+/**
+ * Compile-time record sets (C++17, header-only)
+ *
+ * Records are defined as constexpr objects, ie names are normalized and records are encoded (in wire format) at compile
+ * time and end up in read-only memory:
+ *
+ *  static constexpr auto host_a    = minimr::a(".here-be-kittens.local", 10, 0, 0, 100);
+ *  static constexpr auto echo_ptr  = minimr::ptr("._echo._udp.local", ".Here be Kittens._echo._udp.local");
+ *  static constexpr auto echo_srv  = minimr::srv(".Here be Kittens._echo._udp.local", 0, 0, 7, ".here-be-kittens.local");
+ *  static constexpr auto echo_txt  = minimr::txt(".Here be Kittens._echo._udp.local", "key1=value1", "key2=value2");
+ *
+ *  using services = minimr::record_set<host_a, echo_ptr, echo_srv, echo_txt>;
+ *
+ *  services::query_response_msg(msg, msglen, outmsg, &outmsglen, sizeof(outmsg), &unicast_requested);
+ *
+ * Records are written with cache-flush bit unless shared (as by MINIMR_RR_IS_SHARED(), ie PTR records by default), other
+ * sharedness is declared with minimr::with_shared(), ex minimr::with_shared(minimr::srv(...)).
+ *
+ * A record set matches questions against (compile-time) name hashes, types and classes and writes its records without
+ * any handler dispatch. Additional records (SRV, TXT and A/AAAA for PTR answers; A/AAAA for SRV answers; AAAA for A
+ * answers and vice versa) are determined at compile time.
+ *
+ * To use such records with the C interface, minimr::rr<record>() yields a (layout compatible) struct minimr_rr
+ * (with typed operations writing the pre-encoded record). Note that such C records do not provide any additional
+ * records (no query_get_extra_rrs operation) as these are only known within a record set.
+ */
+
+#ifndef MINIMR_MINIMR_HPP
+#define MINIMR_MINIMR_HPP
+
+#include "minimr.h"
+
+#if __cplusplus < 201703L
+#error minimr.hpp requires C++17
+#endif
+
+#include <stddef.h>
+
+namespace minimr {
+
+// TYPE(2) CLASS(2) TTL(4) RDLENGTH(2)
+constexpr size_t wire_header_length = 10;
+
+template<size_t N>
+struct bytes {
+    static constexpr size_t size = N;
+    uint8_t data[N];
+};
+
+namespace detail {
+
+    // not constexpr, ie using these in constant expressions fails compilation with a (hopefully) telling name
+    void name_must_start_with_a_dot();
+    void name_label_too_long();
+    void txt_entry_too_long();
+
+    constexpr uint8_t fold(uint8_t c)
+    {
+        return ('A' <= c && c <= 'Z') ? (c - 'A' + 'a') : c;
+    }
+
+    template<size_t N>
+    constexpr uint32_t name_hash(const bytes<N> & name)
+    {
+        uint32_t h = MINIMR_NAME_HASH_INIT;
+        for(size_t i = 0; i < N && name.data[i] != '\0'; i++){
+            MINIMR_NAME_HASH_STEP(h, name.data[i]);
+        }
+        return h;
+    }
+
+    constexpr bool name_equals(const uint8_t * lhs, const uint8_t * rhs)
+    {
+        size_t i = 0;
+        for(; lhs[i] != '\0' && rhs[i] != '\0'; i++){
+            if (fold(lhs[i]) != fold(rhs[i])){
+                return false;
+            }
+        }
+        return lhs[i] == rhs[i];
+    }
+
+    template<size_t N>
+    constexpr void put16(bytes<N> & dst, size_t pos, uint16_t value)
+    {
+        dst.data[pos] = (value >> 8) & 0xff;
+        dst.data[pos+1] = value & 0xff;
+    }
+
+    template<size_t N, size_t M>
+    constexpr void put(bytes<N> & dst, size_t pos, const bytes<M> & src)
+    {
+        for(size_t i = 0; i < M; i++){
+            dst.data[pos + i] = src.data[i];
+        }
+    }
+
+} // namespace detail
+
+/**
+ * Normalizes NAME given in the usual notation (".segment1.segment2.tld") at compile time, ie yields the same as
+ * minimr_name_normalize() (incl. terminating NUL).
+ */
+template<size_t N>
+constexpr bytes<N> name(const char (&str)[N])
+{
+    static_assert(N > 1, "empty name");
+
+    bytes<N> out{};
+
+    if (str[0] != '.'){
+        detail::name_must_start_with_a_dot();
+    }
+
+    size_t seg = 0;
+
+    for(size_t i = 0; i < N - 1; i++){
+        if (str[i] == '.'){
+            seg = i;
+        } else {
+            out.data[i] = str[i];
+            if (++out.data[seg] > 63){
+                detail::name_label_too_long();
+            }
+        }
+    }
+
+    return out;
+}
+
+/**
+ * Compile-time record
+ */
+template<size_t NameLen, size_t RdLen>
+struct record {
+    uint16_t type;
+    uint16_t cache_class;
+    uint32_t ttl;
+
+    bytes<NameLen> name;
+
+    // TYPE, CLASS, TTL, RDLENGTH and RDATA
+    bytes<wire_header_length + RdLen> wire;
+
+    // offset of trailing name in wire (or 0)
+    uint16_t rdata_name;
+
+    // shared records are written without cache-flush bit
+    bool shared;
+};
+
+template<size_t NameLen, size_t RdLen>
+constexpr record<NameLen, RdLen> make_record(const bytes<NameLen> & name, uint16_t type, uint16_t cache_class, uint32_t ttl, const bytes<RdLen> & rdata, uint16_t rdata_name)
+{
+    record<NameLen, RdLen> rr{};
+
+    rr.type = type;
+    rr.cache_class = cache_class;
+    rr.ttl = ttl;
+    rr.name = name;
+
+    // TTL and cache-flush bit are set when writing
+    detail::put16(rr.wire, 0, type);
+    detail::put16(rr.wire, 2, cache_class);
+    detail::put16(rr.wire, 8, RdLen);
+    detail::put(rr.wire, wire_header_length, rdata);
+
+    rr.rdata_name = rdata_name;
+
+    // sharedness as of the C records (unless declared otherwise, @see with_shared())
+    rr.shared = MINIMR_RR_IS_SHARED(&rr);
+
+    return rr;
+}
+
+template<size_t N>
+constexpr auto a(const char (&rrname)[N], uint8_t a0, uint8_t a1, uint8_t a2, uint8_t a3, uint32_t ttl = MINIMR_DEFAULT_TTL)
+{
+    bytes<4> rdata{{a0, a1, a2, a3}};
+
+    return make_record(name(rrname), MINIMR_DNS_TYPE_A, MINIMR_DNS_CLASS_IN, ttl, rdata, 0);
+}
+
+template<size_t N>
+constexpr auto aaaa(const char (&rrname)[N], const uint16_t (&ipv6)[8], uint32_t ttl = MINIMR_DEFAULT_TTL)
+{
+    bytes<16> rdata{};
+
+    for(size_t i = 0; i < 8; i++){
+        detail::put16(rdata, 2*i, ipv6[i]);
+    }
+
+    return make_record(name(rrname), MINIMR_DNS_TYPE_AAAA, MINIMR_DNS_CLASS_IN, ttl, rdata, 0);
+}
+
+template<size_t N, size_t M>
+constexpr auto ptr(const char (&rrname)[N], const char (&domain)[M], uint32_t ttl = MINIMR_DEFAULT_TTL)
+{
+    return make_record(name(rrname), MINIMR_DNS_TYPE_PTR, MINIMR_DNS_CLASS_IN, ttl, name(domain), wire_header_length);
+}
+
+template<size_t N, size_t M>
+constexpr auto srv(const char (&rrname)[N], uint16_t priority, uint16_t weight, uint16_t port, const char (&target)[M], uint32_t ttl = MINIMR_DEFAULT_TTL)
+{
+    bytes<6 + M> rdata{};
+
+    detail::put16(rdata, 0, priority);
+    detail::put16(rdata, 2, weight);
+    detail::put16(rdata, 4, port);
+    detail::put(rdata, 6, name(target));
+
+    return make_record(name(rrname), MINIMR_DNS_TYPE_SRV, MINIMR_DNS_CLASS_IN, ttl, rdata, wire_header_length + 6);
+}
+
+/**
+ * TXT record with given entries (ex "key=value"), without entries a single empty string is used
+ */
+template<size_t N, size_t ... Ms>
+constexpr auto txt(const char (&rrname)[N], const char (& ... entries)[Ms])
+{
+    // every entry (without NUL) is preceded by its length
+    bytes<(sizeof...(Ms) > 0 ? (0 + ... + Ms) : 1)> rdata{};
+
+    size_t pos = 0;
+
+    auto add = [&](const char * entry, size_t len){
+        if (len - 1 > 255){
+            detail::txt_entry_too_long();
+        }
+        rdata.data[pos++] = len - 1;
+        for(size_t i = 0; i < len - 1; i++){
+            rdata.data[pos++] = entry[i];
+        }
+    };
+
+    (add(entries, Ms), ...);
+
+    return make_record(name(rrname), MINIMR_DNS_TYPE_TXT, MINIMR_DNS_CLASS_IN, MINIMR_DEFAULT_TTL, rdata, 0);
+}
+
+/**
+ * Same record with different TTL
+ */
+template<size_t NameLen, size_t RdLen>
+constexpr record<NameLen, RdLen> with_ttl(record<NameLen, RdLen> rr, uint32_t ttl)
+{
+    rr.ttl = ttl;
+    return rr;
+}
+
+/**
+ * Same record declared shared (or unique), ie written without (or with) cache-flush bit
+ * (see https://tools.ietf.org/html/rfc6762#section-10.2 )
+ */
+template<size_t NameLen, size_t RdLen>
+constexpr record<NameLen, RdLen> with_shared(record<NameLen, RdLen> rr, bool shared = true)
+{
+    rr.shared = shared;
+    return rr;
+}
+
+
+/**
+ * Type independent view of a compile-time record
+ */
+struct record_view {
+    uint16_t type;
+    uint16_t cache_class;
+    uint32_t ttl;
+    uint32_t name_hash;
+
+    const uint8_t * name;
+
+    const uint8_t * wire;
+    uint16_t wire_length;
+    uint16_t rdata_name;
+
+    bool shared;
+};
+
+template<const auto & R>
+constexpr record_view view()
+{
+    return record_view{
+        R.type, R.cache_class, R.ttl, detail::name_hash(R.name),
+        R.name.data,
+        R.wire.data, (uint16_t)R.wire.size, R.rdata_name,
+        R.shared
+    };
+}
+
+/**
+ * Writes record (with given TTL) to outmsg, names are compressed if dict != NULL
+ * @return MINIMR_OK        on success
+ * @return MINIMR_NOT_OK    if record does not fit, in which case neither outlen nor dict are changed
+ */
+inline uint8_t write(const record_view & rr, uint32_t ttl, uint8_t * outmsg, uint16_t * outlen, uint16_t outmsgmaxlen, struct minimr_name_dict * dict)
+{
+    uint16_t l = *outlen;
+
+    if (minimr_name_write(outmsg, &l, outmsgmaxlen, const_cast<uint8_t *>(rr.name), dict) != MINIMR_OK){
+        return MINIMR_NOT_OK;
+    }
+
+    // without compression the trailing name is copied as is
+    uint16_t n = (dict != NULL && rr.rdata_name > 0) ? rr.rdata_name : rr.wire_length;
+
+    if (l + n > outmsgmaxlen){
+        minimr_name_dict_truncate(dict, *outlen);
+        return MINIMR_NOT_OK;
+    }
+
+    uint16_t p = l;
+
+    for(uint16_t i = 0; i < n; i++){
+        outmsg[l++] = rr.wire[i];
+    }
+
+    if (n < rr.wire_length){
+        if (minimr_name_write(outmsg, &l, outmsgmaxlen, const_cast<uint8_t *>(&rr.wire[n]), dict) != MINIMR_OK){
+            minimr_name_dict_truncate(dict, *outlen);
+            return MINIMR_NOT_OK;
+        }
+        minimr_rr_write_end(outmsg, l, p + 8);
+    }
+
+    // shared records without cache-flush bit
+    if (!rr.shared){
+        outmsg[p + 2] |= (MINIMR_DNS_CACHEFLUSH >> 8);
+    }
+
+    p += 4;
+    MINIMR_DNS_RR_WRITE_TTL(outmsg, p, ttl);
+
+    *outlen = l;
+
+    return MINIMR_OK;
+}
+
+
+/************* Interoperability with C records **************/
+
+/**
+ * C record (struct minimr_rr compatible) with given name length
+ */
+template<size_t NameLen>
+MINIMR_RR_TYPE_BEGIN_STNAME(NameLen, c_record)
+MINIMR_RR_TYPE_END();
+
+namespace detail {
+
+    template<const auto & R>
+    int32_t c_get_rr(struct minimr_rr * rr, uint8_t * outmsg, uint16_t * outlen, uint16_t outmsgmaxlen, uint16_t * nrr, void *, struct minimr_name_dict * dict)
+    {
+        static constexpr record_view v = view<R>();
+
+        if (write(v, rr->ttl, outmsg, outlen, outmsgmaxlen, dict) != MINIMR_OK){
+            return MINIMR_NOT_OK;
+        }
+
+        if (nrr != NULL){
+            *nrr = 1;
+        }
+
+        return MINIMR_OK;
+    }
+
+    template<const auto & R>
+    int32_t c_query_get_rr(struct minimr_rr * rr, struct minimr_query_stat *, uint8_t * outmsg, uint16_t * outlen, uint16_t outmsgmaxlen, uint16_t * nrr, void * user_data, struct minimr_name_dict * dict)
+    {
+        return c_get_rr<R>(rr, outmsg, outlen, outmsgmaxlen, nrr, user_data, dict);
+    }
+
+    template<const auto & R>
+    inline constexpr struct minimr_rr_ops c_ops = {
+        NULL,               // query_respond_to
+        c_query_get_rr<R>,  // query_get_rr
+        NULL,               // query_get_authority_rrs
+        NULL,               // query_get_extra_rrs (additional records are only known within a record set)
+        c_get_rr<R>,        // get_rr
+        c_get_rr<R>,        // announce_get_rr
+        NULL,               // announce_get_extra_rrs
+        NULL                // lexcmp
+    };
+
+    template<const auto & R>
+    constexpr c_record<R.name.size> make_c_record()
+    {
+        c_record<R.name.size> rr{};
+
+        rr.type = R.type;
+        rr.cache_class = R.cache_class;
+        rr.ttl = R.ttl;
+        rr.ops = &c_ops<R>;
+        rr.handler = minimr_rr_ops_handler;
+        rr.name_length = R.name.size;
+
+        for(size_t i = 0; i < R.name.size; i++){
+            rr.name[i] = R.name.data[i];
+        }
+
+        return rr;
+    }
+
+    // constant initialized (no runtime normalization) but mutable as the C interface might change the TTL
+    template<const auto & R>
+    inline c_record<R.name.size> c_rr = make_c_record<R>();
+
+} // namespace detail
+
+/**
+ * Gets C record of compile-time record R (one instance per R)
+ */
+template<const auto & R>
+inline struct minimr_rr * rr()
+{
+    return reinterpret_cast<struct minimr_rr *>(&detail::c_rr<R>);
+}
+
+
+/************* Record sets **************/
+
+template<const auto & ... Rs>
+struct record_set {
+
+    static constexpr size_t count = sizeof...(Rs);
+
+    static_assert(count > 0, "empty record set");
+
+    static constexpr record_view records[count] = { view<Rs>() ... };
+
+    /**
+     * extras[i][j] is true if record j is an additional record of record i
+     */
+    struct extras_table {
+        bool extra[count][count];
+    };
+
+    static constexpr bool is_address(size_t i)
+    {
+        return records[i].type == MINIMR_DNS_TYPE_A || records[i].type == MINIMR_DNS_TYPE_AAAA;
+    }
+
+    static constexpr const uint8_t * target(size_t i)
+    {
+        return records[i].rdata_name > 0 ? &records[i].wire[records[i].rdata_name] : NULL;
+    }
+
+    static constexpr extras_table make_extras()
+    {
+        extras_table t{};
+
+        for(size_t i = 0; i < count; i++){
+            for(size_t j = 0; j < count; j++){
+
+                if (i == j) continue;
+
+                // A <-> AAAA of same name
+                if (is_address(i) && is_address(j) && records[i].type != records[j].type){
+                    t.extra[i][j] = detail::name_equals(records[i].name, records[j].name);
+                }
+
+                // SRV -> A/AAAA of target
+                if (records[i].type == MINIMR_DNS_TYPE_SRV && is_address(j)){
+                    t.extra[i][j] = detail::name_equals(target(i), records[j].name);
+                }
+
+                if (records[i].type == MINIMR_DNS_TYPE_PTR){
+
+                    // PTR -> SRV/TXT of instance
+                    if ((records[j].type == MINIMR_DNS_TYPE_SRV || records[j].type == MINIMR_DNS_TYPE_TXT) && detail::name_equals(target(i), records[j].name)){
+                        t.extra[i][j] = true;
+                    }
+
+                    // PTR -> A/AAAA of instance's SRV target
+                    for(size_t k = 0; k < count && is_address(j); k++){
+                        if (records[k].type == MINIMR_DNS_TYPE_SRV &&
+                            detail::name_equals(target(i), records[k].name) &&
+                            detail::name_equals(target(k), records[j].name)){
+                            t.extra[i][j] = true;
+                        }
+                    }
+                }
+            }
+        }
+
+        return t;
+    }
+
+    static constexpr extras_table extras = make_extras();
+
+    /**
+     * Checks if known answer (in msg) is equal to record i and its TTL is at least half of ours
+     * (see https://tools.ietf.org/html/rfc6762#section-7.1 )
+     */
+    static bool is_known_answer(size_t i, struct minimr_rr_stat * rstat, uint8_t * msg, uint16_t msglen)
+    {
+        const record_view & rr = records[i];
+
+        if (rstat->type != rr.type) return false;
+        if ((rstat->cache_class & MINIMR_DNS_RRCLASS) != (rr.cache_class & MINIMR_DNS_RRCLASS)) return false;
+        if (rstat->ttl < rr.ttl / 2) return false;
+
+        // compare rdata up to (compressible) name
+        uint16_t n = (rr.rdata_name > 0 ? rr.rdata_name : rr.wire_length) - wire_header_length;
+
+        if (rr.rdata_name == 0 && rstat->dlength != n) return false;
+        if (rstat->dlength < n) return false;
+
+        for(uint16_t k = 0; k < n; k++){
+            if (msg[rstat->data_offset + k] != rr.wire[wire_header_length + k]) return false;
+        }
+
+        if (rr.rdata_name > 0 && minimr_name_cmp(const_cast<uint8_t *>(&rr.wire[rr.rdata_name]), rstat->data_offset + n, msg, msglen) != 0) return false;
+
+        return minimr_name_cmp(const_cast<uint8_t *>(rr.name), rstat->name_offset, msg, msglen) == 0;
+    }
+
+    /**
+     * Like minimr_query_response_msg() for the records of this set (unicast_requested is optional)
+     * @see minimr_query_response_msg()
+     */
+    static int32_t query_response_msg(
+            uint8_t * msg, uint16_t msglen,
+            uint8_t * outmsg, uint16_t * outmsglen, uint16_t outmsgmaxlen,
+            uint8_t * unicast_requested
+    )
+    {
+        MINIMR_ASSERT(msg != NULL);
+        MINIMR_ASSERT(outmsg != NULL);
+        MINIMR_ASSERT(outmsglen != NULL);
+
+        if (msglen < MINIMR_DNS_HDR_SIZE){
+            return MINIMR_IGNORE;
+        }
+
+        struct minimr_dns_hdr hdr;
+
+        minimr_dns_hdr_read(&hdr, msg);
+
+        if ( (hdr.flags[0] & MINIMR_DNS_HDR1_QR) != MINIMR_DNS_HDR1_QR_QUERY ||
+             (hdr.flags[0] & MINIMR_DNS_HDR1_OPCODE) != MINIMR_DNS_HDR1_OPCODE_QUERY ||
+             hdr.nqueries == 0){
+            return MINIMR_IGNORE;
+        }
+
+        bool answer[count] = {};
+        size_t nanswer = 0;
+        uint8_t unicast = 0;
+
+        uint16_t pos = MINIMR_DNS_HDR_SIZE;
+
+        for(uint16_t iq = 0; iq < hdr.nqueries; iq++){
+
+            struct minimr_query_stat qstat;
+
+            uint8_t res = minimr_extract_query_stat(&qstat, msg, &pos, msglen);
+
+            if (res == MINIMR_DNS_HDR2_RCODE_SERVAIL){
+                return MINIMR_DNS_HDR2_RCODE_SERVAIL;
+            }
+            if (res != MINIMR_OK){
+                return MINIMR_DNS_HDR2_RCODE_FORMERR;
+            }
+
+            uint16_t qclass = qstat.unicast_class & MINIMR_DNS_QCLASS;
+
+            for(size_t i = 0; i < count; i++){
+
+                if (answer[i]) continue;
+
+                if (qstat.name_hash != records[i].name_hash) continue;
+                if (qstat.type != MINIMR_DNS_TYPE_ANY && qstat.type != records[i].type) continue;
+                if (qclass != MINIMR_DNS_CLASS_ANY && qclass != (records[i].cache_class & MINIMR_DNS_RRCLASS)) continue;
+
+                if (minimr_name_cmp(const_cast<uint8_t *>(records[i].name), qstat.name_offset, msg, msglen) != 0) continue;
+
+                answer[i] = true;
+                nanswer++;
+
+                if ((qstat.unicast_class & MINIMR_DNS_QUNICAST) == MINIMR_DNS_QUNICAST){
+                    unicast = 1;
+                }
+            }
+        }
+
+        // known answer suppression
+        for(uint16_t ia = 0; ia < hdr.nanswers && nanswer > 0; ia++){
+
+            struct minimr_rr_stat rstat;
+
+            uint8_t res = minimr_extract_rr_stat(&rstat, msg, &pos, msglen);
+
+            if (res == MINIMR_DNS_HDR2_RCODE_SERVAIL){
+                return MINIMR_DNS_HDR2_RCODE_SERVAIL;
+            }
+            if (res != MINIMR_OK){
+                return MINIMR_DNS_HDR2_RCODE_FORMERR;
+            }
+
+            for(size_t i = 0; i < count; i++){
+                if (answer[i] && is_known_answer(i, &rstat, msg, msglen)){
+                    answer[i] = false;
+                    nanswer--;
+                }
+            }
+        }
+
+        if (nanswer == 0){
+            return MINIMR_IGNORE;
+        }
+
+        if (unicast_requested != NULL){
+            *unicast_requested = unicast;
+        }
+
+        uint16_t outlen = MINIMR_DNS_HDR_SIZE;
+
+#if MINIMR_NAME_COMPRESSION_ENABLED == 1
+        struct minimr_name_dict dict_st;
+        struct minimr_name_dict * dict = &dict_st;
+        minimr_name_dict_init(dict);
+#else
+        struct minimr_name_dict * dict = NULL;
+#endif
+
+        struct minimr_dns_hdr outhdr = {};
+
+        outhdr.transaction_id = hdr.transaction_id;
+        outhdr.flags[0] = MINIMR_DNS_HDR1_QR_REPLY | MINIMR_DNS_HDR1_AA;
+        outhdr.flags[1] = MINIMR_DNS_HDR2_RCODE_NOERROR;
+
+        for(size_t i = 0; i < count; i++){
+            if (!answer[i]) continue;
+
+            if (write(records[i], records[i].ttl, outmsg, &outlen, outmsgmaxlen, dict) != MINIMR_OK){
+                return MINIMR_DNS_HDR2_RCODE_SERVAIL;
+            }
+            outhdr.nanswers++;
+        }
+
+        for(size_t j = 0; j < count; j++){
+            if (answer[j]) continue;
+
+            bool extra = false;
+            for(size_t i = 0; i < count && !extra; i++){
+                extra = answer[i] && extras.extra[i][j];
+            }
+            if (!extra) continue;
+
+            // additional records are optional, ie stop if out of space
+            if (write(records[j], records[j].ttl, outmsg, &outlen, outmsgmaxlen, dict) != MINIMR_OK){
+                break;
+            }
+            outhdr.nextrarr++;
+        }
+
+        minimr_dns_hdr_write(outmsg, &outhdr);
+
+        *outmsglen = outlen;
+
+        return MINIMR_OK;
+    }
+
+    /**
+     * Like minimr_announce_msg() for the records of this set; with ttl = 0 the message is a goodbye message
+     * (ie minimr_terminate_msg())
+     */
+    static int32_t announce_msg(uint8_t * outmsg, uint16_t * outmsglen, uint16_t outmsgmaxlen, bool goodbye = false)
+    {
+        MINIMR_ASSERT(outmsg != NULL);
+        MINIMR_ASSERT(outmsglen != NULL);
+
+        if (outmsgmaxlen < MINIMR_DNS_HDR_SIZE){
+            return MINIMR_NOT_OK;
+        }
+
+        uint16_t outlen = MINIMR_DNS_HDR_SIZE;
+
+#if MINIMR_NAME_COMPRESSION_ENABLED == 1
+        struct minimr_name_dict dict_st;
+        struct minimr_name_dict * dict = &dict_st;
+        minimr_name_dict_init(dict);
+#else
+        struct minimr_name_dict * dict = NULL;
+#endif
+
+        struct minimr_dns_hdr outhdr = {};
+
+        outhdr.flags[0] = MINIMR_DNS_HDR1_QR_REPLY | MINIMR_DNS_HDR1_AA;
+        outhdr.flags[1] = MINIMR_DNS_HDR2_RCODE_NOERROR;
+
+        for(size_t i = 0; i < count; i++){
+            if (write(records[i], goodbye ? 0 : records[i].ttl, outmsg, &outlen, outmsgmaxlen, dict) != MINIMR_OK){
+                return MINIMR_NOT_OK;
+            }
+            outhdr.nanswers++;
+        }
+
+        minimr_dns_hdr_write(outmsg, &outhdr);
+
+        *outmsglen = outlen;
+
+        return MINIMR_OK;
+    }
+
+    static int32_t terminate_msg(uint8_t * outmsg, uint16_t * outmsglen, uint16_t outmsgmaxlen)
+    {
+        return announce_msg(outmsg, outmsglen, outmsgmaxlen, true);
+    }
+
+    /**
+     * C records of this set (for use with the C interface)
+     */
+    static struct minimr_rr ** c_records()
+    {
+        static struct minimr_rr * set[count] = { rr<Rs>() ... };
+        return set;
+    }
+};
+
+} // namespace minimr
+
+#endif //MINIMR_MINIMR_HPP
@@ -0,0 +1,660 @@
+/**
+ * minimr - mini mDNS Responder (framework)
+ *
+ * https://github.com/tschiemer/minimr
+ *
+ * MIT License
+ *
+ * Copyright (c) 2020 Philip Tschiemer, filou.se
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "minimrcache.h"
+
+// (remaining) TTLs are kept in msec, longer TTLs are capped (~24 days)
+#define CACHE_TTL_MAX       2000000UL
+
+// goodbye records and flushed records expire after one second (see https://tools.ietf.org/html/rfc6762#section-10.1 )
+#define CACHE_GRACE         1000
+
+// refresh queries at 80%, 85%, 90% and 95% of the TTL (see https://tools.ietf.org/html/rfc6762#section-5.2 )
+#define CACHE_REFRESH_STEPS 4
+
+static int32_t cache_rr_get_rr(struct minimr_rr * rr, uint8_t * outmsg, uint16_t * outlen, uint16_t outmsgmaxlen, uint16_t * nrr, void * user_data, struct minimr_name_dict * dict);
+
+static const struct minimr_rr_ops cache_rr_ops = {
+    .get_rr = cache_rr_get_rr,
+};
+
+
+/**
+ * Offset of a name in RDATA of given type (-1 if none)
+ */
+static int32_t cache_rdata_name_offset(uint16_t type)
+{
+    switch(type){
+        case MINIMR_DNS_TYPE_PTR:
+        case MINIMR_DNS_TYPE_CNAME:
+        case MINIMR_DNS_TYPE_NS:
+            return 0;
+        case MINIMR_DNS_TYPE_MX:
+            return 2;
+        case MINIMR_DNS_TYPE_SRV:
+            return 6;
+        default:
+            return -1;
+    }
+}
+
+/**
+ * Copies RDATA of record (decompressing names)
+ */
+static int32_t cache_rdata_copy(struct minimr_rr_stat * rstat, uint8_t * msg, uint16_t msglen, uint8_t * rdata, uint16_t * rdlength)
+{
+    if (rstat->data_offset + rstat->dlength > msglen){
+        return MINIMR_NOT_OK;
+    }
+
+    int32_t n = cache_rdata_name_offset(rstat->type);
+
+    if (n < 0){
+
+        if (rstat->dlength > MINIMR_CACHE_RDATALEN){
+            return MINIMR_IGNORE;
+        }
+
+        for(uint16_t i = 0; i < rstat->dlength; i++){
+            rdata[i] = msg[rstat->data_offset + i];
+        }
+
+        *rdlength = rstat->dlength;
+
+        return MINIMR_OK;
+    }
+
+    if (rstat->dlength <= n){
+        return MINIMR_NOT_OK;
+    }
+
+    if (n >= MINIMR_CACHE_RDATALEN){
+        return MINIMR_IGNORE;
+    }
+
+    for(uint16_t i = 0; i < n; i++){
+        rdata[i] = msg[rstat->data_offset + i];
+    }
+
+    int32_t len = minimr_name_uncompress(&rdata[n], MINIMR_CACHE_RDATALEN - n, rstat->data_offset + n, msg, msglen);
+
+    if (len < 0){
+        return MINIMR_IGNORE;
+    }
+
+    *rdlength = n + len + 1;
+
+    return MINIMR_OK;
+}
+
+static int32_t cache_rr_get_rr(struct minimr_rr * rr, uint8_t * outmsg, uint16_t * outlen, uint16_t outmsgmaxlen, uint16_t * nrr, void * user_data, struct minimr_name_dict * dict)
+{
+    struct minimr_cache_rr * crr = (struct minimr_cache_rr *)rr;
+
+    uint16_t l = *outlen;
+    uint16_t rdpos;
+
+    if (minimr_rr_write_begin(rr, outmsg, &l, outmsgmaxlen, dict, &rdpos) != MINIMR_OK){
+        return MINIMR_NOT_OK;
+    }
+
+    // known answers must not have the cache-flush bit set (see https://tools.ietf.org/html/rfc6762#section-10.2 )
+    outmsg[rdpos - 6] &= ~(MINIMR_DNS_CACHEFLUSH >> 8);
+
+    // a trailing name in rdata is compressed as well
+    int32_t n = cache_rdata_name_offset(rr->type);
+
+    if (n < 0 || dict == NULL || rr->type == MINIMR_DNS_TYPE_MX){
+        n = crr->rdata_length;
+    }
+
+    if (minimr_rr_write_data(crr->rdata, n, outmsg, &l, outmsgmaxlen) != MINIMR_OK ||
+        (n < crr->rdata_length && minimr_name_write(outmsg, &l, outmsgmaxlen, &crr->rdata[n], dict) != MINIMR_OK)){
+        minimr_name_dict_truncate(dict, *outlen);
+        return MINIMR_NOT_OK;
+    }
+
+    minimr_rr_write_end(outmsg, l, rdpos);
+
+    *outlen = l;
+
+    if (nrr != NULL){
+        *nrr = 1;
+    }
+
+    return MINIMR_OK;
+}
+
+void minimr_cache_init(
+        struct minimr_cache * cache,
+        struct minimr_cache_rr * pool, uint16_t npool,
+        struct minimr_rr ** records,
+        struct minimr_rr_index_entry * entries,
+        uint16_t * buckets, uint16_t nbuckets
+)
+{
+    MINIMR_ASSERT(cache != NULL);
+    MINIMR_ASSERT(pool != NULL);
+    MINIMR_ASSERT(npool > 0 && npool < MINIMR_CACHE_NONE);
+
+    cache->pool = pool;
+    cache->npool = npool;
+    cache->wheel = NULL;
+
+    minimr_rr_index_init(&cache->index, records, npool, entries, buckets, nbuckets);
+
+    minimr_cache_clear(cache);
+}
+
+void minimr_cache_clear(struct minimr_cache * cache)
+{
+    MINIMR_ASSERT(cache != NULL);
+
+    // free list in order of slots
+    for(uint16_t i = 0; i < cache->npool; i++){
+        cache->pool[i].pos = MINIMR_CACHE_NONE;
+        cache->pool[i].next = i + 1 < cache->npool ? i + 1 : MINIMR_CACHE_NONE;
+    }
+    cache->free = 0;
+    cache->hand = 0;
+
+    minimr_rr_index_init(&cache->index, cache->index.records, cache->npool, cache->index.entries, cache->index.buckets, cache->index.nbuckets);
+
+    if (cache->wheel != NULL){
+        minimr_wheel_clear(cache->wheel);
+    }
+}
+
+void minimr_cache_set_wheel(struct minimr_cache * cache, struct minimr_wheel * wheel)
+{
+    MINIMR_ASSERT(cache != NULL);
+    MINIMR_ASSERT(wheel == NULL || wheel->ntimers >= cache->npool);
+
+    cache->wheel = wheel;
+}
+
+/**
+ * Time the next refresh query of a record is due (or the record expires)
+ */
+static uint32_t cache_deadline(struct minimr_cache_rr * rr)
+{
+    if (rr->refresh >= CACHE_REFRESH_STEPS){
+        return rr->expires;
+    }
+
+    uint32_t ttl = rr->expires - rr->received;
+
+    // variance of 0-2% (by 0.1%), pseudo-random by time of reception such that queriers do not synchronize
+    // (but records of the same message are refreshed together)
+    uint32_t variance = ((rr->received * 2654435761UL) >> 16) % 21;
+
+    return rr->received + ttl / 100 * (80 + 5 * rr->refresh) + ttl / 1000 * variance;
+}
+
+/**
+ * (Re)arms the timer of a record (if there is a wheel)
+ */
+static void cache_arm(struct minimr_cache * cache, struct minimr_cache_rr * rr)
+{
+    if (cache->wheel != NULL){
+        minimr_wheel_add(cache->wheel, rr - cache->pool, cache_deadline(rr));
+    }
+}
+
+/**
+ * Removes record from record set and returns its slot to the pool
+ */
+static void cache_free(struct minimr_cache * cache, struct minimr_cache_rr * rr)
+{
+    uint16_t pos = rr->pos;
+
+    minimr_rr_index_remove(&cache->index, pos);
+
+    // the last record of the set took its place
+    if (pos < cache->index.nrecords){
+        ((struct minimr_cache_rr *)cache->index.records[pos])->pos = pos;
+    }
+
+    if (cache->wheel != NULL){
+        minimr_wheel_cancel(cache->wheel, rr - cache->pool);
+    }
+
+    rr->pos = MINIMR_CACHE_NONE;
+    rr->next = cache->free;
+    cache->free = rr - cache->pool;
+}
+
+/**
+ * Takes slot from pool, evicting a record if need be: the clock hand passes over the slots giving records looked up
+ * since its last pass a second chance, expired records are evicted right away and records received just now are kept
+ */
+static struct minimr_cache_rr * cache_alloc(struct minimr_cache * cache, uint32_t now)
+{
+    if (cache->free == MINIMR_CACHE_NONE){
+
+        // at most two passes (the first pass clears all reference bits)
+        for(uint32_t n = 0; n < 2 * (uint32_t)cache->npool; n++){
+
+            struct minimr_cache_rr * rr = &cache->pool[cache->hand];
+
+            cache->hand = cache->hand + 1 < cache->npool ? cache->hand + 1 : 0;
+
+            if (MINIMR_TIME_DUE(rr->expires, now)){
+                cache_free(cache, rr);
+                break;
+            }
+
+            // records of the message being added (ex. SRV, TXT and addresses of an instance) do not evict each other
+            if (rr->received == now){
+                continue;
+            }
+
+            if (rr->referenced){
+                rr->referenced = 0;
+                continue;
+            }
+
+            cache_free(cache, rr);
+            break;
+        }
+
+        // all records were received just now, ie the message holds more records than the pool
+        if (cache->free == MINIMR_CACHE_NONE){
+            cache_free(cache, &cache->pool[cache->hand]);
+            cache->hand = cache->hand + 1 < cache->npool ? cache->hand + 1 : 0;
+        }
+    }
+
+    uint16_t i = cache->free;
+
+    cache->free = cache->pool[i].next;
+
+    return &cache->pool[i];
+}
+
+int32_t minimr_cache_add(struct minimr_cache * cache, struct minimr_rr_stat * rstat, uint8_t * msg, uint16_t msglen, uint32_t now, struct minimr_cache_rr ** cached)
+{
+    MINIMR_ASSERT(cache != NULL);
+    MINIMR_ASSERT(rstat != NULL);
+    MINIMR_ASSERT(msg != NULL);
+
+    // pseudo records are not cached
+    if (rstat->type == MINIMR_DNS_TYPE_OPT || rstat->type == MINIMR_DNS_TYPE_ANY){
+        return MINIMR_IGNORE;
+    }
+
+    uint8_t name[MINIMR_CACHE_NAMELEN];
+    uint8_t rdata[MINIMR_CACHE_RDATALEN];
+    uint16_t rdlength;
+
+    int32_t namelen = minimr_name_uncompress(name, MINIMR_CACHE_NAMELEN, rstat->name_offset, msg, msglen);
+
+    if (namelen < 0){
+        return MINIMR_IGNORE;
+    }
+
+    int32_t res = cache_rdata_copy(rstat, msg, msglen, rdata, &rdlength);
+
+    if (res != MINIMR_OK){
+        return res;
+    }
+
+    uint32_t hash = minimr_name_hash(name);
+    uint16_t rrclass = rstat->cache_class & MINIMR_DNS_RRCLASS;
+    uint8_t flush = (rstat->cache_class & MINIMR_DNS_CACHEFLUSH) == MINIMR_DNS_CACHEFLUSH;
+
+    uint32_t ttl = rstat->ttl < CACHE_TTL_MAX ? rstat->ttl * 1000 : CACHE_TTL_MAX * 1000;
+
+    // goodbye (see https://tools.ietf.org/html/rfc6762#section-10.1 )
+    if (ttl == 0){
+        ttl = CACHE_GRACE;
+    }
+
+    struct minimr_cache_rr * found = NULL;
+
+    for(uint16_t ie = MINIMR_RR_INDEX_FIRST(&cache->index, hash); ie != MINIMR_RR_INDEX_NONE; ie = cache->index.entries[ie].next){
+
+        if (cache->index.entries[ie].name_hash != hash || cache->index.entries[ie].type != rstat->type) continue;
+
+        struct minimr_cache_rr * rr = (struct minimr_cache_rr *)cache->index.records[ie];
+
+        if (rr->cache_class != rrclass || minimr_name_cmp(rr->name, 0, name, namelen + 1) != 0) continue;
+
+        uint16_t i = 0;
+        if (rr->rdata_length == rdlength){
+            while(i < rdlength && rr->rdata[i] == rdata[i]){
+                i++;
+            }
+        }
+
+        if (i == rdlength && rr->rdata_length == rdlength){
+            found = rr;
+            continue;
+        }
+
+        // records received within the last second are part of the same (flushing) announcement
+        if (flush && !MINIMR_TIME_DUE(now - CACHE_GRACE, rr->received) && !MINIMR_TIME_DUE(rr->expires, now + CACHE_GRACE)){
+            rr->expires = now + CACHE_GRACE;
+            rr->refresh = CACHE_REFRESH_STEPS;
+            cache_arm(cache, rr);
+        }
+    }
+
+    if (found != NULL){
+        found->received = now;
+        found->expires = now + ttl;
+        found->wanted = 0;
+        found->refresh = rstat->ttl == 0 ? CACHE_REFRESH_STEPS : 0;
+        cache_arm(cache, found);
+
+        if (cached != NULL){
+            *cached = found;
+        }
+
+        return MINIMR_OK;
+    }
+
+    // goodbye of a record we do not know
+    if (rstat->ttl == 0){
+        return MINIMR_IGNORE;
+    }
+
+    struct minimr_cache_rr * rr = cache_alloc(cache, now);
+
+    for(int32_t i = 0; i <= namelen; i++){
+        rr->name[i] = name[i];
+    }
+    rr->name_length = namelen + 1;
+
+    rr->type = rstat->type;
+    rr->cache_class = rrclass;
+    rr->ttl = rstat->ttl;
+    rr->ops = &cache_rr_ops;
+    rr->handler = minimr_rr_ops_handler;
+
+#if MINIMR_RR_WIRE_TEMPLATE_USE == 1
+    rr->wire = NULL;
+    rr->wire_length = 0;
+    rr->wire_maxlen = 0;
+#endif
+
+#if MINIMR_RR_DIGEST_USE == 1
+    rr->rdata_digest = 0;
+#endif
+
+    for(uint16_t i = 0; i < rdlength; i++){
+        rr->rdata[i] = rdata[i];
+    }
+    rr->rdata_length = rdlength;
+
+    rr->received = now;
+    rr->expires = now + ttl;
+    rr->referenced = 0;
+    rr->wanted = 0;
+    rr->refresh = 0;
+
+    cache_arm(cache, rr);
+
+    // never fails, the index holds as many records as the pool
+    rr->pos = cache->index.nrecords;
+    minimr_rr_index_add(&cache->index, (struct minimr_rr *)rr);
+
+    if (cached != NULL){
+        *cached = rr;
+    }
+
+    return MINIMR_CACHE_ADDED;
+}
+
+int32_t minimr_cache_add_msg(struct minimr_cache * cache, uint8_t * msg, uint16_t msglen, uint32_t now)
+{
+    MINIMR_ASSERT(cache != NULL);
+    MINIMR_ASSERT(msg != NULL);
+
+    if (msglen < MINIMR_DNS_HDR_SIZE){
+        return MINIMR_IGNORE;
+    }
+
+    struct minimr_dns_hdr hdr;
+
+    minimr_dns_hdr_read(&hdr, msg);
+
+    if ((hdr.flags[0] & MINIMR_DNS_HDR1_QR) != MINIMR_DNS_HDR1_QR_REPLY ||
+        (hdr.flags[0] & MINIMR_DNS_HDR1_OPCODE) != MINIMR_DNS_HDR1_OPCODE_QUERY ||
+        (hdr.flags[1] & MINIMR_DNS_HDR2_RCODE) != MINIMR_DNS_HDR2_RCODE_NOERROR){
+        return MINIMR_IGNORE;
+    }
+
+    uint16_t pos = MINIMR_DNS_HDR_SIZE;
+
+    for(uint16_t i = 0; i < hdr.nqueries; i++){
+
+        struct minimr_query_stat qstat;
+
+        if (minimr_extract_query_stat(&qstat, msg, &pos, msglen) != MINIMR_OK){
+            return MINIMR_DNS_HDR2_RCODE_FORMERR;
+        }
+    }
+
+    uint32_t nrr = (uint32_t)hdr.nanswers + hdr.nauthrr + hdr.nextrarr;
+
+    for(uint32_t i = 0; i < nrr; i++){
+
+        struct minimr_rr_stat rstat;
+
+        if (minimr_extract_rr_stat(&rstat, msg, &pos, msglen) != MINIMR_OK){
+            return MINIMR_DNS_HDR2_RCODE_FORMERR;
+        }
+
+        // authority records (of probe queries) are not records to be cached
+        if (i >= hdr.nanswers && i < hdr.nanswers + hdr.nauthrr){
+            continue;
+        }
+
+        if (minimr_cache_add(cache, &rstat, msg, msglen, now, NULL) == MINIMR_NOT_OK){
+            return MINIMR_DNS_HDR2_RCODE_FORMERR;
+        }
+    }
+
+    return MINIMR_OK;
+}
+
+struct minimr_cache_rr * minimr_cache_lookup(struct minimr_cache * cache, uint8_t * name, uint16_t type, uint32_t now, struct minimr_cache_rr * prev)
+{
+    MINIMR_ASSERT(cache != NULL);
+    MINIMR_ASSERT(name != NULL);
+
+    uint32_t hash;
+    uint16_t ie;
+
+    if (prev == NULL){
+        hash = minimr_name_hash(name);
+        ie = MINIMR_RR_INDEX_FIRST(&cache->index, hash);
+    } else {
+        MINIMR_ASSERT(prev->pos < cache->index.nrecords);
+
+        hash = cache->index.entries[prev->pos].name_hash;
+        ie = cache->index.entries[prev->pos].next;
+    }
+
+    uint16_t namelen = minimr_name_length(name);
+
+    for(; ie != MINIMR_RR_INDEX_NONE; ie = cache->index.entries[ie].next){
+
+        if (cache->index.entries[ie].name_hash != hash) continue;
+
+        if (type != MINIMR_DNS_TYPE_ANY && cache->index.entries[ie].type != type) continue;
+
+        struct minimr_cache_rr * rr = (struct minimr_cache_rr *)cache->index.records[ie];
+
+        if (MINIMR_TIME_DUE(rr->expires, now)) continue;
+
+        if (minimr_name_cmp(rr->name, 0, name, namelen) != 0) continue;
+
+        rr->referenced = 1;
+        rr->wanted = 1;
+        rr->ttl = (rr->expires - now + 999) / 1000;
+
+        return rr;
+    }
+
+    return NULL;
+}
+
+uint16_t minimr_cache_known_answers(struct minimr_cache * cache, uint8_t * name, uint16_t type, uint32_t now, struct minimr_rr ** known_answers, uint16_t maxknown_answers)
+{
+    MINIMR_ASSERT(maxknown_answers == 0 || known_answers != NULL);
+
+    uint16_t n = 0;
+
+    for(struct minimr_cache_rr * rr = NULL; n < maxknown_answers && (rr = minimr_cache_lookup(cache, name, type, now, rr)) != NULL; ){
+
+        if (rr->expires - now > (rr->expires - rr->received) / 2){
+            known_answers[n++] = (struct minimr_rr *)rr;
+        }
+    }
+
+    return n;
+}
+
+uint8_t minimr_cache_bundle(struct minimr_cache * cache, uint8_t * name, uint32_t now, struct minimr_cache_bundle * bundle)
+{
+    MINIMR_ASSERT(bundle != NULL);
+
+    bundle->srv = minimr_cache_lookup(cache, name, MINIMR_DNS_TYPE_SRV, now, NULL);
+    bundle->txt = minimr_cache_lookup(cache, name, MINIMR_DNS_TYPE_TXT, now, NULL);
+    bundle->naddrs = 0;
+    bundle->port = 0;
+    bundle->target = NULL;
+
+    // priority, weight, port, target
+    if (bundle->srv == NULL || bundle->srv->rdata_length <= 6){
+        return MINIMR_NOT_OK;
+    }
+
+    bundle->port = (bundle->srv->rdata[4] << 8) | bundle->srv->rdata[5];
+    bundle->target = &bundle->srv->rdata[6];
+
+    for(struct minimr_cache_rr * rr = NULL; bundle->naddrs < MINIMR_CACHE_BUNDLE_MAXADDRS && (rr = minimr_cache_lookup(cache, bundle->target, MINIMR_DNS_TYPE_A, now, rr)) != NULL; ){
+        bundle->addrs[bundle->naddrs++] = rr;
+    }
+    for(struct minimr_cache_rr * rr = NULL; bundle->naddrs < MINIMR_CACHE_BUNDLE_MAXADDRS && (rr = minimr_cache_lookup(cache, bundle->target, MINIMR_DNS_TYPE_AAAA, now, rr)) != NULL; ){
+        bundle->addrs[bundle->naddrs++] = rr;
+    }
+
+    return bundle->naddrs > 0 ? MINIMR_OK : MINIMR_NOT_OK;
+}
+
+uint16_t minimr_cache_expire(struct minimr_cache * cache, uint32_t now)
+{
+    MINIMR_ASSERT(cache != NULL);
+
+    uint16_t n = 0;
+
+    // backwards, such that records moved into place of removed ones were checked already
+    for(uint16_t i = cache->index.nrecords; i > 0; i--){
+
+        struct minimr_cache_rr * rr = (struct minimr_cache_rr *)cache->index.records[i - 1];
+
+        if (MINIMR_TIME_DUE(rr->expires, now)){
+            cache_free(cache, rr);
+            n++;
+        }
+    }
+
+    return n;
+}
+
+int32_t minimr_cache_refresh_msg(
+        struct minimr_cache * cache, uint32_t now,
+        struct minimr_query * queries, uint16_t maxqueries,
+        struct minimr_rr ** known_answers, uint16_t maxknown_answers,
+        uint8_t * outmsg, uint16_t * outmsglen, uint16_t outmsgmaxlen
+)
+{
+    MINIMR_ASSERT(cache != NULL);
+    MINIMR_ASSERT(cache->wheel != NULL);
+    MINIMR_ASSERT(queries != NULL && maxqueries > 0);
+    MINIMR_ASSERT(maxknown_answers == 0 || known_answers != NULL);
+    MINIMR_ASSERT(outmsg != NULL);
+    MINIMR_ASSERT(outmsglen != NULL);
+
+    uint16_t nqueries = 0;
+    uint16_t i;
+
+    while(nqueries < maxqueries && (i = minimr_wheel_next(cache->wheel, now)) != MINIMR_WHEEL_NONE){
+
+        struct minimr_cache_rr * rr = &cache->pool[i];
+
+        if (rr->pos == MINIMR_CACHE_NONE){
+            continue;
+        }
+
+        if (rr->refresh >= CACHE_REFRESH_STEPS || MINIMR_TIME_DUE(rr->expires, now)){
+            cache_free(cache, rr);
+            continue;
+        }
+
+        if (rr->wanted){
+
+            uint16_t q = 0;
+            while(q < nqueries && (queries[q].type != rr->type || minimr_name_cmp(queries[q].name, 0, rr->name, rr->name_length) != 0)){
+                q++;
+            }
+
+            if (q == nqueries){
+                queries[nqueries].type = rr->type;
+                queries[nqueries].unicast_class = rr->cache_class;
+                queries[nqueries].name = rr->name;
+                nqueries++;
+            }
+        }
+
+        rr->refresh++;
+
+        cache_arm(cache, rr);
+    }
+
+    if (nqueries == 0){
+        return MINIMR_IGNORE;
+    }
+
+    uint16_t nknown_answers = 0;
+
+    for(uint16_t q = 0; q < nqueries; q++){
+        nknown_answers += minimr_cache_known_answers(cache, queries[q].name, queries[q].type, now, &known_answers[nknown_answers], maxknown_answers - nknown_answers);
+    }
+
+    int32_t res = minimr_make_msg(0, 0, 0, queries, nqueries, known_answers, nknown_answers, NULL, 0, NULL, 0, outmsg, outmsglen, outmsgmaxlen, NULL);
+
+    if (res != MINIMR_OK && nknown_answers > 0){
+        res = minimr_make_msg(0, 0, 0, queries, nqueries, NULL, 0, NULL, 0, NULL, 0, outmsg, outmsglen, outmsgmaxlen, NULL);
+    }
+
+    return res;
+}
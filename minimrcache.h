@@ -0,0 +1,215 @@
+/**
+ * minimr - mini mDNS Responder (framework)
+ *
+ * https://github.com/tschiemer/minimr
+ *
+ * MIT License
+ *
+ * Copyright (c) 2020 Philip Tschiemer, filou.se
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef MINIMR_MINIMRCACHE_H
+#define MINIMR_MINIMRCACHE_H
+
+#include "minimr.h"
+#include "minimrwheel.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// invalid slot (ex. free slot)
+#define MINIMR_CACHE_NONE   0xffff
+
+// minimr_cache_add() result: new record
+#define MINIMR_CACHE_ADDED  0x10
+
+/**
+ * Record slot of a cache pool
+ * RDATA is kept with names uncompressed, the TTL is the remaining TTL as of the last lookup.
+ */
+MINIMR_RR_TYPE_BEGIN_STNAME(MINIMR_CACHE_NAMELEN, minimr_cache_rr)
+    uint32_t received;  // time (msec) record was last received
+    uint32_t expires;   // time (msec) record expires
+    uint16_t pos;       // position in record set (index), MINIMR_CACHE_NONE if slot is free
+    uint16_t next;      // next free slot
+    uint8_t referenced; // looked up since the last pass of the clock hand
+    uint8_t wanted;     // looked up since it was last received (ie to be refreshed)
+    uint8_t refresh;    // refresh queries due so far
+    uint16_t rdata_length;
+    uint8_t rdata[MINIMR_CACHE_RDATALEN];
+MINIMR_RR_TYPE_END();
+
+/**
+ * Cache of records seen in responses (of other responders) backed by a caller-provided pool of fixed-size record slots
+ * (see https://tools.ietf.org/html/rfc6762#section-10 ).
+ *
+ * Records expire with their TTL, goodbye records (TTL 0) one second after being received. A record with the
+ * cache-flush bit set flushes all other records of the same name, type and class received more than one second ago
+ * (see https://tools.ietf.org/html/rfc6762#section-10.2 ). If the pool is exhausted, a record not looked up
+ * recently is evicted (CLOCK, ie approximated LRU) - but not one received at the same time, ie the records of a
+ * message do not evict each other (unless it holds more records than the pool). Records are looked up by name and
+ * type through a record index in (expected) constant time.
+ *
+ * Cached records can be passed as known answers to minimr_make_msg() et al (TTL as of the last lookup, without
+ * cache-flush bit).
+ *
+ * Optionally a timer wheel tracks the expiry of records and their refresh at 80%, 85%, 90% and 95% of their TTL
+ * (see https://tools.ietf.org/html/rfc6762#section-5.2 ) for records looked up since they were last received.
+ * Time is given by the caller as (wrapping) msec timestamps.
+ *
+ * NOTE a cache is not thread-safe.
+ */
+struct minimr_cache {
+    struct minimr_cache_rr * pool;
+    uint16_t npool;
+
+    // first free slot
+    uint16_t free;
+
+    // clock hand
+    uint16_t hand;
+
+    struct minimr_rr_index index;
+
+    // timers by slot (optional)
+    struct minimr_wheel * wheel;
+};
+
+/**
+ * Initializes an empty cache
+ * records[] and entries[] must hold npool elements, nbuckets MUST be a power of two (typically nbuckets >= npool)
+ */
+void minimr_cache_init(
+        struct minimr_cache * cache,
+        struct minimr_cache_rr * pool, uint16_t npool,
+        struct minimr_rr ** records,
+        struct minimr_rr_index_entry * entries,
+        uint16_t * buckets, uint16_t nbuckets
+);
+
+/**
+ * Removes all records
+ */
+void minimr_cache_clear(struct minimr_cache * cache);
+
+/**
+ * Tracks expiry and refresh of records with given (initialized) wheel holding (at least) npool timers (NULL to stop)
+ * NOTE to be set while the cache is empty
+ */
+void minimr_cache_set_wheel(struct minimr_cache * cache, struct minimr_wheel * wheel);
+
+/**
+ * Cached records (including expired records not yet removed)
+ */
+#define MINIMR_CACHE_RECORDS(__cache__)     ((__cache__)->index.records)
+#define MINIMR_CACHE_NRECORDS(__cache__)    ((__cache__)->index.nrecords)
+
+/**
+ * Adds (or refreshes) record of a message (ex. from within a minimr_rr_handler)
+ * @param cached            set to the cached record (if any, may be NULL)
+ * @return MINIMR_CACHE_ADDED if record was added
+ * @return MINIMR_OK        if record was refreshed (or is a goodbye)
+ * @return MINIMR_IGNORE    if record is not cached (name or rdata too long, goodbye of an unknown record)
+ * @return MINIMR_NOT_OK    if the record is faulty
+ */
+int32_t minimr_cache_add(struct minimr_cache * cache, struct minimr_rr_stat * rstat, uint8_t * msg, uint16_t msglen, uint32_t now, struct minimr_cache_rr ** cached);
+
+/**
+ * Adds (or refreshes) all answer and additional records of given response message
+ * @return MINIMR_OK        on success
+ * @return MINIMR_IGNORE    if not a response
+ * @return MINIMR_DNS_HDR2_RCODE_FORMERR if the message is faulty (records up to the fault are added)
+ */
+int32_t minimr_cache_add_msg(struct minimr_cache * cache, uint8_t * msg, uint16_t msglen, uint32_t now);
+
+/**
+ * Looks up (unexpired) records with given name and type (MINIMR_DNS_TYPE_ANY for any type) and updates their TTL to
+ * the remaining TTL
+ * @param name      normalized name
+ * @param prev      previously found record (NULL to get the first)
+ * @return next record or NULL if there are none (left)
+ */
+struct minimr_cache_rr * minimr_cache_lookup(struct minimr_cache * cache, uint8_t * name, uint16_t type, uint32_t now, struct minimr_cache_rr * prev);
+
+/**
+ * Collects the (unexpired) records with given name and type (MINIMR_DNS_TYPE_ANY for any type) at more than half
+ * their TTL, ie the records to be listed as known answers of a query (see
+ * https://tools.ietf.org/html/rfc6762#section-7.1 ). Like minimr_cache_lookup(), this updates their TTL.
+ * @param name      normalized name
+ * @return number of records added to known_answers[] (at most maxknown_answers)
+ */
+uint16_t minimr_cache_known_answers(struct minimr_cache * cache, uint8_t * name, uint16_t type, uint32_t now, struct minimr_rr ** known_answers, uint16_t maxknown_answers);
+
+/**
+ * Records of a service instance as sent along with a PTR answer (in the additional section)
+ */
+struct minimr_cache_bundle {
+    struct minimr_cache_rr * srv;
+    struct minimr_cache_rr * txt;
+    struct minimr_cache_rr * addrs[MINIMR_CACHE_BUNDLE_MAXADDRS];   // A and AAAA of the target host
+    uint8_t naddrs;
+    uint16_t port;
+    uint8_t * target;   // host name (normalized, within the RDATA of the SRV record)
+};
+
+/**
+ * Collects the (unexpired) records of a service instance: SRV, TXT and the addresses of the SRV target
+ * (see https://tools.ietf.org/html/rfc6763#section-12 ), ie resolves an instance without further queries if the
+ * responder sent them along with its PTR answer. Like minimr_cache_lookup(), this updates their TTL.
+ * @param name      normalized instance name (ex. RDATA of a cached PTR record)
+ * @return MINIMR_OK        if the instance is usable (SRV and at least one address are known)
+ * @return MINIMR_NOT_OK    if not (records known so far are set, the others NULL)
+ */
+uint8_t minimr_cache_bundle(struct minimr_cache * cache, uint8_t * name, uint32_t now, struct minimr_cache_bundle * bundle);
+
+/**
+ * Removes expired records
+ * NOTE this changes the positions of records within the record set
+ * @return number of removed records
+ */
+uint16_t minimr_cache_expire(struct minimr_cache * cache, uint32_t now);
+
+/**
+ * Handles expired timers of the wheel (@see minimr_wheel_next_deadline()): removes expired records and generates one
+ * query for all records due for refresh, with the cached records of the questions (at more than half their TTL) as
+ * known answers (dropped if the message would not fit otherwise).
+ * Refresh queries are due at 80%, 85%, 90% and 95% of the TTL plus 0-2% (pseudo-random by time of reception).
+ * If there are more questions than fit queries[], the remaining ones are left for the next call.
+ * @param queries           memory for questions
+ * @param known_answers     memory for known answers (maxknown_answers may be 0)
+ * @return MINIMR_OK        if a query was generated
+ * @return MINIMR_IGNORE    if no refresh is due
+ * @return MINIMR_DNS_HDR2_RCODE_SERVAIL if the questions do not fit outmsgmaxlen
+ */
+int32_t minimr_cache_refresh_msg(
+        struct minimr_cache * cache, uint32_t now,
+        struct minimr_query * queries, uint16_t maxqueries,
+        struct minimr_rr ** known_answers, uint16_t maxknown_answers,
+        uint8_t * outmsg, uint16_t * outmsglen, uint16_t outmsgmaxlen
+);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //MINIMR_MINIMRCACHE_H
@@ -0,0 +1,435 @@
+/**
+ * minimr - mini mDNS Responder (framework)
+ *
+ * https://github.com/tschiemer/minimr
+ *
+ * MIT License
+ *
+ * Copyright (c) 2020 Philip Tschiemer, filou.se
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "minimrdnssd.h"
+
+// resolved event was reported (private bit of minimr_dnssd_op.have)
+#define DNSSD_REPORTED  0x80
+
+static const uint16_t dnssd_qtypes[MINIMR_DNSSD_NQUESTIONS] = {
+    MINIMR_DNS_TYPE_PTR,
+    MINIMR_DNS_TYPE_SRV,
+    MINIMR_DNS_TYPE_TXT,
+    MINIMR_DNS_TYPE_A,
+    MINIMR_DNS_TYPE_AAAA
+};
+
+struct dnssd_msg_ctx {
+    struct minimr_dnssd * dnssd;
+    uint32_t now;
+    uint32_t random;
+    minimr_rr_section section;  // section handled in this pass
+};
+
+static uint8_t dnssd_name_eq(uint8_t * name, struct minimr_cache_rr * rr)
+{
+    return minimr_name_cmp(name, 0, rr->name, rr->name_length) == 0;
+}
+
+void minimr_dnssd_init(
+        struct minimr_dnssd * dnssd,
+        struct minimr_dnssd_op * ops, uint16_t nops,
+        struct minimr_cache * cache,
+        struct minimr_querier * querier,
+        minimr_dnssd_callback callback
+)
+{
+    MINIMR_ASSERT(dnssd != NULL);
+    MINIMR_ASSERT(nops == 0 || ops != NULL);
+    MINIMR_ASSERT(nops < MINIMR_DNSSD_NONE);
+    MINIMR_ASSERT(cache != NULL);
+    MINIMR_ASSERT(querier != NULL);
+    MINIMR_ASSERT(callback != NULL);
+
+    dnssd->ops = ops;
+    dnssd->nops = nops;
+    dnssd->cache = cache;
+    dnssd->querier = querier;
+    dnssd->callback = callback;
+
+    for(uint16_t i = 0; i < nops; i++){
+        ops[i].kind = MINIMR_DNSSD_OP_FREE;
+    }
+}
+
+/**
+ * Starts asking question q of operation (unless asked already)
+ */
+static void dnssd_ask(struct minimr_dnssd * dnssd, struct minimr_dnssd_op * op, uint8_t q, uint8_t * name, uint32_t now, uint32_t random)
+{
+    if (op->questions[q] == MINIMR_QUERIER_NONE){
+        op->questions[q] = minimr_querier_start(dnssd->querier, name, dnssd_qtypes[q], now, random);
+
+        // resolving is one-shot, ie the first query may as well be answered directly
+        if (op->kind == MINIMR_DNSSD_OP_RESOLVE && op->questions[q] != MINIMR_QUERIER_NONE){
+            minimr_querier_unicast(dnssd->querier, op->questions[q]);
+        }
+    }
+}
+
+/**
+ * Stops asking question q of operation
+ */
+static void dnssd_unask(struct minimr_dnssd * dnssd, struct minimr_dnssd_op * op, uint8_t q)
+{
+    if (op->questions[q] != MINIMR_QUERIER_NONE){
+        minimr_querier_stop(dnssd->querier, op->questions[q]);
+        op->questions[q] = MINIMR_QUERIER_NONE;
+    }
+}
+
+/**
+ * Reports event to operation i
+ * @return 0 if the operation was stopped (from within the callback)
+ */
+static uint8_t dnssd_emit(struct minimr_dnssd * dnssd, uint16_t i, uint8_t event, struct minimr_cache_rr * rr)
+{
+    uint8_t kind = dnssd->ops[i].kind;
+
+    dnssd->callback(dnssd, i, event, rr, dnssd->ops[i].user_data);
+
+    return dnssd->ops[i].kind == kind;
+}
+
+static void dnssd_record(struct minimr_dnssd * dnssd, uint16_t i, uint8_t event, struct minimr_cache_rr * rr, uint32_t now, uint32_t random);
+
+/**
+ * Takes addresses of the target host of a resolve operation from the cache, asks for them if there are none
+ */
+static void dnssd_resolve_addresses(struct minimr_dnssd * dnssd, uint16_t i, uint32_t now, uint32_t random)
+{
+    struct minimr_dnssd_op * op = &dnssd->ops[i];
+
+    for(uint8_t q = MINIMR_DNSSD_Q_A; q <= MINIMR_DNSSD_Q_AAAA; q++){
+        for(struct minimr_cache_rr * rr = NULL; (rr = minimr_cache_lookup(dnssd->cache, op->target, dnssd_qtypes[q], now, rr)) != NULL; ){
+
+            dnssd_record(dnssd, i, MINIMR_DNSSD_ADDED, rr, now, random);
+
+            if (op->kind != MINIMR_DNSSD_OP_RESOLVE){
+                return;
+            }
+        }
+    }
+
+    // both in one query (unless cached)
+    for(uint8_t q = MINIMR_DNSSD_Q_A; q <= MINIMR_DNSSD_Q_AAAA; q++){
+        if (minimr_cache_lookup(dnssd->cache, op->target, dnssd_qtypes[q], now, NULL) == NULL){
+            dnssd_ask(dnssd, op, q, op->target, now, random);
+        }
+    }
+}
+
+/**
+ * Handles (received or cached) record for operation i
+ */
+static void dnssd_record(struct minimr_dnssd * dnssd, uint16_t i, uint8_t event, struct minimr_cache_rr * rr, uint32_t now, uint32_t random)
+{
+    struct minimr_dnssd_op * op = &dnssd->ops[i];
+
+    uint8_t addr = rr->type == MINIMR_DNS_TYPE_A || rr->type == MINIMR_DNS_TYPE_AAAA;
+
+    switch(op->kind){
+
+        case MINIMR_DNSSD_OP_BROWSE:
+            if (rr->type == MINIMR_DNS_TYPE_PTR && dnssd_name_eq(op->name, rr)){
+                dnssd_emit(dnssd, i, event, rr);
+            }
+            return;
+
+        case MINIMR_DNSSD_OP_ADDRESS:
+            if (addr && dnssd_name_eq(op->name, rr)){
+                dnssd_emit(dnssd, i, event, rr);
+            }
+            return;
+
+        case MINIMR_DNSSD_OP_RESOLVE:
+            break;
+
+        default:
+            return;
+    }
+
+    if (rr->type == MINIMR_DNS_TYPE_SRV && dnssd_name_eq(op->name, rr)){
+
+        // priority, weight, port, target
+        if (event == MINIMR_DNSSD_REMOVED || rr->rdata_length <= 6 || rr->rdata_length - 6 > MINIMR_CACHE_NAMELEN){
+            dnssd_emit(dnssd, i, event, rr);
+            return;
+        }
+
+        uint8_t * target = &rr->rdata[6];
+        uint8_t known = (op->have & MINIMR_DNSSD_HAVE_SRV) && minimr_name_cmp(op->target, 0, target, rr->rdata_length - 6) == 0;
+
+        if (!known){
+            // the address questions ask for the previous target
+            dnssd_unask(dnssd, op, MINIMR_DNSSD_Q_A);
+            dnssd_unask(dnssd, op, MINIMR_DNSSD_Q_AAAA);
+
+            for(uint16_t l = 0; l < rr->rdata_length - 6; l++){
+                op->target[l] = target[l];
+            }
+
+            op->have = (op->have | MINIMR_DNSSD_HAVE_SRV) & ~(MINIMR_DNSSD_HAVE_ADDR | DNSSD_REPORTED);
+        }
+
+        op->port = (rr->rdata[4] << 8) | rr->rdata[5];
+
+        dnssd_unask(dnssd, op, MINIMR_DNSSD_Q_SRV);
+
+        if (dnssd_emit(dnssd, i, event, rr) && !known){
+            dnssd_resolve_addresses(dnssd, i, now, random);
+        }
+
+    } else if (rr->type == MINIMR_DNS_TYPE_TXT && dnssd_name_eq(op->name, rr)){
+
+        if (event == MINIMR_DNSSD_ADDED){
+            op->have |= MINIMR_DNSSD_HAVE_TXT;
+            dnssd_unask(dnssd, op, MINIMR_DNSSD_Q_TXT);
+        }
+
+        dnssd_emit(dnssd, i, event, rr);
+
+    } else if (addr && (op->have & MINIMR_DNSSD_HAVE_SRV) && dnssd_name_eq(op->target, rr)){
+
+        if (event == MINIMR_DNSSD_ADDED){
+            op->have |= MINIMR_DNSSD_HAVE_ADDR;
+            dnssd_unask(dnssd, op, rr->type == MINIMR_DNS_TYPE_A ? MINIMR_DNSSD_Q_A : MINIMR_DNSSD_Q_AAAA);
+
+            // first usable address
+            if ((op->have & DNSSD_REPORTED) == 0){
+                op->have |= DNSSD_REPORTED;
+                if (!dnssd_emit(dnssd, i, MINIMR_DNSSD_RESOLVED, rr)){
+                    return;
+                }
+            }
+        }
+
+        dnssd_emit(dnssd, i, event, rr);
+    }
+}
+
+/**
+ * Takes free operation slot
+ */
+static uint16_t dnssd_start(struct minimr_dnssd * dnssd, uint8_t kind, uint8_t * name, void * user_data)
+{
+    uint16_t namelen = minimr_name_length(name);
+
+    if (namelen > MINIMR_CACHE_NAMELEN){
+        return MINIMR_DNSSD_NONE;
+    }
+
+    for(uint16_t i = 0; i < dnssd->nops; i++){
+
+        struct minimr_dnssd_op * op = &dnssd->ops[i];
+
+        if (op->kind != MINIMR_DNSSD_OP_FREE) continue;
+
+        op->kind = kind;
+        op->have = 0;
+        op->user_data = user_data;
+
+        for(uint8_t q = 0; q < MINIMR_DNSSD_NQUESTIONS; q++){
+            op->questions[q] = MINIMR_QUERIER_NONE;
+        }
+
+        for(uint16_t l = 0; l < namelen; l++){
+            op->name[l] = name[l];
+        }
+
+        return i;
+    }
+
+    return MINIMR_DNSSD_NONE;
+}
+
+/**
+ * Reports cached records of given type and name to operation i
+ */
+static void dnssd_cached(struct minimr_dnssd * dnssd, uint16_t i, uint16_t type, uint32_t now, uint32_t random)
+{
+    uint8_t kind = dnssd->ops[i].kind;
+
+    for(struct minimr_cache_rr * rr = NULL; dnssd->ops[i].kind == kind && (rr = minimr_cache_lookup(dnssd->cache, dnssd->ops[i].name, type, now, rr)) != NULL; ){
+        dnssd_record(dnssd, i, MINIMR_DNSSD_ADDED, rr, now, random);
+    }
+}
+
+uint16_t minimr_dnssd_browse(struct minimr_dnssd * dnssd, uint8_t * name, uint32_t now, uint32_t random, void * user_data)
+{
+    MINIMR_ASSERT(dnssd != NULL);
+    MINIMR_ASSERT(name != NULL);
+
+    uint16_t i = dnssd_start(dnssd, MINIMR_DNSSD_OP_BROWSE, name, user_data);
+
+    if (i == MINIMR_DNSSD_NONE){
+        return MINIMR_DNSSD_NONE;
+    }
+
+    struct minimr_dnssd_op * op = &dnssd->ops[i];
+
+    dnssd_ask(dnssd, op, MINIMR_DNSSD_Q_PTR, op->name, now, random);
+
+    if (op->questions[MINIMR_DNSSD_Q_PTR] == MINIMR_QUERIER_NONE){
+        op->kind = MINIMR_DNSSD_OP_FREE;
+        return MINIMR_DNSSD_NONE;
+    }
+
+    dnssd_cached(dnssd, i, MINIMR_DNS_TYPE_PTR, now, random);
+
+    return i;
+}
+
+uint16_t minimr_dnssd_resolve(struct minimr_dnssd * dnssd, uint8_t * name, uint32_t now, uint32_t random, void * user_data)
+{
+    MINIMR_ASSERT(dnssd != NULL);
+    MINIMR_ASSERT(name != NULL);
+
+    uint16_t i = dnssd_start(dnssd, MINIMR_DNSSD_OP_RESOLVE, name, user_data);
+
+    if (i == MINIMR_DNSSD_NONE){
+        return MINIMR_DNSSD_NONE;
+    }
+
+    struct minimr_dnssd_op * op = &dnssd->ops[i];
+
+    dnssd_cached(dnssd, i, MINIMR_DNS_TYPE_SRV, now, random);
+    dnssd_cached(dnssd, i, MINIMR_DNS_TYPE_TXT, now, random);
+
+    if (op->kind != MINIMR_DNSSD_OP_RESOLVE){
+        return i;
+    }
+
+    // both in one query
+    if ((op->have & MINIMR_DNSSD_HAVE_SRV) == 0){
+        dnssd_ask(dnssd, op, MINIMR_DNSSD_Q_SRV, op->name, now, random);
+    }
+    if ((op->have & MINIMR_DNSSD_HAVE_TXT) == 0){
+        dnssd_ask(dnssd, op, MINIMR_DNSSD_Q_TXT, op->name, now, random);
+    }
+
+    return i;
+}
+
+uint16_t minimr_dnssd_address(struct minimr_dnssd * dnssd, uint8_t * name, uint32_t now, uint32_t random, void * user_data)
+{
+    MINIMR_ASSERT(dnssd != NULL);
+    MINIMR_ASSERT(name != NULL);
+
+    uint16_t i = dnssd_start(dnssd, MINIMR_DNSSD_OP_ADDRESS, name, user_data);
+
+    if (i == MINIMR_DNSSD_NONE){
+        return MINIMR_DNSSD_NONE;
+    }
+
+    struct minimr_dnssd_op * op = &dnssd->ops[i];
+
+    dnssd_ask(dnssd, op, MINIMR_DNSSD_Q_A, op->name, now, random);
+    dnssd_ask(dnssd, op, MINIMR_DNSSD_Q_AAAA, op->name, now, random);
+
+    if (op->questions[MINIMR_DNSSD_Q_A] == MINIMR_QUERIER_NONE || op->questions[MINIMR_DNSSD_Q_AAAA] == MINIMR_QUERIER_NONE){
+        minimr_dnssd_stop(dnssd, i);
+        return MINIMR_DNSSD_NONE;
+    }
+
+    dnssd_cached(dnssd, i, MINIMR_DNS_TYPE_A, now, random);
+    dnssd_cached(dnssd, i, MINIMR_DNS_TYPE_AAAA, now, random);
+
+    return i;
+}
+
+void minimr_dnssd_stop(struct minimr_dnssd * dnssd, uint16_t op)
+{
+    MINIMR_ASSERT(dnssd != NULL);
+    MINIMR_ASSERT(op < dnssd->nops);
+
+    for(uint8_t q = 0; q < MINIMR_DNSSD_NQUESTIONS; q++){
+        dnssd_unask(dnssd, &dnssd->ops[op], q);
+    }
+
+    dnssd->ops[op].kind = MINIMR_DNSSD_OP_FREE;
+}
+
+static uint8_t dnssd_rrhandler(struct minimr_dns_hdr * hdr, minimr_rr_section section, struct minimr_rr_stat * rstat, uint8_t * msg, uint16_t msglen, void * user_data)
+{
+    struct dnssd_msg_ctx * ctx = user_data;
+    struct minimr_dnssd * dnssd = ctx->dnssd;
+
+    // authority records (of probe queries) are not records to be cached
+    if (section != ctx->section){
+        return MINIMR_CONTINUE;
+    }
+
+    struct minimr_cache_rr * rr;
+    uint8_t event;
+
+    int32_t res = minimr_cache_add(dnssd->cache, rstat, msg, msglen, ctx->now, &rr);
+
+    if (res == MINIMR_CACHE_ADDED){
+        event = MINIMR_DNSSD_ADDED;
+    } else if (res == MINIMR_OK && rstat->ttl == 0){
+        event = MINIMR_DNSSD_REMOVED;
+    } else if (res == MINIMR_NOT_OK){
+        return MINIMR_ABORT;
+    } else {
+        return MINIMR_CONTINUE;
+    }
+
+    for(uint16_t i = 0; i < dnssd->nops; i++){
+        if (dnssd->ops[i].kind != MINIMR_DNSSD_OP_FREE){
+            dnssd_record(dnssd, i, event, rr, ctx->now, ctx->random);
+        }
+    }
+
+    return MINIMR_CONTINUE;
+}
+
+int32_t minimr_dnssd_msg(struct minimr_dnssd * dnssd, uint8_t * msg, uint16_t msglen, uint32_t now, uint32_t random)
+{
+    MINIMR_ASSERT(dnssd != NULL);
+    MINIMR_ASSERT(msg != NULL);
+
+    struct dnssd_msg_ctx ctx = {
+        .dnssd = dnssd,
+        .now = now,
+        .random = random,
+        .section = minimr_rr_section_extra
+    };
+
+    // additional records first, such that the records sent along with an answer are at hand when it is reported
+    // (ex. the bundle of an instance is complete once its PTR record is reported, @see minimr_cache_bundle())
+    int32_t res = minimr_parse_msg(msg, msglen, minimr_msgtype_response, NULL, NULL, 0, dnssd_rrhandler, NULL, 0, &ctx);
+
+    if (res != MINIMR_OK){
+        return res;
+    }
+
+    ctx.section = minimr_rr_section_answer;
+
+    return minimr_parse_msg(msg, msglen, minimr_msgtype_response, NULL, NULL, 0, dnssd_rrhandler, NULL, 0, &ctx);
+}
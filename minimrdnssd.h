@@ -0,0 +1,180 @@
+/**
+ * minimr - mini mDNS Responder (framework)
+ *
+ * https://github.com/tschiemer/minimr
+ *
+ * MIT License
+ *
+ * Copyright (c) 2020 Philip Tschiemer, filou.se
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef MINIMR_MINIMRDNSSD_H
+#define MINIMR_MINIMRDNSSD_H
+
+#include "minimr.h"
+#include "minimrcache.h"
+#include "minimrquerier.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// invalid operation handle
+#define MINIMR_DNSSD_NONE       0xffff
+
+/**
+ * Kinds of operations
+ */
+#define MINIMR_DNSSD_OP_FREE        0
+#define MINIMR_DNSSD_OP_BROWSE      1   // instances (PTR) of a service type
+#define MINIMR_DNSSD_OP_RESOLVE     2   // SRV, TXT and address (A/AAAA) of an instance
+#define MINIMR_DNSSD_OP_ADDRESS     3   // addresses (A/AAAA) of a host
+
+/**
+ * Events
+ */
+#define MINIMR_DNSSD_ADDED          1   // record (new or from cache)
+#define MINIMR_DNSSD_REMOVED        2   // goodbye of record
+#define MINIMR_DNSSD_RESOLVED       3   // first usable address (and port) of the instance
+
+/**
+ * Questions of an operation
+ */
+#define MINIMR_DNSSD_Q_PTR          0
+#define MINIMR_DNSSD_Q_SRV          1
+#define MINIMR_DNSSD_Q_TXT          2
+#define MINIMR_DNSSD_Q_A            3
+#define MINIMR_DNSSD_Q_AAAA         4
+#define MINIMR_DNSSD_NQUESTIONS     5
+
+/**
+ * Records of a resolve operation known so far
+ */
+#define MINIMR_DNSSD_HAVE_SRV       1
+#define MINIMR_DNSSD_HAVE_TXT       2
+#define MINIMR_DNSSD_HAVE_ADDR      4
+#define MINIMR_DNSSD_HAVE_ALL       (MINIMR_DNSSD_HAVE_SRV | MINIMR_DNSSD_HAVE_TXT | MINIMR_DNSSD_HAVE_ADDR)
+
+struct minimr_dnssd;
+
+/**
+ * Event callback
+ * @param op        operation handle
+ * @param rr        record (address record for MINIMR_DNSSD_RESOLVED), its TTL is the remaining TTL
+ * @param user_data of the operation
+ */
+typedef void (*minimr_dnssd_callback)(struct minimr_dnssd * dnssd, uint16_t op, uint8_t event, struct minimr_cache_rr * rr, void * user_data);
+
+/**
+ * Browse, resolve or address operation
+ */
+struct minimr_dnssd_op {
+    uint8_t kind;
+    uint8_t have;                                   // MINIMR_DNSSD_HAVE_* (resolve)
+    uint16_t questions[MINIMR_DNSSD_NQUESTIONS];    // querier handles (MINIMR_QUERIER_NONE if not asked)
+    uint8_t name[MINIMR_CACHE_NAMELEN];             // service type, instance or host name (normalized)
+    uint8_t target[MINIMR_CACHE_NAMELEN];           // host name of the instance (resolve, once SRV is known)
+    uint16_t port;                                  // port of the instance (resolve, once SRV is known)
+    void * user_data;
+};
+
+/**
+ * DNS-SD client (see https://tools.ietf.org/html/rfc6763 ): browses service types, resolves instances and follows
+ * addresses of hosts, reporting records as they are added and removed.
+ *
+ * Received responses go into the cache, ie records of the additional section (SRV, TXT and addresses sent along with
+ * PTR answers) are at hand without asking: they are handled before the answers, ie once a PTR record is reported the
+ * records sent along are cached (@see minimr_cache_bundle()). Operations are answered from the cache first and only ask (through the
+ * querier) for what is missing: a resolve operation asks for SRV, TXT (and A and AAAA of the target, if it is cached
+ * already) in one query requesting a unicast response, for the addresses of the target host as soon as it is known
+ * (unless cached) and stops asking for each type once it is answered. It reports the first usable address and port
+ * (MINIMR_DNSSD_RESOLVED) as soon as SRV and an address of either family are known, later records (the address of
+ * the other family, TXT) as they come in. Browse and address operations ask continuously.
+ *
+ * NOTE removals are reported for goodbyes only (records expiring silently are not)
+ * All memory is provided by the caller.
+ *
+ * Typical host loop:
+ *  - start operation:  minimr_dnssd_browse() et al (events of cached records are reported at once)
+ *  - received message: minimr_dnssd_msg()
+ *  - timer (@see minimr_querier_next_deadline()) expired: send minimr_querier_msg() until it returns MINIMR_IGNORE
+ *  - stop operation:   minimr_dnssd_stop()
+ */
+struct minimr_dnssd {
+    struct minimr_dnssd_op * ops;
+    uint16_t nops;
+
+    struct minimr_cache * cache;
+    struct minimr_querier * querier;
+
+    minimr_dnssd_callback callback;
+};
+
+/**
+ * Initializes client without operations
+ */
+void minimr_dnssd_init(
+        struct minimr_dnssd * dnssd,
+        struct minimr_dnssd_op * ops, uint16_t nops,
+        struct minimr_cache * cache,
+        struct minimr_querier * querier,
+        minimr_dnssd_callback callback
+);
+
+/**
+ * Starts browsing for instances of a service type (ex. "._http._tcp.local")
+ * @param name      normalized name
+ * @param random    random number (for the delay of the first query)
+ * @return operation handle or MINIMR_DNSSD_NONE if there are too many operations (or questions) or the name is too long
+ */
+uint16_t minimr_dnssd_browse(struct minimr_dnssd * dnssd, uint8_t * name, uint32_t now, uint32_t random, void * user_data);
+
+/**
+ * Starts resolving an instance (ex. "\x07printer._http._tcp.local")
+ * @see minimr_dnssd_browse()
+ */
+uint16_t minimr_dnssd_resolve(struct minimr_dnssd * dnssd, uint8_t * name, uint32_t now, uint32_t random, void * user_data);
+
+/**
+ * Starts following the addresses of a host (ex. "\x07printer.local")
+ * @see minimr_dnssd_browse()
+ */
+uint16_t minimr_dnssd_address(struct minimr_dnssd * dnssd, uint8_t * name, uint32_t now, uint32_t random, void * user_data);
+
+/**
+ * Stops operation (may be called from within the callback)
+ */
+void minimr_dnssd_stop(struct minimr_dnssd * dnssd, uint16_t op);
+
+/**
+ * Handles received message: adds its records to the cache and reports them to the operations
+ * @param random    random number (for the delay of follow-up queries)
+ * @return MINIMR_OK        on success
+ * @return MINIMR_DNS_HDR2_RCODE_FORMERR or MINIMR_DNS_HDR2_RCODE_SERVAIL if the message is faulty
+ */
+int32_t minimr_dnssd_msg(struct minimr_dnssd * dnssd, uint8_t * msg, uint16_t msglen, uint32_t now, uint32_t random);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //MINIMR_MINIMRDNSSD_H
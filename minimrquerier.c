@@ -0,0 +1,287 @@
+/**
+ * minimr - mini mDNS Responder (framework)
+ *
+ * https://github.com/tschiemer/minimr
+ *
+ * MIT License
+ *
+ * Copyright (c) 2020 Philip Tschiemer, filou.se
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "minimrquerier.h"
+
+/**
+ * Schedules the next (QM) query of a question (sent now), doubling the interval up to the maximum
+ */
+static void querier_question_sent(struct minimr_querier_question * q, uint32_t now)
+{
+    q->unicast = 0;
+    q->deadline = now + q->interval;
+    q->interval = q->interval < MINIMR_QUERIER_INTERVAL_MAX / 2 ? 2 * q->interval : MINIMR_QUERIER_INTERVAL_MAX;
+}
+
+void minimr_querier_init(
+        struct minimr_querier * querier,
+        struct minimr_querier_question * questions, struct minimr_query * queries, uint16_t maxquestions,
+        struct minimr_rr ** known_answers, uint16_t maxknown_answers,
+        struct minimr_cache * cache,
+        struct minimr_question_table * seen,
+        uint32_t window
+)
+{
+    MINIMR_ASSERT(querier != NULL);
+    MINIMR_ASSERT(maxquestions == 0 || (questions != NULL && queries != NULL));
+    MINIMR_ASSERT(maxquestions < MINIMR_QUERIER_NONE);
+    MINIMR_ASSERT(maxknown_answers == 0 || known_answers != NULL);
+
+    querier->questions = questions;
+    querier->queries = queries;
+    querier->maxquestions = maxquestions;
+    querier->known_answers = known_answers;
+    querier->maxknown_answers = maxknown_answers;
+    querier->cache = cache;
+    querier->seen = seen;
+    querier->window = window;
+
+    minimr_querier_clear(querier);
+}
+
+void minimr_querier_clear(struct minimr_querier * querier)
+{
+    MINIMR_ASSERT(querier != NULL);
+
+    for(uint16_t i = 0; i < querier->maxquestions; i++){
+        querier->questions[i].nusers = 0;
+    }
+
+    querier->nqueries = 0;
+    querier->nknown_answers = 0;
+    querier->cursor.section = MINIMR_MSG_SECTION_DONE;
+}
+
+uint16_t minimr_querier_start(struct minimr_querier * querier, uint8_t * name, uint16_t type, uint32_t now, uint32_t random)
+{
+    MINIMR_ASSERT(querier != NULL);
+    MINIMR_ASSERT(name != NULL);
+
+    uint16_t namelen = minimr_name_length(name);
+    uint16_t slot = MINIMR_QUERIER_NONE;
+
+    if (namelen > MINIMR_CACHE_NAMELEN){
+        return MINIMR_QUERIER_NONE;
+    }
+
+    for(uint16_t i = 0; i < querier->maxquestions; i++){
+
+        struct minimr_querier_question * q = &querier->questions[i];
+
+        if (q->nusers == 0){
+            if (slot == MINIMR_QUERIER_NONE){
+                slot = i;
+            }
+            continue;
+        }
+
+        // shared question, keeps its schedule
+        if (q->type == type && minimr_name_cmp(q->name, 0, name, namelen) == 0){
+            q->nusers++;
+            return i;
+        }
+    }
+
+    if (slot == MINIMR_QUERIER_NONE){
+        return MINIMR_QUERIER_NONE;
+    }
+
+    struct minimr_querier_question * q = &querier->questions[slot];
+
+    for(uint16_t i = 0; i < namelen; i++){
+        q->name[i] = name[i];
+    }
+    q->type = type;
+    q->nusers = 1;
+    q->unicast = 0;
+    q->interval = MINIMR_QUERIER_INTERVAL_MIN;
+    q->deadline = now + MINIMR_QUERIER_DELAY_MIN + random % (MINIMR_QUERIER_DELAY_MAX - MINIMR_QUERIER_DELAY_MIN + 1);
+
+    return slot;
+}
+
+void minimr_querier_unicast(struct minimr_querier * querier, uint16_t handle)
+{
+    MINIMR_ASSERT(querier != NULL);
+    MINIMR_ASSERT(handle < querier->maxquestions);
+
+    querier->questions[handle].unicast = 1;
+}
+
+void minimr_querier_stop(struct minimr_querier * querier, uint16_t handle)
+{
+    MINIMR_ASSERT(querier != NULL);
+    MINIMR_ASSERT(handle < querier->maxquestions);
+
+    if (querier->questions[handle].nusers > 0){
+        querier->questions[handle].nusers--;
+    }
+}
+
+uint8_t minimr_querier_next_deadline(struct minimr_querier * querier, uint32_t * deadline)
+{
+    MINIMR_ASSERT(querier != NULL);
+    MINIMR_ASSERT(deadline != NULL);
+
+    uint8_t found = 0;
+
+    for(uint16_t i = 0; i < querier->maxquestions; i++){
+
+        struct minimr_querier_question * q = &querier->questions[i];
+
+        if (q->nusers == 0) continue;
+
+        if (!found || MINIMR_TIME_DUE(q->deadline, *deadline)){
+            *deadline = q->deadline;
+            found = 1;
+        }
+    }
+
+    return found ? MINIMR_OK : MINIMR_NOT_OK;
+}
+
+int32_t minimr_querier_msg(
+        struct minimr_querier * querier,
+        uint32_t now,
+        uint8_t * outmsg, uint16_t * outmsglen, uint16_t outmsgmaxlen,
+        void * user_data
+)
+{
+    MINIMR_ASSERT(querier != NULL);
+    MINIMR_ASSERT(outmsg != NULL);
+    MINIMR_ASSERT(outmsglen != NULL);
+
+    int32_t res;
+
+    // remaining known answers of the query in progress
+    if (!MINIMR_MSG_CURSOR_DONE(&querier->cursor)){
+
+        res = minimr_make_msg_next(
+                0, 0, 0,
+                querier->queries, querier->nqueries,
+                querier->known_answers, querier->nknown_answers,
+                NULL, 0,
+                NULL, 0,
+                &querier->cursor,
+                outmsg, outmsglen, outmsgmaxlen,
+                user_data
+        );
+
+        if (res == MINIMR_OK){
+            return MINIMR_OK;
+        }
+
+        querier->cursor.section = MINIMR_MSG_SECTION_DONE;
+
+        if (res != MINIMR_IGNORE){
+            return res;
+        }
+    }
+
+    uint8_t due = 0;
+
+    for(uint16_t i = 0; i < querier->maxquestions && !due; i++){
+        due = querier->questions[i].nusers > 0 && MINIMR_TIME_DUE(querier->questions[i].deadline, now);
+    }
+
+    if (!due){
+        return MINIMR_IGNORE;
+    }
+
+    // questions due (within the window) as long as they certainly fit the first packet
+    uint16_t len = MINIMR_DNS_HDR_SIZE;
+
+    querier->nqueries = 0;
+    querier->nknown_answers = 0;
+
+    for(uint16_t i = 0; i < querier->maxquestions; i++){
+
+        struct minimr_querier_question * q = &querier->questions[i];
+
+        if (q->nusers == 0 || !MINIMR_TIME_DUE(q->deadline, now + querier->window)) continue;
+
+        struct minimr_query * query = &querier->queries[querier->nqueries];
+
+        query->type = q->type;
+        query->unicast_class = MINIMR_DNS_CLASS_IN | (q->unicast ? MINIMR_DNS_QUNICAST : 0);
+        query->name = q->name;
+
+        // asked by another host already, ie considered sent (unless we want a unicast response of our own)
+        if (querier->seen != NULL && !q->unicast && minimr_question_table_seen(querier->seen, query, now) == MINIMR_OK){
+            querier_question_sent(q, now);
+            continue;
+        }
+
+        uint16_t qlen = minimr_name_length(q->name) + 4;
+
+        // left for the next query (unless it does not even fit alone)
+        if (len + qlen > outmsgmaxlen && querier->nqueries > 0) continue;
+
+        querier->nqueries++;
+
+        len += qlen;
+
+        querier_question_sent(q, now);
+
+        if (len > outmsgmaxlen){
+            break;
+        }
+    }
+
+    if (querier->nqueries == 0){
+        return MINIMR_IGNORE;
+    }
+
+    if (querier->cache != NULL){
+        for(uint16_t i = 0; i < querier->nqueries; i++){
+            querier->nknown_answers += minimr_cache_known_answers(
+                    querier->cache, querier->queries[i].name, querier->queries[i].type, now,
+                    &querier->known_answers[querier->nknown_answers], querier->maxknown_answers - querier->nknown_answers
+            );
+        }
+    }
+
+    minimr_msg_cursor_init(&querier->cursor);
+
+    res = minimr_make_msg_next(
+            0, 0, 0,
+            querier->queries, querier->nqueries,
+            querier->known_answers, querier->nknown_answers,
+            NULL, 0,
+            NULL, 0,
+            &querier->cursor,
+            outmsg, outmsglen, outmsgmaxlen,
+            user_data
+    );
+
+    if (res != MINIMR_OK){
+        querier->cursor.section = MINIMR_MSG_SECTION_DONE;
+    }
+
+    return res;
+}
@@ -0,0 +1,182 @@
+/**
+ * minimr - mini mDNS Responder (framework)
+ *
+ * https://github.com/tschiemer/minimr
+ *
+ * MIT License
+ *
+ * Copyright (c) 2020 Philip Tschiemer, filou.se
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef MINIMR_MINIMRQUERIER_H
+#define MINIMR_MINIMRQUERIER_H
+
+#include "minimr.h"
+#include "minimrcache.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// random delay of the first query of a question (see https://tools.ietf.org/html/rfc6762#section-5.2 )
+#ifndef MINIMR_QUERIER_DELAY_MIN
+#define MINIMR_QUERIER_DELAY_MIN        20
+#endif
+
+#ifndef MINIMR_QUERIER_DELAY_MAX
+#define MINIMR_QUERIER_DELAY_MAX        120
+#endif
+
+// interval between the first and second query, doubled with every query up to the maximum interval
+#ifndef MINIMR_QUERIER_INTERVAL_MIN
+#define MINIMR_QUERIER_INTERVAL_MIN     1000
+#endif
+
+#ifndef MINIMR_QUERIER_INTERVAL_MAX
+#define MINIMR_QUERIER_INTERVAL_MAX     3600000
+#endif
+
+// invalid question handle
+#define MINIMR_QUERIER_NONE             0xffff
+
+/**
+ * Question asked continuously (shared by all operations asking it)
+ */
+struct minimr_querier_question {
+    uint8_t name[MINIMR_CACHE_NAMELEN];  // normalized name (copy)
+    uint16_t type;
+    uint16_t nusers;        // number of operations asking, 0 if slot is free
+    uint8_t unicast;        // next query requests a unicast response (QU)
+    uint32_t interval;      // time (msec) to the query after the next one
+    uint32_t deadline;      // time (msec) of the next query
+};
+
+/**
+ * Continuous querier: asks any number of questions (of browse and resolve operations) at intervals of 1, 2, 4 .. sec
+ * up to one hour (see https://tools.ietf.org/html/rfc6762#section-5.2 ), multiplexed into as few queries as possible.
+ *
+ * Operations asking the same question (name and type) share it and its schedule. Once a question is due, all
+ * questions due within the aggregation window are sent along (ahead of time). The cached records (at more than half
+ * their TTL) of the questions are listed as known answers, spread across several packets if need be.
+ * Questions another host asked recently (as noted in the optional question table, see
+ * https://tools.ietf.org/html/rfc6762#section-7.3 ) are considered sent, ie are skipped until their next deadline.
+ *
+ * Time is given by the caller as (wrapping) msec timestamps, random numbers likewise.
+ * All memory is provided by the caller.
+ *
+ * Typical host loop:
+ *  - start operation:  minimr_querier_start() (and look up the cache for answers known already)
+ *  - received message: minimr_cache_add_msg() (and look up the cache for new answers)
+ *  - timer (@see minimr_querier_next_deadline()) expired: send minimr_querier_msg() until it returns MINIMR_IGNORE
+ *  - stop operation:   minimr_querier_stop()
+ */
+struct minimr_querier {
+    struct minimr_querier_question * questions;
+    uint16_t maxquestions;
+
+    uint32_t window;
+
+    // source of known answers (optional)
+    struct minimr_cache * cache;
+
+    // questions of other hosts (optional)
+    struct minimr_question_table * seen;
+
+    // query in progress
+    struct minimr_query * queries;
+    uint16_t nqueries;
+    struct minimr_rr ** known_answers;
+    uint16_t nknown_answers;
+    uint16_t maxknown_answers;
+    struct minimr_msg_cursor cursor;
+};
+
+/**
+ * Initializes querier without questions
+ * @param questions         memory for questions
+ * @param queries           memory for the questions of a query (maxquestions)
+ * @param known_answers     memory for the known answers of a query (maxknown_answers may be 0)
+ * @param cache             cache of known answers (NULL if none)
+ * @param seen              recently seen questions of other hosts (NULL if none)
+ * @param window            time (msec) questions may be sent ahead of their deadline to be aggregated
+ */
+void minimr_querier_init(
+        struct minimr_querier * querier,
+        struct minimr_querier_question * questions, struct minimr_query * queries, uint16_t maxquestions,
+        struct minimr_rr ** known_answers, uint16_t maxknown_answers,
+        struct minimr_cache * cache,
+        struct minimr_question_table * seen,
+        uint32_t window
+);
+
+/**
+ * Drops all questions (and the query in progress)
+ */
+void minimr_querier_clear(struct minimr_querier * querier);
+
+/**
+ * Starts asking question (or joins the operations asking it already)
+ * @param name      normalized name (copied, ie the caller's buffer may change once started)
+ * @param random    random number (for the delay of the first query)
+ * @return question handle or MINIMR_QUERIER_NONE if there are too many questions (or the name is too long)
+ */
+uint16_t minimr_querier_start(struct minimr_querier * querier, uint8_t * name, uint16_t type, uint32_t now, uint32_t random);
+
+/**
+ * Requests a unicast response to the next query of the question (QU, see
+ * https://tools.ietf.org/html/rfc6762#section-5.4 ), ex. for the first query of a one-shot operation
+ */
+void minimr_querier_unicast(struct minimr_querier * querier, uint16_t handle);
+
+/**
+ * Stops asking question (once all operations asking it stopped)
+ */
+void minimr_querier_stop(struct minimr_querier * querier, uint16_t handle);
+
+/**
+ * Gets the time the next query is due (to be passed to the host's timer)
+ * @return MINIMR_OK        if there are questions
+ * @return MINIMR_NOT_OK    if not
+ */
+uint8_t minimr_querier_next_deadline(struct minimr_querier * querier, uint32_t * deadline);
+
+/**
+ * Generates (the next packet of) a query with the questions due (and all questions which can be sent along) and
+ * their known answers
+ * Questions not fitting the message remain due, ie call until MINIMR_IGNORE is returned.
+ * NOTE the cache must not change until all packets of a query are generated
+ * @return MINIMR_OK        if a packet was generated
+ * @return MINIMR_IGNORE    if no question is due
+ * @return MINIMR_DNS_HDR2_RCODE_SERVAIL if a question (or known answer) does not fit a packet (the query is dropped)
+ */
+int32_t minimr_querier_msg(
+        struct minimr_querier * querier,
+        uint32_t now,
+        uint8_t * outmsg, uint16_t * outmsglen, uint16_t outmsgmaxlen,
+        void * user_data
+);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //MINIMR_MINIMRQUERIER_H
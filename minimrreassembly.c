@@ -0,0 +1,290 @@
+/**
+ * minimr - mini mDNS Responder (framework)
+ *
+ * https://github.com/tschiemer/minimr
+ *
+ * MIT License
+ *
+ * Copyright (c) 2020 Philip Tschiemer, filou.se
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "minimrreassembly.h"
+
+void minimr_reassembly_init(
+        struct minimr_reassembly * re,
+        struct minimr_reassembly_slot * slots, uint16_t nslots,
+        uint8_t * buffer, uint16_t maxlen
+)
+{
+    MINIMR_ASSERT(re != NULL);
+    MINIMR_ASSERT(nslots == 0 || slots != NULL);
+    MINIMR_ASSERT(nslots == 0 || buffer != NULL);
+
+    re->slots = slots;
+    re->nslots = nslots;
+    re->maxlen = maxlen;
+
+    for(uint16_t i = 0; i < nslots; i++){
+        slots[i].buffer = &buffer[i * maxlen];
+        slots[i].length = 0;
+    }
+}
+
+void minimr_reassembly_clear(struct minimr_reassembly * re)
+{
+    MINIMR_ASSERT(re != NULL);
+
+    for(uint16_t i = 0; i < re->nslots; i++){
+        re->slots[i].length = 0;
+    }
+}
+
+/**
+ * Appends message to slot (if it fits)
+ */
+static uint8_t reassembly_append(struct minimr_reassembly * re, struct minimr_reassembly_slot * slot, uint8_t * msg, uint16_t msglen)
+{
+    if ((uint32_t)slot->length + 2 + msglen > re->maxlen){
+        return MINIMR_NOT_OK;
+    }
+
+    slot->buffer[slot->length++] = (msglen >> 8) & 0xff;
+    slot->buffer[slot->length++] = msglen & 0xff;
+
+    for(uint16_t i = 0; i < msglen; i++){
+        slot->buffer[slot->length++] = msg[i];
+    }
+
+    return MINIMR_OK;
+}
+
+int32_t minimr_reassembly_add(
+        struct minimr_reassembly * re,
+        uint8_t * msg, uint16_t msglen,
+        uint8_t * src, uint8_t srclen,
+        uint32_t now, uint32_t random
+)
+{
+    MINIMR_ASSERT(re != NULL);
+    MINIMR_ASSERT(msg != NULL);
+    MINIMR_ASSERT(src != NULL);
+    MINIMR_ASSERT(srclen <= MINIMR_REASSEMBLY_SRC_MAXLEN);
+
+    if (msglen < MINIMR_DNS_HDR_SIZE){
+        return MINIMR_IGNORE;
+    }
+
+    struct minimr_dns_hdr hdr;
+
+    minimr_dns_hdr_read(&hdr, msg);
+
+    if ( (hdr.flags[0] & MINIMR_DNS_HDR1_QR) != MINIMR_DNS_HDR1_QR_QUERY ||
+         (hdr.flags[0] & MINIMR_DNS_HDR1_OPCODE) != MINIMR_DNS_HDR1_OPCODE_QUERY){
+        return MINIMR_IGNORE;
+    }
+
+    uint8_t truncated = (hdr.flags[0] & MINIMR_DNS_HDR1_TC) == MINIMR_DNS_HDR1_TC;
+
+    // known answer list of source still being continued
+    struct minimr_reassembly_slot * slot = NULL;
+
+    for(uint16_t i = 0; i < re->nslots && slot == NULL; i++){
+
+        struct minimr_reassembly_slot * s = &re->slots[i];
+
+        if (s->length == 0 || s->complete || s->srclen != srclen){
+            continue;
+        }
+
+        uint8_t l = 0;
+        while(l < srclen && s->src[l] == src[l]){
+            l++;
+        }
+
+        if (l == srclen){
+            slot = s;
+        }
+    }
+
+    // continued known answer list
+    if (hdr.nqueries == 0){
+
+        if (slot == NULL || hdr.nanswers == 0){
+            return MINIMR_IGNORE;
+        }
+
+        // if it does not fit, these known answers are just not considered
+        reassembly_append(re, slot, msg, msglen);
+
+        // complete, no need to wait any longer
+        if (truncated == 0){
+            slot->complete = 1;
+            slot->deadline = now;
+        }
+
+        return MINIMR_OK;
+    }
+
+    if (truncated == 0){
+        return MINIMR_IGNORE;
+    }
+
+    // a new query ends the previous known answer list
+    if (slot != NULL){
+        slot->complete = 1;
+        slot->deadline = now;
+    }
+
+    slot = NULL;
+
+    for(uint16_t i = 0; i < re->nslots && slot == NULL; i++){
+        if (re->slots[i].length == 0){
+            slot = &re->slots[i];
+        }
+    }
+
+    if (slot == NULL){
+        return MINIMR_NOT_OK;
+    }
+
+    if (reassembly_append(re, slot, msg, msglen) != MINIMR_OK){
+        slot->length = 0;
+        return MINIMR_NOT_OK;
+    }
+
+    for(uint8_t l = 0; l < srclen; l++){
+        slot->src[l] = src[l];
+    }
+    slot->srclen = srclen;
+    slot->complete = 0;
+    slot->deadline = now + MINIMR_REASSEMBLY_DELAY_MIN + random % (MINIMR_REASSEMBLY_DELAY_MAX - MINIMR_REASSEMBLY_DELAY_MIN + 1);
+
+    return MINIMR_OK;
+}
+
+uint8_t minimr_reassembly_next_deadline(struct minimr_reassembly * re, uint32_t * deadline)
+{
+    MINIMR_ASSERT(re != NULL);
+    MINIMR_ASSERT(deadline != NULL);
+
+    uint8_t found = 0;
+
+    for(uint16_t i = 0; i < re->nslots; i++){
+
+        if (re->slots[i].length == 0){
+            continue;
+        }
+
+        if (found == 0 || MINIMR_TIME_DUE(re->slots[i].deadline, *deadline)){
+            *deadline = re->slots[i].deadline;
+            found = 1;
+        }
+    }
+
+    return found ? MINIMR_OK : MINIMR_NOT_OK;
+}
+
+/**
+ * Matches query held in slot and checks all of its known answers
+ */
+static int32_t reassembly_match(
+        struct minimr_reassembly_slot * slot,
+        struct minimr_query_stat qstats[], uint16_t nqstats, uint16_t * nq,
+        struct minimr_rr ** records, uint16_t nrecords,
+        struct minimr_rr_index * index,
+        uint8_t *unicast_requested,
+        void * user_data
+)
+{
+    uint16_t pos = 0;
+    uint16_t len = (slot->buffer[0] << 8) | slot->buffer[1];
+
+    int32_t res = minimr_query_match(&slot->buffer[2], len, qstats, nqstats, nq, records, nrecords, index, unicast_requested, user_data);
+
+    pos += 2 + len;
+
+    while (res == MINIMR_OK && pos + 2 <= slot->length){
+
+        len = (slot->buffer[pos] << 8) | slot->buffer[pos + 1];
+
+        res = minimr_query_match_known_answers(&slot->buffer[pos + 2], len, qstats, *nq, records, nrecords, index, unicast_requested, user_data);
+
+        // faulty messages are not considered
+        if (res != MINIMR_OK && res != MINIMR_IGNORE){
+            res = MINIMR_OK;
+        }
+
+        pos += 2 + len;
+    }
+
+    return res;
+}
+
+int32_t minimr_reassembly_response_msg(
+        struct minimr_reassembly * re,
+        uint32_t now,
+        struct minimr_query_stat qstats[], uint16_t nqstats,
+        struct minimr_rr ** records, uint16_t nrecords,
+        struct minimr_rr_index * index,
+        uint8_t *outmsg, uint16_t *outmsglen, uint16_t outmsgmaxlen,
+        uint8_t *unicast_requested,
+        uint8_t * src, uint8_t * srclen,
+        void * user_data
+)
+{
+    MINIMR_ASSERT(re != NULL);
+    MINIMR_ASSERT(src != NULL);
+    MINIMR_ASSERT(srclen != NULL);
+
+    for(uint16_t i = 0; i < re->nslots; i++){
+
+        struct minimr_reassembly_slot * slot = &re->slots[i];
+
+        if (slot->length == 0 || !MINIMR_TIME_DUE(slot->deadline, now)){
+            continue;
+        }
+
+        uint16_t nq = 0;
+
+        int32_t res = reassembly_match(slot, qstats, nqstats, &nq, records, nrecords, index, unicast_requested, user_data);
+
+        if (res == MINIMR_OK){
+
+            uint16_t tid = (slot->buffer[2] << 8) | slot->buffer[3];
+
+            res = minimr_query_match_response_msg(tid, qstats, nq, records, nrecords, index, NULL, outmsg, outmsglen, outmsgmaxlen, user_data);
+        }
+
+        for(uint8_t l = 0; l < slot->srclen; l++){
+            src[l] = slot->src[l];
+        }
+        *srclen = slot->srclen;
+
+        // released
+        slot->length = 0;
+
+        if (res == MINIMR_OK || res == MINIMR_DNS_HDR2_RCODE_SERVAIL){
+            return res;
+        }
+    }
+
+    return MINIMR_IGNORE;
+}
@@ -0,0 +1,152 @@
+/**
+ * minimr - mini mDNS Responder (framework)
+ *
+ * https://github.com/tschiemer/minimr
+ *
+ * MIT License
+ *
+ * Copyright (c) 2020 Philip Tschiemer, filou.se
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef MINIMR_MINIMRREASSEMBLY_H
+#define MINIMR_MINIMRREASSEMBLY_H
+
+#include "minimr.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// max length of source address (ex. sizeof(struct sockaddr_in6))
+#ifndef MINIMR_REASSEMBLY_SRC_MAXLEN
+#define MINIMR_REASSEMBLY_SRC_MAXLEN    28
+#endif
+
+// time (msec) truncated queries are held for their known answers to follow (see https://tools.ietf.org/html/rfc6762#section-7.2 )
+#ifndef MINIMR_REASSEMBLY_DELAY_MIN
+#define MINIMR_REASSEMBLY_DELAY_MIN     400
+#endif
+
+#ifndef MINIMR_REASSEMBLY_DELAY_MAX
+#define MINIMR_REASSEMBLY_DELAY_MAX     500
+#endif
+
+/**
+ * Truncated query (and its continued known answer lists) of one source
+ */
+struct minimr_reassembly_slot {
+    uint8_t src[MINIMR_REASSEMBLY_SRC_MAXLEN];
+    uint8_t srclen;
+    uint8_t complete;   // last message (without TC) received
+    uint16_t length;    // bytes of buffer used (messages, each prefixed by its 16bit length), 0 if unused
+    uint32_t deadline;  // time (msec) to respond
+    uint8_t * buffer;
+};
+
+/**
+ * Reassembly of queries whose known answer list spans several messages (see
+ * https://tools.ietf.org/html/rfc6762#section-7.2 ).
+ *
+ * A query with the TC flag set is held (for MINIMR_REASSEMBLY_DELAY_MIN - MAX msec) together with the subsequent
+ * messages of the same source (continuing the known answer list) and answered only once the list is complete (or the
+ * time is up), such that all of its known answers suppress answers.
+ *
+ * The source is an opaque key (ex. address and port) given by the caller. Each slot holds the messages of one source
+ * up to a fixed length; known answers not fitting are dropped (ie answered nonetheless).
+ * Time is given by the caller as (wrapping) msec timestamps, random numbers likewise.
+ * All memory is provided by the caller.
+ *
+ * Typical host loop:
+ *  - received message:     unless minimr_reassembly_add() holds it (MINIMR_OK), respond as usual
+ *  - timer (@see minimr_reassembly_next_deadline()) expired: send minimr_reassembly_response_msg() until it returns
+ *    MINIMR_IGNORE
+ */
+struct minimr_reassembly {
+    struct minimr_reassembly_slot * slots;
+    uint16_t nslots;
+    uint16_t maxlen;    // buffer length of each slot
+};
+
+/**
+ * Initializes reassembly
+ * @param buffer    buffer of nslots * maxlen bytes
+ */
+void minimr_reassembly_init(
+        struct minimr_reassembly * re,
+        struct minimr_reassembly_slot * slots, uint16_t nslots,
+        uint8_t * buffer, uint16_t maxlen
+);
+
+/**
+ * Drops all held queries
+ */
+void minimr_reassembly_clear(struct minimr_reassembly * re);
+
+/**
+ * Holds given message if it is a truncated query (TC) or continues the known answer list of a held query of the same
+ * source.
+ * @param random    random number (for the delay)
+ * @return MINIMR_OK        if the message is held (ie must not be answered now)
+ * @return MINIMR_IGNORE    if the message is neither (ie is to be processed as usual)
+ * @return MINIMR_NOT_OK    if a truncated query could not be held (no slot left), ie is to be answered as usual
+ */
+int32_t minimr_reassembly_add(
+        struct minimr_reassembly * re,
+        uint8_t * msg, uint16_t msglen,
+        uint8_t * src, uint8_t srclen,
+        uint32_t now, uint32_t random
+);
+
+/**
+ * Gets the time the next held query is to be answered (to be passed to the host's timer)
+ * @return MINIMR_OK        if there are held queries
+ * @return MINIMR_NOT_OK    if not
+ */
+uint8_t minimr_reassembly_next_deadline(struct minimr_reassembly * re, uint32_t * deadline);
+
+/**
+ * Generates response to the next held query due (considering all of its known answers), which is released.
+ * Queries not requiring an answer (anymore) are released silently.
+ * @param src       buffer of MINIMR_REASSEMBLY_SRC_MAXLEN bytes receiving the source of the query
+ * @param srclen    receives length of source
+ * @return MINIMR_OK        if a message was generated
+ * @return MINIMR_IGNORE    if no (more) query is due
+ * @return MINIMR_DNS_HDR2_RCODE_SERVAIL on failure
+ * @see minimr_query_response_msg()
+ */
+int32_t minimr_reassembly_response_msg(
+        struct minimr_reassembly * re,
+        uint32_t now,
+        struct minimr_query_stat qstats[], uint16_t nqstats,
+        struct minimr_rr ** records, uint16_t nrecords,
+        struct minimr_rr_index * index,
+        uint8_t *outmsg, uint16_t *outmsglen, uint16_t outmsgmaxlen,
+        uint8_t *unicast_requested,
+        uint8_t * src, uint8_t * srclen,
+        void * user_data
+);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //MINIMR_MINIMRREASSEMBLY_H
@@ -0,0 +1,487 @@
+/**
+ * minimr - mini mDNS Responder (framework)
+ *
+ * https://github.com/tschiemer/minimr
+ *
+ * MIT License
+ *
+ * Copyright (c) 2020 Philip Tschiemer, filou.se
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "minimrregistry.h"
+
+static int32_t registry_rr_get_rr(struct minimr_rr * rr, uint8_t * outmsg, uint16_t * outlen, uint16_t outmsgmaxlen, uint16_t * nrr, void * user_data, struct minimr_name_dict * dict);
+static int32_t registry_rr_query_get_rr(struct minimr_rr * rr, struct minimr_query_stat * qstat, uint8_t * outmsg, uint16_t * outlen, uint16_t outmsgmaxlen, uint16_t * nrr, void * user_data, struct minimr_name_dict * dict);
+static int32_t registry_rr_query_get_extra_rrs(struct minimr_rr * rr, struct minimr_query_stat * qstat, uint8_t * outmsg, uint16_t * outlen, uint16_t outmsgmaxlen, uint16_t * nrr, void * user_data, struct minimr_name_dict * dict);
+
+static const struct minimr_rr_ops registry_rr_ops = {
+    .query_get_rr = registry_rr_query_get_rr,
+    .query_get_extra_rrs = registry_rr_query_get_extra_rrs,
+    .get_rr = registry_rr_get_rr,
+    .announce_get_rr = registry_rr_get_rr,
+};
+
+/**
+ * Copies and normalizes a name (formatted as .segment1.segment2. etc .tld)
+ */
+static uint8_t registry_name_init(uint8_t * dst, uint16_t maxlen, uint16_t * length, uint8_t * src)
+{
+    if (src == NULL || src[0] != '.'){
+        return MINIMR_NOT_OK;
+    }
+
+    uint16_t i = 0;
+
+    for(; src[i] != '\0'; i++){
+        if (i + 1 >= maxlen){
+            return MINIMR_NOT_OK;
+        }
+        dst[i] = src[i];
+    }
+    dst[i] = '\0';
+
+    minimr_name_normalize(dst, length);
+
+    return MINIMR_OK;
+}
+
+static uint8_t registry_rr_write(struct minimr_registry_rr * rr, uint8_t * outmsg, uint16_t * outlen, uint16_t outmsgmaxlen, struct minimr_name_dict * dict)
+{
+#if MINIMR_RR_WIRE_TEMPLATE_USE == 1
+    return minimr_rr_wire_write((struct minimr_rr *)rr, outmsg, outlen, outmsgmaxlen, dict);
+#else
+    uint16_t l = *outlen;
+    uint16_t rdpos;
+
+    if (minimr_rr_write_begin((struct minimr_rr *)rr, outmsg, &l, outmsgmaxlen, dict, &rdpos) != MINIMR_OK){
+        return MINIMR_NOT_OK;
+    }
+
+    // (names in) RDATA are written uncompressed
+    if (minimr_rr_write_data(&rr->data[MINIMR_REGISTRY_HDRLEN], rr->data_length - MINIMR_REGISTRY_HDRLEN, outmsg, &l, outmsgmaxlen) != MINIMR_OK){
+        minimr_name_dict_truncate(dict, *outlen);
+        return MINIMR_NOT_OK;
+    }
+
+    minimr_rr_write_end(outmsg, l, rdpos);
+
+    *outlen = l;
+
+    return MINIMR_OK;
+#endif
+}
+
+static int32_t registry_rr_get_rr(struct minimr_rr * rr, uint8_t * outmsg, uint16_t * outlen, uint16_t outmsgmaxlen, uint16_t * nrr, void * user_data, struct minimr_name_dict * dict)
+{
+    if (registry_rr_write((struct minimr_registry_rr *)rr, outmsg, outlen, outmsgmaxlen, dict) != MINIMR_OK){
+        return MINIMR_NOT_OK;
+    }
+
+    if (nrr != NULL){
+        *nrr = 1;
+    }
+
+    return MINIMR_OK;
+}
+
+static int32_t registry_rr_query_get_rr(struct minimr_rr * rr, struct minimr_query_stat * qstat, uint8_t * outmsg, uint16_t * outlen, uint16_t outmsgmaxlen, uint16_t * nrr, void * user_data, struct minimr_name_dict * dict)
+{
+    return registry_rr_get_rr(rr, outmsg, outlen, outmsgmaxlen, nrr, user_data, dict);
+}
+
+/**
+ * Writes all records of the registry with given name and type (looked up through the index)
+ */
+static uint8_t registry_write_matching(struct minimr_registry * reg, uint8_t * name, uint16_t type, uint8_t * outmsg, uint16_t * outlen, uint16_t outmsgmaxlen, uint16_t * n, struct minimr_name_dict * dict)
+{
+    uint32_t hash = minimr_name_hash(name);
+    uint16_t namelen = minimr_name_length(name);
+
+    for(uint16_t ie = MINIMR_RR_INDEX_FIRST(&reg->index, hash); ie != MINIMR_RR_INDEX_NONE; ie = reg->index.entries[ie].next){
+
+        if (reg->index.entries[ie].name_hash != hash || reg->index.entries[ie].type != type) continue;
+
+        struct minimr_registry_rr * rr = (struct minimr_registry_rr *)reg->index.records[ie];
+
+        if (minimr_name_cmp(rr->name, 0, name, namelen) != 0) continue;
+
+        if (registry_rr_write(rr, outmsg, outlen, outmsgmaxlen, dict) != MINIMR_OK){
+            return MINIMR_NOT_OK;
+        }
+
+        (*n)++;
+    }
+
+    return MINIMR_OK;
+}
+
+/**
+ * Address records of the targets of all SRV records with given name
+ */
+static uint8_t registry_write_srv_targets(struct minimr_registry * reg, uint8_t * name, uint8_t * outmsg, uint16_t * outlen, uint16_t outmsgmaxlen, uint16_t * n, struct minimr_name_dict * dict)
+{
+    uint32_t hash = minimr_name_hash(name);
+    uint16_t namelen = minimr_name_length(name);
+
+    for(uint16_t ie = MINIMR_RR_INDEX_FIRST(&reg->index, hash); ie != MINIMR_RR_INDEX_NONE; ie = reg->index.entries[ie].next){
+
+        if (reg->index.entries[ie].name_hash != hash || reg->index.entries[ie].type != MINIMR_DNS_TYPE_SRV) continue;
+
+        struct minimr_registry_rr * rr = (struct minimr_registry_rr *)reg->index.records[ie];
+
+        if (minimr_name_cmp(rr->name, 0, name, namelen) != 0) continue;
+
+        // PRIORITY(2) WEIGHT(2) PORT(2) TARGET
+        uint8_t * target = &rr->data[MINIMR_REGISTRY_HDRLEN + 6];
+
+        if (registry_write_matching(reg, target, MINIMR_DNS_TYPE_A, outmsg, outlen, outmsgmaxlen, n, dict) != MINIMR_OK ||
+            registry_write_matching(reg, target, MINIMR_DNS_TYPE_AAAA, outmsg, outlen, outmsgmaxlen, n, dict) != MINIMR_OK){
+            return MINIMR_NOT_OK;
+        }
+    }
+
+    return MINIMR_OK;
+}
+
+/**
+ * Additional records as recommended by https://tools.ietf.org/html/rfc6763#section-12 (and AAAA records of A answers
+ * and vice versa)
+ */
+static int32_t registry_rr_query_get_extra_rrs(struct minimr_rr * rr, struct minimr_query_stat * qstat, uint8_t * outmsg, uint16_t * outlen, uint16_t outmsgmaxlen, uint16_t * nrr, void * user_data, struct minimr_name_dict * dict)
+{
+    struct minimr_registry_rr * rrr = (struct minimr_registry_rr *)rr;
+    struct minimr_registry * reg = rrr->registry;
+
+    uint8_t * rdata = &rrr->data[MINIMR_REGISTRY_HDRLEN];
+
+    uint16_t n = 0;
+
+    // all extra records are written at once (or not at all)
+    uint16_t l = *outlen;
+
+    uint8_t res = MINIMR_OK;
+
+    if (rr->type == MINIMR_DNS_TYPE_PTR){
+        // service instance: SRV, TXT and the addresses of the SRV target
+        // (also note that the PTR record of a service might point to a record that is not part of the registry)
+        if (registry_write_matching(reg, rdata, MINIMR_DNS_TYPE_SRV, outmsg, &l, outmsgmaxlen, &n, dict) != MINIMR_OK ||
+            registry_write_matching(reg, rdata, MINIMR_DNS_TYPE_TXT, outmsg, &l, outmsgmaxlen, &n, dict) != MINIMR_OK ||
+            registry_write_srv_targets(reg, rdata, outmsg, &l, outmsgmaxlen, &n, dict) != MINIMR_OK){
+            res = MINIMR_NOT_OK;
+        }
+    } else if (rr->type == MINIMR_DNS_TYPE_SRV){
+        uint8_t * target = &rdata[6];
+
+        if (registry_write_matching(reg, target, MINIMR_DNS_TYPE_A, outmsg, &l, outmsgmaxlen, &n, dict) != MINIMR_OK ||
+            registry_write_matching(reg, target, MINIMR_DNS_TYPE_AAAA, outmsg, &l, outmsgmaxlen, &n, dict) != MINIMR_OK){
+            res = MINIMR_NOT_OK;
+        }
+    } else if (rr->type == MINIMR_DNS_TYPE_A && qstat->type == MINIMR_DNS_TYPE_A){
+        res = registry_write_matching(reg, rr->name, MINIMR_DNS_TYPE_AAAA, outmsg, &l, outmsgmaxlen, &n, dict);
+    } else if (rr->type == MINIMR_DNS_TYPE_AAAA && qstat->type == MINIMR_DNS_TYPE_AAAA){
+        res = registry_write_matching(reg, rr->name, MINIMR_DNS_TYPE_A, outmsg, &l, outmsgmaxlen, &n, dict);
+    }
+
+    if (res != MINIMR_OK){
+        minimr_name_dict_truncate(dict, *outlen);
+        return MINIMR_NOT_OK;
+    }
+
+    *outlen = l;
+
+    if (nrr != NULL){
+        *nrr = n;
+    }
+
+    return MINIMR_OK;
+}
+
+void minimr_registry_init(
+        struct minimr_registry * reg,
+        struct minimr_registry_rr * pool, uint16_t npool,
+        struct minimr_rr ** records,
+        struct minimr_rr_index_entry * entries,
+        uint16_t * buckets, uint16_t nbuckets
+)
+{
+    MINIMR_ASSERT(reg != NULL);
+    MINIMR_ASSERT(pool != NULL);
+    MINIMR_ASSERT(npool > 0 && npool < MINIMR_REGISTRY_NONE);
+
+    reg->pool = pool;
+    reg->npool = npool;
+
+    // free list in order of slots
+    for(uint16_t i = 0; i < npool; i++){
+        pool[i].group = MINIMR_REGISTRY_NONE;
+        pool[i].next = i + 1 < npool ? i + 1 : MINIMR_REGISTRY_NONE;
+    }
+    reg->free = 0;
+
+    reg->generation = 0;
+
+    minimr_rr_index_init(&reg->index, records, npool, entries, buckets, nbuckets);
+}
+
+uint16_t minimr_registry_add(struct minimr_registry * reg, uint8_t * name, uint16_t type, uint32_t ttl, uint8_t * rdata, uint16_t rdlength, uint16_t group)
+{
+    MINIMR_ASSERT(reg != NULL);
+    MINIMR_ASSERT(rdata != NULL || rdlength == 0);
+
+    if (rdlength > MINIMR_REGISTRY_RDATALEN || reg->free == MINIMR_REGISTRY_NONE){
+        return MINIMR_REGISTRY_NONE;
+    }
+
+    if (group != MINIMR_REGISTRY_NONE){
+        if (group >= reg->npool || reg->pool[group].group == MINIMR_REGISTRY_NONE){
+            return MINIMR_REGISTRY_NONE;
+        }
+        group = reg->pool[group].group;
+    }
+
+    uint16_t handle = reg->free;
+    struct minimr_registry_rr * rr = &reg->pool[handle];
+
+    if (registry_name_init(rr->name, sizeof(rr->name), &rr->name_length, name) != MINIMR_OK){
+        return MINIMR_REGISTRY_NONE;
+    }
+
+    reg->free = rr->next;
+
+    rr->type = type;
+    rr->cache_class = MINIMR_DNS_CLASS_IN;
+    rr->ttl = ttl;
+    rr->ops = &registry_rr_ops;
+    rr->handler = minimr_rr_ops_handler;
+    rr->registry = reg;
+
+    // TTL and cache-flush bit are set when writing
+    uint16_t l = 0;
+
+    MINIMR_DNS_RR_WRITE_TYPE(rr->data, l, rr->type);
+    MINIMR_DNS_Q_WRITE_CLASS(rr->data, l, rr->cache_class);
+    MINIMR_DNS_RR_WRITE_TTL(rr->data, l, 0);
+
+    rr->data[l++] = (rdlength >> 8) & 0xff;
+    rr->data[l++] = rdlength & 0xff;
+
+    for(uint16_t i = 0; i < rdlength; i++){
+        rr->data[l++] = rdata[i];
+    }
+
+    rr->data_length = l;
+
+#if MINIMR_RR_WIRE_TEMPLATE_USE == 1
+    rr->wire = rr->data;
+    rr->wire_length = rr->data_length;
+    rr->wire_maxlen = sizeof(rr->data);
+#endif
+
+#if MINIMR_RR_DIGEST_USE == 1
+    minimr_rr_digest_update((struct minimr_rr *)rr, NULL);
+#endif
+
+    // new groups consist of the record only, other records are inserted after the first record of the group
+    if (group == MINIMR_REGISTRY_NONE){
+        rr->group = handle;
+        rr->next = MINIMR_REGISTRY_NONE;
+    } else {
+        rr->group = group;
+        rr->next = reg->pool[group].next;
+        reg->pool[group].next = handle;
+    }
+
+    // never fails, the index holds as many records as the pool
+    rr->pos = reg->index.nrecords;
+    minimr_rr_index_add(&reg->index, (struct minimr_rr *)rr);
+
+    minimr_response_cache_invalidate(&reg->generation);
+
+    return handle;
+}
+
+uint16_t minimr_registry_add_a(struct minimr_registry * reg, uint8_t * name, uint32_t ttl, uint8_t * ipv4, uint16_t group)
+{
+    MINIMR_ASSERT(ipv4 != NULL);
+
+    return minimr_registry_add(reg, name, MINIMR_DNS_TYPE_A, ttl, ipv4, 4, group);
+}
+
+uint16_t minimr_registry_add_aaaa(struct minimr_registry * reg, uint8_t * name, uint32_t ttl, uint16_t * ipv6, uint16_t group)
+{
+    MINIMR_ASSERT(ipv6 != NULL);
+
+    uint8_t rdata[16];
+
+    for(uint8_t i = 0; i < 8; i++){
+        rdata[2*i] = (ipv6[i] >> 8) & 0xff;
+        rdata[2*i + 1] = ipv6[i] & 0xff;
+    }
+
+    return minimr_registry_add(reg, name, MINIMR_DNS_TYPE_AAAA, ttl, rdata, sizeof(rdata), group);
+}
+
+uint16_t minimr_registry_add_service(
+        struct minimr_registry * reg,
+        uint8_t * instance, uint8_t * service, uint8_t * target,
+        uint16_t port,
+        uint8_t * txt, uint16_t txtlength,
+        uint32_t ttl
+)
+{
+    MINIMR_ASSERT(reg != NULL);
+
+    // PRIORITY(2) WEIGHT(2) PORT(2) TARGET
+    uint8_t rdata[6 + MINIMR_REGISTRY_NAMELEN];
+    uint16_t namelen;
+
+    // the pool must hold all records (such that nothing is added on failure)
+    uint16_t nfree = 0;
+    for(uint16_t i = reg->free; i != MINIMR_REGISTRY_NONE && nfree < 3; i = reg->pool[i].next){
+        nfree++;
+    }
+    if (nfree < 3){
+        return MINIMR_REGISTRY_NONE;
+    }
+
+    // PTR: service -> instance
+    if (registry_name_init(rdata, sizeof(rdata), &namelen, instance) != MINIMR_OK){
+        return MINIMR_REGISTRY_NONE;
+    }
+
+    uint16_t group = minimr_registry_add(reg, service, MINIMR_DNS_TYPE_PTR, ttl, rdata, minimr_name_length(rdata), MINIMR_REGISTRY_NONE);
+
+    if (group == MINIMR_REGISTRY_NONE){
+        return MINIMR_REGISTRY_NONE;
+    }
+
+    // SRV: instance -> target:port
+    rdata[0] = 0;
+    rdata[1] = 0;
+    rdata[2] = 0;
+    rdata[3] = 0;
+    rdata[4] = (port >> 8) & 0xff;
+    rdata[5] = port & 0xff;
+
+    if (registry_name_init(&rdata[6], sizeof(rdata) - 6, &namelen, target) != MINIMR_OK ||
+        minimr_registry_add(reg, instance, MINIMR_DNS_TYPE_SRV, ttl, rdata, 6 + minimr_name_length(&rdata[6]), group) == MINIMR_REGISTRY_NONE){
+        minimr_registry_remove(reg, group);
+        return MINIMR_REGISTRY_NONE;
+    }
+
+    // TXT: an empty TXT record consists of a single empty string (see https://tools.ietf.org/html/rfc6763#section-6.1 )
+    uint8_t empty = 0;
+
+    if (txt == NULL || txtlength == 0){
+        txt = &empty;
+        txtlength = 1;
+    }
+
+    if (minimr_registry_add(reg, instance, MINIMR_DNS_TYPE_TXT, ttl, txt, txtlength, group) == MINIMR_REGISTRY_NONE){
+        minimr_registry_remove(reg, group);
+        return MINIMR_REGISTRY_NONE;
+    }
+
+    return group;
+}
+
+/**
+ * Removes record from record set and returns its slot to the pool
+ */
+static void registry_free(struct minimr_registry * reg, uint16_t handle)
+{
+    struct minimr_registry_rr * rr = &reg->pool[handle];
+
+    uint16_t pos = rr->pos;
+
+    minimr_rr_index_remove(&reg->index, pos);
+
+    // the last record of the set took its place
+    if (pos < reg->index.nrecords){
+        ((struct minimr_registry_rr *)reg->index.records[pos])->pos = pos;
+    }
+
+    rr->group = MINIMR_REGISTRY_NONE;
+    rr->next = reg->free;
+    reg->free = handle;
+}
+
+uint8_t minimr_registry_remove(struct minimr_registry * reg, uint16_t handle)
+{
+    MINIMR_ASSERT(reg != NULL);
+
+    if (handle >= reg->npool || reg->pool[handle].group == MINIMR_REGISTRY_NONE){
+        return MINIMR_NOT_OK;
+    }
+
+    struct minimr_registry_rr * rr = &reg->pool[handle];
+
+    if (rr->group == handle){
+        // whole group
+        for(uint16_t i = handle; i != MINIMR_REGISTRY_NONE; ){
+            uint16_t next = reg->pool[i].next;
+            registry_free(reg, i);
+            i = next;
+        }
+    } else {
+        uint16_t * link = &reg->pool[rr->group].next;
+
+        while (*link != handle){
+            link = &reg->pool[*link].next;
+        }
+        *link = rr->next;
+
+        registry_free(reg, handle);
+    }
+
+    minimr_response_cache_invalidate(&reg->generation);
+
+    return MINIMR_OK;
+}
+
+struct minimr_rr * minimr_registry_get(struct minimr_registry * reg, uint16_t handle)
+{
+    MINIMR_ASSERT(reg != NULL);
+
+    if (handle >= reg->npool || reg->pool[handle].group == MINIMR_REGISTRY_NONE){
+        return NULL;
+    }
+
+    return (struct minimr_rr *)&reg->pool[handle];
+}
+
+uint16_t minimr_registry_get_group(struct minimr_registry * reg, uint16_t handle, struct minimr_rr ** records, uint16_t maxrecords)
+{
+    MINIMR_ASSERT(reg != NULL);
+    MINIMR_ASSERT(records != NULL);
+
+    if (handle >= reg->npool || reg->pool[handle].group == MINIMR_REGISTRY_NONE){
+        return 0;
+    }
+
+    uint16_t n = 0;
+
+    for(uint16_t i = reg->pool[handle].group; i != MINIMR_REGISTRY_NONE && n < maxrecords; i = reg->pool[i].next){
+        records[n++] = (struct minimr_rr *)&reg->pool[i];
+    }
+
+    return n;
+}
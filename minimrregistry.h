@@ -0,0 +1,157 @@
+/**
+ * minimr - mini mDNS Responder (framework)
+ *
+ * https://github.com/tschiemer/minimr
+ *
+ * MIT License
+ *
+ * Copyright (c) 2020 Philip Tschiemer, filou.se
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef MINIMR_MINIMRREGISTRY_H
+#define MINIMR_MINIMRREGISTRY_H
+
+#include "minimr.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// invalid handle (ex. if the pool is exhausted)
+#define MINIMR_REGISTRY_NONE    0xffff
+
+// TYPE(2) CLASS(2) TTL(4) RDLENGTH(2)
+#define MINIMR_REGISTRY_HDRLEN  10
+
+/**
+ * Record slot of a registry pool
+ * The record data is kept in wire format (TYPE CLASS TTL RDLENGTH RDATA, where names in RDATA are uncompressed), which
+ * doubles as wire template (if MINIMR_RR_WIRE_TEMPLATE_USE == 1).
+ */
+MINIMR_RR_TYPE_BEGIN_STNAME(MINIMR_REGISTRY_NAMELEN, minimr_registry_rr)
+    struct minimr_registry * registry;
+    uint16_t pos;       // position in record set (index)
+    uint16_t group;     // handle of first record of group, MINIMR_REGISTRY_NONE if slot is free
+    uint16_t next;      // next record of group or next free slot
+    uint16_t data_length;
+    uint8_t data[MINIMR_REGISTRY_HDRLEN + MINIMR_REGISTRY_RDATALEN];
+MINIMR_RR_TYPE_END();
+
+/**
+ * Dynamic record set backed by a caller-provided pool of fixed-size record slots (ie no allocation and no
+ * fragmentation) that keeps a record index up to date.
+ *
+ * Records are added individually or as groups (ex. PTR, SRV and TXT of a service) and are referred to by handle;
+ * adding and removing a record takes (expected) constant time. The record set (records, nrecords) and the index can be
+ * passed as-is to minimr_query_response_msg() or minimr_indexed_query_response_msg() respectively.
+ *
+ * NOTE a registry is not thread-safe, ie changes must not happen concurrently to generating messages.
+ */
+struct minimr_registry {
+    struct minimr_registry_rr * pool;
+    uint16_t npool;
+
+    // first free slot
+    uint16_t free;
+
+    struct minimr_rr_index index;
+
+    // generation of the record set (to bind response caches to, @see minimr_response_cache_init())
+    volatile uint32_t generation;
+};
+
+/**
+ * Initializes an empty registry
+ * records[] and entries[] must hold npool elements, nbuckets MUST be a power of two (typically nbuckets >= npool)
+ */
+void minimr_registry_init(
+        struct minimr_registry * reg,
+        struct minimr_registry_rr * pool, uint16_t npool,
+        struct minimr_rr ** records,
+        struct minimr_rr_index_entry * entries,
+        uint16_t * buckets, uint16_t nbuckets
+);
+
+/**
+ * Record set (including records of all groups) as passed to minimr_query_response_msg() et al.
+ */
+#define MINIMR_REGISTRY_RECORDS(__reg__)    ((__reg__)->index.records)
+#define MINIMR_REGISTRY_NRECORDS(__reg__)   ((__reg__)->index.nrecords)
+
+/**
+ * Adds a record
+ * @param name      formatted as .segment1.segment2. etc .tld
+ * @param rdata     RDATA in wire format (names uncompressed)
+ * @param group     handle of a record of the group to add the record to, or MINIMR_REGISTRY_NONE for a new group
+ * @return handle of record (which is the group handle of a new group), MINIMR_REGISTRY_NONE if the pool is exhausted,
+ *         the name or rdata is too long or group is invalid
+ */
+uint16_t minimr_registry_add(struct minimr_registry * reg, uint8_t * name, uint16_t type, uint32_t ttl, uint8_t * rdata, uint16_t rdlength, uint16_t group);
+
+uint16_t minimr_registry_add_a(struct minimr_registry * reg, uint8_t * name, uint32_t ttl, uint8_t * ipv4, uint16_t group);
+
+uint16_t minimr_registry_add_aaaa(struct minimr_registry * reg, uint8_t * name, uint32_t ttl, uint16_t * ipv6, uint16_t group);
+
+/**
+ * Adds a service as group of PTR (service -> instance), SRV (instance -> target:port) and TXT record
+ * (see https://tools.ietf.org/html/rfc6763#section-4.1 )
+ * A/AAAA records of the target (which are added as extra records to PTR and SRV answers) are added separately.
+ *
+ * @param instance  instance name, ex. ".My Printer._ipp._tcp.local"
+ * @param service   service type, ex. "._ipp._tcp.local"
+ * @param target    host name, ex. ".my-printer.local"
+ * @param txt       TXT RDATA in wire format (ex. normalized through minimr_txt_normalize()), NULL for an empty TXT
+ * @return group handle or MINIMR_REGISTRY_NONE on failure (nothing is added)
+ */
+uint16_t minimr_registry_add_service(
+        struct minimr_registry * reg,
+        uint8_t * instance, uint8_t * service, uint8_t * target,
+        uint16_t port,
+        uint8_t * txt, uint16_t txtlength,
+        uint32_t ttl
+);
+
+/**
+ * Removes record - or all records of the group if the handle is a group handle
+ * NOTE to send goodbye messages, first get the group's records (minimr_registry_get_group()) and pass them to
+ * minimr_terminate_msg().
+ * @return MINIMR_OK        on success
+ * @return MINIMR_NOT_OK    if handle is invalid
+ */
+uint8_t minimr_registry_remove(struct minimr_registry * reg, uint16_t handle);
+
+/**
+ * Gets record of handle (or NULL if invalid)
+ */
+struct minimr_rr * minimr_registry_get(struct minimr_registry * reg, uint16_t handle);
+
+/**
+ * Gets (at most maxrecords) records of the group of given record
+ * @return number of records
+ */
+uint16_t minimr_registry_get_group(struct minimr_registry * reg, uint16_t handle, struct minimr_rr ** records, uint16_t maxrecords);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //MINIMR_MINIMRREGISTRY_H
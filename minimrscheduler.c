@@ -0,0 +1,373 @@
+/**
+ * minimr - mini mDNS Responder (framework)
+ *
+ * https://github.com/tschiemer/minimr
+ *
+ * MIT License
+ *
+ * Copyright (c) 2020 Philip Tschiemer, filou.se
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "minimrscheduler.h"
+
+void minimr_scheduler_init(struct minimr_scheduler * sched, struct minimr_pending_answer * pending, uint16_t maxpending, uint32_t window)
+{
+    MINIMR_ASSERT(sched != NULL);
+    MINIMR_ASSERT(maxpending == 0 || pending != NULL);
+
+    sched->pending = pending;
+    sched->npending = 0;
+    sched->maxpending = maxpending;
+    sched->window = window;
+}
+
+void minimr_scheduler_clear(struct minimr_scheduler * sched)
+{
+    MINIMR_ASSERT(sched != NULL);
+
+    sched->npending = 0;
+}
+
+/**
+ * Queues answer of record (or advances the times of the pending answer of the record)
+ */
+static uint8_t scheduler_add(struct minimr_scheduler * sched, uint16_t record, uint16_t type, uint32_t earliest, uint32_t deadline, uint8_t truncated)
+{
+    for(uint16_t i = 0; i < sched->npending; i++){
+
+        struct minimr_pending_answer * p = &sched->pending[i];
+
+        if (p->record != record){
+            continue;
+        }
+
+        if (!MINIMR_TIME_DUE(p->earliest, earliest)){
+            p->earliest = earliest;
+        }
+        if (!MINIMR_TIME_DUE(p->deadline, deadline)){
+            p->deadline = deadline;
+        }
+
+        // answering any type is a superset of answering a type
+        if (type == MINIMR_DNS_TYPE_ANY){
+            p->type = type;
+        }
+
+        // once answering another query, the answer is not canceled by known answers of the truncated query
+        p->truncated = p->truncated && truncated;
+
+        return MINIMR_OK;
+    }
+
+    if (sched->npending >= sched->maxpending){
+        return MINIMR_NOT_OK;
+    }
+
+    struct minimr_pending_answer * p = &sched->pending[sched->npending++];
+
+    p->record = record;
+    p->type = type;
+    p->earliest = earliest;
+    p->deadline = deadline;
+    p->truncated = truncated;
+
+    return MINIMR_OK;
+}
+
+int32_t minimr_scheduler_query(
+        struct minimr_scheduler * sched,
+        uint8_t * msg, uint16_t msglen,
+        struct minimr_query_stat qstats[], uint16_t nqstats,
+        struct minimr_rr ** records, uint16_t nrecords,
+        struct minimr_rr_index * index,
+        uint32_t now, uint32_t random,
+        uint8_t * unicast_requested,
+        void * user_data
+)
+{
+    MINIMR_ASSERT(sched != NULL);
+
+    struct minimr_dns_hdr hdr;
+
+    if (msglen >= MINIMR_DNS_HDR_SIZE){
+        minimr_dns_hdr_read(&hdr, msg);
+    } else {
+        hdr.flags[0] = 0;
+    }
+
+    // more known answers follow (which might suppress answers)
+    uint8_t truncated = (hdr.flags[0] & MINIMR_DNS_HDR1_TC) == MINIMR_DNS_HDR1_TC;
+
+    uint32_t tc = now + MINIMR_SCHEDULER_TC_DELAY_MIN + random % (MINIMR_SCHEDULER_TC_DELAY_MAX - MINIMR_SCHEDULER_TC_DELAY_MIN + 1);
+
+    // known answers (typically of the follow-up packets of a truncated query) cancel answers held off for them
+    if (sched->npending > 0){
+
+        struct minimr_rr ** rrs = index != NULL ? index->records : records;
+        uint16_t nrrs = index != NULL ? index->nrecords : nrecords;
+
+        sched->npending = minimr_known_answer_cancel(sched->pending, sched->npending, msg, msglen, rrs, nrrs, user_data);
+
+        // and yet more known answers follow
+        for(uint16_t i = 0; truncated && i < sched->npending; i++){
+            if (sched->pending[i].truncated && MINIMR_TIME_DUE(sched->pending[i].deadline, tc)){
+                sched->pending[i].earliest = sched->pending[i].deadline = tc;
+            }
+        }
+    }
+
+    uint16_t nq = 0;
+    uint8_t unicast_req = 0;
+
+    int32_t res = minimr_query_match(msg, msglen, qstats, nqstats, &nq, records, nrecords, index, &unicast_req, user_data);
+
+    if (unicast_requested != NULL){
+        *unicast_requested = unicast_req;
+    }
+
+    if (res != MINIMR_OK || unicast_req){
+        return res;
+    }
+
+    if (index != NULL){
+        records = index->records;
+    }
+
+    uint32_t shared = now + MINIMR_SCHEDULER_SHARED_DELAY_MIN + random % (MINIMR_SCHEDULER_SHARED_DELAY_MAX - MINIMR_SCHEDULER_SHARED_DELAY_MIN + 1);
+
+    res = MINIMR_OK;
+
+    for(uint16_t iq = 0; iq < nq; iq++){
+
+        if (qstats[iq].relevant == 0){
+            continue;
+        }
+
+        struct minimr_rr * rr = records[qstats[iq].match_i];
+
+        uint32_t earliest = now;
+        uint32_t deadline = now;
+
+        if (truncated){
+            earliest = deadline = tc;
+        } else if (MINIMR_RR_IS_SHARED(rr)){
+            earliest = now + MINIMR_SCHEDULER_SHARED_DELAY_MIN;
+            deadline = shared;
+        }
+
+        if (scheduler_add(sched, qstats[iq].match_i, qstats[iq].type, earliest, deadline, truncated) != MINIMR_OK){
+            res = MINIMR_NOT_OK;
+        }
+    }
+
+    return res;
+}
+
+void minimr_scheduler_response(
+        struct minimr_scheduler * sched,
+        uint8_t * msg, uint16_t msglen,
+        struct minimr_rr ** records, uint16_t nrecords,
+        void * user_data
+)
+{
+    MINIMR_ASSERT(sched != NULL);
+
+    sched->npending = minimr_duplicate_answer_suppress(sched->pending, sched->npending, msg, msglen, records, nrecords, user_data);
+}
+
+uint8_t minimr_scheduler_next_deadline(struct minimr_scheduler * sched, uint32_t * deadline)
+{
+    MINIMR_ASSERT(sched != NULL);
+    MINIMR_ASSERT(deadline != NULL);
+
+    if (sched->npending == 0){
+        return MINIMR_NOT_OK;
+    }
+
+    uint32_t d = sched->pending[0].deadline;
+
+    for(uint16_t i = 1; i < sched->npending; i++){
+        if (MINIMR_TIME_DUE(sched->pending[i].deadline, d)){
+            d = sched->pending[i].deadline;
+        }
+    }
+
+    *deadline = d;
+
+    return MINIMR_OK;
+}
+
+int32_t minimr_scheduler_msg(
+        struct minimr_scheduler * sched,
+        struct minimr_rr ** records, uint16_t nrecords,
+        uint32_t now,
+        uint8_t * outmsg, uint16_t * outmsglen, uint16_t outmsgmaxlen,
+        void * user_data
+)
+{
+    MINIMR_ASSERT(sched != NULL);
+    MINIMR_ASSERT(records != NULL);
+    MINIMR_ASSERT(outmsg != NULL);
+    MINIMR_ASSERT(outmsglen != NULL);
+
+    uint8_t due = 0;
+
+    for(uint16_t i = 0; i < sched->npending && due == 0; i++){
+        due = MINIMR_TIME_DUE(sched->pending[i].deadline, now);
+    }
+
+    if (due == 0){
+        return MINIMR_IGNORE;
+    }
+
+    if (outmsgmaxlen <= MINIMR_DNS_HDR_SIZE){
+        return MINIMR_DNS_HDR2_RCODE_SERVAIL;
+    }
+
+#if MINIMR_NAME_COMPRESSION_ENABLED == 1
+    struct minimr_name_dict dict_st;
+    struct minimr_name_dict * dict = &dict_st;
+    minimr_name_dict_init(dict);
+#else
+    struct minimr_name_dict * dict = NULL;
+#endif
+
+    uint16_t outlen = MINIMR_DNS_HDR_SIZE;
+    uint16_t nanswers = 0;
+    uint16_t nextrarr = 0;
+
+    int32_t res = MINIMR_OK;
+
+    // answers sent along are those past their minimum delay and due within the window
+    uint32_t until = now + sched->window;
+
+    // written answers are moved to the front, [0 .. nwritten)
+    uint16_t nwritten = 0;
+
+    for(uint16_t i = 0; i < sched->npending; i++){
+
+        struct minimr_pending_answer p = sched->pending[i];
+
+        if (!MINIMR_TIME_DUE(p.deadline, now) && !(MINIMR_TIME_DUE(p.earliest, now) && MINIMR_TIME_DUE(p.deadline, until))){
+            continue;
+        }
+
+        struct minimr_rr * rr = p.record < nrecords ? records[p.record] : NULL;
+
+        uint16_t nrr = 0;
+
+        if (rr != NULL){
+
+            struct minimr_query_stat qstat = {
+                .type = p.type,
+                .unicast_class = rr->cache_class & MINIMR_DNS_QCLASS,
+                .match_i = p.record,
+                .relevant = 1
+            };
+
+            uint16_t l = outlen;
+
+            //minimr_rr_fun_handler( minimquery_get_*, struct minimr_rr * rr, struct minimr_query_stat * qstat, uint8_t * outmsg, uint16_t * outlen, uint16_t outmsgmaxlen, uint16_t * nrr, void * user_data, struct minimr_name_dict * dict)
+            if (MINIMR_RR_OP_QUERY_GET_RR(rr, &qstat, outmsg, &l, outmsgmaxlen, &nrr, user_data, dict) != MINIMR_OK){
+
+                // remains pending for the next message - unless it does not even fit into an empty one
+                if (nanswers > 0){
+                    continue;
+                }
+                res = MINIMR_DNS_HDR2_RCODE_SERVAIL;
+                nrr = 0;
+            } else {
+                outlen = l;
+            }
+        }
+
+        nanswers += nrr;
+
+        // written (or dropped), shifting the skipped ones behind it to keep their order
+        for(uint16_t j = i; j > nwritten; j--){
+            sched->pending[j] = sched->pending[j - 1];
+        }
+        sched->pending[nwritten++] = p;
+
+        // report the dropped answer, the others remain pending for the next message
+        if (res != MINIMR_OK){
+            break;
+        }
+    }
+
+    // extra records of the written answers, as far as they fit
+    for(uint16_t i = 0; i < nwritten && res == MINIMR_OK; i++){
+
+        struct minimr_rr * rr = sched->pending[i].record < nrecords ? records[sched->pending[i].record] : NULL;
+
+        if (rr == NULL){
+            continue;
+        }
+
+        struct minimr_query_stat qstat = {
+            .type = sched->pending[i].type,
+            .unicast_class = rr->cache_class & MINIMR_DNS_QCLASS,
+            .match_i = sched->pending[i].record,
+            .relevant = 1
+        };
+
+        uint16_t nrr = 0;
+        uint16_t l = outlen;
+
+        //minimr_rr_fun_handler( minimquery_get_*, struct minimr_rr * rr, struct minimr_query_stat * qstat, uint8_t * outmsg, uint16_t * outlen, uint16_t outmsgmaxlen, uint16_t * nrr, void * user_data, struct minimr_name_dict * dict)
+        if (MINIMR_RR_OP_QUERY_GET_EXTRARR(rr, &qstat, outmsg, &l, outmsgmaxlen, &nrr, user_data, dict) == MINIMR_OK){
+            outlen = l;
+            nextrarr += nrr;
+        }
+    }
+
+    // remove written answers (preserving the order of the remaining)
+    for(uint16_t i = nwritten; i < sched->npending; i++){
+        sched->pending[i - nwritten] = sched->pending[i];
+    }
+    sched->npending -= nwritten;
+
+    if (res != MINIMR_OK){
+        return res;
+    }
+
+    if (nanswers == 0){
+        return MINIMR_IGNORE;
+    }
+
+    struct minimr_dns_hdr outhdr;
+
+    outhdr.transaction_id = 0;
+
+    outhdr.flags[0] = MINIMR_DNS_HDR1_QR_REPLY | MINIMR_DNS_HDR1_AA;
+    outhdr.flags[1] = MINIMR_DNS_HDR2_RCODE_NOERROR;
+
+    outhdr.nqueries = 0;
+    outhdr.nanswers = nanswers;
+    outhdr.nauthrr = 0;
+    outhdr.nextrarr = nextrarr;
+
+    minimr_dns_hdr_write(outmsg, &outhdr);
+
+    *outmsglen = outlen;
+
+    return MINIMR_OK;
+}
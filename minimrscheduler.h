@@ -0,0 +1,159 @@
+/**
+ * minimr - mini mDNS Responder (framework)
+ *
+ * https://github.com/tschiemer/minimr
+ *
+ * MIT License
+ *
+ * Copyright (c) 2020 Philip Tschiemer, filou.se
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef MINIMR_MINIMRSCHEDULER_H
+#define MINIMR_MINIMRSCHEDULER_H
+
+#include "minimr.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// random delay of answers of shared records (see https://tools.ietf.org/html/rfc6762#section-6 )
+#ifndef MINIMR_SCHEDULER_SHARED_DELAY_MIN
+#define MINIMR_SCHEDULER_SHARED_DELAY_MIN   20
+#endif
+
+#ifndef MINIMR_SCHEDULER_SHARED_DELAY_MAX
+#define MINIMR_SCHEDULER_SHARED_DELAY_MAX   120
+#endif
+
+// random delay of answers to truncated queries (more known answers follow)
+#ifndef MINIMR_SCHEDULER_TC_DELAY_MIN
+#define MINIMR_SCHEDULER_TC_DELAY_MIN       400
+#endif
+
+#ifndef MINIMR_SCHEDULER_TC_DELAY_MAX
+#define MINIMR_SCHEDULER_TC_DELAY_MAX       500
+#endif
+
+/**
+ * Response scheduler: queues (multicast) answers per record with deadlines and aggregates them into as few messages as
+ * possible (see https://tools.ietf.org/html/rfc6762#section-6 ).
+ *
+ * Answers of unique records are due at once, answers of shared records after a random delay of
+ * MINIMR_SCHEDULER_SHARED_DELAY_MIN - MAX msec, answers to truncated queries after MINIMR_SCHEDULER_TC_DELAY_MIN - MAX
+ * msec. A record is queued at most once (with the earliest deadline).
+ * Once an answer is due, all answers due within the aggregation window (and past their minimum delay) are sent along.
+ * Pending answers of shared records another responder sends in the meantime are canceled (@see
+ * minimr_duplicate_answer_suppress()), as are pending answers to truncated queries known to the querier according to
+ * the follow-up packets (passed to minimr_scheduler_query() like any query, @see minimr_known_answer_cancel()). As
+ * the source of queries is unknown to the scheduler, the known answers of any query cancel these.
+ *
+ * Pending answers refer to records by index, ie the scheduler is bound to one record set and must be cleared if the
+ * record set changes (except for records being appended).
+ * Time is given by the caller as (wrapping) msec timestamps, random numbers likewise.
+ * All memory is provided by the caller.
+ *
+ * Typical host loop:
+ *  - received query:       minimr_scheduler_query()
+ *  - received response:    minimr_scheduler_response()
+ *  - timer (@see minimr_scheduler_next_deadline()) expired: send minimr_scheduler_msg() until it returns MINIMR_IGNORE
+ */
+struct minimr_scheduler {
+    struct minimr_pending_answer * pending;
+    uint16_t npending;
+    uint16_t maxpending;
+
+    uint32_t window;
+};
+
+/**
+ * Initializes (empty) scheduler
+ * @param window    time (msec) answers may be sent ahead of their deadline to be aggregated
+ */
+void minimr_scheduler_init(struct minimr_scheduler * sched, struct minimr_pending_answer * pending, uint16_t maxpending, uint32_t window);
+
+/**
+ * Drops all pending answers
+ */
+void minimr_scheduler_clear(struct minimr_scheduler * sched);
+
+/**
+ * Queues answers to given query (after known answer suppression, @see minimr_query_match()) and cancels pending answers
+ * to truncated queries suppressed by its known answers (if yet more known answers follow, these are held off further)
+ * Questions asking for a unicast response are not answered by the scheduler (*unicast_requested is set), such queries
+ * are to be answered at once using minimr_query_response_msg().
+ * @param random    random number (for the delay)
+ * @return MINIMR_OK        if answers were queued (or a unicast response was requested)
+ * @return MINIMR_IGNORE    if there is nothing to answer
+ * @return MINIMR_NOT_OK    if not all answers could be queued (the queue is full)
+ * @return MINIMR_DNS_HDR2_RCODE_FORMERR or MINIMR_DNS_HDR2_RCODE_SERVAIL on failure
+ */
+int32_t minimr_scheduler_query(
+        struct minimr_scheduler * sched,
+        uint8_t * msg, uint16_t msglen,
+        struct minimr_query_stat qstats[], uint16_t nqstats,
+        struct minimr_rr ** records, uint16_t nrecords,
+        struct minimr_rr_index * index,
+        uint32_t now, uint32_t random,
+        uint8_t * unicast_requested,
+        void * user_data
+);
+
+/**
+ * Cancels pending answers which the given response (of another responder) contains already
+ * @see minimr_duplicate_answer_suppress()
+ */
+void minimr_scheduler_response(
+        struct minimr_scheduler * sched,
+        uint8_t * msg, uint16_t msglen,
+        struct minimr_rr ** records, uint16_t nrecords,
+        void * user_data
+);
+
+/**
+ * Gets the time the next answer is due (to be passed to the host's timer)
+ * @return MINIMR_OK        if there are pending answers
+ * @return MINIMR_NOT_OK    if not
+ */
+uint8_t minimr_scheduler_next_deadline(struct minimr_scheduler * sched, uint32_t * deadline);
+
+/**
+ * Generates response message with the answers due (and all answers which can be sent along) and their extra records
+ * Answers not fitting the message remain pending (due), ie call until MINIMR_IGNORE is returned.
+ * @return MINIMR_OK        if a message was generated
+ * @return MINIMR_IGNORE    if no answer is due
+ * @return MINIMR_DNS_HDR2_RCODE_SERVAIL if an answer could not be written (it is dropped and no message generated,
+ *                                       the remaining answers are left for the next call)
+ */
+int32_t minimr_scheduler_msg(
+        struct minimr_scheduler * sched,
+        struct minimr_rr ** records, uint16_t nrecords,
+        uint32_t now,
+        uint8_t * outmsg, uint16_t * outmsglen, uint16_t outmsgmaxlen,
+        void * user_data
+);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //MINIMR_MINIMRSCHEDULER_H
@@ -29,140 +29,57 @@
 #include "minimrsimple.h"
 #include "minimr.h"
 
-#if MINIMR_SIMPLE_INTERFACE_ENABLED == 1
-
+#include <stddef.h>
 
-#include <stdarg.h>
+#if MINIMR_SIMPLE_INTERFACE_ENABLED == 1
 
 static uint8_t simple_probe_rrhandler(struct minimr_dns_hdr * hdr, minimr_rr_section section, struct minimr_rr_stat * rstat, uint8_t * msg, uint16_t msglen, void * user_data);
-static int32_t simple_rr_handler(minimr_rr_fun type, struct minimr_rr *rr, ...);
-
-
-#if MINIMR_RR_TYPE_A_DEFAULT
-minimr_rr_a minimr_simple_rr_a = {
-    .cache_class = MINIMR_DNS_CLASS_IN,
-    .type = MINIMR_DNS_TYPE_A,
-    .ttl = MINIMR_DEFAULT_TTL,
-    .handler = simple_rr_handler,
-
-#ifdef MINIMR_SIMPLE_HOSTNAME
-    .name = MINIMR_SIMPLE_HOSTNAME
-#endif
-
-#ifdef MINIMR_SIMPLE_IPV4
-    .ipv4 = MINIMR_SIMPLE_IPV4
-#endif
-};
-#endif
-
-#if MINIMR_RR_TYPE_AAAA_DEFAULT
-minimr_rr_aaaa minimr_simple_rr_aaaa = {
-    .cache_class = MINIMR_DNS_CLASS_IN,
-    .type = MINIMR_DNS_TYPE_AAAA,
-    .ttl = MINIMR_DEFAULT_TTL,
-    .handler = simple_rr_handler,
-
-#ifdef MINIMR_SIMPLE_HOSTNAME
-    .name = MINIMR_SIMPLE_HOSTNAME
-#endif
-
-#ifdef MINIMR_SIMPLE_IPV6
-    .ipv6 = MINIMR_SIMPLE_IPV6
-#endif
-
-};
-#endif
-
-
-#if MINIMR_RR_TYPE_SRV_DEFAULT
-minimr_rr_srv minimr_simple_rr_srv = {
-    .cache_class = MINIMR_DNS_CLASS_IN,
-    .type = MINIMR_DNS_TYPE_SRV,
-    .ttl = MINIMR_DEFAULT_TTL,
-    .handler = simple_rr_handler,
-
-#ifdef MINIMR_SIMPLE_SERVICE_NAME
-    .name = MINIMR_SIMPLE_SERVICE_NAME,
-#endif
-
-#ifdef MINIMR_SIMPLE_SERVICE_WEIGHT
-    .weight = MINIMR_SIMPLE_SERVICE_WEIGHT,
-#else
-    .weight = 0,
-#endif
 
-#ifdef MINIMR_SIMPLE_SERVICE_PRIORITY
-    .priority = MINIMR_SIMPLE_SERVICE_PRIORITY,
-#else
-    .priority = 0,
-#endif
-
-#ifdef MINIMR_SIMPLE_SERVICE_PORT
-    .port = MINIMR_SIMPLE_SERVICE_PORT,
-#else
-    .port = 0,
-#endif
-
-#ifdef MINIMR_SIMPLE_HOSTNAME
-    .target = MINIMR_SIMPLE_HOSTNAME
-#endif
-};
-#endif
-
-#if MINIMR_RR_TYPE_TXT_DEFAULT
-minimr_rr_txt minimr_simple_rr_txt = {
-    .cache_class = MINIMR_DNS_CLASS_IN,
-    .type = MINIMR_DNS_TYPE_TXT,
-    .ttl = MINIMR_DEFAULT_TTL,
-    .handler = simple_rr_handler,
-
-#ifdef MINIMR_SIMPLE_SERVICE_NAME
-    .name = MINIMR_SIMPLE_SERVICE_NAME,
+#if MINIMR_TIMESTAMP_USE
+static int32_t simple_rr_query_respond_to(struct minimr_rr * rr, void * user_data);
 #endif
+static int32_t simple_rr_query_get_extra_rrs(struct minimr_rr * rr, struct minimr_query_stat * qstat, uint8_t * outmsg, uint16_t * outlen, uint16_t outmsgmaxlen, uint16_t * nrr, void * user_data, struct minimr_name_dict * dict);
 
-#ifdef MINIMR_SIMPLE_SERVICE_TXT
-    .txt = MINIMR_SIMPLE_SERVICE_TXT
+// note that by using the default get_rr for announcements all records will be in the answer section of the
+// announce message (and none will be passed in the extra RR section)
+static const struct minimr_rr_ops simple_rr_ops = {
+#if MINIMR_TIMESTAMP_USE
+    .query_respond_to = simple_rr_query_respond_to,
 #endif
-
+    .query_get_rr = minimr_default_rr_op_query_get_rr,
+    .query_get_extra_rrs = simple_rr_query_get_extra_rrs,
+    .get_rr = minimr_default_rr_op_get_rr,
+    .announce_get_rr = minimr_default_rr_op_get_rr,
 };
-#endif
-
 
-#if MINIMR_RR_TYPE_PTR_DEFAULT
-minimr_rr_ptr minimr_simple_rr_ptr = {
-    .cache_class = MINIMR_DNS_CLASS_IN,
-    .type = MINIMR_DNS_TYPE_PTR,
-    .ttl = MINIMR_DEFAULT_TTL,
-    .handler = simple_rr_handler,
+#define SIMPLE_CTX_OF(__rr__, __member__) ((struct minimr_simple_ctx *)((uint8_t *)(__rr__) - offsetof(struct minimr_simple_ctx, __member__)))
 
-#ifdef MINIMR_SIMPLE_SERVICE_PTR
-    .name = MINIMR_SIMPLE_SERVICE_PTR,
-#endif
-
-#ifdef MINIMR_SIMPLE_HOSTNAME
-    .domain = MINIMR_SIMPLE_HOSTNAME
-#endif
-
-};
-#endif
-
-struct minimr_rr * minimr_simple_rr_set[MINIMR_RR_TYPE_DEFAULT_COUNT] = {
+/**
+ * Context of one of its records (the records are embedded in the context, ie no back reference is needed)
+ */
+static struct minimr_simple_ctx * simple_ctx_of(struct minimr_rr * rr)
+{
+    switch(rr->type){
 #if MINIMR_RR_TYPE_A_DEFAULT
-        (struct minimr_rr *)&minimr_simple_rr_a,
+        case MINIMR_DNS_TYPE_A:     return SIMPLE_CTX_OF(rr, rr_a);
 #endif
 #if MINIMR_RR_TYPE_AAAA_DEFAULT
-        (struct minimr_rr *)&minimr_simple_rr_aaaa,
+        case MINIMR_DNS_TYPE_AAAA:  return SIMPLE_CTX_OF(rr, rr_aaaa);
 #endif
 #if MINIMR_RR_TYPE_SRV_DEFAULT
-        (struct minimr_rr *)&minimr_simple_rr_srv,
+        case MINIMR_DNS_TYPE_SRV:   return SIMPLE_CTX_OF(rr, rr_srv);
 #endif
 #if MINIMR_RR_TYPE_TXT_DEFAULT
-        (struct minimr_rr *)&minimr_simple_rr_txt,
+        case MINIMR_DNS_TYPE_TXT:   return SIMPLE_CTX_OF(rr, rr_txt);
 #endif
 #if MINIMR_RR_TYPE_PTR_DEFAULT
-        (struct minimr_rr *)&minimr_simple_rr_ptr,
+        case MINIMR_DNS_TYPE_PTR:   return SIMPLE_CTX_OF(rr, rr_ptr);
 #endif
-};
+        default:
+            MINIMR_ASSERT(0);
+            return NULL;
+    }
+}
 
 
 typedef struct {
@@ -178,150 +95,396 @@ typedef struct {
     simple_tie_t ties[MINIMR_RR_TYPE_DEFAULT_COUNT];
 } simple_tie_breaker_t;
 
-static volatile simple_state_t simple_state;
+simple_state_t minimr_simple_get_state(struct minimr_simple_ctx * ctx)
+{
+    return ctx->state;
+}
 
-static uint8_t simple_announcement_count;
-static uint8_t simple_probe_count;
+void * minimr_simple_get_user_data(struct minimr_simple_ctx * ctx)
+{
+    return ctx->cfg.user_data;
+}
 
-static struct minimr_simple_init_st simple_cfg;
+/**
+ * Begins update of records, ie readers started in the meantime will retry
+ */
+static void simple_write_begin(struct minimr_simple_ctx * ctx)
+{
+    ctx->seq++;
+    MINIMR_MEMORY_BARRIER();
+}
+
+/**
+ * Ends update of records (outdating the cached responses)
+ */
+static void simple_write_end(struct minimr_simple_ctx * ctx)
+{
+    minimr_response_cache_invalidate(&ctx->generation);
+    MINIMR_MEMORY_BARRIER();
+    ctx->seq++;
+}
+
+/**
+ * Begins reading records, returns sequence to be passed to simple_read_retry()
+ */
+static uint32_t simple_read_begin(struct minimr_simple_ctx * ctx)
+{
+    uint32_t seq = ctx->seq;
+    MINIMR_MEMORY_BARRIER();
+    return seq;
+}
+
+/**
+ * @return 1 if the records have been (or were being) updated since simple_read_begin(), ie the read must be repeated
+ */
+static uint8_t simple_read_retry(struct minimr_simple_ctx * ctx, uint32_t seq)
+{
+    MINIMR_MEMORY_BARRIER();
+    return (seq & 1) || seq != ctx->seq;
+}
+
+/**
+ * Updates the wire template and rdata digest of a changed record (within a write section)
+ * Instead of marking them outdated (as minimr_rr_changed()) they are computed at once, ie readers never compute them
+ * themselves (concurrently).
+ */
+static void simple_rr_changed(struct minimr_rr * rr)
+{
+#if MINIMR_RR_WIRE_TEMPLATE_USE == 1
+    minimr_default_rr_wire_update(rr);
+#endif
+#if MINIMR_RR_DIGEST_USE == 1
+    minimr_rr_digest_update(rr, NULL);
+#endif
+}
+
+/**
+ * Copies (NUL-terminated) src to dst of given size
+ */
+static uint8_t simple_strcpy(uint8_t * dst, uint16_t maxlen, uint8_t * src)
+{
+    if (src == NULL){
+        return MINIMR_NOT_OK;
+    }
+
+    uint16_t i = 0;
+
+    for(; src[i] != '\0'; i++){
+        if (i + 1 >= maxlen){
+            return MINIMR_NOT_OK;
+        }
+        dst[i] = src[i];
+    }
+    dst[i] = '\0';
+
+    return MINIMR_OK;
+}
+
+/**
+ * Copies and normalizes a name (formatted as .segment1.segment2. etc .tld)
+ */
+static uint8_t simple_name_init(uint8_t * dst, uint16_t maxlen, uint16_t * length, uint8_t * src)
+{
+    if (simple_strcpy(dst, maxlen, src) != MINIMR_OK || dst[0] != '.'){
+        return MINIMR_NOT_OK;
+    }
 
-simple_state_t minimr_simple_get_state()
+    minimr_name_normalize(dst, length);
+
+    return MINIMR_OK;
+}
+
+static void simple_rr_init(struct minimr_rr * rr, uint16_t type, uint8_t * wire, uint16_t wire_maxlen)
 {
-    return simple_state;
+    rr->type = type;
+    rr->cache_class = MINIMR_DNS_CLASS_IN;
+    rr->ttl = MINIMR_DEFAULT_TTL;
+    rr->ops = &simple_rr_ops;
+    rr->handler = minimr_rr_ops_handler;
+
+#if MINIMR_RR_WIRE_TEMPLATE_USE == 1
+    rr->wire = wire;
+    rr->wire_length = 0;
+    rr->wire_maxlen = wire_maxlen;
+#endif
 }
 
-void minimr_simple_set_ips(uint8_t * ipv4, uint16_t * ipv6)
+#if MINIMR_RR_WIRE_TEMPLATE_USE == 1
+#define SIMPLE_WIRE(__buf__) (__buf__), sizeof(__buf__)
+#else
+#define SIMPLE_WIRE(__buf__) NULL, 0
+#endif
+
+void minimr_simple_set_ips(struct minimr_simple_ctx * ctx, uint8_t * ipv4, uint16_t * ipv6)
 {
+    MINIMR_ASSERT(ctx != NULL);
+
+    simple_write_begin(ctx);
+
 #if MINIMR_RR_TYPE_A_DEFAULT
     if (ipv4 == NULL){
-        minimr_simple_rr_set[MINIMR_SIMPLE_A_INDEX] = NULL;
+        ctx->rr_set[MINIMR_SIMPLE_A_INDEX] = NULL;
     } else {
         // MINIMR_DEBUGF("setting A ipv4\n");
-        minimr_simple_rr_a.ipv4[0] = ipv4[0];
-        minimr_simple_rr_a.ipv4[1] = ipv4[1];
-        minimr_simple_rr_a.ipv4[2] = ipv4[2];
-        minimr_simple_rr_a.ipv4[3] = ipv4[3];
-        minimr_simple_rr_set[MINIMR_SIMPLE_A_INDEX] = (struct minimr_rr *)&minimr_simple_rr_a;
+        ctx->rr_a.ipv4[0] = ipv4[0];
+        ctx->rr_a.ipv4[1] = ipv4[1];
+        ctx->rr_a.ipv4[2] = ipv4[2];
+        ctx->rr_a.ipv4[3] = ipv4[3];
+        simple_rr_changed((struct minimr_rr *)&ctx->rr_a);
+        ctx->rr_set[MINIMR_SIMPLE_A_INDEX] = (struct minimr_rr *)&ctx->rr_a;
     }
 #endif
 
 #if MINIMR_RR_TYPE_AAAA_DEFAULT
     if (ipv6 == NULL){
-        minimr_simple_rr_set[MINIMR_SIMPLE_AAAA_INDEX] = NULL;
+        ctx->rr_set[MINIMR_SIMPLE_AAAA_INDEX] = NULL;
     } else {
         // MINIMR_DEBUGF("setting AAAA ipv6\n");
-        minimr_simple_rr_aaaa.ipv6[0] = ipv6[0];
-        minimr_simple_rr_aaaa.ipv6[1] = ipv6[1];
-        minimr_simple_rr_aaaa.ipv6[2] = ipv6[2];
-        minimr_simple_rr_aaaa.ipv6[3] = ipv6[3];
-        minimr_simple_rr_aaaa.ipv6[4] = ipv6[4];
-        minimr_simple_rr_aaaa.ipv6[5] = ipv6[5];
-        minimr_simple_rr_aaaa.ipv6[6] = ipv6[6];
-        minimr_simple_rr_aaaa.ipv6[7] = ipv6[7];
-        minimr_simple_rr_set[MINIMR_SIMPLE_AAAA_INDEX] = (struct minimr_rr *)&minimr_simple_rr_aaaa;
+        ctx->rr_aaaa.ipv6[0] = ipv6[0];
+        ctx->rr_aaaa.ipv6[1] = ipv6[1];
+        ctx->rr_aaaa.ipv6[2] = ipv6[2];
+        ctx->rr_aaaa.ipv6[3] = ipv6[3];
+        ctx->rr_aaaa.ipv6[4] = ipv6[4];
+        ctx->rr_aaaa.ipv6[5] = ipv6[5];
+        ctx->rr_aaaa.ipv6[6] = ipv6[6];
+        ctx->rr_aaaa.ipv6[7] = ipv6[7];
+        simple_rr_changed((struct minimr_rr *)&ctx->rr_aaaa);
+        ctx->rr_set[MINIMR_SIMPLE_AAAA_INDEX] = (struct minimr_rr *)&ctx->rr_aaaa;
     }
 #endif
+
+    simple_write_end(ctx);
+}
+
+#if MINIMR_RR_TYPE_SRV_DEFAULT
+void minimr_simple_set_srv(struct minimr_simple_ctx * ctx, uint16_t priority, uint16_t weight, uint16_t port)
+{
+    MINIMR_ASSERT(ctx != NULL);
+
+    simple_write_begin(ctx);
+
+    ctx->rr_srv.priority = priority;
+    ctx->rr_srv.weight = weight;
+    ctx->rr_srv.port = port;
+    simple_rr_changed((struct minimr_rr *)&ctx->rr_srv);
+
+    simple_write_end(ctx);
+}
+#endif
+
+#if MINIMR_RR_TYPE_TXT_DEFAULT
+uint8_t minimr_simple_set_txt(struct minimr_simple_ctx * ctx, uint8_t * txt)
+{
+    MINIMR_ASSERT(ctx != NULL);
+    MINIMR_ASSERT(txt != NULL);
+
+    // normalized beforehand to keep the update as short as possible
+    uint8_t field[sizeof(ctx->rr_txt.txt) + 1];
+    uint16_t length = 0;
+
+    if (txt[0] != MINIMR_SIMPLE_SERVICE_TXTMARKER || simple_strcpy(field, sizeof(field), txt) != MINIMR_OK){
+        return MINIMR_NOT_OK;
+    }
+
+    minimr_txt_normalize(field, &length, MINIMR_SIMPLE_SERVICE_TXTMARKER);
+
+    simple_write_begin(ctx);
+
+    for(uint16_t i = 0; i < length; i++){
+        ctx->rr_txt.txt[i] = field[i];
+    }
+    ctx->rr_txt.txt_length = length;
+    simple_rr_changed((struct minimr_rr *)&ctx->rr_txt);
+
+    simple_write_end(ctx);
+
+    return MINIMR_OK;
 }
+#endif
 
 
-void minimr_simple_init(struct minimr_simple_init_st * init_st)
+uint8_t minimr_simple_init(struct minimr_simple_ctx * ctx, struct minimr_simple_init_st * init_st)
 {
+    MINIMR_ASSERT(ctx != NULL);
     MINIMR_ASSERT(init_st != NULL);
     MINIMR_ASSERT(init_st->probe_or_not == 0 || init_st->probing_end_timer != NULL);
     MINIMR_ASSERT(init_st->probe_or_not == 0 || init_st->reconfiguration_needed != NULL);
     MINIMR_ASSERT(init_st->announcement_count <= 8);
     MINIMR_ASSERT(init_st->announcement_count < 2 || init_st->announcement_timer != NULL);
 
-    simple_cfg.state_changed = init_st->state_changed;
-    simple_cfg.processing_required = init_st->processing_required;
-
-    simple_cfg.probe_or_not = init_st->probe_or_not;
-    simple_cfg.probing_end_timer = init_st->probing_end_timer;
-    simple_cfg.reconfiguration_needed = init_st->reconfiguration_needed;
-
-    simple_cfg.announcement_count = init_st->announcement_count;
-    simple_cfg.announcement_timer = init_st->announcement_timer;
-
 #if MINIMR_TIMESTAMP_USE
     MINIMR_ASSERT(init_st->time_now != NULL);
     MINIMR_ASSERT(init_st->time_cpy != NULL);
     MINIMR_ASSERT(init_st->time_diff_sec != NULL);
-
-    simple_cfg.time_now = init_st->time_now;
-    simple_cfg.time_cpy = init_st->time_cpy;
-    simple_cfg.time_diff_sec = init_st->time_diff_sec;
 #endif //MINIMR_TIMESTAMP_USE
 
-    simple_state = simple_state_init;
+    for(uint32_t i = 0; i < sizeof(struct minimr_simple_ctx); i++){
+        ((uint8_t *)ctx)[i] = 0;
+    }
+
+    ctx->cfg = *init_st;
+
+    ctx->state = simple_state_init;
+
+    uint8_t * hostname = init_st->hostname;
+    uint8_t * service_name = init_st->service_name;
+    uint8_t * service_ptr = init_st->service_ptr;
+
+#ifdef MINIMR_SIMPLE_HOSTNAME
+    if (hostname == NULL){
+        hostname = (uint8_t *)MINIMR_SIMPLE_HOSTNAME;
+    }
+#endif
+#ifdef MINIMR_SIMPLE_SERVICE_NAME
+    if (service_name == NULL){
+        service_name = (uint8_t *)MINIMR_SIMPLE_SERVICE_NAME;
+    }
+#endif
+#ifdef MINIMR_SIMPLE_SERVICE_PTR
+    if (service_ptr == NULL){
+        service_ptr = (uint8_t *)MINIMR_SIMPLE_SERVICE_PTR;
+    }
+#endif
+
+    // (names of) unused records are not required
+    (void)service_name;
+    (void)service_ptr;
+
+    simple_write_begin(ctx);
 
 #if MINIMR_RR_TYPE_A_DEFAULT
-    minimr_name_normalize(minimr_simple_rr_a.name, &minimr_simple_rr_a.name_length);
+    simple_rr_init((struct minimr_rr *)&ctx->rr_a, MINIMR_DNS_TYPE_A, SIMPLE_WIRE(ctx->wire_a));
+    if (simple_name_init(ctx->rr_a.name, sizeof(ctx->rr_a.name), &ctx->rr_a.name_length, hostname) != MINIMR_OK){
+        simple_write_end(ctx);
+        return MINIMR_NOT_OK;
+    }
+#ifdef MINIMR_SIMPLE_IPV4
+    uint8_t ipv4[4] = MINIMR_SIMPLE_IPV4;
+    for(uint8_t i = 0; i < 4; i++){
+        ctx->rr_a.ipv4[i] = ipv4[i];
+    }
+#endif
+    simple_rr_changed((struct minimr_rr *)&ctx->rr_a);
+    ctx->rr_set[MINIMR_SIMPLE_A_INDEX] = (struct minimr_rr *)&ctx->rr_a;
 #endif
 #if MINIMR_RR_TYPE_AAAA_DEFAULT
-    minimr_name_normalize(minimr_simple_rr_aaaa.name, &minimr_simple_rr_aaaa.name_length);
+    simple_rr_init((struct minimr_rr *)&ctx->rr_aaaa, MINIMR_DNS_TYPE_AAAA, SIMPLE_WIRE(ctx->wire_aaaa));
+    if (simple_name_init(ctx->rr_aaaa.name, sizeof(ctx->rr_aaaa.name), &ctx->rr_aaaa.name_length, hostname) != MINIMR_OK){
+        simple_write_end(ctx);
+        return MINIMR_NOT_OK;
+    }
+#ifdef MINIMR_SIMPLE_IPV6
+    uint16_t ipv6[8] = MINIMR_SIMPLE_IPV6;
+    for(uint8_t i = 0; i < 8; i++){
+        ctx->rr_aaaa.ipv6[i] = ipv6[i];
+    }
+#endif
+    simple_rr_changed((struct minimr_rr *)&ctx->rr_aaaa);
+    ctx->rr_set[MINIMR_SIMPLE_AAAA_INDEX] = (struct minimr_rr *)&ctx->rr_aaaa;
 #endif
 #if MINIMR_RR_TYPE_SRV_DEFAULT
-    minimr_name_normalize(minimr_simple_rr_srv.name, &minimr_simple_rr_srv.name_length);
-    minimr_name_normalize(minimr_simple_rr_srv.target, &minimr_simple_rr_srv.target_length);
+    simple_rr_init((struct minimr_rr *)&ctx->rr_srv, MINIMR_DNS_TYPE_SRV, SIMPLE_WIRE(ctx->wire_srv));
+    if (simple_name_init(ctx->rr_srv.name, sizeof(ctx->rr_srv.name), &ctx->rr_srv.name_length, service_name) != MINIMR_OK ||
+        simple_name_init(ctx->rr_srv.target, sizeof(ctx->rr_srv.target), &ctx->rr_srv.target_length, hostname) != MINIMR_OK){
+        simple_write_end(ctx);
+        return MINIMR_NOT_OK;
+    }
+#ifdef MINIMR_SIMPLE_SERVICE_PRIORITY
+    ctx->rr_srv.priority = MINIMR_SIMPLE_SERVICE_PRIORITY;
+#endif
+#ifdef MINIMR_SIMPLE_SERVICE_WEIGHT
+    ctx->rr_srv.weight = MINIMR_SIMPLE_SERVICE_WEIGHT;
+#endif
+#ifdef MINIMR_SIMPLE_SERVICE_PORT
+    ctx->rr_srv.port = MINIMR_SIMPLE_SERVICE_PORT;
+#endif
+    simple_rr_changed((struct minimr_rr *)&ctx->rr_srv);
+    ctx->rr_set[MINIMR_SIMPLE_SRV_INDEX] = (struct minimr_rr *)&ctx->rr_srv;
 #endif
 #if MINIMR_RR_TYPE_TXT_DEFAULT
-    minimr_name_normalize(minimr_simple_rr_txt.name, &minimr_simple_rr_txt.name_length);
-    minimr_txt_normalize(minimr_simple_rr_txt.txt, &minimr_simple_rr_txt.txt_length, MINIMR_SIMPLE_SERVICE_TXTMARKER);
+    simple_rr_init((struct minimr_rr *)&ctx->rr_txt, MINIMR_DNS_TYPE_TXT, SIMPLE_WIRE(ctx->wire_txt));
+    if (simple_name_init(ctx->rr_txt.name, sizeof(ctx->rr_txt.name), &ctx->rr_txt.name_length, service_name) != MINIMR_OK){
+        simple_write_end(ctx);
+        return MINIMR_NOT_OK;
+    }
+#ifdef MINIMR_SIMPLE_SERVICE_TXT
+    if (simple_strcpy(ctx->rr_txt.txt, sizeof(ctx->rr_txt.txt), (uint8_t *)MINIMR_SIMPLE_SERVICE_TXT) != MINIMR_OK){
+        simple_write_end(ctx);
+        return MINIMR_NOT_OK;
+    }
+    minimr_txt_normalize(ctx->rr_txt.txt, &ctx->rr_txt.txt_length, MINIMR_SIMPLE_SERVICE_TXTMARKER);
+#endif
+    simple_rr_changed((struct minimr_rr *)&ctx->rr_txt);
+    ctx->rr_set[MINIMR_SIMPLE_TXT_INDEX] = (struct minimr_rr *)&ctx->rr_txt;
 #endif
 #if MINIMR_RR_TYPE_PTR_DEFAULT
-    minimr_name_normalize(minimr_simple_rr_ptr.name, &minimr_simple_rr_ptr.name_length);
-    minimr_name_normalize(minimr_simple_rr_ptr.domain, &minimr_simple_rr_ptr.domain_length);
+    simple_rr_init((struct minimr_rr *)&ctx->rr_ptr, MINIMR_DNS_TYPE_PTR, SIMPLE_WIRE(ctx->wire_ptr));
+    if (simple_name_init(ctx->rr_ptr.name, sizeof(ctx->rr_ptr.name), &ctx->rr_ptr.name_length, service_ptr) != MINIMR_OK ||
+        simple_name_init(ctx->rr_ptr.domain, sizeof(ctx->rr_ptr.domain), &ctx->rr_ptr.domain_length, hostname) != MINIMR_OK){
+        simple_write_end(ctx);
+        return MINIMR_NOT_OK;
+    }
+    simple_rr_changed((struct minimr_rr *)&ctx->rr_ptr);
+    ctx->rr_set[MINIMR_SIMPLE_PTR_INDEX] = (struct minimr_rr *)&ctx->rr_ptr;
 #endif
+
+    simple_write_end(ctx);
+
+    return MINIMR_OK;
 }
 
-void minimr_simple_start(uint16_t ttl)
+void minimr_simple_start(struct minimr_simple_ctx * ctx, uint16_t ttl)
 {
+    MINIMR_ASSERT(ctx != NULL);
+
     // only act when in init or stopped state
-    if (simple_state != simple_state_init && simple_state != simple_state_stopped){
+    if (ctx->state != simple_state_init && ctx->state != simple_state_stopped){
         return;
     }
 
     MINIMR_DEBUGF("minimrsimple: starting\n");
 
 #if MINIMR_RR_TYPE_A_DEFAULT
-    minimr_simple_rr_a.ttl = ttl;
+    ctx->rr_a.ttl = ttl;
 #endif
 #if MINIMR_RR_TYPE_AAAA_DEFAULT
-    minimr_simple_rr_aaaa.ttl = ttl;
+    ctx->rr_aaaa.ttl = ttl;
 #endif
 #if MINIMR_RR_TYPE_SRV_DEFAULT
-    minimr_simple_rr_srv.ttl = ttl;
+    ctx->rr_srv.ttl = ttl;
 #endif
 #if MINIMR_RR_TYPE_TXT_DEFAULT
-    minimr_simple_rr_txt.ttl = ttl;
+    ctx->rr_txt.ttl = ttl;
 #endif
 #if MINIMR_RR_TYPE_PTR_DEFAULT
-    minimr_simple_rr_ptr.ttl = ttl;
+    ctx->rr_ptr.ttl = ttl;
 #endif
 
-    if (simple_cfg.probe_or_not){
-        simple_state = simple_state_probe;
+    minimr_response_cache_invalidate(&ctx->generation);
+
+    if (ctx->cfg.probe_or_not){
+        ctx->state = simple_state_probe;
     } else {
-        simple_state = simple_state_announce;
+        ctx->state = simple_state_announce;
     }
 
-    if (simple_cfg.state_changed != NULL){
-        simple_cfg.state_changed(simple_state);
+    if (ctx->cfg.state_changed != NULL){
+        ctx->cfg.state_changed(ctx, ctx->state);
     }
 
-    if (simple_cfg.processing_required != NULL){
-        simple_cfg.processing_required();
+    if (ctx->cfg.processing_required != NULL){
+        ctx->cfg.processing_required(ctx);
     }
 }
 
-int32_t minimr_simple_stop(uint8_t *outmsg, uint16_t *outmsglen, uint16_t outmsgmaxlen)
+int32_t minimr_simple_stop(struct minimr_simple_ctx * ctx, uint8_t *outmsg, uint16_t *outmsglen, uint16_t outmsgmaxlen)
 {
-    simple_state_t before = simple_state;
+    simple_state_t before = ctx->state;
 
-    simple_state = simple_state_stopped;
+    ctx->state = simple_state_stopped;
 
-    if (simple_cfg.state_changed != NULL && before != simple_state_stopped){
-        simple_cfg.state_changed(simple_state_stopped);
+    if (ctx->cfg.state_changed != NULL && before != simple_state_stopped){
+        ctx->cfg.state_changed(ctx, simple_state_stopped);
     }
 
     if (outmsg == NULL || outmsgmaxlen == 0){
@@ -330,103 +493,103 @@ int32_t minimr_simple_stop(uint8_t *outmsg, uint16_t *outmsglen, uint16_t outmsg
 
     MINIMR_DEBUGF("minimrsimple: stopping\n");
 
-    return minimr_simple_terminate_msg(outmsg, outmsglen, outmsgmaxlen);
+    return minimr_simple_terminate_msg(ctx, outmsg, outmsglen, outmsgmaxlen);
 }
 
-void minimr_simple_probe(uint8_t * outmsg, uint16_t * outmsglen, uint16_t outmsgmaxlen)
+void minimr_simple_probe(struct minimr_simple_ctx * ctx, uint8_t * outmsg, uint16_t * outmsglen, uint16_t outmsgmaxlen)
 {
     // if not in the right state, do nothing
-    if (simple_state != simple_state_await_probe_response){
+    if (ctx->state != simple_state_await_probe_response){
         return;
     }
 
-    // MINIMR_DEBUGF("probe count = %d\n", simple_probe_count);
+    // MINIMR_DEBUGF("probe count = %d\n", ctx->probe_count);
 
     // after the third probe we're ok!
-    if (simple_probe_count >= 3){
+    if (ctx->probe_count >= 3){
 
         MINIMR_DEBUGF("minimrsimple: starting responding\n");
 
-        simple_state = simple_state_announce;
+        ctx->state = simple_state_announce;
 
-        if (simple_cfg.state_changed != NULL){
-            simple_cfg.state_changed(simple_state);
+        if (ctx->cfg.state_changed != NULL){
+            ctx->cfg.state_changed(ctx, ctx->state);
         }
 
-        if (simple_cfg.processing_required != NULL){
-            simple_cfg.processing_required();
+        if (ctx->cfg.processing_required != NULL){
+            ctx->cfg.processing_required(ctx);
         }
         return;
     }
 
     MINIMR_DEBUGF("minimrsimple: probing\n");
 
-    simple_probe_count++;
-    simple_cfg.probing_end_timer(MINIMR_DNS_PROBE_WAIT_MSEC);
+    ctx->probe_count++;
+    ctx->cfg.probing_end_timer(ctx, MINIMR_DNS_PROBE_WAIT_MSEC);
 
     // MINIMR_DEBUGF("reprobe!\n");
-    minimr_simple_probequery_msg(outmsg, outmsglen, outmsgmaxlen, 1);
+    minimr_simple_probequery_msg(ctx, outmsg, outmsglen, outmsgmaxlen, 1);
 }
 
-int32_t minimr_simple_announce(uint8_t *outmsg, uint16_t *outmsglen, uint16_t outmsgmaxlen)
+int32_t minimr_simple_announce(struct minimr_simple_ctx * ctx, uint8_t *outmsg, uint16_t *outmsglen, uint16_t outmsgmaxlen)
 {
     // cancel action if fsm was stopped
-    if (simple_state == simple_state_stopped){
+    if (ctx->state == simple_state_stopped){
         return MINIMR_ABORT;
     }
 
     // is there a way to set a timer for the next announcement?
-    if (simple_cfg.announcement_timer != NULL){
+    if (ctx->cfg.announcement_timer != NULL){
 
-        if (simple_announcement_count < simple_cfg.announcement_count){
+        if (ctx->announcement_count < ctx->cfg.announcement_count){
             // in fsm announcement count is initialized with 0
             // exponential increment in delay times
-            simple_cfg.announcement_timer(1 << simple_announcement_count);
+            ctx->cfg.announcement_timer(ctx, 1 << ctx->announcement_count);
 
-            simple_announcement_count++;
+            ctx->announcement_count++;
         }
 
     }
 
     MINIMR_DEBUGF("minimrsimple: announcing\n");
 
-    return minimr_simple_announce_msg(outmsg, outmsglen, outmsgmaxlen);
+    return minimr_simple_announce_msg(ctx, outmsg, outmsglen, outmsgmaxlen);
 }
 
-int32_t minimr_simple_fsm(uint8_t *msg, uint16_t msglen, uint8_t *outmsg, uint16_t *outmsglen, uint16_t outmsgmaxlen, uint8_t *unicast_requested)
+int32_t minimr_simple_fsm(struct minimr_simple_ctx * ctx, uint8_t *msg, uint16_t msglen, uint8_t *outmsg, uint16_t *outmsglen, uint16_t outmsgmaxlen, uint8_t *unicast_requested)
 {
-    if (simple_state == simple_state_init){
+    if (ctx->state == simple_state_init){
         // wait for explicit start command
         return MINIMR_OK;
     }
 
-    if (simple_state == simple_state_stopped){
+    if (ctx->state == simple_state_stopped){
         // wait for explicit (re-)start command
         return MINIMR_OK;
     }
 
-    if (simple_state == simple_state_probe){
+    if (ctx->state == simple_state_probe){
 
-        int32_t res = minimr_simple_probequery_msg(outmsg, outmsglen, outmsgmaxlen, 0); // 0 -> no unicast requested
+        int32_t res = minimr_simple_probequery_msg(ctx, outmsg, outmsglen, outmsgmaxlen, 0); // 0 -> no unicast requested
 
         if (res != MINIMR_OK){
             MINIMR_DEBUGF("initial probe query failed, stopping!\n");
-            simple_state = simple_state_stopped;
+            ctx->state = simple_state_stopped;
         } else {
-            simple_state = simple_state_await_probe_response;
+            ctx->state = simple_state_await_probe_response;
 
-            simple_probe_count = 1;
-            simple_cfg.probing_end_timer(MINIMR_DNS_PROBE_WAIT_MSEC);
+            ctx->probe_count = 1;
+            ctx->cfg.probing_end_timer(ctx, MINIMR_DNS_PROBE_WAIT_MSEC);
         }
 
-        if (simple_cfg.state_changed != NULL){
-            simple_cfg.state_changed(simple_state);
+        if (ctx->cfg.state_changed != NULL){
+            ctx->cfg.state_changed(ctx, ctx->state);
         }
 
         return res;
     }
 
-    if (simple_state == simple_state_await_probe_response){
+    if (ctx->state == simple_state_await_probe_response){
 
         if (msg != NULL && msglen > 0){
             struct minimr_filter filters[2];
@@ -438,23 +601,23 @@ int32_t minimr_simple_fsm(uint8_t *msg, uint16_t msglen, uint8_t *outmsg, uint16
 
             }
 #if MINIMR_RR_TYPE_A_DEFAULT
-            else if (minimr_simple_rr_set[MINIMR_SIMPLE_A_INDEX] != NULL){
-                filters[0].name = minimr_simple_rr_a.name;
-                filters[0].name_length = minimr_simple_rr_a.name_length;
+            else if (ctx->rr_set[MINIMR_SIMPLE_A_INDEX] != NULL){
+                filters[0].name = ctx->rr_a.name;
+                filters[0].name_length = ctx->rr_a.name_length;
             }
 #endif
 #if MINIMR_RR_TYPE_AAAA_DEFAULT
-            else if (minimr_simple_rr_set[MINIMR_SIMPLE_AAAA_INDEX] != NULL){
-                filters[0].name = minimr_simple_rr_aaaa.name;
-                filters[0].name_length = minimr_simple_rr_aaaa.name_length;
+            else if (ctx->rr_set[MINIMR_SIMPLE_AAAA_INDEX] != NULL){
+                filters[0].name = ctx->rr_aaaa.name;
+                filters[0].name_length = ctx->rr_aaaa.name_length;
             }
 #endif
             else {
                 MINIMR_DEBUGF("No valid A/AAAA set through set_ips(..) - stopping!\n");
-                simple_state = simple_state_stopped;
+                ctx->state = simple_state_stopped;
 
-                if (simple_cfg.state_changed != NULL){
-                    simple_cfg.state_changed(simple_state);
+                if (ctx->cfg.state_changed != NULL){
+                    ctx->cfg.state_changed(ctx, ctx->state);
                 }
 
                 return MINIMR_NOT_OK;
@@ -466,16 +629,16 @@ int32_t minimr_simple_fsm(uint8_t *msg, uint16_t msglen, uint8_t *outmsg, uint16
             filters[1].type = MINIMR_DNS_TYPE_ANY;
 
 #if MINIMR_RR_TYPE_SRV_DEFAULT
-            filters[1].name = minimr_simple_rr_srv.name;
-            filters[1].name_length = minimr_simple_rr_srv.name_length;
+            filters[1].name = ctx->rr_srv.name;
+            filters[1].name_length = ctx->rr_srv.name_length;
             nfilters++;
 #elif MINIMR_RR_TYPE_TXT_DEFAULT
-            filters[1].name = minimr_simple_rr_txt.name;
-            filters[1].name_length = minimr_simple_rr_txt.name_length;
+            filters[1].name = ctx->rr_txt.name;
+            filters[1].name_length = ctx->rr_txt.name_length;
             nfilters++;
 #endif
 
-            int32_t res = minimr_parse_msg(msg, msglen, minimr_msgtype_any, NULL, NULL, 0, simple_probe_rrhandler, filters, nfilters, NULL);
+            int32_t res = minimr_parse_msg(msg, msglen, minimr_msgtype_any, NULL, NULL, 0, simple_probe_rrhandler, filters, nfilters, ctx);
 
             if (res != MINIMR_OK){
                 // MINIMR_DEBUGF("parse failed %d\n", res);
@@ -485,31 +648,31 @@ int32_t minimr_simple_fsm(uint8_t *msg, uint16_t msglen, uint8_t *outmsg, uint16
         }
     }
 
-    if (simple_state == simple_state_announce){
+    if (ctx->state == simple_state_announce){
 
         MINIMR_DEBUGF("minimrsimple: starting announcements\n");
 
-        simple_announcement_count = 0;
+        ctx->announcement_count = 0;
 
-        int32_t res = minimr_simple_announce(outmsg, outmsglen, outmsgmaxlen);
+        int32_t res = minimr_simple_announce(ctx, outmsg, outmsglen, outmsgmaxlen);
 
         if (res != MINIMR_OK){
             MINIMR_DEBUGF("initial announcement failed, stopping!\n");
-            simple_state = simple_state_stopped;
+            ctx->state = simple_state_stopped;
         } else {
-            simple_state = simple_state_responding;
+            ctx->state = simple_state_responding;
         }
 
-        if (simple_cfg.state_changed != NULL){
-            simple_cfg.state_changed(simple_state);
+        if (ctx->cfg.state_changed != NULL){
+            ctx->cfg.state_changed(ctx, ctx->state);
         }
 
         return res;
     }
 
-    if (simple_state == simple_state_responding){
+    if (ctx->state == simple_state_responding){
         if (msg != NULL && msglen > 0){
-            return minimr_simple_query_response_msg(msg, msglen, outmsg, outmsglen, outmsgmaxlen, unicast_requested);
+            return minimr_simple_query_response_msg(ctx, msg, msglen, outmsg, outmsglen, outmsgmaxlen, unicast_requested);
         }
 
         return MINIMR_OK;
@@ -519,6 +682,7 @@ int32_t minimr_simple_fsm(uint8_t *msg, uint16_t msglen, uint8_t *outmsg, uint16
 }
 
 int32_t minimr_simple_probequery_msg(
+        struct minimr_simple_ctx * ctx,
         uint8_t *outmsg, uint16_t *outmsglen, uint16_t outmsgmaxlen,
         uint8_t request_unicast
 )
@@ -531,13 +695,13 @@ int32_t minimr_simple_probequery_msg(
     }
 #if MINIMR_RR_TYPE_A_DEFAULT
     // check if
-    else if (minimr_simple_rr_set[MINIMR_SIMPLE_A_INDEX] != NULL){
-        hostname = minimr_simple_rr_a.name;
+    else if (ctx->rr_set[MINIMR_SIMPLE_A_INDEX] != NULL){
+        hostname = ctx->rr_a.name;
     }
 #endif
 #if MINIMR_RR_TYPE_AAAA_DEFAULT
-    else if (minimr_simple_rr_set[MINIMR_SIMPLE_AAAA_INDEX] != NULL){
-        hostname = minimr_simple_rr_aaaa.name;
+    else if (ctx->rr_set[MINIMR_SIMPLE_AAAA_INDEX] != NULL){
+        hostname = ctx->rr_aaaa.name;
     }
     #endif
     else {
@@ -547,44 +711,77 @@ int32_t minimr_simple_probequery_msg(
 
     // only probe for servicename if it has been defined.
 #if MINIMR_RR_TYPE_SRV_DEFAULT
-    servicename = minimr_simple_rr_srv.name;
+    servicename = ctx->rr_srv.name;
 #elif MINIMR_RR_TYPE_TXT_DEFAULT
-    servicename = minimr_simple_rr_txt.name;
+    servicename = ctx->rr_txt.name;
 #endif
 
 
 // #if MINIMR_RR_TYPE_PTR_DEFAULT
 //     // do not add PTR record to probequery
-//     void * ptr = minimr_simple_rr_set[MINIMR_SIMPLE_PTR_INDEX];
-//     minimr_simple_rr_set[MINIMR_SIMPLE_PTR_INDEX] = NULL;
+//     void * ptr = ctx->rr_set[MINIMR_SIMPLE_PTR_INDEX];
+//     ctx->rr_set[MINIMR_SIMPLE_PTR_INDEX] = NULL;
 // #endif
 
-    int32_t res = minimr_probequery_msg(hostname, servicename, minimr_simple_rr_set, MINIMR_RR_TYPE_DEFAULT_COUNT, outmsg, outmsglen, outmsgmaxlen, request_unicast,  NULL);
+    uint16_t len = *outmsglen;
+    uint32_t seq;
+    int32_t res;
+
+    do {
+        seq = simple_read_begin(ctx);
+        *outmsglen = len;
+        res = minimr_probequery_msg(hostname, servicename, ctx->rr_set, MINIMR_RR_TYPE_DEFAULT_COUNT, outmsg, outmsglen, outmsgmaxlen, request_unicast,  NULL);
+    } while (simple_read_retry(ctx, seq));
 
 
 // #if MINIMR_RR_TYPE_PTR_DEFAULT
 //     // restore previous state
-//     minimr_simple_rr_set[MINIMR_SIMPLE_PTR_INDEX] = ptr;
+//     ctx->rr_set[MINIMR_SIMPLE_PTR_INDEX] = ptr;
 // #endif
 
     return res;
 }
 
 int32_t minimr_simple_announce_msg(
+        struct minimr_simple_ctx * ctx,
         uint8_t *outmsg, uint16_t *outmsglen, uint16_t outmsgmaxlen
 )
 {
-    return minimr_announce_msg(minimr_simple_rr_set, MINIMR_RR_TYPE_DEFAULT_COUNT, outmsg, outmsglen, outmsgmaxlen, NULL);
+    uint16_t len = *outmsglen;
+    uint32_t seq;
+    int32_t res;
+
+    do {
+        seq = simple_read_begin(ctx);
+        *outmsglen = len;
+        res = minimr_announce_msg(ctx->rr_set, MINIMR_RR_TYPE_DEFAULT_COUNT, outmsg, outmsglen, outmsgmaxlen, NULL);
+    } while (simple_read_retry(ctx, seq));
+
+    return res;
 }
 
 int32_t minimr_simple_terminate_msg(
+        struct minimr_simple_ctx * ctx,
         uint8_t *outmsg, uint16_t *outmsglen, uint16_t outmsgmaxlen
 )
 {
-    return minimr_terminate_msg(minimr_simple_rr_set, MINIMR_RR_TYPE_DEFAULT_COUNT, outmsg, outmsglen, outmsgmaxlen, NULL);
+    uint16_t len = *outmsglen;
+    uint32_t seq;
+    int32_t res;
+
+    minimr_response_cache_invalidate(&ctx->generation);
+
+    do {
+        seq = simple_read_begin(ctx);
+        *outmsglen = len;
+        res = minimr_terminate_msg(ctx->rr_set, MINIMR_RR_TYPE_DEFAULT_COUNT, outmsg, outmsglen, outmsgmaxlen, NULL);
+    } while (simple_read_retry(ctx, seq));
+
+    return res;
 }
 
 int32_t minimr_simple_query_response_msg(
+        struct minimr_simple_ctx * ctx,
         uint8_t *msg, uint16_t msglen,
         uint8_t *outmsg, uint16_t *outmsglen, uint16_t outmsgmaxlen,
         uint8_t *unicast_requested
@@ -593,30 +790,43 @@ int32_t minimr_simple_query_response_msg(
 
     struct minimr_query_stat qstats[MINIMR_RR_TYPE_DEFAULT_COUNT];
 
-    return minimr_query_response_msg(
-        msg, msglen,
-        qstats, MINIMR_RR_TYPE_DEFAULT_COUNT,
-        minimr_simple_rr_set, MINIMR_RR_TYPE_DEFAULT_COUNT,
-        outmsg, outmsglen, outmsgmaxlen,
-        unicast_requested,
-        NULL
-    );
+    uint16_t len = *outmsglen;
+    uint32_t seq;
+    int32_t res;
+
+    // a response built while the records were being updated is discarded (and rebuilt)
+    do {
+        seq = simple_read_begin(ctx);
+        *outmsglen = len;
+        res = minimr_query_response_msg(
+            msg, msglen,
+            qstats, MINIMR_RR_TYPE_DEFAULT_COUNT,
+            ctx->rr_set, MINIMR_RR_TYPE_DEFAULT_COUNT,
+            outmsg, outmsglen, outmsgmaxlen,
+            unicast_requested,
+            NULL
+        );
+    } while (simple_read_retry(ctx, seq));
+
+    return res;
 }
 
 uint8_t simple_probe_rrhandler(struct minimr_dns_hdr * hdr, minimr_rr_section section, struct minimr_rr_stat * rstat, uint8_t * msg, uint16_t msglen, void * user_data)
-{   
+{
+    struct minimr_simple_ctx * ctx = user_data;
+
     // in case another (authorative) host is responding to our probequery we already pretty much lost
     if ((hdr->flags[0] & MINIMR_DNS_HDR1_QR) == MINIMR_DNS_HDR1_QR_REPLY){
 
         // only care about authorative responses
         if ( (hdr->flags[0] & MINIMR_DNS_HDR1_AA) == MINIMR_DNS_HDR1_AA){
 
-            simple_state = simple_state_stopped;
+            ctx->state = simple_state_stopped;
 
-            simple_cfg.reconfiguration_needed();
+            ctx->cfg.reconfiguration_needed(ctx);
 
-            if (simple_cfg.state_changed != NULL){
-                simple_cfg.state_changed(simple_state);
+            if (ctx->cfg.state_changed != NULL){
+                ctx->cfg.state_changed(ctx, ctx->state);
             }
 
             return MINIMR_ABORT;
@@ -630,238 +840,104 @@ uint8_t simple_probe_rrhandler(struct minimr_dns_hdr * hdr, minimr_rr_section se
     //but (because actual tiebreaking as specified by the RFC is beyond this framework) instead we just tell the host
     //to reconfigure..
 
-    simple_state = simple_state_stopped;
+    ctx->state = simple_state_stopped;
 
-    simple_cfg.reconfiguration_needed();
+    ctx->cfg.reconfiguration_needed(ctx);
 
     return MINIMR_ABORT;
 }
 
-int32_t simple_rr_handler(minimr_rr_fun fun, struct minimr_rr *rr, ...)
+#if MINIMR_TIMESTAMP_USE
+int32_t simple_rr_query_respond_to(struct minimr_rr * rr, void * user_data)
 {
-    MINIMR_ASSERT(MINIMR_RR_FUN_IS_VALID(fun));
-
-    va_list args;
-    va_start(args, rr);
-
-    struct minimr_query_stat * qstat;
-    uint8_t * outmsg;
-    uint16_t * outmsglen;
-    uint16_t outmsgmaxlen;
-    uint16_t * nrr;
-    uint8_t unicast_requested;
-    void * user_data;
-
-    //
-    uint16_t rclass;
-    uint16_t rtype;
-    uint8_t * rdata;
-    uint16_t rdlength;
-
-    switch(fun){
-
+    struct minimr_simple_ctx * ctx = simple_ctx_of(rr);
 
-        //minimr_rr_fun_handler( minimquery_get_*, struct minimr_rr * rr, struct minimr_query_stat * qstat, uint8_t * outmsg, uint16_t * outlen, uint16_t outmsgmaxlen, uint16_t * nrr, void * user_data)
-        case minimr_rr_fun_query_get_rr:
-        case minimr_rr_fun_query_get_authority_rrs:
-        case minimr_rr_fun_query_get_extra_rrs:
-            qstat = (struct minimr_query_stat *)va_arg(args, void*);
-            // INTENDED FALL THROUGH
+    MINIMR_TIMESTAMP_TYPE now;
+    ctx->cfg.time_now(&now);
 
-        //minimr_rr_fun_handler( minimr_rr_fun_get_rr, struct minimr_rr * rr,  uint8_t * outmsg, uint16_t * outlen, uint16_t outmsgmaxlen, uint16_t * nrr, void * user_data)
-        //minimr_rr_fun_handler( minimr_rr_fun_announce_get_*, uint8_t * outmsg, uint16_t * outlen, uint16_t outmsgmaxlen, uint16_t * nrr, void * user_data)
-        case minimr_rr_fun_get_rr:
-        case minimr_rr_fun_announce_get_rr:
-        case minimr_rr_fun_announce_get_extra_rrs:
-            outmsg = va_arg(args, uint8_t *);
-            outmsglen = va_arg(args, uint16_t *);
-            outmsgmaxlen = va_arg(args, int); // uint16_t will be promoted to int
-            nrr = va_arg(args, uint16_t *);
-            // INTENDED FALL THROUGH
-
-        // minimr_rr_fun_handler( minimr_rr_fun_query_respond_to, struct minimr_rr * rr, void * user_data);
-        case minimr_rr_fun_query_respond_to:
-            user_data = va_arg(args, void*);
-            break;
-
-
-        case minimr_rr_fun_lexcmp:
-            rclass = va_arg(args, int32_t);
-            rtype = va_arg(args, int32_t);
-            rdata = va_arg(args, uint8_t*);
-            rdlength = va_arg(args, int32_t);
-            user_data = va_arg(args, void*);
-            break;
+    // if already answered within the last second, then don't answer
+    if (ctx->cfg.time_diff_sec(&rr->last_responded, &now) > 1){
+        return MINIMR_DO_NOT_RESPOND;
     }
 
-    va_end(args);
+    ctx->cfg.time_cpy(&rr->last_responded, &now);
 
+    return MINIMR_RESPOND;
+}
+#endif
 
-    if (fun == minimr_rr_fun_query_respond_to){
+int32_t simple_rr_query_get_extra_rrs(struct minimr_rr * rr, struct minimr_query_stat * qstat, uint8_t * outmsg, uint16_t * outlen, uint16_t outmsgmaxlen, uint16_t * nrr, void * user_data, struct minimr_name_dict * dict)
+{
+    struct minimr_simple_ctx * ctx = simple_ctx_of(rr);
 
-#if MINIMR_TIMESTAMP_USE
-        MINIMR_TIMESTAMP_TYPE now;
-        simple_cfg.time_now(&now);
+    uint16_t n = 0;
 
-        // if already answered within the last second, then don't answer
-        if (simple_cfg.time_diff_sec(&rr->last_responded, &now) > 1){
-            return MINIMR_DO_NOT_RESPOND;
-        }
+    // all extra records are written at once (or not at all)
+    uint16_t l = *outlen;
 
-        simple_cfg.time_cpy(&rr->last_responded, &now);
-#endif
-
-        return MINIMR_RESPOND;
+#if MINIMR_RR_TYPE_A_DEFAULT && MINIMR_RR_TYPE_AAAA_DEFAULT
+    // if type A was queried but we also have an AAAA type (which is set) add the AAAA record as extra
+    if (rr->type == MINIMR_DNS_TYPE_A && qstat->type == MINIMR_DNS_TYPE_A && ctx->rr_set[MINIMR_SIMPLE_AAAA_INDEX] != NULL){
+        if (minimr_default_rr_write((struct minimr_rr *)&ctx->rr_aaaa, outmsg, &l, outmsgmaxlen, dict) != MINIMR_OK) goto extra_failed;
+        n++;
     }
+    // and vice versa
+    if (rr->type == MINIMR_DNS_TYPE_AAAA && qstat->type == MINIMR_DNS_TYPE_AAAA && ctx->rr_set[MINIMR_SIMPLE_A_INDEX] != NULL){
+        if (minimr_default_rr_write((struct minimr_rr *)&ctx->rr_a, outmsg, &l, outmsgmaxlen, dict) != MINIMR_OK) goto extra_failed;
+        n++;
+    }
+#endif //MINIMR_RR_TYPE_A_DEFAULT && MINIMR_RR_TYPE_AAAA_DEFAULT
 
-    // combining the three function types is safe only because we do not use qstat here
-    // note that by treating announce_get_rr identical to get_rr all records will be in the answer section of the
-    // announce message (and none will be passed in th extra RR section; see below)
-    if (fun == minimr_rr_fun_query_get_rr || fun == minimr_rr_fun_get_rr || fun == minimr_rr_fun_announce_get_rr){
-
-        if ( 0
-
-#if MINIMR_RR_TYPE_A_DEFAULT
-             || (rr->type == MINIMR_DNS_TYPE_A && outmsgmaxlen < MINIMR_DNS_RR_A_SIZE(rr->name_length))
-#endif
-#if MINIMR_RR_TYPE_AAAA_DEFAULT
-             || (rr->type == MINIMR_DNS_TYPE_AAAA && outmsgmaxlen < MINIMR_DNS_RR_AAAA_SIZE(rr->name_length))
-#endif
 #if MINIMR_RR_TYPE_PTR_DEFAULT
-             || (rr->type == MINIMR_DNS_TYPE_PTR && outmsgmaxlen < MINIMR_DNS_RR_PTR_SIZE(rr->name_length, ((minimr_rr_ptr*)rr)->domain_length))
-#endif
+    // if type == PTR then the query was for unknown services (ie PTRs)
+    if (rr->type == MINIMR_DNS_TYPE_PTR){
+
+        // this only works because we the actual records are referencable
 #if MINIMR_RR_TYPE_SRV_DEFAULT
-             || (rr->type == MINIMR_DNS_TYPE_SRV && outmsgmaxlen < MINIMR_DNS_RR_SRV_SIZE(rr->name_length, ((minimr_rr_srv*)rr)->target_length))
+        if (ctx->rr_set[MINIMR_SIMPLE_SRV_INDEX] != NULL){
+            if (minimr_default_rr_write((struct minimr_rr *)&ctx->rr_srv, outmsg, &l, outmsgmaxlen, dict) != MINIMR_OK) goto extra_failed;
+            n++;
+        }
 #endif
 #if MINIMR_RR_TYPE_TXT_DEFAULT
-             || (rr->type == MINIMR_DNS_TYPE_TXT && outmsgmaxlen < MINIMR_DNS_RR_TXT_SIZE(rr->name_length, ((minimr_rr_txt*)rr)->txt_length))
-#endif
-                ) {
-
-            return MINIMR_NOT_OK;
-        }
-
-        uint16_t l = *outmsglen;
-
-        // our macro always sets the cache flush flag
-        MINIMR_DNS_RR_WRITE_COMMON(outmsg, l, rr->name, rr->name_length, rr->type, rr->cache_class, rr->ttl);
-
-        if (0){
-            // :)
+        if (ctx->rr_set[MINIMR_SIMPLE_TXT_INDEX] != NULL) {
+            if (minimr_default_rr_write((struct minimr_rr *)&ctx->rr_txt, outmsg, &l, outmsgmaxlen, dict) != MINIMR_OK) goto extra_failed;
+            n++;
         }
+#endif
 #if MINIMR_RR_TYPE_A_DEFAULT
-        else if (rr->type == MINIMR_DNS_TYPE_A) {
-            MINIMR_DNS_RR_WRITE_A_BODY(outmsg, l, ((minimr_rr_a*)rr)->ipv4);
+        // only pass A record if set
+        if (ctx->rr_set[MINIMR_SIMPLE_A_INDEX] != NULL){
+            if (minimr_default_rr_write((struct minimr_rr *)&ctx->rr_a, outmsg, &l, outmsgmaxlen, dict) != MINIMR_OK) goto extra_failed;
+            n++;
         }
 #endif
 #if MINIMR_RR_TYPE_AAAA_DEFAULT
-        else if (rr->type == MINIMR_DNS_TYPE_AAAA) {
-            MINIMR_DNS_RR_WRITE_A_BODY(outmsg, l, ((minimr_rr_aaaa*)rr)->ipv6);
-        }
-#endif
-#if MINIMR_RR_TYPE_PTR_DEFAULT
-        else if (rr->type == MINIMR_DNS_TYPE_PTR) {
-            MINIMR_DNS_RR_WRITE_PTR_BODY(outmsg, l, ((minimr_rr_ptr*)rr)->domain, ((minimr_rr_ptr*)rr)->domain_length);
-        }
-#endif
-#if MINIMR_RR_TYPE_SRV_DEFAULT
-        else if (rr->type == MINIMR_DNS_TYPE_SRV) {
-            MINIMR_DNS_RR_WRITE_SRV_BODY(outmsg, l, ((minimr_rr_srv*)rr)->priority, ((minimr_rr_srv*)rr)->weight, ((minimr_rr_srv*)rr)->port, ((minimr_rr_srv*)rr)->target, ((minimr_rr_srv*)rr)->target_length);
-        }
-#endif
-#if MINIMR_RR_TYPE_TXT_DEFAULT
-        else if (rr->type == MINIMR_DNS_TYPE_TXT) {
-            MINIMR_DNS_RR_WRITE_TXT_BODY(outmsg, l, ((minimr_rr_txt*)rr)->txt, ((minimr_rr_txt*)rr)->txt_length);
+        // only pass AAAA record if set
+        if (ctx->rr_set[MINIMR_SIMPLE_AAAA_INDEX] != NULL){
+            if (minimr_default_rr_write((struct minimr_rr *)&ctx->rr_aaaa, outmsg, &l, outmsgmaxlen, dict) != MINIMR_OK) goto extra_failed;
+            n++;
         }
 #endif
-        else {
-            MINIMR_DEBUGF("Unrecognized record type: %d", rr->type);
-            return MINIMR_NOT_OK;
-        }
-
-        *outmsglen = l;
-        if (nrr != NULL){
-            *nrr = 1;
-        }
-
-        return MINIMR_OK;
     }
+#endif //MINIMR_RR_TYPE_PTR_DEFAULT
 
-    if (fun == minimr_rr_fun_query_get_authority_rrs){
-
-        // no auth to add
+    *outlen = l;
 
-        return MINIMR_OK;
+    if (nrr != NULL){
+        *nrr = n;
     }
 
-    // combining these two function types i
-    if (fun == minimr_rr_fun_query_get_extra_rrs){
-
-        uint16_t n = 0;
-
-#if MINIMR_RR_TYPE_A_DEFAULT && MINIMR_RR_TYPE_AAAA_DEFAULT
-        // if type A was queried but we also have an AAAA type (which is set) add the AAAA record as extra
-        if (rr->type == MINIMR_DNS_TYPE_A && qstat->type == MINIMR_DNS_TYPE_AAAA && minimr_simple_rr_set[MINIMR_SIMPLE_A_INDEX] != NULL){
-            if (simple_rr_handler(minimr_rr_fun_get_rr, (struct minimr_rr *)&minimr_simple_rr_aaaa, qstat, outmsg, outmsglen, outmsgmaxlen, NULL) != MINIMR_OK) return MINIMR_NOT_OK;
-            n++;
-        }
-        // and vice versa
-        if (rr->type == MINIMR_DNS_TYPE_AAAA && qstat->type == MINIMR_DNS_TYPE_A && minimr_simple_rr_set[MINIMR_SIMPLE_AAAA_INDEX] != NULL){
-            if (simple_rr_handler(minimr_rr_fun_get_rr, (struct minimr_rr *)&minimr_simple_rr_a, qstat, outmsg, outmsglen, outmsgmaxlen, NULL) != MINIMR_OK) return MINIMR_NOT_OK;
-            n++;
-        }
-#endif //MINIMR_RR_TYPE_A_DEFAULT && MINIMR_RR_TYPE_AAAA_DEFAULT
-
-#if MINIMR_RR_TYPE_PTR_DEFAULT
-        // if type == PTR then the query was for unknown services (ie PTRs)
-        if (rr->type == MINIMR_DNS_TYPE_PTR){
-
-            // this only works because we the actual records are referencable
-#if MINIMR_RR_TYPE_A_DEFAULT
-            // only pass A record if set
-            if (minimr_simple_rr_set[MINIMR_SIMPLE_A_INDEX] != NULL){
-                if (simple_rr_handler(minimr_rr_fun_get_rr, (struct minimr_rr *)&minimr_simple_rr_a, qstat, outmsg, outmsglen, outmsgmaxlen, NULL) != MINIMR_OK) return MINIMR_NOT_OK;
-                n++;
-            }
-#endif
-#if MINIMR_RR_TYPE_AAAA_DEFAULT
-            // only pass AAAA record if set
-            if (minimr_simple_rr_set[MINIMR_SIMPLE_AAAA_INDEX] != NULL){
-                if (simple_rr_handler(minimr_rr_fun_get_rr, (struct minimr_rr *)&minimr_simple_rr_aaaa, qstat, outmsg, outmsglen, outmsgmaxlen, NULL) != MINIMR_OK) return MINIMR_NOT_OK;
-                n++;
-            }
-#endif
-#if MINIMR_RR_TYPE_SRV_DEFAULT
-            if (minimr_simple_rr_set[MINIMR_SIMPLE_SRV_INDEX] != NULL){
-                if (simple_rr_handler(minimr_rr_fun_get_rr, (struct minimr_rr *)&minimr_simple_rr_srv, qstat, outmsg, outmsglen, outmsgmaxlen, NULL) != MINIMR_OK) return MINIMR_NOT_OK;
-                n++;
-            }
-#endif
-#if MINIMR_RR_TYPE_TXT_DEFAULT
-            if (minimr_simple_rr_set[MINIMR_SIMPLE_TXT_INDEX] != NULL) {
-                if (simple_rr_handler(minimr_rr_fun_get_rr, (struct minimr_rr *) &minimr_simple_rr_txt, qstat, outmsg,
-                                      outmsglen, outmsgmaxlen, NULL) != MINIMR_OK)
-                    return MINIMR_NOT_OK;
-                n++;
-            }
-#endif
-        }
-#endif //MINIMR_RR_TYPE_PTR_DEFAULT
-
+    return MINIMR_OK;
 
-        if (nrr != NULL){
-            *nrr = n;
-        }
+extra_failed:
+    minimr_name_dict_truncate(dict, *outlen);
 
-        return MINIMR_OK;
-    }
+    return MINIMR_NOT_OK;
+}
 
-    if (fun == minimr_rr_fun_announce_get_extra_rrs){
-        // do nothing (note: to keep things simple all announcement records will be in the normal answer section and not in the extra RR section; see above)
-        return MINIMR_OK;
-    }
 
-    // lexcmp is not used but the code will be left here for reference
+// lexcmp is not used but the code will be left here for reference (would be simple_rr_ops.lexcmp)
 //    if (fun == minimr_rr_fun_lexcmp){
 //
 //
@@ -984,9 +1060,6 @@ int32_t simple_rr_handler(minimr_rr_fun fun, struct minimr_rr *rr, ...)
 //        return 0;
 //    }
 
-    return MINIMR_OK; // ...
-}
-
 
 
 #endif //#if MINIMR_SIMPLE_INTERFACE_ENABLED == 1
\ No newline at end of file
@@ -43,34 +43,25 @@ extern "C" {
 #endif
 
 #if MINIMR_RR_TYPE_A_DEFAULT
-extern minimr_rr_a minimr_simple_rr_a;
 #define MINIMR_SIMPLE_A_INDEX 0
 #endif
 
 #if MINIMR_RR_TYPE_AAAA_DEFAULT
-extern minimr_rr_aaaa minimr_simple_rr_aaaa;
 #define MINIMR_SIMPLE_AAAA_INDEX MINIMR_RR_TYPE_A_DEFAULT
 #endif
 
 #if MINIMR_RR_TYPE_SRV_DEFAULT
-extern minimr_rr_srv minimr_simple_rr_srv;
 #define MINIMR_SIMPLE_SRV_INDEX (MINIMR_RR_TYPE_A_DEFAULT + MINIMR_RR_TYPE_AAAA_DEFAULT)
 #endif
 
 #if MINIMR_RR_TYPE_TXT_DEFAULT
-extern minimr_rr_txt minimr_simple_rr_txt;
 #define MINIMR_SIMPLE_TXT_INDEX (MINIMR_RR_TYPE_A_DEFAULT + MINIMR_RR_TYPE_AAAA_DEFAULT + MINIMR_RR_TYPE_SRV_DEFAULT)
 #endif
 
 #if MINIMR_RR_TYPE_PTR_DEFAULT
-extern minimr_rr_ptr minimr_simple_rr_ptr;
 #define MINIMR_SIMPLE_PTR_INDEX (MINIMR_RR_TYPE_A_DEFAULT + MINIMR_RR_TYPE_AAAA_DEFAULT + MINIMR_RR_TYPE_SRV_DEFAULT + MINIMR_RR_TYPE_TXT_DEFAULT)
 #endif
 
-extern struct minimr_rr * minimr_simple_rr_set[MINIMR_RR_TYPE_DEFAULT_COUNT];
-
-void minimr_simple_set_ips(uint8_t * ipv4, uint16_t * ipv6);
-
 
 /************* Simple State Machine ******************/
 
@@ -83,7 +74,7 @@ typedef enum {
     simple_state_stopped
 } simple_state_t;
 
-simple_state_t minimr_simple_get_state();
+struct minimr_simple_ctx;
 
 struct minimr_simple_init_st {
 
@@ -91,12 +82,12 @@ struct minimr_simple_init_st {
      * Called by FSM, when minimr_simple_fsm() should be called to drive internal state processing.
      * Optional. If not given you are expected to call minimr_siple_fsm() regularly.
      */
-    void (*processing_required)();
+    void (*processing_required)(struct minimr_simple_ctx * ctx);
 
     /**
      * Optional callback for status changes.
      */
-    void (*state_changed)(simple_state_t state);
+    void (*state_changed)(struct minimr_simple_ctx * ctx, simple_state_t state);
 
     /**
      * If false (no probing) the records are assumed to be unique. There will be no probing phase.
@@ -107,14 +98,14 @@ struct minimr_simple_init_st {
     /**
      * called when minimr_simple_reprobe_callback() is to be called
      */
-    void (*probing_end_timer)(uint16_t msec);
+    void (*probing_end_timer)(struct minimr_simple_ctx * ctx, uint16_t msec);
 
     /**
      * Notification to host that there is a name conflict and reconfiguration is needed.
      * After reconfiguration by host, a call to minimr_simple_start() is required; the fsm will not process any
      * incoming messages.
      */
-    void (*reconfiguration_needed)();
+    void (*reconfiguration_needed)(struct minimr_simple_ctx * ctx);
 
     /**
      * Number of desired announcements
@@ -129,7 +120,7 @@ struct minimr_simple_init_st {
     /**
      * Host is requested to call minimr_simple_announce(..) in given number of seconds
      */
-    void (*announcement_timer)(uint16_t sec); // called when an announcement in <sec> seconds is requested
+    void (*announcement_timer)(struct minimr_simple_ctx * ctx, uint16_t sec); // called when an announcement in <sec> seconds is requested
 
 
 #if MINIMR_TIMESTAMP_USE
@@ -137,62 +128,172 @@ struct minimr_simple_init_st {
     void (*time_cpy)(MINIMR_TIMESTAMP_TYPE* dst, MINIMR_TIMESTAMP_TYPE* src);
     int (*time_diff_sec)(MINIMR_TIMESTAMP_TYPE* before, MINIMR_TIMESTAMP_TYPE* after);
 #endif //MINIMR_TIMESTAMP_USE
+
+    /**
+     * Names of the responder (formatted as .segment1.segment2. etc .tld), copied during initialization.
+     * Optional. If NULL MINIMR_SIMPLE_HOSTNAME, MINIMR_SIMPLE_SERVICE_NAME and MINIMR_SIMPLE_SERVICE_PTR are used.
+     */
+    uint8_t * hostname;
+    uint8_t * service_name;
+    uint8_t * service_ptr;
+
+    /**
+     * Optional host data, see minimr_simple_get_user_data()
+     */
+    void * user_data;
+};
+
+/**
+ * Responder instance, ie its records and the state of its FSM.
+ * Allocated by the host (any number of instances, they are independent of each other), to be initialized through
+ * minimr_simple_init(). Members are private to minimrsimple except for the record set (rr_set) which may be passed to
+ * the message generators of the framework.
+ */
+struct minimr_simple_ctx {
+
+#if MINIMR_RR_TYPE_A_DEFAULT
+    minimr_rr_a rr_a;
+#endif
+#if MINIMR_RR_TYPE_AAAA_DEFAULT
+    minimr_rr_aaaa rr_aaaa;
+#endif
+#if MINIMR_RR_TYPE_SRV_DEFAULT
+    minimr_rr_srv rr_srv;
+#endif
+#if MINIMR_RR_TYPE_TXT_DEFAULT
+    minimr_rr_txt rr_txt;
+#endif
+#if MINIMR_RR_TYPE_PTR_DEFAULT
+    minimr_rr_ptr rr_ptr;
+#endif
+
+    // active records (A/AAAA are NULL unless set through minimr_simple_set_ips())
+    struct minimr_rr * rr_set[MINIMR_RR_TYPE_DEFAULT_COUNT];
+
+#if MINIMR_RR_WIRE_TEMPLATE_USE == 1
+    // TYPE(2) CLASS(2) TTL(4) RDLENGTH(2) RDATA
+#if MINIMR_RR_TYPE_A_DEFAULT
+    uint8_t wire_a[10 + 4];
+#endif
+#if MINIMR_RR_TYPE_AAAA_DEFAULT
+    uint8_t wire_aaaa[10 + 16];
+#endif
+#if MINIMR_RR_TYPE_SRV_DEFAULT
+    uint8_t wire_srv[10 + 6 + MINIMR_RR_TYPE_SRV_DEFAULT_TARGETLEN];
+#endif
+#if MINIMR_RR_TYPE_TXT_DEFAULT
+    uint8_t wire_txt[10 + MINIMR_RR_TYPE_TXT_DEFAULT_TXTLEN];
+#endif
+#if MINIMR_RR_TYPE_PTR_DEFAULT
+    uint8_t wire_ptr[10 + MINIMR_RR_TYPE_PTR_DEFAULT_DOMAINLEN];
+#endif
+#endif //MINIMR_RR_WIRE_TEMPLATE_USE == 1
+
+    volatile simple_state_t state;
+
+    uint8_t announcement_count;
+    uint8_t probe_count;
+
+    // sequence counter of record updates (odd while an update is in progress)
+    volatile uint32_t seq;
+
+    // generation of the record set (to bind response caches to, @see minimr_response_cache_init())
+    volatile uint32_t generation;
+
+    struct minimr_simple_init_st cfg;
 };
 
 /**
  * Initialize FSM
  * FSM will be in initialization state and will not process any input until minimr_simple_start() is called.
+ * @return MINIMR_OK        on success
+ * @return MINIMR_NOT_OK    if a name is missing or does not fit into the records
+ */
+uint8_t minimr_simple_init(struct minimr_simple_ctx * ctx, struct minimr_simple_init_st * init_st);
+
+simple_state_t minimr_simple_get_state(struct minimr_simple_ctx * ctx);
+
+void * minimr_simple_get_user_data(struct minimr_simple_ctx * ctx);
+
+/**
+ * Record updates (set_ips, set_srv, set_txt) are published through a seqlock: messages generated by the simple interface
+ * (responses, announcements, ..) concurrently to an update are discarded and regenerated, ie readers never block nor
+ * see a half-written record.
+ * NOTE updates MUST NOT be called concurrently (single writer per context). On single core systems where the response
+ * path may preempt an update (ex. interrupt context), updates must be done with preemption disabled.
+ * NOTE the response cache (if enabled) is not thread-safe.
+ */
+void minimr_simple_set_ips(struct minimr_simple_ctx * ctx, uint8_t * ipv4, uint16_t * ipv6);
+
+#if MINIMR_RR_TYPE_SRV_DEFAULT
+/**
+ * Updates the SRV record's priority, weight and port (target stays unchanged)
  */
-void minimr_simple_init(struct minimr_simple_init_st * init_st);
+void minimr_simple_set_srv(struct minimr_simple_ctx * ctx, uint16_t priority, uint16_t weight, uint16_t port);
+#endif
+
+#if MINIMR_RR_TYPE_TXT_DEFAULT
+/**
+ * Updates the TXT record, txt must be formatted as MINIMR_SIMPLE_SERVICE_TXT (ie using MINIMR_SIMPLE_SERVICE_TXTMARKER)
+ * @return MINIMR_OK        on success
+ * @return MINIMR_NOT_OK    if txt is too long or not formatted accordingly (the TXT record stays unchanged)
+ */
+uint8_t minimr_simple_set_txt(struct minimr_simple_ctx * ctx, uint8_t * txt);
+#endif
 
 /**
  * Start FSM
  *
  * IMPORTANT Always call with a random (startup) delay uniformly distributed between 0 - 250 ms. (see https://tools.ietf.org/html/rfc6762#section-8.1 )
  */
-void minimr_simple_start(uint16_t ttl);
+void minimr_simple_start(struct minimr_simple_ctx * ctx, uint16_t ttl);
 
 /**
  * To be called by host when the probing end timer has been triggered.
  */
-void minimr_simple_probe(uint8_t * outmsg, uint16_t * outmsglen, uint16_t outmsgmaxlen);
+void minimr_simple_probe(struct minimr_simple_ctx * ctx, uint8_t * outmsg, uint16_t * outmsglen, uint16_t outmsgmaxlen);
 
 /**
  * To be called by host when the announcement timer has been triggered.
  */
-int32_t minimr_simple_announce(uint8_t *outmsg, uint16_t *outmsglen, uint16_t outmsgmaxlen);
+int32_t minimr_simple_announce(struct minimr_simple_ctx * ctx, uint8_t *outmsg, uint16_t *outmsglen, uint16_t outmsgmaxlen);
 
 /**
  * Can be called arbitrarily by host to stop FSM and to (optionally) generate a RR invalidation message.
  * If outmsg == NULL || outmsgmaxlen == 0 no message is generated (other hosts might assume that the host is still valid)
  */
-int32_t minimr_simple_stop(uint8_t *outmsg, uint16_t *outmsglen, uint16_t outmsgmaxlen);
+int32_t minimr_simple_stop(struct minimr_simple_ctx * ctx, uint8_t *outmsg, uint16_t *outmsglen, uint16_t outmsgmaxlen);
 
 
 /**
  * Core of FSM to be called either when inbound mDNS messages arrive (passed as msg, msglen) or when a state change occurs.
  * Can also be called in an infinite loop.
+ * With multiple instances sharing a socket, each inbound message is to be passed to each instance.
  */
-int32_t minimr_simple_fsm(uint8_t *msg, uint16_t msglen, uint8_t *outmsg, uint16_t *outmsglen, uint16_t outmsgmaxlen, uint8_t *unicast_requested);
+int32_t minimr_simple_fsm(struct minimr_simple_ctx * ctx, uint8_t *msg, uint16_t msglen, uint8_t *outmsg, uint16_t *outmsglen, uint16_t outmsgmaxlen, uint8_t *unicast_requested);
 
 
 /************* Standalone functions (also called by FSM) ******************/
 // if you don't want to use the above state machine, you can also use them directly
 
 int32_t minimr_simple_probequery_msg(
+        struct minimr_simple_ctx * ctx,
         uint8_t *outmsg, uint16_t *outmsglen, uint16_t outmsgmaxlen,
         uint8_t request_unicast
 );
 
 int32_t minimr_simple_announce_msg(
+        struct minimr_simple_ctx * ctx,
         uint8_t *outmsg, uint16_t *outmsglen, uint16_t outmsgmaxlen
 );
 
 int32_t minimr_simple_terminate_msg(
+        struct minimr_simple_ctx * ctx,
         uint8_t *outmsg, uint16_t *outmsglen, uint16_t outmsgmaxlen
 );
 
 int32_t minimr_simple_query_response_msg(
+        struct minimr_simple_ctx * ctx,
         uint8_t *msg, uint16_t msglen,
         uint8_t *outmsg, uint16_t *outmsglen, uint16_t outmsgmaxlen,
         uint8_t *unicast_requested
@@ -0,0 +1,273 @@
+/**
+ * minimr - mini mDNS Responder (framework)
+ *
+ * https://github.com/tschiemer/minimr
+ *
+ * MIT License
+ *
+ * Copyright (c) 2020 Philip Tschiemer, filou.se
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "minimrwheel.h"
+
+#define WHEEL_MASK          (MINIMR_WHEEL_NSLOTS - 1)
+
+// ticks (relative to the current tick) timers of a level reach
+#define WHEEL_REACH(level)  ((uint32_t)1 << (MINIMR_WHEEL_BITS * (level)))
+
+#define WHEEL_TICK_TIME(t)  ((uint32_t)(t) << MINIMR_WHEEL_TICK_SHIFT)
+
+void minimr_wheel_init(struct minimr_wheel * wheel, struct minimr_wheel_timer * timers, uint16_t ntimers, uint32_t now)
+{
+    MINIMR_ASSERT(wheel != NULL);
+    MINIMR_ASSERT(ntimers == 0 || timers != NULL);
+    MINIMR_ASSERT(ntimers < MINIMR_WHEEL_NONE);
+
+    wheel->timers = timers;
+    wheel->ntimers = ntimers;
+    wheel->tick = now >> MINIMR_WHEEL_TICK_SHIFT;
+
+    minimr_wheel_clear(wheel);
+}
+
+void minimr_wheel_clear(struct minimr_wheel * wheel)
+{
+    MINIMR_ASSERT(wheel != NULL);
+
+    for(uint16_t i = 0; i < wheel->ntimers; i++){
+        wheel->timers[i].list = MINIMR_WHEEL_NONE;
+    }
+
+    for(uint16_t i = 0; i <= MINIMR_WHEEL_EXPIRED; i++){
+        wheel->lists[i] = MINIMR_WHEEL_NONE;
+    }
+
+    wheel->npending = 0;
+}
+
+static void wheel_link(struct minimr_wheel * wheel, uint16_t i, uint16_t list)
+{
+    struct minimr_wheel_timer * timer = &wheel->timers[i];
+
+    timer->list = list;
+    timer->prev = MINIMR_WHEEL_NONE;
+    timer->next = wheel->lists[list];
+
+    if (timer->next != MINIMR_WHEEL_NONE){
+        wheel->timers[timer->next].prev = i;
+    }
+
+    wheel->lists[list] = i;
+}
+
+static void wheel_unlink(struct minimr_wheel * wheel, uint16_t i)
+{
+    struct minimr_wheel_timer * timer = &wheel->timers[i];
+
+    if (timer->prev == MINIMR_WHEEL_NONE){
+        wheel->lists[timer->list] = timer->next;
+    } else {
+        wheel->timers[timer->prev].next = timer->next;
+    }
+
+    if (timer->next != MINIMR_WHEEL_NONE){
+        wheel->timers[timer->next].prev = timer->prev;
+    }
+
+    timer->list = MINIMR_WHEEL_NONE;
+}
+
+/**
+ * Links timer into the slot of its tick of expiry (relative to the current tick)
+ */
+static void wheel_place(struct minimr_wheel * wheel, uint16_t i)
+{
+    int32_t d = (int32_t)(wheel->timers[i].deadline - WHEEL_TICK_TIME(wheel->tick));
+
+    // rounded up, such that timers never expire early (timers due expire with the current tick)
+    uint32_t ticks = d <= 0 ? 0 : ((uint32_t)d + WHEEL_TICK_TIME(1) - 1) >> MINIMR_WHEEL_TICK_SHIFT;
+
+    if (ticks >= WHEEL_REACH(MINIMR_WHEEL_LEVELS)){
+        ticks = WHEEL_REACH(MINIMR_WHEEL_LEVELS) - 1;
+    }
+
+    uint8_t level = 0;
+    while(level < MINIMR_WHEEL_LEVELS - 1 && ticks >= WHEEL_REACH(level + 1)){
+        level++;
+    }
+
+    uint32_t t = wheel->tick + ticks;
+
+    wheel_link(wheel, i, level * MINIMR_WHEEL_NSLOTS + ((t >> (level * MINIMR_WHEEL_BITS)) & WHEEL_MASK));
+
+    wheel->npending++;
+}
+
+void minimr_wheel_add(struct minimr_wheel * wheel, uint16_t i, uint32_t deadline)
+{
+    MINIMR_ASSERT(wheel != NULL);
+    MINIMR_ASSERT(i < wheel->ntimers);
+
+    minimr_wheel_cancel(wheel, i);
+
+    wheel->timers[i].deadline = deadline;
+
+    wheel_place(wheel, i);
+}
+
+void minimr_wheel_cancel(struct minimr_wheel * wheel, uint16_t i)
+{
+    MINIMR_ASSERT(wheel != NULL);
+    MINIMR_ASSERT(i < wheel->ntimers);
+
+    uint16_t list = wheel->timers[i].list;
+
+    if (list == MINIMR_WHEEL_NONE){
+        return;
+    }
+
+    wheel_unlink(wheel, i);
+
+    if (list != MINIMR_WHEEL_EXPIRED){
+        wheel->npending--;
+    }
+}
+
+uint8_t minimr_wheel_next_deadline(struct minimr_wheel * wheel, uint32_t * deadline)
+{
+    MINIMR_ASSERT(wheel != NULL);
+    MINIMR_ASSERT(deadline != NULL);
+
+    // expired timers not yet handled
+    if (wheel->lists[MINIMR_WHEEL_EXPIRED] != MINIMR_WHEEL_NONE){
+        *deadline = WHEEL_TICK_TIME(wheel->tick - 1);
+        return MINIMR_OK;
+    }
+
+    if (wheel->npending == 0){
+        return MINIMR_NOT_OK;
+    }
+
+    uint8_t found = 0;
+    uint32_t best = 0;
+
+    // first non-empty slot per level, slots of higher levels are due once they are cascaded
+    for(uint8_t level = 0; level < MINIMR_WHEEL_LEVELS; level++){
+
+        uint32_t base = wheel->tick >> (level * MINIMR_WHEEL_BITS);
+
+        // the current slot of a higher level holds timers of the next round (unless it is cascaded with the current tick)
+        uint32_t k0 = (level == 0 || (wheel->tick & (WHEEL_REACH(level) - 1)) == 0) ? 0 : 1;
+
+        for(uint32_t k = k0; k < k0 + MINIMR_WHEEL_NSLOTS; k++){
+
+            if (wheel->lists[level * MINIMR_WHEEL_NSLOTS + ((base + k) & WHEEL_MASK)] == MINIMR_WHEEL_NONE) continue;
+
+            uint32_t t = (base + k) << (level * MINIMR_WHEEL_BITS);
+
+            if (!found || (int32_t)(t - best) < 0){
+                best = t;
+                found = 1;
+            }
+            break;
+        }
+    }
+
+    *deadline = WHEEL_TICK_TIME(best);
+
+    return MINIMR_OK;
+}
+
+/**
+ * Moves timers of a slot to lower levels (or expired list)
+ */
+static void wheel_cascade(struct minimr_wheel * wheel, uint16_t list)
+{
+    uint16_t i = wheel->lists[list];
+
+    wheel->lists[list] = MINIMR_WHEEL_NONE;
+
+    while(i != MINIMR_WHEEL_NONE){
+        uint16_t next = wheel->timers[i].next;
+
+        wheel->npending--;
+
+        wheel_place(wheel, i);
+
+        i = next;
+    }
+}
+
+/**
+ * Processes the current tick: cascades slots of higher levels (once per round of the level below) and moves the
+ * timers of the current slot to the expired list
+ */
+static void wheel_tick(struct minimr_wheel * wheel)
+{
+    uint32_t t = wheel->tick;
+
+    for(uint8_t level = 1; level < MINIMR_WHEEL_LEVELS && (t & (WHEEL_REACH(level) - 1)) == 0; level++){
+        wheel_cascade(wheel, level * MINIMR_WHEEL_NSLOTS + ((t >> (level * MINIMR_WHEEL_BITS)) & WHEEL_MASK));
+    }
+
+    uint16_t list = t & WHEEL_MASK;
+    uint16_t i = wheel->lists[list];
+
+    wheel->lists[list] = MINIMR_WHEEL_NONE;
+
+    while(i != MINIMR_WHEEL_NONE){
+        uint16_t next = wheel->timers[i].next;
+
+        wheel->npending--;
+
+        wheel_link(wheel, i, MINIMR_WHEEL_EXPIRED);
+
+        i = next;
+    }
+
+    wheel->tick++;
+}
+
+uint16_t minimr_wheel_next(struct minimr_wheel * wheel, uint32_t now)
+{
+    MINIMR_ASSERT(wheel != NULL);
+
+    while(wheel->lists[MINIMR_WHEEL_EXPIRED] == MINIMR_WHEEL_NONE && (int32_t)(now - WHEEL_TICK_TIME(wheel->tick)) >= 0){
+
+        // nothing to cascade or expire, skip ahead
+        if (wheel->npending == 0){
+            wheel->tick += ((now - WHEEL_TICK_TIME(wheel->tick)) >> MINIMR_WHEEL_TICK_SHIFT) + 1;
+            break;
+        }
+
+        wheel_tick(wheel);
+    }
+
+    uint16_t i = wheel->lists[MINIMR_WHEEL_EXPIRED];
+
+    if (i == MINIMR_WHEEL_NONE){
+        return MINIMR_WHEEL_NONE;
+    }
+
+    wheel_unlink(wheel, i);
+
+    return i;
+}
@@ -0,0 +1,139 @@
+/**
+ * minimr - mini mDNS Responder (framework)
+ *
+ * https://github.com/tschiemer/minimr
+ *
+ * MIT License
+ *
+ * Copyright (c) 2020 Philip Tschiemer, filou.se
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef MINIMR_MINIMRWHEEL_H
+#define MINIMR_MINIMRWHEEL_H
+
+#include "minimr.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// tick length (2^shift msec), timers expire at most one tick late (never early)
+#ifndef MINIMR_WHEEL_TICK_SHIFT
+#define MINIMR_WHEEL_TICK_SHIFT     7
+#endif
+
+// slots per level (2^bits) and levels, ie timers reach (2^bits)^levels ticks (default ~24 days) ahead
+#ifndef MINIMR_WHEEL_BITS
+#define MINIMR_WHEEL_BITS           6
+#endif
+
+#ifndef MINIMR_WHEEL_LEVELS
+#define MINIMR_WHEEL_LEVELS         4
+#endif
+
+// invalid timer (ex. end of list)
+#define MINIMR_WHEEL_NONE           0xffff
+
+#define MINIMR_WHEEL_NSLOTS         (1 << MINIMR_WHEEL_BITS)
+
+// list of expired timers (following the slots of all levels)
+#define MINIMR_WHEEL_EXPIRED        (MINIMR_WHEEL_LEVELS * MINIMR_WHEEL_NSLOTS)
+
+/**
+ * Timer (doubly linked into the list of its slot)
+ */
+struct minimr_wheel_timer {
+    uint32_t deadline;
+    uint16_t next;
+    uint16_t prev;
+    uint16_t list;      // slot (or MINIMR_WHEEL_EXPIRED), MINIMR_WHEEL_NONE if not pending
+};
+
+/**
+ * Hierarchical timer wheel over a caller-provided array of timers (referred to by index, ex. the slot of a record in
+ * a pool): timers are added to and canceled from the slot of their (tick of) expiry in constant time, far timers are
+ * kept in slots of higher levels (of exponentially coarser ticks) and cascaded down as time passes.
+ *
+ * Time is given by the caller as (wrapping) msec timestamps, deadlines MUST be less than 2^31 msec ahead.
+ *
+ * Typical host loop:
+ *  - (re)arm timer:    minimr_wheel_add()
+ *  - timer (@see minimr_wheel_next_deadline()) expired: handle minimr_wheel_next() until it returns MINIMR_WHEEL_NONE
+ */
+struct minimr_wheel {
+    struct minimr_wheel_timer * timers;
+    uint16_t ntimers;
+
+    // number of timers in slots (ie not yet expired)
+    uint16_t npending;
+
+    // next tick to process
+    uint32_t tick;
+
+    // list heads of slots (per level) and expired timers
+    uint16_t lists[MINIMR_WHEEL_EXPIRED + 1];
+};
+
+/**
+ * Initializes wheel without pending timers
+ */
+void minimr_wheel_init(struct minimr_wheel * wheel, struct minimr_wheel_timer * timers, uint16_t ntimers, uint32_t now);
+
+/**
+ * Cancels all timers
+ */
+void minimr_wheel_clear(struct minimr_wheel * wheel);
+
+/**
+ * @return 1 if timer is pending (or expired but not yet handled)
+ */
+#define MINIMR_WHEEL_PENDING(__wheel__, __i__)  ((__wheel__)->timers[__i__].list != MINIMR_WHEEL_NONE)
+
+/**
+ * (Re)arms timer i
+ */
+void minimr_wheel_add(struct minimr_wheel * wheel, uint16_t i, uint32_t deadline);
+
+/**
+ * Cancels timer i (if pending)
+ */
+void minimr_wheel_cancel(struct minimr_wheel * wheel, uint16_t i);
+
+/**
+ * Gets the time the wheel has to be advanced next (a timer expires or timers are cascaded, to be passed to the
+ * host's timer)
+ * @return MINIMR_OK        if there are pending timers
+ * @return MINIMR_NOT_OK    if not
+ */
+uint8_t minimr_wheel_next_deadline(struct minimr_wheel * wheel, uint32_t * deadline);
+
+/**
+ * Advances wheel to now and takes the next expired timer (which is no longer pending)
+ * @return timer index or MINIMR_WHEEL_NONE if no (more) timer expired
+ */
+uint16_t minimr_wheel_next(struct minimr_wheel * wheel, uint32_t now);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //MINIMR_MINIMRWHEEL_H
@@ -0,0 +1,201 @@
+/**
+ * minimr - mini mDNS Responder (framework)
+ *
+ * https://github.com/tschiemer/minimr
+ *
+ * MIT License
+ *
+ * Copyright (c) 2020 Philip Tschiemer, filou.se
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/**
+ * Compares minimr_name_cmp() against the plain scalar implementation (both for equality of results and speed).
+ *
+ * Build (from this directory), ex:
+ *
+ *  cc -O2 -I. -I../.. ../../minimr.c namecmp-bench.c -o namecmp-bench
+ *  cc -O2 -mavx2 -I. -I../.. ../../minimr.c namecmp-bench.c -o namecmp-bench
+ *  cc -O2 -DMINIMR_NAME_CMP_SIMD=0 -I. -I../.. ../../minimr.c namecmp-bench.c -o namecmp-bench
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "minimr.h"
+
+#define NNAMES  8
+#define MSGLEN  512
+
+static const char * names[NNAMES] = {
+    ".here-be-kittens.local",
+    ".HERE-BE-KITTENS.local",
+    ".here-be-kittenz.local",
+    "._echo._udp.local",
+    "._services._dns-sd._udp.local",
+    ".Here be Kittens._echo._udp.local",
+    ".Here be Kittens (living room, 2nd floor)._echo._udp.local",
+    ".here be kittens (living room, 2nd floor)._echo._udp.local",
+};
+
+/**
+ * Copy of the scalar (byte-wise) implementation for reference
+ */
+static int32_t ref_name_cmp(uint8_t * uncompressed_name, uint16_t namepos, uint8_t * msg, uint16_t msglen)
+{
+    uint16_t len = 0;
+
+    uint8_t njumps = 0;
+
+    while (uncompressed_name[len] != '\0' && namepos < msglen && msg[namepos] != '\0'){
+
+        if ((msg[namepos] & MINIMR_DNS_COMPRESSED_NAME) == MINIMR_DNS_COMPRESSED_NAME){
+
+            uint16_t offset;
+
+            do {
+                if (namepos+1 >= msglen){
+                    return -1;
+                }
+
+                offset = ((msg[namepos] & MINIMR_DNS_COMPRESSED_NAME_OFFSET) << 8) | msg[namepos+1];
+
+                njumps++;
+
+                if (njumps > MINIMR_COMPRESSION_MAX_JUMPS){
+                    return -1;
+                }
+
+                namepos = offset;
+
+            } while ((msg[namepos] & MINIMR_DNS_COMPRESSED_NAME) == MINIMR_DNS_COMPRESSED_NAME);
+
+            continue;
+        }
+
+        uint8_t seglen = uncompressed_name[len];
+
+        for(uint8_t i = 0; i <= seglen && namepos < msglen; i++){
+            uint8_t lhs = uncompressed_name[len++];
+            uint8_t rhs = msg[namepos++];
+
+            #define LOWERCASE(c) ( ('A' <= (c) && (c) <= 'Z') ? ((c) - 'A' + 'a' ) : (c) )
+            lhs = LOWERCASE(lhs);
+            rhs = LOWERCASE(rhs);
+            #undef LOWERCASE
+
+            if (lhs < rhs) return -1;
+            if (lhs > rhs) return 1;
+        }
+    }
+
+    if (namepos >= msglen){
+        return 1;
+    }
+
+    if (uncompressed_name[len] == msg[namepos]) return 0;
+
+    if (uncompressed_name[len] == '\0') return -1;
+
+    return 1;
+}
+
+static double now()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static int sign(int32_t v)
+{
+    return (v > 0) - (v < 0);
+}
+
+int main(int argc, char * argv[])
+{
+    long iterations = argc > 1 ? atol(argv[1]) : 1000000;
+
+    uint8_t stored[NNAMES][256];
+    uint8_t msg[MSGLEN];
+    uint16_t msglen = MINIMR_DNS_HDR_SIZE;
+    uint16_t offsets[NNAMES];
+
+    struct minimr_name_dict dict;
+    minimr_name_dict_init(&dict);
+
+    memset(msg, 0, sizeof(msg));
+
+    // stored names (as is) and message with (compressed) names
+    for(int i = 0; i < NNAMES; i++){
+        uint16_t len;
+
+        strcpy((char*)stored[i], names[i]);
+        minimr_name_normalize(stored[i], &len);
+
+        offsets[i] = msglen;
+        minimr_name_write(msg, &msglen, sizeof(msg), stored[i], &dict);
+    }
+
+    // results must be identical
+    int errors = 0;
+    for(int i = 0; i < NNAMES; i++){
+        for(int j = 0; j < NNAMES; j++){
+            int32_t a = minimr_name_cmp(stored[i], offsets[j], msg, msglen);
+            int32_t b = ref_name_cmp(stored[i], offsets[j], msg, msglen);
+            if (sign(a) != sign(b)){
+                printf("MISMATCH %s vs %s: %d != %d\n", names[i], names[j], a, b);
+                errors++;
+            }
+        }
+    }
+
+    if (errors){
+        return EXIT_FAILURE;
+    }
+
+    volatile int32_t sink = 0;
+
+    double t0 = now();
+    for(long n = 0; n < iterations; n++){
+        for(int i = 0; i < NNAMES; i++){
+            for(int j = 0; j < NNAMES; j++){
+                sink += ref_name_cmp(stored[i], offsets[j], msg, msglen);
+            }
+        }
+    }
+    double t1 = now();
+    for(long n = 0; n < iterations; n++){
+        for(int i = 0; i < NNAMES; i++){
+            for(int j = 0; j < NNAMES; j++){
+                sink += minimr_name_cmp(stored[i], offsets[j], msg, msglen);
+            }
+        }
+    }
+    double t2 = now();
+
+    double ncmp = (double)iterations * NNAMES * NNAMES;
+
+    printf("scalar         %8.2f ns/cmp\n", (t1 - t0) * 1e9 / ncmp);
+    printf("minimr_name_cmp %7.2f ns/cmp\n", (t2 - t1) * 1e9 / ncmp);
+
+    return EXIT_SUCCESS;
+}